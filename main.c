@@ -20,11 +20,38 @@
  * DEALINGS IN THE SOFTWARE.
 */
 
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+//Winsock 2 must be included before anything includes "windows.h".
+#if defined(_WIN32)
+#include <winsock2.h>
+#endif
+
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 //If you want the quest item in the main room, uncomment the following line.
 //#define BORING_MODE
@@ -40,6 +67,9 @@
 
 #define CALCULATION_TRESHOLD 0.01f
 #define UPDATE_TIMEOUT_MS 30
+//The interval (in milliseconds) in which the GLUT thread checks for new 
+//render packets while the simulation runs on its own thread.
+#define RENDER_POLL_TIMEOUT_MS 2
 #define INFO_LOG_SIZE 512
 
 //In units/second, without any friction.
@@ -48,6 +78,8 @@
 //Applied once/update (in units/second).
 #define PLAYER_FRICTION 5.0f
 #define PLAYER_GRAVITY 0.08f
+//The radius of the player used for collisions with walls (in units).
+#define PLAYER_RADIUS 0.2f
 //Applied once/update (in degrees/second).
 #define ITEM_ROTATION_SPEED 45.0f
 
@@ -62,6 +94,28 @@
 #define DEFAULT_WINDOW_WIDTH 640
 #define DEFAULT_WINDOW_HEIGHT 480
 
+//Fields further away from the player than this (in units) will be faded out.
+#define FADE_DISTANCE 4.0f
+
+//The edge length of a (square) map chunk in fields. Must be an even number, so
+//that the maze generator can alternate between rooms and walls.
+#define CHUNK_SIZE 16
+//The amount of chunks around the chunk of the player (in each direction) which
+//are kept loaded. Must be smaller than CHUNK_CACHE_WIDTH / 2.
+#define CHUNK_VIEW_RADIUS 1
+//The chunk cache is a toroidal CHUNK_CACHE_WIDTH x CHUNK_CACHE_WIDTH grid.
+#define CHUNK_CACHE_WIDTH 8
+//The chunk cache keeps chunks of this many levels - the level of the player and
+//the levels right above and below.
+#define CHUNK_CACHE_LEVELS 3
+//The height of a level in units (a wall is exactly one unit high).
+#define LEVEL_HEIGHT 1.0f
+//In seconds.
+#define STREAMING_STATISTICS_INTERVAL 10.0
+//The time (in milliseconds) which may be spent on re-meshing changed chunks 
+//during one update - the remaining chunks are re-meshed in later updates.
+#define REMESH_BUDGET_MS 2.0
+
 //=============================================================================
 //  Commonly used utility and simple math functions used across the program.
 //=============================================================================
@@ -85,6 +139,860 @@ float Common_degToRad(float deg)
   return deg * (PI / 180.0f);
 }
 
+//Gets the current value of a monotonic high-resolution clock.
+//Returns the time in seconds since an unspecified (but fixed) point in time.
+double Common_getTimeSeconds(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+#endif
+}
+
+//Gets the amount of logical processors available to the application.
+//Returns at least 1.
+int Common_getProcessorCount(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return MAX(1, (int)systemInfo.dwNumberOfProcessors);
+#else
+  return MAX(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+}
+
+//Gets the amount of memory of the application which is currently resident
+//in physical memory (the working set).
+//Returns the size in bytes or 0 if it isn't available.
+size_t Common_getResidentMemory(void)
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+    sizeof(counters))) return 0;
+  return (size_t)counters.WorkingSetSize;
+#else
+  unsigned long totalPages = 0, residentPages = 0;
+  FILE *file = fopen("/proc/self/statm", "r");
+  if (file == NULL) return 0;
+  int valueCount = fscanf(file, "%lu %lu", &totalPages, &residentPages);
+  fclose(file);
+  if (valueCount != 2) return 0;
+  return (size_t)residentPages * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//Allocates memory and terminates the application if that fails.
+//size: The amount of bytes to allocate.
+//Returns a pointer to the (uninitialized) memory.
+void *Common_allocate(size_t size)
+{
+  void *memory = malloc(MAX(size, 1));
+  if (memory == NULL) Common_terminate("MEMORY_ALLOCATION",
+    "The system ran out of memory.");
+  return memory;
+}
+
+//=============================================================================
+// Threading: Thin wrappers around the thread primitives of the platform.
+//=============================================================================
+
+//Provides a handle to a thread started with "Thread_create".
+typedef struct
+{
+#if defined(_WIN32)
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+} Thread;
+
+//Provides a (non-recursive) mutual exclusion lock.
+//Use "Mutex_initialize" before using an instance.
+typedef struct
+{
+#if defined(_WIN32)
+  CRITICAL_SECTION handle;
+#else
+  pthread_mutex_t handle;
+#endif
+} Mutex;
+
+//Provides a condition variable, which is always used together with a Mutex.
+//Use "ConditionVariable_initialize" before using an instance.
+typedef struct
+{
+#if defined(_WIN32)
+  CONDITION_VARIABLE handle;
+#else
+  pthread_cond_t handle;
+#endif
+} ConditionVariable;
+
+//Contains the function and argument of a new thread until it was started.
+typedef struct
+{
+  void (*function)(void *);
+  void *argument;
+} ThreadStartInfo;
+
+//The entry point of every thread started with "Thread_create".
+#if defined(_WIN32)
+DWORD WINAPI Thread_run(LPVOID startInfoPointer)
+#else
+void *Thread_run(void *startInfoPointer)
+#endif
+{
+  ThreadStartInfo startInfo = *(ThreadStartInfo *)startInfoPointer;
+  free(startInfoPointer);
+  startInfo.function(startInfo.argument);
+  return 0;
+}
+
+//Starts a new thread.
+//function: The function which should be executed in the new thread.
+//argument: The argument which is passed to the function.
+//Terminates the application if the thread couldn't be created.
+Thread Thread_create(void (*function)(void *), void *argument)
+{
+  Thread thread;
+  ThreadStartInfo *startInfo =
+    (ThreadStartInfo *)Common_allocate(sizeof(ThreadStartInfo));
+  startInfo->function = function;
+  startInfo->argument = argument;
+
+#if defined(_WIN32)
+  thread.handle = CreateThread(NULL, 0, Thread_run, startInfo, 0, NULL);
+  if (thread.handle == NULL)
+#else
+  if (pthread_create(&thread.handle, NULL, Thread_run, startInfo) != 0)
+#endif
+    Common_terminate("THREADING", "A new thread couldn't be created.");
+
+  return thread;
+}
+
+//Blocks until a thread has finished and releases its resources.
+//self: A pointer to the thread.
+void Thread_join(Thread *self)
+{
+#if defined(_WIN32)
+  WaitForSingleObject(self->handle, INFINITE);
+  CloseHandle(self->handle);
+#else
+  pthread_join(self->handle, NULL);
+#endif
+}
+
+//Suspends the calling thread for (at least) the given time.
+//seconds: The time to sleep in seconds.
+void Thread_sleep(double seconds)
+{
+#if defined(_WIN32)
+  Sleep((DWORD)(seconds * 1000.0));
+#else
+  struct timespec duration;
+  duration.tv_sec = (time_t)seconds;
+  duration.tv_nsec = (long)((seconds - (double)duration.tv_sec) * 1e9);
+  nanosleep(&duration, NULL);
+#endif
+}
+
+//Initializes a Mutex instance.
+void Mutex_initialize(Mutex *self)
+{
+#if defined(_WIN32)
+  InitializeCriticalSection(&self->handle);
+#else
+  pthread_mutex_init(&self->handle, NULL);
+#endif
+}
+
+//Releases the resources of an (unlocked) Mutex instance.
+void Mutex_destroy(Mutex *self)
+{
+#if defined(_WIN32)
+  DeleteCriticalSection(&self->handle);
+#else
+  pthread_mutex_destroy(&self->handle);
+#endif
+}
+
+//Blocks until the mutex could be acquired by the calling thread.
+void Mutex_lock(Mutex *self)
+{
+#if defined(_WIN32)
+  EnterCriticalSection(&self->handle);
+#else
+  pthread_mutex_lock(&self->handle);
+#endif
+}
+
+//Releases a mutex previously acquired with "Mutex_lock".
+void Mutex_unlock(Mutex *self)
+{
+#if defined(_WIN32)
+  LeaveCriticalSection(&self->handle);
+#else
+  pthread_mutex_unlock(&self->handle);
+#endif
+}
+
+//Initializes a ConditionVariable instance.
+void ConditionVariable_initialize(ConditionVariable *self)
+{
+#if defined(_WIN32)
+  InitializeConditionVariable(&self->handle);
+#else
+  pthread_cond_init(&self->handle, NULL);
+#endif
+}
+
+//Releases the resources of a ConditionVariable instance.
+void ConditionVariable_destroy(ConditionVariable *self)
+{
+#if defined(_WIN32)
+  self;
+#else
+  pthread_cond_destroy(&self->handle);
+#endif
+}
+
+//Releases the mutex, waits until the condition variable is signalled and 
+//acquires the mutex again. Spurious wakeups are possible, so the awaited 
+//condition must always be checked again afterwards.
+//self: A pointer to the condition variable.
+//mutex: A pointer to the (currently locked) mutex.
+void ConditionVariable_wait(ConditionVariable *self, Mutex *mutex)
+{
+#if defined(_WIN32)
+  SleepConditionVariableCS(&self->handle, &mutex->handle, INFINITE);
+#else
+  pthread_cond_wait(&self->handle, &mutex->handle);
+#endif
+}
+
+//Wakes up (at least) one thread waiting on the condition variable.
+void ConditionVariable_signal(ConditionVariable *self)
+{
+#if defined(_WIN32)
+  WakeConditionVariable(&self->handle);
+#else
+  pthread_cond_signal(&self->handle);
+#endif
+}
+
+//Wakes up all threads waiting on the condition variable.
+void ConditionVariable_broadcast(ConditionVariable *self)
+{
+#if defined(_WIN32)
+  WakeAllConditionVariable(&self->handle);
+#else
+  pthread_cond_broadcast(&self->handle);
+#endif
+}
+
+//=============================================================================
+// WorkerPool: A fixed set of background threads processing queued tasks.
+//=============================================================================
+
+//Declares a variable with a separate instance for every thread.
+#if defined(_WIN32)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+//The initial capacity of the task queue of every thread.
+#define WORKER_POOL_QUEUE_CAPACITY 64
+//The amount of tasks "WorkerPool_parallelFor" splits its indicies into for
+//every thread (more tasks balance the load better, but add more overhead).
+#define WORKER_POOL_TASKS_PER_THREAD 4
+
+//Defines the signature of a function which can be queued in a WorkerPool.
+typedef void (*WorkerPoolTaskFunction)(void *data);
+
+//Counts the unfinished tasks of a group of tasks (see "WorkerPool_wait").
+//Optionally, a task can be submitted as soon as the count drops to 0 (see 
+//"WorkerPool_submitAfter"), so that tasks can depend on other tasks.
+//Use "WorkerPoolCounter_initialize" before using an instance.
+typedef struct WorkerPoolCounter
+{
+  int count;
+  WorkerPoolTaskFunction continuation;
+  void *continuationData;
+  struct WorkerPoolCounter *continuationCounter;
+} WorkerPoolCounter;
+
+typedef struct
+{
+  WorkerPoolTaskFunction function;
+  void *data;
+  WorkerPoolCounter *counter;
+} WorkerPoolTask;
+
+//Contains the statistics of a thread since the last reset of the pool 
+//statistics (see "WorkerPool_printStatistics").
+typedef struct
+{
+  double busySeconds;
+  int executedTaskCount;
+  //The amount of tasks the thread took from the queues of other workers.
+  int stolenTaskCount;
+} WorkerPoolStatistics;
+
+struct WorkerPool;
+
+//Provides the task queue of a worker thread (or of all threads which aren't 
+//part of the pool). The owner takes tasks from the back (so that it works on
+//the most recent tasks, which are likely still in the cache), while idle 
+//workers steal tasks from the front.
+typedef struct
+{
+  struct WorkerPool *pool;
+  int index;
+
+  Mutex mutex;
+  //A ring buffer of queued tasks, which grows when it's full.
+  WorkerPoolTask *tasks;
+  int taskCapacity, taskHead, taskCount;
+
+  //Only accessed while the mutex of the pool is locked.
+  WorkerPoolStatistics statistics;
+} WorkerPoolQueue;
+
+//Provides a pool of worker threads which process tasks with work stealing: 
+//every worker has its own task queue and takes tasks from the other queues 
+//when its own queue is empty. Tasks submitted by other threads (like the main
+//thread) are queued in one additional, shared queue.
+//As the worker threads keep a pointer to the pool, instances can't be copied 
+//and need to be initialized in place with "WorkerPool_initialize".
+typedef struct WorkerPool
+{
+  Thread *threads;
+  int threadCount;
+  //One queue for every worker thread, followed by the shared queue.
+  WorkerPoolQueue *queues;
+
+  Mutex mutex;
+  ConditionVariable taskAvailable;
+  ConditionVariable counterChanged;
+
+  //The amount of tasks in all queues. As this is updated after the queues, it
+  //can be off by a few tasks (and even be negative) for a short time.
+  int queuedTaskCount;
+  double statisticsStartTime;
+
+  bool isShuttingDown;
+} WorkerPool;
+
+//The queue of the worker thread the calling thread is, or NULL if the calling
+//thread isn't a worker thread.
+THREAD_LOCAL WorkerPoolQueue *currentWorkerPoolQueue = NULL;
+//The amount of tasks the calling thread is currently executing (which is 
+//more than 1 while a task waits for other tasks).
+THREAD_LOCAL int workerPoolTaskDepth = 0;
+//The time the calling thread spent blocked in "WorkerPool_wait" in total.
+THREAD_LOCAL double workerPoolBlockedSeconds = 0;
+
+//Initializes a WorkerPoolCounter instance with a count of 0.
+void WorkerPoolCounter_initialize(WorkerPoolCounter *self)
+{
+  self->count = 0;
+  self->continuation = NULL;
+  self->continuationData = NULL;
+  self->continuationCounter = NULL;
+}
+
+//Gets the queue new tasks of the calling thread are added to.
+//self: A pointer to the pool.
+WorkerPoolQueue *WorkerPool_getQueue(WorkerPool *self)
+{
+  if (currentWorkerPoolQueue != NULL && currentWorkerPoolQueue->pool == self)
+    return currentWorkerPoolQueue;
+  else return &self->queues[self->threadCount];
+}
+
+//Adds a task to the back of a queue without waking up any worker threads.
+//self: A pointer to the pool.
+//queue: A pointer to the target queue.
+//task: The task to add.
+void WorkerPool_pushTask(WorkerPool *self, WorkerPoolQueue *queue,
+  WorkerPoolTask task)
+{
+  Mutex_lock(&queue->mutex);
+  if (queue->taskCount == queue->taskCapacity)
+  {
+    //Unroll the ring buffer into a bigger buffer.
+    int newCapacity = queue->taskCapacity * 2;
+    WorkerPoolTask *newTasks = (WorkerPoolTask *)Common_allocate(
+      sizeof(WorkerPoolTask) * newCapacity);
+    for (int i = 0; i < queue->taskCount; i++)
+      newTasks[i] = queue->tasks[(queue->taskHead + i) % queue->taskCapacity];
+    free(queue->tasks);
+    queue->tasks = newTasks;
+    queue->taskCapacity = newCapacity;
+    queue->taskHead = 0;
+  }
+  queue->tasks[(queue->taskHead + queue->taskCount) % queue->taskCapacity] =
+    task;
+  queue->taskCount++;
+  Mutex_unlock(&queue->mutex);
+
+  Mutex_lock(&self->mutex);
+  self->queuedTaskCount++;
+  Mutex_unlock(&self->mutex);
+}
+
+//Wakes up idle worker threads (and threads waiting for a counter).
+//self: A pointer to the pool.
+//taskCount: The amount of tasks which were added.
+void WorkerPool_notify(WorkerPool *self, int taskCount)
+{
+  Mutex_lock(&self->mutex);
+  if (taskCount == 1) ConditionVariable_signal(&self->taskAvailable);
+  else ConditionVariable_broadcast(&self->taskAvailable);
+  ConditionVariable_broadcast(&self->counterChanged);
+  Mutex_unlock(&self->mutex);
+}
+
+//Removes a task from the front or the back of a queue.
+//queue: A pointer to the queue.
+//fromBack: true to take the most recent task, false to take the oldest one.
+//onlyCounted: true to only take tasks which belong to a counter.
+//task: A pointer to store the task.
+//Returns true if a task was taken, false if there was no matching task.
+bool WorkerPool_popTask(WorkerPoolQueue *queue, bool fromBack,
+  bool onlyCounted, WorkerPoolTask *task)
+{
+  bool wasTaken = false;
+
+  Mutex_lock(&queue->mutex);
+  if (queue->taskCount > 0)
+  {
+    int index = fromBack ?
+      (queue->taskHead + queue->taskCount - 1) % queue->taskCapacity :
+      queue->taskHead;
+    if (!onlyCounted || queue->tasks[index].counter != NULL)
+    {
+      *task = queue->tasks[index];
+      if (!fromBack)
+        queue->taskHead = (queue->taskHead + 1) % queue->taskCapacity;
+      queue->taskCount--;
+      wasTaken = true;
+    }
+  }
+  Mutex_unlock(&queue->mutex);
+
+  return wasTaken;
+}
+
+//Takes the next task for a thread: from the back of its own queue or, if that
+//is empty, from the front of the other queues.
+//self: A pointer to the pool.
+//queue: A pointer to the queue of the thread.
+//onlyCounted: true to only take tasks which belong to a counter.
+//task: A pointer to store the task.
+//wasStolen: A pointer to store whether the task was stolen from the queue of
+//another worker thread.
+//Returns true if a task was taken, false if there was no matching task.
+bool WorkerPool_takeTask(WorkerPool *self, WorkerPoolQueue *queue,
+  bool onlyCounted, WorkerPoolTask *task, bool *wasStolen)
+{
+  int queueCount = self->threadCount + 1;
+  bool wasTaken = WorkerPool_popTask(queue, true, onlyCounted, task);
+  *wasStolen = false;
+
+  for (int i = 1; i < queueCount && !wasTaken; i++)
+  {
+    WorkerPoolQueue *victim = &self->queues[(queue->index + i) % queueCount];
+    wasTaken = WorkerPool_popTask(victim, false, onlyCounted, task);
+    *wasStolen = wasTaken && victim->index < self->threadCount;
+  }
+
+  if (wasTaken)
+  {
+    Mutex_lock(&self->mutex);
+    self->queuedTaskCount--;
+    Mutex_unlock(&self->mutex);
+  }
+
+  return wasTaken;
+}
+
+//Executes a task, updates the statistics of the executing thread and the 
+//counter of the task (and submits the continuation of the counter when all
+//tasks of the counter are finished).
+//self: A pointer to the pool.
+//queue: A pointer to the queue of the executing thread.
+//task: The task to execute.
+//wasStolen: true if the task was stolen from the queue of another worker.
+void WorkerPool_executeTask(WorkerPool *self, WorkerPoolQueue *queue,
+  WorkerPoolTask task, bool wasStolen)
+{
+  //The busy time of nested tasks is already part of the outermost task, but
+  //the time it was blocked waiting for other tasks isn't.
+  double startTime = Common_getTimeSeconds();
+  double blockedSeconds = workerPoolBlockedSeconds;
+  workerPoolTaskDepth++;
+  task.function(task.data);
+  workerPoolTaskDepth--;
+  double busySeconds = workerPoolTaskDepth > 0 ? 0.0 :
+    Common_getTimeSeconds() - startTime -
+    (workerPoolBlockedSeconds - blockedSeconds);
+
+  WorkerPoolTask continuation;
+  continuation.function = NULL;
+
+  Mutex_lock(&self->mutex);
+  queue->statistics.busySeconds += busySeconds;
+  queue->statistics.executedTaskCount++;
+  if (wasStolen) queue->statistics.stolenTaskCount++;
+
+  //A counter usually lives on the stack of the thread waiting for it - it 
+  //must not be accessed after it reached 0 and the mutex was unlocked.
+  if (task.counter != NULL && --task.counter->count == 0)
+  {
+    continuation.function = task.counter->continuation;
+    continuation.data = task.counter->continuationData;
+    continuation.counter = task.counter->continuationCounter;
+    ConditionVariable_broadcast(&self->counterChanged);
+  }
+  Mutex_unlock(&self->mutex);
+
+  if (continuation.function != NULL)
+  {
+    WorkerPool_pushTask(self, queue, continuation);
+    WorkerPool_notify(self, 1);
+  }
+}
+
+//The main loop of a worker thread, which runs until the pool is destroyed.
+//queuePointer: A pointer to the WorkerPoolQueue of the worker.
+void WorkerPool_runWorker(void *queuePointer)
+{
+  WorkerPoolQueue *queue = (WorkerPoolQueue *)queuePointer;
+  WorkerPool *self = queue->pool;
+  currentWorkerPoolQueue = queue;
+
+  while (true)
+  {
+    WorkerPoolTask task;
+    bool wasStolen;
+    if (WorkerPool_takeTask(self, queue, false, &task, &wasStolen))
+    {
+      WorkerPool_executeTask(self, queue, task, wasStolen);
+      continue;
+    }
+
+    Mutex_lock(&self->mutex);
+    while (self->queuedTaskCount <= 0 && !self->isShuttingDown)
+      ConditionVariable_wait(&self->taskAvailable, &self->mutex);
+    bool isFinished = self->queuedTaskCount <= 0;
+    Mutex_unlock(&self->mutex);
+    if (isFinished) break;
+  }
+}
+
+//Initializes a WorkerPool instance and starts its worker threads.
+//self: A pointer to the (uninitialized) pool.
+//threadCount: The amount of worker threads (at least 1).
+void WorkerPool_initialize(WorkerPool *self, int threadCount)
+{
+  self->threadCount = MAX(1, threadCount);
+  self->queuedTaskCount = 0;
+  self->statisticsStartTime = Common_getTimeSeconds();
+  self->isShuttingDown = false;
+  Mutex_initialize(&self->mutex);
+  ConditionVariable_initialize(&self->taskAvailable);
+  ConditionVariable_initialize(&self->counterChanged);
+
+  self->queues = (WorkerPoolQueue *)Common_allocate(
+    sizeof(WorkerPoolQueue) * (self->threadCount + 1));
+  for (int i = 0; i <= self->threadCount; i++)
+  {
+    WorkerPoolQueue *queue = &self->queues[i];
+    queue->pool = self;
+    queue->index = i;
+    Mutex_initialize(&queue->mutex);
+    queue->taskCapacity = WORKER_POOL_QUEUE_CAPACITY;
+    queue->taskHead = 0;
+    queue->taskCount = 0;
+    queue->tasks = (WorkerPoolTask *)Common_allocate(
+      sizeof(WorkerPoolTask) * queue->taskCapacity);
+    memset(&queue->statistics, 0, sizeof(WorkerPoolStatistics));
+  }
+
+  self->threads = (Thread *)Common_allocate(sizeof(Thread) * self->threadCount);
+  for (int i = 0; i < self->threadCount; i++)
+    self->threads[i] = Thread_create(WorkerPool_runWorker, &self->queues[i]);
+}
+
+//Queues a new task, which will be executed by one of the worker threads.
+//self: A pointer to the pool.
+//function: The function to execute.
+//data: The argument for the function.
+void WorkerPool_submit(WorkerPool *self, WorkerPoolTaskFunction function,
+  void *data)
+{
+  WorkerPoolTask task;
+  task.function = function;
+  task.data = data;
+  task.counter = NULL;
+  WorkerPool_pushTask(self, WorkerPool_getQueue(self), task);
+  WorkerPool_notify(self, 1);
+}
+
+//Queues a new task which belongs to a counter. The count of the counter is 
+//increased now and decreased again when the task has finished.
+//self: A pointer to the pool.
+//function: The function to execute.
+//data: The argument for the function.
+//counter: A pointer to the counter, which must stay valid until its count 
+//dropped to 0 again (see "WorkerPool_wait").
+void WorkerPool_submitCounted(WorkerPool *self,
+  WorkerPoolTaskFunction function, void *data, WorkerPoolCounter *counter)
+{
+  WorkerPoolTask task;
+  task.function = function;
+  task.data = data;
+  task.counter = counter;
+
+  Mutex_lock(&self->mutex);
+  counter->count++;
+  Mutex_unlock(&self->mutex);
+
+  WorkerPool_pushTask(self, WorkerPool_getQueue(self), task);
+  WorkerPool_notify(self, 1);
+}
+
+//Queues a task as soon as all tasks of a counter have finished (or right 
+//away, if the counter is already at 0). Every counter can only have one such
+//continuation - further continuations can be chained with another counter.
+//self: A pointer to the pool.
+//counter: A pointer to the counter which needs to drop to 0 first.
+//function: The function to execute.
+//data: The argument for the function.
+//continuationCounter: A pointer to the counter the continuation belongs to
+//(which is increased right away), or NULL.
+void WorkerPool_submitAfter(WorkerPool *self, WorkerPoolCounter *counter,
+  WorkerPoolTaskFunction function, void *data,
+  WorkerPoolCounter *continuationCounter)
+{
+  Mutex_lock(&self->mutex);
+  if (counter->continuation != NULL)
+  {
+    Mutex_unlock(&self->mutex);
+    Common_terminate("THREADING", "A counter can only have one continuation.");
+  }
+  if (continuationCounter != NULL) continuationCounter->count++;
+  bool isFinished = counter->count == 0;
+  if (!isFinished)
+  {
+    counter->continuation = function;
+    counter->continuationData = data;
+    counter->continuationCounter = continuationCounter;
+  }
+  Mutex_unlock(&self->mutex);
+
+  if (isFinished)
+  {
+    WorkerPoolTask task;
+    task.function = function;
+    task.data = data;
+    task.counter = continuationCounter;
+    WorkerPool_pushTask(self, WorkerPool_getQueue(self), task);
+    WorkerPool_notify(self, 1);
+  }
+}
+
+//Blocks until all tasks of a counter have finished. Meanwhile, the calling 
+//thread executes queued tasks which belong to a counter (of this or another
+//wait) itself, so this can also be called from a worker thread (like from 
+//within a task).
+//self: A pointer to the pool.
+//counter: A pointer to the counter.
+void WorkerPool_wait(WorkerPool *self, WorkerPoolCounter *counter)
+{
+  WorkerPoolQueue *queue = WorkerPool_getQueue(self);
+
+  while (true)
+  {
+    //Only tasks which belong to a counter are taken, so that waiting is never
+    //delayed by a long task which nobody waits for (like generating a chunk).
+    WorkerPoolTask task;
+    bool wasStolen;
+    Mutex_lock(&self->mutex);
+    bool isFinished = counter->count == 0;
+    Mutex_unlock(&self->mutex);
+    if (isFinished) break;
+    if (WorkerPool_takeTask(self, queue, true, &task, &wasStolen))
+    {
+      WorkerPool_executeTask(self, queue, task, wasStolen);
+      continue;
+    }
+
+    double startTime = Common_getTimeSeconds();
+    Mutex_lock(&self->mutex);
+    if (counter->count > 0)
+      ConditionVariable_wait(&self->counterChanged, &self->mutex);
+    Mutex_unlock(&self->mutex);
+    workerPoolBlockedSeconds += Common_getTimeSeconds() - startTime;
+  }
+}
+
+//Finishes all queued tasks, stops the worker threads and frees the resources 
+//of the pool.
+//self: A pointer to the pool.
+//Does nothing if NULL is provided or the pool has no threads.
+void WorkerPool_destroy(WorkerPool *self)
+{
+  if (self == NULL || self->threads == NULL) return;
+
+  Mutex_lock(&self->mutex);
+  self->isShuttingDown = true;
+  ConditionVariable_broadcast(&self->taskAvailable);
+  Mutex_unlock(&self->mutex);
+
+  for (int i = 0; i < self->threadCount; i++) Thread_join(&self->threads[i]);
+
+  for (int i = 0; i <= self->threadCount; i++)
+  {
+    free(self->queues[i].tasks);
+    Mutex_destroy(&self->queues[i].mutex);
+  }
+  free(self->threads);
+  free(self->queues);
+  self->threads = NULL;
+  self->queues = NULL;
+  Mutex_destroy(&self->mutex);
+  ConditionVariable_destroy(&self->taskAvailable);
+  ConditionVariable_destroy(&self->counterChanged);
+}
+
+//Copies the statistics of all threads since the last reset.
+//self: A pointer to the pool.
+//statistics: The target for the statistics of every worker thread, followed
+//by the statistics of all other threads (threadCount + 1 elements), or NULL.
+//reset: true to reset the statistics afterwards.
+//Returns the amount of seconds since the last reset.
+double WorkerPool_getStatistics(WorkerPool *self,
+  WorkerPoolStatistics *statistics, bool reset)
+{
+  Mutex_lock(&self->mutex);
+  double currentTime = Common_getTimeSeconds();
+  double elapsedSeconds = currentTime - self->statisticsStartTime;
+  for (int i = 0; i <= self->threadCount; i++)
+  {
+    if (statistics != NULL) statistics[i] = self->queues[i].statistics;
+    if (reset)
+      memset(&self->queues[i].statistics, 0, sizeof(WorkerPoolStatistics));
+  }
+  if (reset) self->statisticsStartTime = currentTime;
+  Mutex_unlock(&self->mutex);
+
+  return elapsedSeconds;
+}
+
+//Prints the utilization (the share of the time spent executing tasks) and
+//the amount of executed and stolen tasks of every thread since the last reset
+//and resets the statistics.
+//self: A pointer to the pool.
+void WorkerPool_printStatistics(WorkerPool *self)
+{
+  WorkerPoolStatistics *statistics = (WorkerPoolStatistics *)Common_allocate(
+    sizeof(WorkerPoolStatistics) * (self->threadCount + 1));
+  double elapsedSeconds = WorkerPool_getStatistics(self, statistics, true);
+
+  for (int i = 0; i <= self->threadCount; i++)
+  {
+    if (i < self->threadCount) printf("Worker %d: ", i + 1);
+    else printf("Other threads: ");
+    printf("%.1f%% utilization, %d tasks (%d stolen).\n", elapsedSeconds > 0 ?
+      statistics[i].busySeconds * 100.0 / elapsedSeconds : 0.0,
+      statistics[i].executedTaskCount, statistics[i].stolenTaskCount);
+  }
+
+  free(statistics);
+}
+
+//Defines the signature of a function which is executed for every index of a
+//"WorkerPool_parallelFor" call.
+typedef void (*WorkerPoolForFunction)(void *data, int index);
+
+//Contains a range of indicies of a "WorkerPool_parallelFor" call.
+typedef struct
+{
+  WorkerPoolForFunction function;
+  void *data;
+  int firstIndex, lastIndex;
+} WorkerPoolForRange;
+
+//The task submitted by "WorkerPool_parallelFor" for every range of indicies.
+//rangePointer: A pointer to the WorkerPoolForRange.
+void WorkerPool_runForRange(void *rangePointer)
+{
+  WorkerPoolForRange *range = (WorkerPoolForRange *)rangePointer;
+  for (int i = range->firstIndex; i <= range->lastIndex; i++)
+    range->function(range->data, i);
+}
+
+//Executes a function for every index in [0, count) on the worker threads and
+//the calling thread and blocks until all indicies were processed. The order
+//in which the indicies are processed is undefined.
+//The indicies are split into ranges, which are processed as separate tasks -
+//so this can also be called from within another task (or another
+//"WorkerPool_parallelFor" call), where idle workers steal these ranges.
+//self: A pointer to the pool.
+//count: The amount of indicies.
+//function: The function to execute for every index.
+//data: The first argument for the function.
+void WorkerPool_parallelFor(WorkerPool *self, int count,
+  WorkerPoolForFunction function, void *data)
+{
+  if (count <= 0) return;
+
+  int rangeCount = MIN(count,
+    (self->threadCount + 1) * WORKER_POOL_TASKS_PER_THREAD);
+  WorkerPoolForRange *ranges = (WorkerPoolForRange *)Common_allocate(
+    sizeof(WorkerPoolForRange) * rangeCount);
+  WorkerPoolQueue *queue = WorkerPool_getQueue(self);
+  WorkerPoolCounter counter;
+  WorkerPoolCounter_initialize(&counter);
+  counter.count = rangeCount;
+
+  for (int i = 0; i < rangeCount; i++)
+  {
+    ranges[i].function = function;
+    ranges[i].data = data;
+    ranges[i].firstIndex = (int)((int64_t)count * i / rangeCount);
+    ranges[i].lastIndex = (int)((int64_t)count * (i + 1) / rangeCount) - 1;
+  }
+
+  //The ranges are queued in reverse order, so that the calling thread (which
+  //takes the most recent task) starts with the first indicies.
+  for (int i = rangeCount - 1; i >= 0; i--)
+  {
+    WorkerPoolTask task;
+    task.function = WorkerPool_runForRange;
+    task.data = &ranges[i];
+    task.counter = &counter;
+    WorkerPool_pushTask(self, queue, task);
+  }
+
+  WorkerPool_notify(self, rangeCount);
+  WorkerPool_wait(self, &counter);
+
+  free(ranges);
+}
+
 //=============================================================================
 // Matrix4x4: Matrix4x4 struct and basic calculations with matrices.
 //=============================================================================
@@ -249,6 +1157,8 @@ typedef struct
 
   GLint attribLocation_position;
   GLint attribLocation_color;
+  //The per-instance attribute (only available in the instancing shader).
+  GLint attribLocation_instance;
 
   GLint uniformLocation_model;
   GLint uniformLocation_view;
@@ -257,6 +1167,9 @@ typedef struct
   GLint uniformLocation_opacity;
   GLint uniformLocation_currentTimeMs;
   GLint uniformLocation_brightness;
+  GLint uniformLocation_viewerPosition;
+  GLint uniformLocation_fadeDistance;
+  GLint uniformLocation_instanceScale;
 } ShaderProgram;
 
 const char *ShaderProgram_DefaultVertexShaderSourceCode =
@@ -269,32 +1182,70 @@ const char *ShaderProgram_DefaultVertexShaderSourceCode =
 "attribute vec3 color;\n"
 "varying vec3 vertexColor;\n"
 "varying vec3 fragmentPosition;\n"
+"varying vec3 worldPosition;\n"
 "\n"
 "void main()\n"
 "{\n"
-"   gl_Position = projection * view * model * vec4(position, 1.0f);\n"
+"   vec4 modelPosition = model * vec4(position, 1.0f);\n"
+"   gl_Position = projection * view * modelPosition;\n"
 "   fragmentPosition = position;\n"
+"   worldPosition = modelPosition.xyz;\n"
 "   vertexColor = color;\n"
 "}\n";
 
-const char *ShaderProgram_DefaultFragmentShaderSourceCode =
+//The vertex shader for instanced meshes - every instance is placed at the
+//XYZ coordinates of its instance attribute, rotated around the Y axis by its
+//W coordinate (in radians) and scaled by the instanceScale.
+const char *ShaderProgram_InstancedVertexShaderSourceCode =
 "#version 120\n"
+"uniform mat4 view;\n"
+"uniform mat4 projection;\n"
+"uniform float instanceScale = 1;\n"
 "\n"
-"const float INTENSITY = 0.15;\n"
-"const float LINE_THICCNESS = 5;\n"//this code gonna be thicc even thiccer soon
+"attribute vec3 position;\n"
+"attribute vec3 color;\n"
+"attribute vec4 instance;\n"
+"varying vec3 vertexColor;\n"
+"varying vec3 fragmentPosition;\n"
+"varying vec3 worldPosition;\n"
+"\n"
+"void main()\n"
+"{\n"
+"   vec3 scaled = position * instanceScale;\n"
+"   float s = sin(instance.w), c = cos(instance.w);\n"
+"   vec4 modelPosition = vec4(c * scaled.x + s * scaled.z, scaled.y,\n"
+"     c * scaled.z - s * scaled.x, 1.0) + vec4(instance.xyz, 0.0);\n"
+"   gl_Position = projection * view * modelPosition;\n"
+"   fragmentPosition = position;\n"
+"   worldPosition = modelPosition.xyz;\n"
+"   vertexColor = color;\n"
+"}\n";
+
+const char *ShaderProgram_DefaultFragmentShaderSourceCode =
+"#version 120\n"
+"\n"
+"const float INTENSITY = 0.15;\n"
+"const float LINE_THICCNESS = 5;\n"//this code gonna be thicc even thiccer soon
 "\n"
 "uniform float screenHeight;\n"
 "uniform float currentTimeMs;\n"
 "uniform float opacity = 1;\n"
 "uniform float brightness = 1;\n"
+"uniform vec3 viewerPosition;\n"
+"uniform float fadeDistance = 0;\n"//0 disables the distance fade
 "varying vec3 vertexColor;\n"
+"varying vec3 worldPosition;\n"
 "\n"
 "void main()\n"
 "{\n"
 "   float screenY = (gl_FragCoord.y + currentTimeMs) / screenHeight;\n"
 "   float scanLine = 1.0 - INTENSITY * \n"
 "     mod(screenY * screenHeight/LINE_THICCNESS, 1.0);\n"
-"   gl_FragColor = vec4(vertexColor.rgb * scanLine * brightness, opacity);\n"
+"   float distanceOpacity = fadeDistance > 0.0 ? 1.0 - clamp(\n"
+"     distance(worldPosition.xz, viewerPosition.xz) - fadeDistance, 0.0, 1.0)\n"
+"     : 1.0;\n"
+"   gl_FragColor = vec4(vertexColor.rgb * scanLine * brightness,\n"
+"     opacity * distanceOpacity);\n"
 "}\n";
 
 //Initializes (generates, compiles and links) a new ShaderProgram instance.
@@ -365,6 +1316,8 @@ ShaderProgram ShaderProgram_create(const char *vertexShaderSourceCode,
     newShaderProgram.handle, "position");
   newShaderProgram.attribLocation_color = glGetAttribLocation(
     newShaderProgram.handle, "color");
+  newShaderProgram.attribLocation_instance = glGetAttribLocation(
+    newShaderProgram.handle, "instance");
 
   newShaderProgram.uniformLocation_model = glGetUniformLocation(
     newShaderProgram.handle, "model");
@@ -380,6 +1333,12 @@ ShaderProgram ShaderProgram_create(const char *vertexShaderSourceCode,
     newShaderProgram.handle, "currentTimeMs");
   newShaderProgram.uniformLocation_brightness = glGetUniformLocation(
     newShaderProgram.handle, "brightness");
+  newShaderProgram.uniformLocation_viewerPosition = glGetUniformLocation(
+    newShaderProgram.handle, "viewerPosition");
+  newShaderProgram.uniformLocation_fadeDistance = glGetUniformLocation(
+    newShaderProgram.handle, "fadeDistance");
+  newShaderProgram.uniformLocation_instanceScale = glGetUniformLocation(
+    newShaderProgram.handle, "instanceScale");
 
   return newShaderProgram;
 }
@@ -406,6 +1365,17 @@ ShaderProgram ShaderProgram_createDefault(bool makeCurrent)
     ShaderProgram_DefaultFragmentShaderSourceCode, makeCurrent);
 }
 
+//Initializes (generates, compiles and links) a new ShaderProgram instance for
+//instanced meshes (see "BufferedMesh_drawInstanced").
+//makeCurrent: true to use the new program as current program, false not to.
+//Returns a new ShaderProgram instance.
+//Terminates the program if compiling the shader or linking the program fails.
+ShaderProgram ShaderProgram_createInstanced(bool makeCurrent)
+{
+  return ShaderProgram_create(ShaderProgram_InstancedVertexShaderSourceCode,
+    ShaderProgram_DefaultFragmentShaderSourceCode, makeCurrent);
+}
+
 //Sets a 4-dimensional matrix value on the shader program.
 //uniformLocation: The location of the uniform (of type "mat4").
 //matrix: A pointer to the matrix value which should be uploaded to the shader.
@@ -424,6 +1394,17 @@ void ShaderProgram_setUniformValue_float(GLint uniformLocation,
   glUniform1f(uniformLocation, value);
 }
 
+//Sets a 3-dimensional vector value on the shader program.
+//uniformLocation: The location of the uniform (of type "vec3").
+//x: The X component of the vector.
+//y: The Y component of the vector.
+//z: The Z component of the vector.
+void ShaderProgram_setUniformValue_vec3(GLint uniformLocation,
+  const float x, const float y, const float z)
+{
+  glUniform3f(uniformLocation, x, y, z);
+}
+
 //=============================================================================
 // BufferedMesh: BufferedMesh and associated functions.
 //=============================================================================
@@ -434,6 +1415,12 @@ typedef struct
   GLuint bufferHandle;
   GLuint vaoHandle;
   unsigned int vertexCount;
+  //The amount of vertices the buffer on the GPU has room for.
+  unsigned int vertexCapacity;
+  //The buffer with the instance attributes (4 floats per instance), which is
+  //only created for instanced meshes.
+  GLuint instanceBufferHandle;
+  unsigned int instanceCount, instanceCapacity;
 } BufferedMesh;
 
 //Initializes a new BufferedMesh instance.
@@ -447,6 +1434,10 @@ BufferedMesh BufferedMesh_create(const float *vertexData,
   BufferedMesh bufferedMesh;
 
   bufferedMesh.vertexCount = arrayLength / FLOATS_PER_VERTEX;
+  bufferedMesh.vertexCapacity = bufferedMesh.vertexCount;
+  bufferedMesh.instanceBufferHandle = 0;
+  bufferedMesh.instanceCount = 0;
+  bufferedMesh.instanceCapacity = 0;
   if (arrayLength % FLOATS_PER_VERTEX != 0)
     Common_terminate("BUFFEREDMESH_CREATION", "Invalid vertex data length - "
       "must be divisable by the amount of floats per vertex.");
@@ -489,10 +1480,97 @@ void BufferedMesh_destroy(BufferedMesh *self)
 
   glDeleteVertexArrays(1, &(self->vaoHandle));
   glDeleteBuffers(1, &(self->bufferHandle));
+  if (self->instanceBufferHandle != 0)
+    glDeleteBuffers(1, &(self->instanceBufferHandle));
 
   self->vaoHandle = 0;
   self->bufferHandle = 0;
+  self->instanceBufferHandle = 0;
   self->vertexCount = 0;
+  self->vertexCapacity = 0;
+  self->instanceCount = 0;
+  self->instanceCapacity = 0;
+}
+
+//Replaces the vertex data of a BufferedMesh. If the new data fits into the 
+//existing buffer, it's only updated - otherwise, a bigger buffer is allocated
+//(with some headroom, as meshes which change once usually change again).
+//self: A pointer to the buffered mesh.
+//vertexData: A pointer to vertex data with vertices in the format XYZRGB.
+//arrayLength: The amount of float elements in vertexData.
+//Terminates the program when the arrayLength is not divisible by 6.
+void BufferedMesh_update(BufferedMesh *self, const float *vertexData,
+  const int arrayLength)
+{
+  if (arrayLength % FLOATS_PER_VERTEX != 0)
+    Common_terminate("BUFFEREDMESH_UPDATE", "Invalid vertex data length - "
+      "must be divisable by the amount of floats per vertex.");
+
+  self->vertexCount = arrayLength / FLOATS_PER_VERTEX;
+
+  glBindBuffer(GL_ARRAY_BUFFER, self->bufferHandle);
+
+  if (self->vertexCount > self->vertexCapacity)
+  {
+    self->vertexCapacity = self->vertexCount + self->vertexCount / 4;
+    glBufferData(GL_ARRAY_BUFFER,
+      sizeof(float) * FLOATS_PER_VERTEX * self->vertexCapacity, NULL,
+      GL_DYNAMIC_DRAW);
+  }
+
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * arrayLength, vertexData);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//Replaces the instance attributes of a BufferedMesh, which is drawn once per
+//instance by "BufferedMesh_drawInstanced" then. The instance buffer is 
+//created on the first call and grows like the vertex buffer.
+//self: A pointer to the buffered mesh.
+//instanceData: A pointer to 4 floats per instance (see the instanced shader).
+//instanceCount: The amount of instances.
+//targetShader: The instanced shader program (see 
+//"ShaderProgram_createInstanced").
+void BufferedMesh_updateInstances(BufferedMesh *self, const float *instanceData,
+  unsigned int instanceCount, ShaderProgram targetShader)
+{
+  if (self->instanceBufferHandle == 0)
+  {
+    glGenBuffers(1, &self->instanceBufferHandle);
+    glBindVertexArray(self->vaoHandle);
+    glBindBuffer(GL_ARRAY_BUFFER, self->instanceBufferHandle);
+    glVertexAttribPointer(targetShader.attribLocation_instance, 4, GL_FLOAT,
+      GL_FALSE, 4 * sizeof(float), NULL);
+    glEnableVertexAttribArray(targetShader.attribLocation_instance);
+    glVertexAttribDivisorARB(targetShader.attribLocation_instance, 1);
+    glBindVertexArray(0);
+  }
+  else glBindBuffer(GL_ARRAY_BUFFER, self->instanceBufferHandle);
+
+  self->instanceCount = instanceCount;
+  if (instanceCount > self->instanceCapacity)
+  {
+    self->instanceCapacity = instanceCount + instanceCount / 4;
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * self->instanceCapacity,
+      NULL, GL_STREAM_DRAW);
+  }
+
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 4 * instanceCount,
+    instanceData);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+//Draws all instances of a BufferedMesh (see "BufferedMesh_updateInstances")
+//with a single draw call, using the instanced shader program.
+//self: A pointer to the buffered mesh.
+//Does nothing if NULL is provided.
+void BufferedMesh_drawInstanced(const BufferedMesh *self)
+{
+  if (self == NULL || self->instanceCount == 0) return;
+
+  glBindVertexArray(self->vaoHandle);
+  glDrawArraysInstancedARB(GL_TRIANGLES, 0, self->vertexCount,
+    self->instanceCount);
+  glBindVertexArray(0);
 }
 
 //Draws a BufferedMesh to the screen.
@@ -508,10 +1586,532 @@ void BufferedMesh_draw(const BufferedMesh *self)
   glBindVertexArray(0);
 }
 
+//=============================================================================
+// RenderQueue: Render packets passed from the simulation to the drawing code.
+//=============================================================================
+
+//The amount of render packets - one is recorded by the simulation, one is
+//drawn and the remaining one is queued in between.
+#define RENDER_PACKET_COUNT 3
+//The maximum amount of draw commands in a render packet.
+#define RENDER_MAX_COMMANDS 64
+
+//Defines an enum of the draw commands in a render packet.
+typedef enum
+{
+  //Draws a mesh with a model transformation.
+  RenderDrawMesh,
+  //Draws the chunks around the viewer (see "World_draw").
+  RenderDrawWorld,
+  //Draws the maze dweller instances of the packet (see "Npc_draw").
+  RenderDrawNpcs
+} RenderCommandType;
+
+typedef struct
+{
+  RenderCommandType type;
+  //The mesh and its model transformation (only for RenderDrawMesh).
+  const BufferedMesh *mesh;
+  Matrix4x4 model;
+  //The distance after which everything is faded out, or 0 to disable that.
+  float fadeDistance;
+} RenderCommand;
+
+//Contains everything which is needed to draw one frame: the camera, the
+//values of the shader uniforms and a list of draw commands. A packet is
+//recorded by the simulation and isn't changed anymore after it was
+//published, so that it can be drawn while the simulation goes on.
+typedef struct
+{
+  Matrix4x4 view;
+  //The viewer position in world coordinates and the level of the viewer.
+  float viewerX, viewerY, viewerZ;
+  int viewerLevel;
+  float currentTimeMs, brightness;
+
+  RenderCommand commands[RENDER_MAX_COMMANDS];
+  int commandCount;
+
+  //The instances of the maze dwellers (see "NpcPopulation_getInstances").
+  float *instances;
+  int instanceCount, instanceCapacity;
+
+  //The consecutive number of the packet and the time it was published at.
+  unsigned int frameNumber;
+  double publishTime;
+  bool wasPresented;
+} RenderPacket;
+
+//Defines an enum of the ways the drawing code picks the next packet.
+typedef enum
+{
+  //Always draws the most recent packet and drops older ones, so that the
+  //latency is as low as possible (but frames can be skipped).
+  RenderLatencyMode,
+  //Draws every packet in order - the simulation waits while the queue is
+  //full, so that no frame is skipped (at the cost of more latency).
+  RenderThroughputMode
+} RenderMode;
+
+//Provides a queue of render packets between one recording thread (the
+//simulation) and one drawing thread (the one owning the GL context).
+//Use "RenderQueue_initialize" before using an instance.
+typedef struct
+{
+  RenderPacket packets[RENDER_PACKET_COUNT];
+  RenderMode mode;
+
+  //The indicies of the published packets which weren't drawn yet (oldest
+  //first), the packet which is recorded and the packet which was drawn last
+  //(which stays reserved, so that it can be drawn again) - or -1.
+  int queue[RENDER_PACKET_COUNT];
+  int queueLength, recordedPacket, drawnPacket;
+  unsigned int nextFrameNumber;
+  bool isShuttingDown;
+
+  Mutex mutex;
+  ConditionVariable packetReleased;
+
+  //The statistics since the last call of "RenderQueue_printStatistics".
+  unsigned int publishedCount, presentedCount, droppedCount, acquiredCount;
+  int maxQueueLength;
+  double queueLengthSum, latencySum, maxLatency;
+} RenderQueue;
+
+//Resets the statistics of a RenderQueue.
+//self: A pointer to the queue.
+void RenderQueue_resetStatistics(RenderQueue *self)
+{
+  self->publishedCount = 0;
+  self->presentedCount = 0;
+  self->droppedCount = 0;
+  self->acquiredCount = 0;
+  self->maxQueueLength = 0;
+  self->queueLengthSum = 0;
+  self->latencySum = 0;
+  self->maxLatency = 0;
+}
+
+//Initializes a RenderQueue instance.
+//self: A pointer to the (uninitialized) queue.
+//mode: The way the next packet is picked for drawing.
+//instanceCapacity: The maximum amount of instances in a packet.
+void RenderQueue_initialize(RenderQueue *self, RenderMode mode,
+  int instanceCapacity)
+{
+  self->mode = mode;
+  self->queueLength = 0;
+  self->recordedPacket = -1;
+  self->drawnPacket = -1;
+  self->nextFrameNumber = 0;
+  self->isShuttingDown = false;
+  Mutex_initialize(&self->mutex);
+  ConditionVariable_initialize(&self->packetReleased);
+  RenderQueue_resetStatistics(self);
+
+  for (int i = 0; i < RENDER_PACKET_COUNT; i++)
+  {
+    self->packets[i].commandCount = 0;
+    self->packets[i].instanceCount = 0;
+    self->packets[i].instanceCapacity = MAX(0, instanceCapacity);
+    self->packets[i].instances = (float *)Common_allocate(
+      sizeof(float) * 4 * self->packets[i].instanceCapacity);
+  }
+}
+
+//Releases the resources of a RenderQueue instance.
+//self: A pointer to the queue.
+void RenderQueue_destroy(RenderQueue *self)
+{
+  for (int i = 0; i < RENDER_PACKET_COUNT; i++)
+  {
+    free(self->packets[i].instances);
+    self->packets[i].instances = NULL;
+  }
+  Mutex_destroy(&self->mutex);
+  ConditionVariable_destroy(&self->packetReleased);
+}
+
+//Removes the oldest packets from the queue.
+//self: A pointer to the queue (with the mutex locked).
+//count: The amount of packets to remove.
+void RenderQueue_dequeue(RenderQueue *self, int count)
+{
+  for (int i = count; i < self->queueLength; i++)
+    self->queue[i - count] = self->queue[i];
+  self->queueLength -= count;
+}
+
+//Gets a packet which isn't queued or drawn for recording the next frame. In
+//the latency mode, the oldest queued packet is dropped if there's none - in
+//the throughput mode, the calling thread waits until a packet was drawn.
+//self: A pointer to the queue.
+//Returns a pointer to the empty packet, which needs to be published with
+//"RenderQueue_publish", or NULL if the queue was shut down.
+RenderPacket *RenderQueue_beginRecording(RenderQueue *self)
+{
+  RenderPacket *packet = NULL;
+
+  Mutex_lock(&self->mutex);
+  while (packet == NULL && !self->isShuttingDown)
+  {
+    for (int i = 0; i < RENDER_PACKET_COUNT && packet == NULL; i++)
+    {
+      bool isQueued = i == self->drawnPacket;
+      for (int j = 0; j < self->queueLength; j++)
+        isQueued = isQueued || self->queue[j] == i;
+      if (!isQueued)
+      {
+        self->recordedPacket = i;
+        packet = &self->packets[i];
+      }
+    }
+
+    if (packet == NULL && self->mode == RenderLatencyMode)
+    {
+      self->recordedPacket = self->queue[0];
+      packet = &self->packets[self->queue[0]];
+      RenderQueue_dequeue(self, 1);
+      self->droppedCount++;
+    }
+    else if (packet == NULL)
+      ConditionVariable_wait(&self->packetReleased, &self->mutex);
+  }
+  Mutex_unlock(&self->mutex);
+
+  if (packet != NULL)
+  {
+    packet->commandCount = 0;
+    packet->instanceCount = 0;
+  }
+  return packet;
+}
+
+//Publishes a recorded packet, which isn't changed anymore afterwards.
+//self: A pointer to the queue.
+//packet: A pointer to the packet (see "RenderQueue_beginRecording").
+void RenderQueue_publish(RenderQueue *self, RenderPacket *packet)
+{
+  Mutex_lock(&self->mutex);
+  packet->frameNumber = self->nextFrameNumber++;
+  packet->publishTime = Common_getTimeSeconds();
+  packet->wasPresented = false;
+  self->queue[self->queueLength++] = self->recordedPacket;
+  self->recordedPacket = -1;
+  self->publishedCount++;
+  Mutex_unlock(&self->mutex);
+}
+
+//Checks whether a packet was published which wasn't drawn yet.
+//self: A pointer to the queue.
+bool RenderQueue_hasPacket(RenderQueue *self)
+{
+  Mutex_lock(&self->mutex);
+  bool hasPacket = self->queueLength > 0;
+  Mutex_unlock(&self->mutex);
+  return hasPacket;
+}
+
+//Gets the packet which should be drawn next: the most recent one in the
+//latency mode (the older ones are dropped) or the oldest one in the
+//throughput mode. The previously drawn packet is released.
+//self: A pointer to the queue.
+//Returns a pointer to the packet, which stays valid until the next call - or
+//the previously drawn packet if no new packet was published (which is NULL
+//if no packet was published at all yet).
+const RenderPacket *RenderQueue_acquire(RenderQueue *self)
+{
+  Mutex_lock(&self->mutex);
+  if (self->queueLength > 0)
+  {
+    self->acquiredCount++;
+    self->queueLengthSum += self->queueLength;
+    self->maxQueueLength = MAX(self->maxQueueLength, self->queueLength);
+
+    if (self->mode == RenderLatencyMode && self->queueLength > 1)
+    {
+      self->droppedCount += self->queueLength - 1;
+      RenderQueue_dequeue(self, self->queueLength - 1);
+    }
+    self->drawnPacket = self->queue[0];
+    RenderQueue_dequeue(self, 1);
+    ConditionVariable_signal(&self->packetReleased);
+  }
+  const RenderPacket *packet = self->drawnPacket >= 0 ?
+    &self->packets[self->drawnPacket] : NULL;
+  Mutex_unlock(&self->mutex);
+
+  return packet;
+}
+
+//Records that a packet is visible now (after the buffers were swapped) and
+//measures the latency added by the queue: the time since it was published.
+//self: A pointer to the queue.
+//packet: A pointer to the packet (see "RenderQueue_acquire").
+void RenderQueue_present(RenderQueue *self, const RenderPacket *packet)
+{
+  Mutex_lock(&self->mutex);
+  if (!packet->wasPresented)
+  {
+    double latency = Common_getTimeSeconds() - packet->publishTime;
+    self->packets[packet - self->packets].wasPresented = true;
+    self->presentedCount++;
+    self->latencySum += latency;
+    self->maxLatency = MAX(self->maxLatency, latency);
+  }
+  Mutex_unlock(&self->mutex);
+}
+
+//Wakes up a thread waiting in "RenderQueue_beginRecording" and makes all
+//following calls return NULL.
+//self: A pointer to the queue.
+void RenderQueue_shutdown(RenderQueue *self)
+{
+  Mutex_lock(&self->mutex);
+  self->isShuttingDown = true;
+  ConditionVariable_broadcast(&self->packetReleased);
+  Mutex_unlock(&self->mutex);
+}
+
+//Prints the amount of published, presented and dropped packets, the average
+//and maximum queue length (when a packet was acquired) and the latency added
+//by the queue since the last call - and resets these statistics.
+//self: A pointer to the queue.
+void RenderQueue_printStatistics(RenderQueue *self)
+{
+  Mutex_lock(&self->mutex);
+  printf("Render queue (%s mode): %u frames published, %u presented, %u "
+    "dropped, %.2f queued on average (%d at most), %.3f ms latency on "
+    "average (%.3f ms at most).\n",
+    self->mode == RenderLatencyMode ? "latency" : "throughput",
+    self->publishedCount, self->presentedCount, self->droppedCount,
+    self->acquiredCount > 0 ? self->queueLengthSum / self->acquiredCount : 0.0,
+    self->maxQueueLength, self->presentedCount > 0 ?
+    self->latencySum * 1000.0 / self->presentedCount : 0.0,
+    self->maxLatency * 1000.0);
+  RenderQueue_resetStatistics(self);
+  Mutex_unlock(&self->mutex);
+}
+
+//Adds a draw command to a packet.
+//self: A pointer to the packet.
+//type: The type of the command.
+//mesh: The mesh to draw (for RenderDrawMesh) or NULL.
+//model: The model transformation (for RenderDrawMesh) or NULL.
+//fadeDistance: The distance after which everything is faded out (or 0).
+//Does nothing if the packet is full.
+void RenderPacket_addCommand(RenderPacket *self, RenderCommandType type,
+  const BufferedMesh *mesh, const Matrix4x4 *model, float fadeDistance)
+{
+  if (self->commandCount >= RENDER_MAX_COMMANDS) return;
+
+  RenderCommand *command = &self->commands[self->commandCount++];
+  command->type = type;
+  command->mesh = mesh;
+  command->model = model != NULL ? *model : Matrix4x4_create(true);
+  command->fadeDistance = fadeDistance;
+}
+
+//=============================================================================
+// ViewAtlas: Many small views rendered offscreen into one texture.
+//=============================================================================
+
+//The amount of atlas images which can be read back at once - older ones are
+//dropped if they weren't mapped in time.
+#define VIEW_ATLAS_READBACKS 3
+
+//Provides a framebuffer with one big texture, which is split into square
+//tiles for many small views (like the first-person views of bots). Every
+//finished atlas is copied into a pixel buffer asynchronously, so that the
+//pixels can be mapped some frames later without stalling the pipeline.
+//Use "ViewAtlas_initialize" before using an instance.
+typedef struct
+{
+  GLuint framebufferHandle, textureHandle, depthBufferHandle;
+  GLuint pixelBufferHandles[VIEW_ATLAS_READBACKS];
+  GLsync fences[VIEW_ATLAS_READBACKS];
+  //The views are placed row by row, starting at the bottom left (like the
+  //rows of the RGBA pixels, which are read back from the bottom).
+  int viewCount, viewSize, columnCount, rowCount, width, height;
+  //The amount of atlas images read back and mapped (or dropped) so far -
+  //the ones in between are pending.
+  unsigned int readbackCount, mappedCount, droppedCount;
+} ViewAtlas;
+
+//Initializes a ViewAtlas instance.
+//self: A pointer to the (uninitialized) atlas.
+//viewCount: The amount of views.
+//viewSize: The width and height of every view (in pixels).
+//Terminates the application if offscreen rendering isn't supported or if
+//the atlas would be too big.
+void ViewAtlas_initialize(ViewAtlas *self, int viewCount, int viewSize)
+{
+  GLint maxSize = 0;
+
+  if (!GLEW_ARB_framebuffer_object || !GLEW_ARB_pixel_buffer_object ||
+    !GLEW_ARB_sync) Common_terminate("LOADING", "Rendering views requires "
+    "framebuffer objects, pixel buffers and fences, which aren't supported.");
+
+  self->viewCount = MAX(1, viewCount);
+  self->viewSize = viewSize;
+  self->columnCount = (int)ceil(sqrt((double)self->viewCount));
+  self->rowCount = (self->viewCount + self->columnCount - 1) /
+    self->columnCount;
+  self->width = self->columnCount * viewSize;
+  self->height = self->rowCount * viewSize;
+  self->readbackCount = 0;
+  self->mappedCount = 0;
+  self->droppedCount = 0;
+
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  if (self->width > maxSize || self->height > maxSize) Common_terminate(
+    "LOADING", "The views don't fit into the biggest supported texture.");
+
+  glGenTextures(1, &self->textureHandle);
+  glBindTexture(GL_TEXTURE_2D, self->textureHandle);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, self->width, self->height, 0,
+    GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenRenderbuffers(1, &self->depthBufferHandle);
+  glBindRenderbuffer(GL_RENDERBUFFER, self->depthBufferHandle);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, self->width,
+    self->height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &self->framebufferHandle);
+  glBindFramebuffer(GL_FRAMEBUFFER, self->framebufferHandle);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+    self->textureHandle, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+    GL_RENDERBUFFER, self->depthBufferHandle);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) Common_terminate("LOADING",
+    "The framebuffer of the views is incomplete.");
+
+  glGenBuffers(VIEW_ATLAS_READBACKS, self->pixelBufferHandles);
+  for (int i = 0; i < VIEW_ATLAS_READBACKS; i++)
+  {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, self->pixelBufferHandles[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)self->width *
+      self->height * 4, NULL, GL_STREAM_READ);
+    self->fences[i] = NULL;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+//Releases the resources of a ViewAtlas instance (including pending
+//readbacks).
+//self: A pointer to the atlas.
+void ViewAtlas_destroy(ViewAtlas *self)
+{
+  for (int i = 0; i < VIEW_ATLAS_READBACKS; i++)
+    if (self->fences[i] != NULL) glDeleteSync(self->fences[i]);
+  glDeleteBuffers(VIEW_ATLAS_READBACKS, self->pixelBufferHandles);
+  glDeleteFramebuffers(1, &self->framebufferHandle);
+  glDeleteRenderbuffers(1, &self->depthBufferHandle);
+  glDeleteTextures(1, &self->textureHandle);
+}
+
+//Starts drawing into the atlas: binds its framebuffer and clears all views.
+//self: A pointer to the atlas.
+void ViewAtlas_begin(ViewAtlas *self)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, self->framebufferHandle);
+  glViewport(0, 0, self->width, self->height);
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glEnable(GL_SCISSOR_TEST);
+}
+
+//Restricts the following draw calls to the tile of a view.
+//self: A pointer to the atlas.
+//index: The index of the view.
+void ViewAtlas_selectView(ViewAtlas *self, int index)
+{
+  int x = (index % self->columnCount) * self->viewSize;
+  int y = (index / self->columnCount) * self->viewSize;
+  glViewport(x, y, self->viewSize, self->viewSize);
+  glScissor(x, y, self->viewSize, self->viewSize);
+}
+
+//Finishes drawing into the atlas and starts copying it into the next pixel
+//buffer (dropping the oldest readback if all of them are pending). Binds the
+//default framebuffer again.
+//self: A pointer to the atlas.
+void ViewAtlas_end(ViewAtlas *self)
+{
+  glDisable(GL_SCISSOR_TEST);
+
+  if (self->readbackCount - self->mappedCount == VIEW_ATLAS_READBACKS)
+  {
+    int oldest = self->mappedCount % VIEW_ATLAS_READBACKS;
+    glDeleteSync(self->fences[oldest]);
+    self->fences[oldest] = NULL;
+    self->mappedCount++;
+    self->droppedCount++;
+  }
+
+  //With a pixel buffer bound, glReadPixels only queues the copy.
+  int next = self->readbackCount % VIEW_ATLAS_READBACKS;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, self->pixelBufferHandles[next]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, self->width, self->height, GL_RGBA, GL_UNSIGNED_BYTE,
+    NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  self->fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  self->readbackCount++;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glFlush();
+}
+
+//Maps the pixels of the oldest pending readback, if its copy is finished.
+//self: A pointer to the atlas.
+//wait: true to wait until the copy is finished, false to return right away.
+//Returns a pointer to width * height RGBA pixels (see "ViewAtlas"), which
+//stays valid until "ViewAtlas_unmap" is called (which needs to happen
+//before the next "ViewAtlas_end") - or NULL if no readback is finished.
+const uint8_t *ViewAtlas_map(ViewAtlas *self, bool wait)
+{
+  if (self->readbackCount == self->mappedCount) return NULL;
+
+  int oldest = self->mappedCount % VIEW_ATLAS_READBACKS;
+  GLenum result;
+  do result = glClientWaitSync(self->fences[oldest],
+    GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+  while (wait && result == GL_TIMEOUT_EXPIRED);
+  if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+    return NULL;
+
+  glDeleteSync(self->fences[oldest]);
+  self->fences[oldest] = NULL;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, self->pixelBufferHandles[oldest]);
+  const uint8_t *pixels =
+    (const uint8_t *)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return pixels;
+}
+
+//Unmaps the pixels mapped with "ViewAtlas_map", so that the pixel buffer
+//can be used for the next readbacks.
+//self: A pointer to the atlas.
+void ViewAtlas_unmap(ViewAtlas *self)
+{
+  glBindBuffer(GL_PIXEL_PACK_BUFFER,
+    self->pixelBufferHandles[self->mappedCount % VIEW_ATLAS_READBACKS]);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  self->mappedCount++;
+}
+
 //The following variable definitions contain the vertex definitions as raw
 //float arrays - this data was generated using Blender 2.82 and the python
 //script attached to the bottom of this file. 
-//The actual program code continues at line 1686.
+//The actual program code continues at line 3286.
 const float floorMeshData[] =
 {
    0.5f, 0.0f, 0.0f, 0.353f, 0.894f, 0.498f,
@@ -1700,6 +3300,9 @@ typedef enum
 //Defines an enum of valid field types.
 typedef enum
 {
+  //A lift, which takes the player to the lift at the same position on the
+  //level above or below (which is drawn like an arch).
+  Lift = -3,
   //The starting point of the user.
   Init = -2,
   //The gate between the main room and the labyrinth.
@@ -1714,11 +3317,11 @@ typedef enum
   Goal = 3
 } Field;
 
-//The following three variables define the game field and need to be consistent
-//to allow the game to start.
-const int mapWidth = 15;
-const int mapDepth = 11;
-const Field map[] =
+//The following three variables define the built-in game field and need to be
+//consistent to allow the game to start.
+const int defaultMapWidth = 15;
+const int defaultMapDepth = 11;
+Field defaultMap[] =
 {
   Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall,
   Wall, Tile, Tile, Tile, Tile, Wall, Tile, Tile, Tile, Tile, Wall,
@@ -1741,12 +3344,21 @@ const Field map[] =
   Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall, Wall
 };
 
+//The following variables define the current game field, which is either the
+//built-in one or a generated maze. The fields are stored level by level, each
+//level X-major - so the field at (x, level, z) is at the index 
+//(level * mapWidth + x) * mapDepth + z. The fields can be changed at runtime
+//with "Game_setMapFieldByIndicies".
+int mapWidth = 0, mapDepth = 0, mapLevels = 1;
+Field *map = NULL;
+
 bool isLoaded = false;
 ShaderProgram shaderProgram;
 BufferedMesh skyboxMesh, wallMesh, floorMesh, archMesh, crystalMesh, tubeMesh;
 
 //Contains the current states of the input actions, which get updated by the
-//user input event handlers and should not be modified anywhere else.
+//user input event handlers and should not be modified anywhere else (and are
+//only accessed while "inputMutex" is locked).
 bool inputForward = false, inputRight = false, inputBackwards = false,
 inputLeft = false, inputJump = false, inputAction = false;
 
@@ -1754,13 +3366,19 @@ inputLeft = false, inputJump = false, inputAction = false;
 float previousMouseX = 0, previousMouseY = 0;
 //Always contains the current mouse data (updated by onMouse event).
 float currentMouseX = 0, currentMouseY = 0;
+//The state of the action input during the last update, so that a lift only
+//moves the player once per key press.
+bool previousInputAction = false;
 
 //The following values are modified in the update method and should not be 
 //changed anywhere else. Unless stated otherwise, the values are all in world
 //units, rotation angles are in degrees.
 
-//The current exact player position in the world.
+//The current exact player position in the world. The playerY is relative to
+//the floor of the current level of the player.
 float playerX = 0, playerY = 0, playerZ = 0;
+//The current level of the player.
+int playerLevel = 0;
 //The current player accerlation.
 float playerAccerlationX = 0, playerAccerlationY = 0, playerAccerlationZ = 0;
 //The current player rotation.
@@ -1775,506 +3393,13106 @@ ItemState itemState = Initial;
 //A current value that - if decremented - will fade out the game to black.
 float gameBrightness = 0.0f;
 
-//The time (with the application start as "point zero") when the game was 
-//updated the last time (in milliseconds).
-int lastUpdateTime;
+//The time (see "Common_getTimeSeconds") when the game was started and when it
+//was updated the last time.
+double gameStartTime = 0, lastUpdateTime = 0;
 //The milliseconds part of the current time (= application runtime % 1000).
 float currentTimeMs = 0;
 
 //The current dimensions of the game window.
 int currentWindowWidth, currentWindowHeight;
 
-//Translates a world position into field indicies (without checking bounds).
-//positionX: The X position in world coordinates.
-//positionY: The Y position in world coordinates.
-//indexX: The pointer to store the resulting field index (X axis) into.
-//indexY: The pointer to store the resulting field index (Y axis) into.
-void Game_getMapFieldIndiciesByPosition(float positionX, float positionZ,
-  int *indexX, int *indexZ)
+//The way render packets are passed from the simulation to the drawing code
+//and whether the simulation runs on its own thread (see "--render-mode") - 
+//otherwise, it runs on the GLUT thread, right before the world is updated.
+RenderMode renderMode = RenderLatencyMode;
+bool useSimulationThread = true;
+RenderQueue renderQueue;
+Thread simulationThread;
+//Locked by the simulation during every update and by the GLUT thread while it
+//changes the world (which the simulation reads).
+Mutex simulationMutex;
+//Locked while the input values are changed or read.
+Mutex inputMutex;
+//The mouse movement (in pixels) since the last update of the simulation.
+float inputMouseX = 0, inputMouseY = 0;
+//The amount of simulation updates and the amount of simulation updates the
+//world was updated after (the world is updated once per simulation update).
+unsigned int simulationUpdateCount = 0, worldUpdateCount = 0;
+//true after the game was completed or when the simulation should stop.
+bool isGameFinished = false, isSimulationStopping = false;
+
+//=============================================================================
+// Maze: Deterministic, chunk-wise generation of (endless) multi-level mazes.
+//=============================================================================
+
+//The amount of rooms per chunk along each axis - rooms are placed on the odd
+//local field indicies, the walls between them on the even ones.
+#define MAZE_ROOMS_PER_AXIS (CHUNK_SIZE / 2)
+//Every n-th chunk (on average) contains a quest item.
+#define MAZE_ITEM_CHUNK_RATIO 4
+
+//Mixes the bits of a 32-bit value (the "fmix32" finalizer of MurmurHash3).
+uint32_t Maze_mix(uint32_t h)
 {
-  (*indexX) = (int)roundf(positionX);
-  (*indexZ) = (int)roundf(positionZ);
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
 }
 
-//Translates field indicies into world coordinates (without checking bounds).
-//indexX: The field index on the X-axis.
-//indexY: The field index on the Y-axis.
-//positionX: The pointer to store the resulting X position world coordinate.
-//positionY: The pointer to store the resulting Y position world coordinate.
-void Game_getMapFieldPositionByIndicies(int indexX, int indexZ,
-  float *positionX, float *positionZ)
+//Hashes a seed and three integer values into a pseudo-random 32-bit value.
+//The same input always yields the same output, independent of the platform.
+uint32_t Maze_hash(uint32_t seed, int a, int b, int c)
 {
-  (*positionX) = (float)indexX;
-  (*positionZ) = (float)indexZ;
+  uint32_t h = Maze_mix(seed + 0x9E3779B9u);
+  h = Maze_mix(h ^ (uint32_t)a);
+  h = Maze_mix(h + (uint32_t)b * 0x9E3779B9u);
+  return Maze_mix(h ^ ((uint32_t)c * 0x7FEB352Du));
 }
 
-//Gets the field type at specific field indicies.
-//To retrieve the field type at a specific world position, use the
-//"Game_getMapFieldByPosition" function instead.
-//x: The x index of the field.
-//z: The z index of the field.
-//Terminates the application if x or z are out of bounds.
-Field Game_getMapFieldByIndicies(int x, int z)
+//Gets the next value of a xorshift32 pseudo-random number generator.
+//state: A pointer to the (non-zero) generator state, which will be updated.
+uint32_t Maze_random(uint32_t *state)
 {
-  if (x < 0 || x > mapWidth || z < 0 || z > mapDepth)
-    Common_terminate("INGAME", "An invalid field position was requested.");
-  return map[x * mapDepth + z];
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
 }
 
-//Gets the field type at a specific world position.
-//To retrieve the field type at specific field indicies, use the
-//"Game_getMapFieldByIndicies" function instead.
-//x: The X position world coordinate.
-//z: The X position world coordinate.
-//Terminates the application if x or z are out of bounds of the field.
-Field Game_getMapFieldByPosition(float x, float z)
+//Hashes a seed, a chunk position and a purpose (to get different values for
+//different decisions about the same chunk) into a pseudo-random value.
+uint32_t Maze_hashChunk(uint32_t seed, int chunkX, int level, int chunkZ,
+  int purpose)
 {
-  int indexX = 0, indexZ = 0;
-  Game_getMapFieldIndiciesByPosition(x, z, &indexX, &indexZ);
-  return map[indexX * mapDepth + indexZ];
+  return Maze_hash(seed, chunkX, chunkZ, level * 16 + purpose);
 }
 
-//Ocurrs when the game is loaded, after the window was opened the first time.
-//Terminates the application when the function is called more than once or when
-//the map definition is invalid.
-void Game_onLoad(void)
+//Gets the local Z index of the door in the western wall of a chunk (the wall
+//at the local X index 0), which connects the chunk to its western neighbour.
+//As every chunk only opens its own western and northern wall, the generation
+//of a chunk never depends on the generated fields of its neighbours.
+int Maze_getWestDoorZ(uint32_t seed, int chunkX, int level, int chunkZ)
 {
-  printf("\n");
+  return (int)(Maze_hashChunk(seed, chunkX, level, chunkZ, 1) %
+    MAZE_ROOMS_PER_AXIS) * 2 + 1;
+}
 
-  if (isLoaded) Common_terminate("LOADING",
-    "The load function was called more than once.");
+//Gets the local X index of the door in the northern wall of a chunk (the wall
+//at the local Z index 0), which connects the chunk to its northern neighbour.
+int Maze_getNorthDoorX(uint32_t seed, int chunkX, int level, int chunkZ)
+{
+  return (int)(Maze_hashChunk(seed, chunkX, level, chunkZ, 2) %
+    MAZE_ROOMS_PER_AXIS) * 2 + 1;
+}
 
-  lastUpdateTime = glutGet(GLUT_ELAPSED_TIME);
+//Gets the index of the lift field in a chunk (in the fields of the chunk),
+//which connects a level with the level above. Lifts are placed in rooms, 
+//which exist at the same position on every level - but never in the first 
+//room, where the player starts. The lifts above even levels use the rooms
+//with an even index and the ones above odd levels the rooms with an odd
+//index, so the lifts of two pairs of levels never end up in the same room:
+//a shaft over three levels would always take the player on its middle level
+//up (see "SessionBatch_stepRange"), so its lowest level couldn't be reached
+//from there.
+//lowerLevel: The index of the lower one of the two connected levels.
+int Maze_getLiftIndex(uint32_t seed, int chunkX, int lowerLevel, int chunkZ)
+{
+  const int roomCount = MAZE_ROOMS_PER_AXIS * MAZE_ROOMS_PER_AXIS;
+  uint32_t hash = Maze_hashChunk(seed, chunkX, lowerLevel, chunkZ, 4);
+  int room = lowerLevel % 2 == 0 ?
+    2 + 2 * (int)(hash % ((roomCount - 1) / 2)) :
+    1 + 2 * (int)(hash % (roomCount / 2));
+  int roomX = room / MAZE_ROOMS_PER_AXIS, roomZ = room % MAZE_ROOMS_PER_AXIS;
+  return (roomX * 2 + 1) * CHUNK_SIZE + (roomZ * 2 + 1);
+}
 
-  printf("Initializing OpenGL context and shaders...\n");
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_CULL_FACE);
-  shaderProgram = ShaderProgram_createDefault(true);
+//Gets the amount of passages leading out of a room of a generated chunk.
+//fields: The fields of the chunk (with the doors already opened).
+//localX: The local X index of the room.
+//localZ: The local Z index of the room.
+//eastDoorZ: The local Z index of the door in the western wall of the eastern
+//neighbour chunk.
+//southDoorX: The local X index of the door in the northern wall of the 
+//southern neighbour chunk.
+int Maze_getRoomExitCount(const Field *fields, int localX, int localZ,
+  int eastDoorZ, int southDoorX)
+{
+  int exitCount = 0;
+  if (fields[(localX - 1) * CHUNK_SIZE + localZ] != Wall) exitCount++;
+  if (fields[localX * CHUNK_SIZE + localZ - 1] != Wall) exitCount++;
+  if (localX + 1 < CHUNK_SIZE)
+  {
+    if (fields[(localX + 1) * CHUNK_SIZE + localZ] != Wall) exitCount++;
+  }
+  else if (eastDoorZ == localZ) exitCount++;
+  if (localZ + 1 < CHUNK_SIZE)
+  {
+    if (fields[localX * CHUNK_SIZE + localZ + 1] != Wall) exitCount++;
+  }
+  else if (southDoorX == localX) exitCount++;
+  return exitCount;
+}
 
-  printf("Loading game assets...\n");
+//Places a field in a randomly chosen dead end room of a generated chunk.
+//Dead ends are used so that placed fields never block a passage.
+//fields: The fields of the chunk (with the doors already opened).
+//field: The field type to place.
+//random: A pointer to the state of the random number generator.
+//eastDoorZ, southDoorX: See "Maze_getRoomExitCount".
+void Maze_placeInDeadEnd(Field *fields, Field field, uint32_t *random,
+  int eastDoorZ, int southDoorX)
+{
+  int deadEnds[MAZE_ROOMS_PER_AXIS * MAZE_ROOMS_PER_AXIS];
+  int deadEndCount = 0;
+
+  for (int localX = 1; localX < CHUNK_SIZE; localX += 2)
+    for (int localZ = 1; localZ < CHUNK_SIZE; localZ += 2)
+      if (fields[localX * CHUNK_SIZE + localZ] == Tile &&
+        Maze_getRoomExitCount(fields, localX, localZ, eastDoorZ,
+          southDoorX) == 1)
+        deadEnds[deadEndCount++] = localX * CHUNK_SIZE + localZ;
+
+  if (deadEndCount > 0)
+    fields[deadEnds[Maze_random(random) % deadEndCount]] = field;
+}
 
-  if (LENGTHOF(map) != (mapWidth * mapDepth))
-    Common_terminate("LOADING",
-      "The map size doesn't match with the actual data size.");
+//Generates the fields of a chunk of an endless maze. The fields inside a chunk
+//form a perfect maze (generated with a randomized depth-first search), which
+//is connected to every neighbour chunk with a door and to the chunks above 
+//and below with a lift - so every room of the endless maze can be reached 
+//from every other room.
+//seed: The seed of the maze.
+//chunkX: The X index of the chunk (in chunks, not in fields).
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk (in chunks, not in fields).
+//levelCount: The amount of levels of the maze.
+//fields: The target array for CHUNK_SIZE * CHUNK_SIZE fields (X-major).
+void Maze_generateChunk(uint32_t seed, int chunkX, int level, int chunkZ,
+  int levelCount, Field *fields)
+{
+  const int roomCount = MAZE_ROOMS_PER_AXIS * MAZE_ROOMS_PER_AXIS;
+  bool visited[MAZE_ROOMS_PER_AXIS * MAZE_ROOMS_PER_AXIS];
+  int stack[MAZE_ROOMS_PER_AXIS * MAZE_ROOMS_PER_AXIS];
+  int stackSize = 0;
 
-  bool spawnPointFound = false;
-  int spawnX = 0, spawnZ = 0;
-  for (spawnX = 0; spawnX < mapWidth && !spawnPointFound; spawnX++)
-    for (spawnZ = 0; spawnZ < mapDepth && !spawnPointFound; spawnZ++)
-      if (Game_getMapFieldByIndicies(spawnX, spawnZ) == Init)
-      {
-        spawnPointFound = true;
-        //As the for loop will increment spawnX/spawnZ once more even though 
-        //the spawn point was already found, the values need to be decremented 
-        //here once to be correct.
-        spawnX--;
-        spawnZ--;
-      }
+  uint32_t random = Maze_hashChunk(seed, chunkX, level, chunkZ, 0) | 1;
 
-  Game_getMapFieldPositionByIndicies(spawnX, spawnZ, &playerX, &playerZ);
+  for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++) fields[i] = Wall;
+  for (int i = 0; i < roomCount; i++) visited[i] = false;
 
-  if (!spawnPointFound) Common_terminate("LOADING",
-    "The map doesn't contain a player spawn point.");
+  int startRoom = (int)(Maze_random(&random) % roomCount);
+  visited[startRoom] = true;
+  stack[stackSize++] = startRoom;
 
-  skyboxMesh = BufferedMesh_create(
-    skyboxMeshData, LENGTHOF(skyboxMeshData), shaderProgram);
-  wallMesh = BufferedMesh_create(
-    wallMeshData, LENGTHOF(wallMeshData), shaderProgram);
-  floorMesh = BufferedMesh_create(
-    floorMeshData, LENGTHOF(floorMeshData), shaderProgram);
-  archMesh = BufferedMesh_create(
-    archMeshData, LENGTHOF(archMeshData), shaderProgram);
-  crystalMesh = BufferedMesh_create(
-    crystalMeshData, LENGTHOF(crystalMeshData), shaderProgram);
-  tubeMesh = BufferedMesh_create(
-    tubeMeshData, LENGTHOF(tubeMeshData), shaderProgram);
+  while (stackSize > 0)
+  {
+    int room = stack[stackSize - 1];
+    int roomX = room / MAZE_ROOMS_PER_AXIS, roomZ = room % MAZE_ROOMS_PER_AXIS;
+    fields[(roomX * 2 + 1) * CHUNK_SIZE + (roomZ * 2 + 1)] = Tile;
+
+    int candidates[4], candidateCount = 0;
+    if (roomX > 0 && !visited[room - MAZE_ROOMS_PER_AXIS])
+      candidates[candidateCount++] = room - MAZE_ROOMS_PER_AXIS;
+    if (roomX < MAZE_ROOMS_PER_AXIS - 1 && !visited[room + MAZE_ROOMS_PER_AXIS])
+      candidates[candidateCount++] = room + MAZE_ROOMS_PER_AXIS;
+    if (roomZ > 0 && !visited[room - 1])
+      candidates[candidateCount++] = room - 1;
+    if (roomZ < MAZE_ROOMS_PER_AXIS - 1 && !visited[room + 1])
+      candidates[candidateCount++] = room + 1;
+
+    if (candidateCount == 0)
+    {
+      stackSize--;
+      continue;
+    }
 
-  isLoaded = true;
+    //Remove the wall between the current room and the chosen neighbour room.
+    int next = candidates[Maze_random(&random) % candidateCount];
+    int nextX = next / MAZE_ROOMS_PER_AXIS, nextZ = next % MAZE_ROOMS_PER_AXIS;
+    fields[(roomX + nextX + 1) * CHUNK_SIZE + (roomZ + nextZ + 1)] = Tile;
 
-  printf("Application initialized successfully!\n");
+    visited[next] = true;
+    stack[stackSize++] = next;
+  }
+
+  fields[Maze_getWestDoorZ(seed, chunkX, level, chunkZ)] = Tile;
+  fields[Maze_getNorthDoorX(seed, chunkX, level, chunkZ) * CHUNK_SIZE] = Tile;
+
+  if (level > 0)
+    fields[Maze_getLiftIndex(seed, chunkX, level - 1, chunkZ)] = Lift;
+  if (level + 1 < levelCount)
+    fields[Maze_getLiftIndex(seed, chunkX, level, chunkZ)] = Lift;
+
+  int eastDoorZ = Maze_getWestDoorZ(seed, chunkX + 1, level, chunkZ);
+  int southDoorX = Maze_getNorthDoorX(seed, chunkX, level, chunkZ + 1);
+
+  //The player always starts in the north-western room of the chunk at the 
+  //origin, with the goal and a quest item close by. More quest items are 
+  //scattered around.
+  if (chunkX == 0 && level == 0 && chunkZ == 0)
+  {
+    fields[1 * CHUNK_SIZE + 1] = Init;
+    Maze_placeInDeadEnd(fields, Goal, &random, eastDoorZ, southDoorX);
+    Maze_placeInDeadEnd(fields, Item, &random, eastDoorZ, southDoorX);
+  }
+  else if (Maze_hashChunk(seed, chunkX, level, chunkZ, 3) %
+    MAZE_ITEM_CHUNK_RATIO == 0)
+    Maze_placeInDeadEnd(fields, Item, &random, eastDoorZ, southDoorX);
 }
 
-//Ocurrs when the game is destroyed.
-void Game_onDestroy()
+//Generates a finite maze from the chunks of an endless maze, surrounded by
+//walls. The size is rounded up to a multiple of the chunk size plus one (for
+//the outer walls), so that no room is cut off from the rest of the maze.
+//seed: The seed of the maze.
+//width: A pointer to the requested width (in fields), which is updated.
+//depth: A pointer to the requested depth (in fields), which is updated.
+//levelCount: The amount of levels.
+//Returns the fields of the new maze (level-major, then X-major), which need
+//to be freed with "free".
+Field *Maze_generateMap(uint32_t seed, int *width, int *depth, int levelCount)
 {
-  if (isLoaded)
+  int chunkCountX = MAX(1, (*width - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  int chunkCountZ = MAX(1, (*depth - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  *width = chunkCountX * CHUNK_SIZE + 1;
+  *depth = chunkCountZ * CHUNK_SIZE + 1;
+
+  Field *fields = (Field *)Common_allocate(
+    sizeof(Field) * (size_t)levelCount * *width * *depth);
+  Field chunkFields[CHUNK_SIZE * CHUNK_SIZE];
+
+  for (int level = 0; level < levelCount; level++)
   {
-    printf("Unloading game resources and closing application...\n");
-    BufferedMesh_destroy(&skyboxMesh);
-    BufferedMesh_destroy(&wallMesh);
-    BufferedMesh_destroy(&floorMesh);
-    BufferedMesh_destroy(&archMesh);
-    BufferedMesh_destroy(&crystalMesh);
-    BufferedMesh_destroy(&tubeMesh);
+    Field *levelFields = fields + (size_t)level * *width * *depth;
 
-    ShaderProgram_destroy(&shaderProgram);
+    for (int chunkX = 0; chunkX < chunkCountX; chunkX++)
+    {
+      for (int chunkZ = 0; chunkZ < chunkCountZ; chunkZ++)
+      {
+        Maze_generateChunk(seed, chunkX, level, chunkZ, levelCount,
+          chunkFields);
+        for (int localX = 0; localX < CHUNK_SIZE; localX++)
+          memcpy(&levelFields[(size_t)(chunkX * CHUNK_SIZE + localX) * *depth
+            + chunkZ * CHUNK_SIZE], &chunkFields[localX * CHUNK_SIZE],
+            sizeof(Field) * CHUNK_SIZE);
+      }
+    }
 
-    glutLeaveMainLoop();
-    printf("Application terminated successfully!\n\n");
+    //Close the doors of the chunks on the border of the map.
+    for (int x = 0; x < *width; x++)
+    {
+      levelFields[(size_t)x * *depth] = Wall;
+      levelFields[(size_t)x * *depth + *depth - 1] = Wall;
+    }
+    for (int z = 0; z < *depth; z++)
+    {
+      levelFields[z] = Wall;
+      levelFields[(size_t)(*width - 1) * *depth + z] = Wall;
+    }
   }
+
+  return fields;
 }
 
-//Ocurrs when the game window is resized.
-void Game_onResize(int newWidth, int newHeight)
+//=============================================================================
+// MapFile: Compressed storage of map chunks and map files.
+//=============================================================================
+
+//Defines an enum of the encodings of a stored chunk (stored in its first byte).
+typedef enum
 {
-  const Matrix4x4 projection =
-    Matrix4x4_createPerspective((float)newWidth / newHeight, 0.001f, 200, 70);
+  //Every field is stored in 4 bits.
+  ChunkEncodingRaw = 0,
+  //The fields are run-length encoded and the runs are compressed with an
+  //LZ77-style pass afterwards.
+  ChunkEncodingCompressed = 1
+} ChunkEncoding;
+
+#define CHUNK_FIELD_COUNT (CHUNK_SIZE * CHUNK_SIZE)
+//The maximum size of an encoded chunk in bytes - which is the size of the raw
+//encoding, as the compressed encoding is only used when it's smaller.
+#define CHUNK_ENCODED_MAX_SIZE (1 + CHUNK_FIELD_COUNT / 2)
+//Fields are stored as unsigned values, shifted by the smallest field value.
+#define CHUNK_FIELD_OFFSET 3
+//Every run of the run-length encoding is stored in one byte, with the field in
+//the upper 3 bits and the run length in the lower 5 bits.
+#define CHUNK_RLE_MAX_RUN 32
+//The LZ pass either copies up to CHUNK_LZ_MAX_LITERALS runs or repeats up to
+//CHUNK_LZ_MAX_MATCH runs from up to 255 runs before.
+#define CHUNK_LZ_MAX_LITERALS 128
+#define CHUNK_LZ_MIN_MATCH 3
+#define CHUNK_LZ_MAX_MATCH (CHUNK_LZ_MIN_MATCH + 127)
+#define CHUNK_LZ_MAX_OFFSET 255
+
+//The first bytes of every map file (the last one is the format version).
+const char mapFileMagic[4] = { 'G', 'Q', 'M', 1 };
+
+//Encodes the fields of a chunk.
+//fields: The CHUNK_FIELD_COUNT fields of the chunk.
+//compress: true to use the compressed encoding if it's smaller than the raw
+//encoding, false to always use the raw encoding.
+//target: The target buffer for at least CHUNK_ENCODED_MAX_SIZE bytes.
+//Returns the amount of bytes written into the target buffer.
+int MapFile_encodeChunk(const Field *fields, bool compress, uint8_t *target)
+{
+  if (compress)
+  {
+    uint8_t runs[CHUNK_FIELD_COUNT];
+    uint8_t encoded[1 + CHUNK_FIELD_COUNT + CHUNK_FIELD_COUNT /
+      CHUNK_LZ_MAX_LITERALS + 1];
+    int runCount = 0, size = 0;
 
-  glViewport(0, 0, newWidth, newHeight);
-  ShaderProgram_setUniformValue_Matrix4x4(
-    shaderProgram.uniformLocation_projection, &projection);
-  ShaderProgram_setUniformValue_float(
-    shaderProgram.uniformLocation_screenHeight, (float)newHeight);
-  currentWindowWidth = newWidth;
-  currentWindowHeight = newHeight;
+    for (int i = 0; i < CHUNK_FIELD_COUNT;)
+    {
+      int length = 1;
+      while (i + length < CHUNK_FIELD_COUNT && length < CHUNK_RLE_MAX_RUN &&
+        fields[i + length] == fields[i]) length++;
+      runs[runCount++] = (uint8_t)(((fields[i] + CHUNK_FIELD_OFFSET) << 5) |
+        (length - 1));
+      i += length;
+    }
+
+    //The runs are compressed greedily - with at most 256 runs per chunk, the
+    //brute force search for the longest match is still fast enough.
+    encoded[size++] = ChunkEncodingCompressed;
+    int literalControl = -1;
+    for (int position = 0; position < runCount;)
+    {
+      int bestLength = 0, bestOffset = 0;
+      for (int offset = 1; offset <= MIN(position, CHUNK_LZ_MAX_OFFSET);
+        offset++)
+      {
+        int length = 0;
+        while (position + length < runCount && length < CHUNK_LZ_MAX_MATCH &&
+          runs[position + length - offset] == runs[position + length])
+          length++;
+        if (length > bestLength)
+        {
+          bestLength = length;
+          bestOffset = offset;
+        }
+      }
+
+      if (bestLength >= CHUNK_LZ_MIN_MATCH)
+      {
+        encoded[size++] = (uint8_t)(0x80 | (bestLength - CHUNK_LZ_MIN_MATCH));
+        encoded[size++] = (uint8_t)bestOffset;
+        position += bestLength;
+        literalControl = -1;
+      }
+      else
+      {
+        if (literalControl < 0 ||
+          encoded[literalControl] == CHUNK_LZ_MAX_LITERALS - 1)
+        {
+          literalControl = size;
+          encoded[size++] = 0;
+        }
+        else encoded[literalControl]++;
+        encoded[size++] = runs[position++];
+      }
+    }
+
+    if (size < CHUNK_ENCODED_MAX_SIZE)
+    {
+      memcpy(target, encoded, size);
+      return size;
+    }
+  }
+
+  target[0] = ChunkEncodingRaw;
+  for (int i = 0; i < CHUNK_FIELD_COUNT / 2; i++)
+    target[1 + i] = (uint8_t)((fields[i * 2] + CHUNK_FIELD_OFFSET) |
+      ((fields[i * 2 + 1] + CHUNK_FIELD_OFFSET) << 4));
+  return CHUNK_ENCODED_MAX_SIZE;
 }
 
-//Ocurrs after the player has pressed a key on the keyboard.
-void Game_onKeyboardDown(unsigned char key, int mouseX, int mouseY)
+//Decodes the fields of a chunk encoded with "MapFile_encodeChunk".
+//source: The encoded chunk.
+//size: The size of the encoded chunk in bytes.
+//fields: The target for the CHUNK_FIELD_COUNT fields of the chunk.
+//Returns true on success, false if the encoded chunk is invalid.
+bool MapFile_decodeChunk(const uint8_t *source, int size, Field *fields)
 {
-  mouseX; mouseY;
+  if (size < 1) return false;
 
-  switch (key)
+  if (source[0] == ChunkEncodingRaw)
   {
-    case 'w': inputForward = true; break;
-    case 's': inputBackwards = true; break;
-    case 'a': inputLeft = true; break;
-    case 'd': inputRight = true; break;
-    case ' ': inputJump = true; break;
-    case 'e': inputAction = true; break;
-    case 27: Game_onDestroy(); break;
+    if (size != CHUNK_ENCODED_MAX_SIZE) return false;
+    for (int i = 0; i < CHUNK_FIELD_COUNT / 2; i++)
+    {
+      int low = source[1 + i] & 0x0F, high = source[1 + i] >> 4;
+      if (low > Goal + CHUNK_FIELD_OFFSET || high > Goal + CHUNK_FIELD_OFFSET)
+        return false;
+      fields[i * 2] = (Field)(low - CHUNK_FIELD_OFFSET);
+      fields[i * 2 + 1] = (Field)(high - CHUNK_FIELD_OFFSET);
+    }
+    return true;
+  }
+  else if (source[0] != ChunkEncodingCompressed) return false;
+
+  uint8_t runs[CHUNK_FIELD_COUNT];
+  int runCount = 0;
+
+  for (int position = 1; position < size;)
+  {
+    int control = source[position++];
+    if (control & 0x80)
+    {
+      int length = (control & 0x7F) + CHUNK_LZ_MIN_MATCH;
+      if (position >= size) return false;
+      int offset = source[position++];
+      if (offset == 0 || offset > runCount ||
+        runCount + length > CHUNK_FIELD_COUNT) return false;
+      //The match may overlap with the runs it creates, so it's copied run by
+      //run instead of with memcpy.
+      for (int i = 0; i < length; i++, runCount++)
+        runs[runCount] = runs[runCount - offset];
+    }
+    else
+    {
+      int length = control + 1;
+      if (position + length > size || runCount + length > CHUNK_FIELD_COUNT)
+        return false;
+      memcpy(&runs[runCount], &source[position], length);
+      runCount += length;
+      position += length;
+    }
+  }
+
+  int fieldCount = 0;
+  for (int i = 0; i < runCount; i++)
+  {
+    int value = runs[i] >> 5, length = (runs[i] & 0x1F) + 1;
+    if (value > Goal + CHUNK_FIELD_OFFSET ||
+      fieldCount + length > CHUNK_FIELD_COUNT) return false;
+    Field field = (Field)(value - CHUNK_FIELD_OFFSET);
+    for (int j = 0; j < length; j++) fields[fieldCount++] = field;
   }
+
+  return fieldCount == CHUNK_FIELD_COUNT;
 }
 
-//Ocurrs after the player has released a key on the keyboard.
-void Game_onKeyboardUp(unsigned char key, int mouseX, int mouseY)
+//Copies the fields of a chunk out of a map. Fields outside of the map
+//boundaries are treated as walls.
+//fields: The fields of the map (level-major, then X-major).
+//width, depth: The size of a level of the map (in fields).
+//chunkX, level, chunkZ: The chunk indicies.
+//chunkFields: The target for the CHUNK_FIELD_COUNT fields of the chunk.
+void MapFile_getChunkFields(const Field *fields, int width, int depth,
+  int chunkX, int level, int chunkZ, Field *chunkFields)
 {
-  mouseX; mouseY;
-
-  switch (key)
+  for (int localX = 0; localX < CHUNK_SIZE; localX++)
   {
-    case 'w': inputForward = false; break;
-    case 's': inputBackwards = false; break;
-    case 'a': inputLeft = false; break;
-    case 'd': inputRight = false; break;
-    case ' ': inputJump = false; break;
-    case 'e': inputAction = false; break;
+    for (int localZ = 0; localZ < CHUNK_SIZE; localZ++)
+    {
+      int x = chunkX * CHUNK_SIZE + localX, z = chunkZ * CHUNK_SIZE + localZ;
+      chunkFields[localX * CHUNK_SIZE + localZ] = x < width && z < depth ?
+        fields[((size_t)level * width + x) * depth + z] : Wall;
+    }
   }
 }
 
-//Ocurrs after the player has moved the mouse.
-void Game_onMouseMove(int mouseX, int mouseY)
+//Copies the fields of a chunk into a map (leaving out the fields outside of
+//the map boundaries). The parameters are the same as for
+//"MapFile_getChunkFields".
+void MapFile_setChunkFields(Field *fields, int width, int depth,
+  int chunkX, int level, int chunkZ, const Field *chunkFields)
 {
-  currentMouseX = (float)mouseX;
-  currentMouseY = (float)mouseY;
+  for (int localX = 0; localX < CHUNK_SIZE; localX++)
+  {
+    int x = chunkX * CHUNK_SIZE + localX;
+    int validDepth = MIN(CHUNK_SIZE, depth - chunkZ * CHUNK_SIZE);
+    if (x >= width) break;
+    memcpy(&fields[((size_t)level * width + x) * depth + chunkZ * CHUNK_SIZE],
+      &chunkFields[localX * CHUNK_SIZE], sizeof(Field) * validDepth);
+  }
 }
 
-//Ocurrs after a "Game_onUpdate" or when GLUT thinks that a redraw is required.
-void Game_onRedraw(void)
+//Writes a 32-bit value in little endian byte order into a buffer.
+void MapFile_writeUInt32(uint8_t *target, uint32_t value)
 {
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  target[0] = (uint8_t)value;
+  target[1] = (uint8_t)(value >> 8);
+  target[2] = (uint8_t)(value >> 16);
+  target[3] = (uint8_t)(value >> 24);
+}
 
-  //Initialize the shader uniforms for this drawing call.
-  ShaderProgram_setUniformValue_float(
-    shaderProgram.uniformLocation_currentTimeMs, currentTimeMs);
-  ShaderProgram_setUniformValue_float(
-    shaderProgram.uniformLocation_brightness, gameBrightness);
+//Reads a 32-bit value in little endian byte order from a buffer.
+uint32_t MapFile_readUInt32(const uint8_t *source)
+{
+  return (uint32_t)source[0] | ((uint32_t)source[1] << 8) |
+    ((uint32_t)source[2] << 16) | ((uint32_t)source[3] << 24);
+}
 
-  const Matrix4x4 viewTransformation =
-    Matrix4x4_createCamera(playerX, playerY + 0.5f, playerZ,
-      playerRotationY, playerRotationX);
-  const Matrix4x4 originTranslationTransformation =
-    Matrix4x4_createTranslation(0, 0, 0);
+//Saves a map into a file. The file starts with the magic bytes and the
+//width, depth and level count of the map (as 32-bit values), followed by the
+//chunks (level by level, each X-major), where every chunk is stored as one
+//byte with its encoded size, followed by the encoded chunk.
+//path: The path of the file, which is overwritten if it exists.
+//fields: The fields of the map (level-major, then X-major).
+//width, depth: The size of a level of the map (in fields).
+//levels: The amount of levels of the map.
+//compress: true to compress the chunks, false to store the fields in 4 bits.
+//Returns the size of the file in bytes.
+//Terminates the application if the file couldn't be written.
+size_t MapFile_save(const char *path, const Field *fields, int width,
+  int depth, int levels, bool compress)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+    Common_terminate("SAVING", "The map file couldn't be opened.");
+
+  uint8_t header[16];
+  memcpy(header, mapFileMagic, sizeof(mapFileMagic));
+  MapFile_writeUInt32(header + 4, (uint32_t)width);
+  MapFile_writeUInt32(header + 8, (uint32_t)depth);
+  MapFile_writeUInt32(header + 12, (uint32_t)levels);
+  bool success = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+  size_t fileSize = sizeof(header);
+
+  int chunkCountX = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  int chunkCountZ = (depth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  Field chunkFields[CHUNK_FIELD_COUNT];
+  uint8_t encoded[1 + CHUNK_ENCODED_MAX_SIZE];
+
+  for (int level = 0; level < levels && success; level++)
+  {
+    for (int chunkX = 0; chunkX < chunkCountX && success; chunkX++)
+    {
+      for (int chunkZ = 0; chunkZ < chunkCountZ && success; chunkZ++)
+      {
+        MapFile_getChunkFields(fields, width, depth, chunkX, level, chunkZ,
+          chunkFields);
+        int size = MapFile_encodeChunk(chunkFields, compress, encoded + 1);
+        encoded[0] = (uint8_t)size;
+        success = fwrite(encoded, 1, size + 1, file) == (size_t)size + 1;
+        fileSize += size + 1;
+      }
+    }
+  }
 
-  ShaderProgram_setUniformValue_Matrix4x4(shaderProgram.uniformLocation_view,
-    &viewTransformation);
-  ShaderProgram_setUniformValue_float(
-    shaderProgram.uniformLocation_opacity, 1);
-  ShaderProgram_setUniformValue_Matrix4x4(
-    shaderProgram.uniformLocation_model, &originTranslationTransformation);
+  if (fclose(file) != 0 || !success)
+    Common_terminate("SAVING", "The map file couldn't be written.");
 
-  //First, draw the skybox (the gradient around the game field).
-  BufferedMesh_draw(&skyboxMesh);
+  return fileSize;
+}
 
-  //Calculate the rotation transformation of the quest item, which is used 
-  //in different parts of the drawing function.
-  const Matrix4x4 meshRotationTransformation =
-    Matrix4x4_createRotationY(itemRotationY);
+//Contains the state of a map file which is decoded in parallel.
+typedef struct
+{
+  const uint8_t **chunks;
+  Field *fields;
+  int width, depth, chunkCountX, chunkCountZ;
+  //Set to true by any thread which found an invalid chunk.
+  bool isInvalid;
+} MapFileLoadContext;
+
+//Decodes a chunk of a map file into the map.
+//contextPointer: A pointer to the MapFileLoadContext.
+//chunkIndex: The index of the chunk in the file.
+void MapFile_decodeChunkIntoMap(void *contextPointer, int chunkIndex)
+{
+  MapFileLoadContext *self = (MapFileLoadContext *)contextPointer;
+  Field chunkFields[CHUNK_FIELD_COUNT];
+  const uint8_t *chunk = self->chunks[chunkIndex];
+  int chunksPerLevel = self->chunkCountX * self->chunkCountZ;
 
-  //If the quest item is currently "held" (it was picked up by the player),
-  //it will be drawn right at the player position - with backface culling and 
-  //a little translation downwards, only the rotation rings are visible to the
-  //player, giving us a "blessed by the gem" kind of look.
-  if (itemState == Held)
+  if (!MapFile_decodeChunk(chunk + 1, chunk[0], chunkFields))
   {
-    const Matrix4x4 meshHoverTranslationTransformation =
-      Matrix4x4_createTranslation(playerX, playerY - 0.2f, playerZ);
-    const Matrix4x4 meshTransformation = Matrix4x4_multiply(
-      &meshHoverTranslationTransformation, &meshRotationTransformation);
-    ShaderProgram_setUniformValue_Matrix4x4(
-      shaderProgram.uniformLocation_model, &meshTransformation);
-    BufferedMesh_draw(&crystalMesh);
+    self->isInvalid = true;
+    return;
   }
 
-  for (int x = 0; x < mapWidth; x++)
-  {
-    for (int z = 0; z < mapDepth; z++)
-    {
-      float fieldX, fieldZ;
-      Game_getMapFieldPositionByIndicies(x, z, &fieldX, &fieldZ);
+  MapFile_setChunkFields(self->fields, self->width, self->depth,
+    (chunkIndex % chunksPerLevel) / self->chunkCountZ,
+    chunkIndex / chunksPerLevel, chunkIndex % self->chunkCountZ, chunkFields);
+}
 
-      //Fields which are too far away to the player will be faded out. This
-      //both looks nice and makes things a bit more efficient. Even though that
-      //probably wouldn't be a bottleneck in an application like this.
-      float objectPlayerDistance =
-        (float)sqrt(pow(fieldX - (double)playerX, 2) +
-          pow(fieldZ - (double)playerZ, 2));
-      float distanceOpacity =
-        1 - MIN(MAX((objectPlayerDistance - 4.0f), 0), 1);
+//Loads a map file saved with "MapFile_save". The chunks are decoded in
+//parallel.
+//path: The path of the file.
+//width, depth, levels: Pointers to store the size of the map into.
+//pool: The pool used to decode the chunks.
+//Returns the fields of the map (level-major, then X-major), which need to be
+//freed with "free".
+//Terminates the application if the file couldn't be read or is invalid.
+Field *MapFile_load(const char *path, int *width, int *depth, int *levels,
+  WorkerPool *pool)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    Common_terminate("LOADING", "The map file couldn't be opened.");
+
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (fileSize < 16) Common_terminate("LOADING", "The map file is invalid.");
+
+  uint8_t *data = (uint8_t *)Common_allocate(fileSize);
+  if (fread(data, 1, fileSize, file) != (size_t)fileSize)
+    Common_terminate("LOADING", "The map file couldn't be read.");
+  fclose(file);
+
+  uint32_t fileWidth = MapFile_readUInt32(data + 4);
+  uint32_t fileDepth = MapFile_readUInt32(data + 8);
+  uint32_t fileLevels = MapFile_readUInt32(data + 12);
+  if (memcmp(data, mapFileMagic, sizeof(mapFileMagic)) != 0 ||
+    fileWidth == 0 || fileDepth == 0 || fileLevels == 0 ||
+    (double)fileWidth * fileDepth * fileLevels >= 2147483647.0)
+    Common_terminate("LOADING", "The map file is invalid.");
+
+  MapFileLoadContext context;
+  context.width = (int)fileWidth;
+  context.depth = (int)fileDepth;
+  context.chunkCountX = (context.width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  context.chunkCountZ = (context.depth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  context.isInvalid = false;
+
+  //The chunks have different sizes, so their positions need to be collected
+  //before they can be decoded in parallel.
+  int chunkCount = context.chunkCountX * context.chunkCountZ * (int)fileLevels;
+  context.chunks = (const uint8_t **)Common_allocate(
+    sizeof(uint8_t *) * chunkCount);
+  long position = 16;
+  for (int i = 0; i < chunkCount; i++)
+  {
+    if (position >= fileSize || position + 1 + data[position] > fileSize)
+      Common_terminate("LOADING", "The map file is incomplete.");
+    context.chunks[i] = data + position;
+    position += 1 + data[position];
+  }
 
-      if (distanceOpacity < EPSILON) continue;
+  context.fields = (Field *)Common_allocate(
+    sizeof(Field) * (size_t)fileWidth * fileDepth * fileLevels);
+  WorkerPool_parallelFor(pool, chunkCount, MapFile_decodeChunkIntoMap,
+    &context);
 
-      ShaderProgram_setUniformValue_float(
-        shaderProgram.uniformLocation_opacity, distanceOpacity);
+  if (context.isInvalid)
+    Common_terminate("LOADING", "The map file contains an invalid chunk.");
 
-      //Set the current field position as transformation matrix for subsequent
-      //drawing calls.
-      Field currentField = map[x * mapDepth + z];
+  free(context.chunks);
+  free(data);
 
-      const Matrix4x4 meshTranslationTransformation =
-        Matrix4x4_createTranslation(fieldX, 0, (float)z);
+  *width = context.width;
+  *depth = context.depth;
+  *levels = (int)fileLevels;
+  return context.fields;
+}
 
-      ShaderProgram_setUniformValue_Matrix4x4(
-        shaderProgram.uniformLocation_model, &meshTranslationTransformation);
+//=============================================================================
+// Analysis: Map validation and connectivity analysis.
+//=============================================================================
 
-      //Drawing the floor under a wall cube isn't required - with the other
-      //field types, it is.
-      if (currentField != Wall) BufferedMesh_draw(&floorMesh);
+//Contains the results of a map analysis (see "Analysis_analyzeMap").
+typedef struct
+{
+  //The amount of fields the player can walk on (everything besides walls,
+  //items and goals), which are connected horizontally and through lifts.
+  size_t walkableFieldCount, reachableFieldCount;
+  //The amount of separate regions of walkable fields.
+  int regionCount;
+  //The amount of walkable fields with exactly one walkable neighbour field.
+  int deadEndCount;
+  int liftCount;
+  //Items and goals count as reachable if the player can get close enough to
+  //interact with them (see the probe in "Game_onUpdate").
+  int itemCount, reachableItemCount;
+  int goalCount, reachableGoalCount;
+  bool hasSpawnPoint;
+  //The amount of bands the map was split into and the threads working on them.
+  int bandCount, threadCount;
+  size_t memoryBytes;
+  double labelSeconds, mergeSeconds, countSeconds, totalSeconds;
+} MapAnalysis;
+
+//Contains the partial results of the analysis of a band of the map - a range
+//of X indicies on all levels, which is processed by a single thread.
+typedef struct
+{
+  int startX, endX;
+  size_t walkableFieldCount, reachableFieldCount;
+  int regionCount, deadEndCount, liftCount;
+  int itemCount, reachableItemCount, goalCount, reachableGoalCount;
+  //The index of the spawn point field in the band or -1.
+  int spawnIndex;
+} AnalysisBand;
+
+//Contains the shared state of a running map analysis.
+typedef struct
+{
+  const Field *fields;
+  int width, depth, levels;
+  //The union-find forest of all fields (one entry per field, where roots
+  //point to themselves), which is only modified by the thread owning the band
+  //of the field until all bands are merged.
+  int *parents;
+  AnalysisBand *bands;
+  int bandCount;
+  //The root of the region containing the spawn point or -1.
+  int spawnRoot;
+} AnalysisContext;
+
+//Checks whether the player can walk on a field - like the collision test in
+//"Game_onUpdate", which only lets the player pass fields <= 0.
+bool Analysis_isWalkable(Field field)
+{
+  return field <= 0;
+}
 
-      if (currentField == Arch)
-        BufferedMesh_draw(&archMesh);
-      else if (currentField == Wall)
-        BufferedMesh_draw(&wallMesh);
-      else if (currentField == Item && itemState == Initial)
-      {
-        //As the item rotates, the transformation matrix needs to be updated
-        //once more here - as a combination of the translation based on the
-        //field position and the rotation calculated above already.
-        const Matrix4x4 meshTransformation = Matrix4x4_multiply(
-          &meshTranslationTransformation, &meshRotationTransformation);
-        ShaderProgram_setUniformValue_Matrix4x4(
-          shaderProgram.uniformLocation_model, &meshTransformation);
+//Checks whether a lift takes the player from a level to the level above and
+//back. A lift always goes up while its shaft continues upwards (see
+//"SessionBatch_stepRange"), so in a shaft over more than two levels, only
+//the two topmost levels are connected in both directions - the lower ones
+//can be left upwards, but never be reached again from above.
+//fields: The fields of the map (level-major, then X-major).
+//width, depth, levels: The size of the map.
+//index: The index of the field on the lower level.
+bool Analysis_isTwoWayLift(const Field *fields, int width, int depth,
+  int levels, int index)
+{
+  const int levelSize = width * depth;
+  int level = index / levelSize;
+  return level + 1 < levels && fields[index] == Lift &&
+    fields[index + levelSize] == Lift && !(level + 2 < levels &&
+    fields[index + 2 * levelSize] == Lift);
+}
 
-        BufferedMesh_draw(&crystalMesh);
-      }
-      else if (currentField == Goal)
-      {
-        BufferedMesh_draw(&tubeMesh);
+//Gets the walkable state of a field, treating fields out of bounds as walls.
+//self: A pointer to the analysis context.
+//x, level, z: The field indicies.
+bool Analysis_isWalkableAt(const AnalysisContext *self, int x, int level,
+  int z)
+{
+  if (x < 0 || x >= self->width || z < 0 || z >= self->depth) return false;
+  return Analysis_isWalkable(
+    self->fields[((size_t)level * self->width + x) * self->depth + z]);
+}
 
-        //If the player dropped the quest item at the target, the quest item
-        //will be drawn right above it... levitating and rotating in its glory.
-        if (itemState == Dropped)
-        {
-          const Matrix4x4 meshTransformation = Matrix4x4_multiply(
-            &meshTranslationTransformation, &meshRotationTransformation);
-          ShaderProgram_setUniformValue_Matrix4x4(
-            shaderProgram.uniformLocation_model, &meshTransformation);
-          BufferedMesh_draw(&crystalMesh);
-        }
-      }
-    }
+//Gets the root of the region of a field and halves the path to it.
+//parents: The union-find forest.
+//index: The index of the field.
+int Analysis_find(int *parents, int index)
+{
+  while (parents[index] != index)
+  {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
   }
-
-  glutSwapBuffers();
+  return index;
 }
 
-//Ocurrs after the configured update timer event fires.
-//Also re-registers the update event timer after invocation.
-void Game_onUpdate(int uselessValue)
+//Gets the root of the region of a field without modifying the forest, so that
+//it can be used by several threads at the same time.
+//parents: The union-find forest.
+//index: The index of the field.
+int Analysis_findWithoutCompression(const int *parents, int index)
 {
-  uselessValue;
+  while (parents[index] != index) index = parents[index];
+  return index;
+}
 
-  int currentUpdateTime = glutGet(GLUT_ELAPSED_TIME);
-  float deltaSeconds = (float)(currentUpdateTime - lastUpdateTime) / 1000;
-  currentTimeMs = (float)(currentUpdateTime % 1000);
+//Merges the regions of two fields. The root with the lower index becomes the
+//root of the merged region.
+//parents: The union-find forest.
+//a, b: The indicies of the two fields.
+void Analysis_union(int *parents, int a, int b)
+{
+  int rootA = Analysis_find(parents, a), rootB = Analysis_find(parents, b);
+  if (rootA < rootB) parents[rootB] = rootA;
+  else if (rootB < rootA) parents[rootA] = rootB;
+}
 
-  itemRotationY += deltaSeconds * ITEM_ROTATION_SPEED;
+//Builds the union-find forest of a band, only connecting fields inside of the
+//band, and counts the fields which don't depend on the connectivity.
+//contextPointer: A pointer to the AnalysisContext.
+//bandIndex: The index of the band.
+void Analysis_labelBand(void *contextPointer, int bandIndex)
+{
+  AnalysisContext *self = (AnalysisContext *)contextPointer;
+  AnalysisBand *band = &self->bands[bandIndex];
 
-  if (itemState == Initial && gameBrightness < 1.0f)
-    gameBrightness = MIN(1, gameBrightness + FADEOUT_SPEED * deltaSeconds);
-  else if (itemState == Dropped)
+  for (int level = 0; level < self->levels; level++)
   {
-    if (gameBrightness > 0.0f) gameBrightness -= FADEOUT_SPEED * deltaSeconds;
-    else
+    for (int x = band->startX; x < band->endX; x++)
     {
-      printf("You finished the game in %.2f seconds. Well done!\n",
-        (currentUpdateTime / 1000.0f));
-      Game_onDestroy();
+      for (int z = 0; z < self->depth; z++)
+      {
+        int index = (level * self->width + x) * self->depth + z;
+        Field field = self->fields[index];
+        self->parents[index] = index;
+
+        if (field == Item) band->itemCount++;
+        else if (field == Goal) band->goalCount++;
+        if (!Analysis_isWalkable(field)) continue;
+
+        band->walkableFieldCount++;
+        if (field == Init && band->spawnIndex < 0) band->spawnIndex = index;
+        if (field == Lift) band->liftCount++;
+
+        int neighbourCount =
+          (Analysis_isWalkableAt(self, x - 1, level, z) ? 1 : 0) +
+          (Analysis_isWalkableAt(self, x + 1, level, z) ? 1 : 0) +
+          (Analysis_isWalkableAt(self, x, level, z - 1) ? 1 : 0) +
+          (Analysis_isWalkableAt(self, x, level, z + 1) ? 1 : 0);
+        if (neighbourCount == 1 && field != Lift) band->deadEndCount++;
+
+        if (x > band->startX &&
+          Analysis_isWalkable(self->fields[index - self->depth]))
+          Analysis_union(self->parents, index, index - self->depth);
+        if (z > 0 && Analysis_isWalkable(self->fields[index - 1]))
+          Analysis_union(self->parents, index, index - 1);
+        if (level > 0 && Analysis_isTwoWayLift(self->fields, self->width,
+          self->depth, self->levels, index - self->width * self->depth))
+          Analysis_union(self->parents, index,
+            index - self->width * self->depth);
+      }
     }
   }
+}
 
-  //Calculate the current mouse position by checking how much the mouse was
-  //moved from the center of the window since the last update, storing the 
-  //distance as (absolute) mouse speed vector, and reposition the mouse to the
-  //center of the screen.
-  float mouseSpeedX = 0, mouseSpeedY = 0;
+//Checks whether the player can interact with a field from the region of the
+//spawn point (from any of the eight surrounding fields).
+//self: A pointer to the analysis context (with merged bands).
+//x, level, z: The field indicies.
+bool Analysis_isInteractable(const AnalysisContext *self, int x, int level,
+  int z)
+{
+  if (self->spawnRoot < 0) return false;
 
-  float capturedMouseX = currentWindowWidth / 2.0f;
-  float capturedMouseY = currentWindowHeight / 2.0f;
+  for (int probeX = x - 1; probeX <= x + 1; probeX++)
+    for (int probeZ = z - 1; probeZ <= z + 1; probeZ++)
+      if (Analysis_isWalkableAt(self, probeX, level, probeZ) &&
+        Analysis_findWithoutCompression(self->parents, (level * self->width +
+          probeX) * self->depth + probeZ) == self->spawnRoot) return true;
 
-  //Prevent the camera rotation to change too much until the game is actually 
-  //visible. Also prevents the camera to rotate wildly due to the initial 
-  //cursor warp to the screen center (which would otherwise be interpreted as
-  //very rapid mouse movement).
-  mouseSpeedX = (capturedMouseX - currentMouseX) * gameBrightness;
-  mouseSpeedY = (capturedMouseY - currentMouseY) * gameBrightness;
+  return false;
+}
 
-  glutSetCursor(GLUT_CURSOR_NONE);
-  glutWarpPointer((int)capturedMouseX, (int)capturedMouseY);
+//Counts the regions of a band and the fields, items and goals of the band
+//which can be reached from the spawn point. The forest isn't modified.
+//contextPointer: A pointer to the AnalysisContext (with merged bands).
+//bandIndex: The index of the band.
+void Analysis_countBand(void *contextPointer, int bandIndex)
+{
+  AnalysisContext *self = (AnalysisContext *)contextPointer;
+  AnalysisBand *band = &self->bands[bandIndex];
 
-  //This mouse movement is then added to the player rotation accerlation 
-  //(which will result into a smoother mouse movement afterwards).
-  //The accerlation is dampened a bit and then applied to the player rotation, 
-  //where the vertical mouse movement will eventually rotate the camera around 
-  //the players' X axis (which points to the "right") and the horizontal mouse 
-  //movement will rotate the camera around the players' Y axis (which points 
-  //to the "top").
-  playerRotationAccerlationX += mouseSpeedY * MOUSE_SPEED * deltaSeconds;
-  playerRotationAccerlationY += mouseSpeedX * MOUSE_SPEED * deltaSeconds;
-  playerRotationAccerlationX -=
-    playerRotationAccerlationX * MOUSE_FRICTION * deltaSeconds;
-  playerRotationAccerlationY -=
-    playerRotationAccerlationY * MOUSE_FRICTION * deltaSeconds;
-
-  playerRotationX += playerRotationAccerlationX;
-  playerRotationY += playerRotationAccerlationY;
-
-  //The raw (independent of the current player view) accerlation is calculated
-  //using the current keyboard input values.
-  float newAxisAccerlationX =
-    (inputRight ? 1.0f : 0) - (inputLeft ? 1 : 0);
-  float newAxisAccerlationZ =
-    (inputForward ? 1.0f : 0) - (inputBackwards ? 1.0f : 0);
-
-  //That new accerlation must be normalized so that the player doesn't move 
-  //faster when going into two different directions simultaneously 
-  //(e.g. forward and left).
-  float newAxisAccerlation =
-    (float)sqrt(pow(newAxisAccerlationX, 2) + pow(newAxisAccerlationZ, 2));
-  if (fabsf(newAxisAccerlation) > 1.0f)
-  {
-    newAxisAccerlationX /= newAxisAccerlation;
-    newAxisAccerlationZ /= newAxisAccerlation;
-  }
-
-  //Rotate the new "raw" accerlation depending the current player rotation 
-  //with some sin/cos magic.
-  float playerRotationYSin = (float)sin(Common_degToRad(playerRotationY));
-  float playerRotationYCos = (float)cos(Common_degToRad(playerRotationY));
-  float newAccerlationX = newAxisAccerlationX * playerRotationYCos
-    - newAxisAccerlationZ * playerRotationYSin;
-  float newAccerlationZ = newAxisAccerlationZ * playerRotationYCos
-    + newAxisAccerlationX * playerRotationYSin;
-
-  //Add the rotated accerlation to the overall rotation and apply friction.
-  playerAccerlationX = (playerAccerlationX + newAccerlationX *
-    (deltaSeconds * PLAYER_MAX_SPEED));
-  playerAccerlationZ = (playerAccerlationZ + newAccerlationZ *
-    (deltaSeconds * PLAYER_MAX_SPEED));
-
-  //If the player hits jump (and is currently on the floor), the vertical 
-  //accerlation is set to the PLAYER_JUMP_SPEED - so that the player bolts into
-  //the air without inertia. While airborne, the accerlation will slowly 
-  //decrease through continuosuly applied gravity. When the player falls back
-  //down and finally hits the floor, the player will slightly bounce off the
-  //floor a few times, depending on FLOOR_BOUNCYNESS, and then be static again.
-  //The FLOOR_BOUNCYNESS prevents another jump while bouncing though - if that
-  //is not wanted, FLOOR_BOUNCYNESS needs to be set to 0.
-  if (playerY > CALCULATION_TRESHOLD)
-    playerAccerlationY -= (PLAYER_GRAVITY * deltaSeconds);
-  else if (inputJump)
-    playerAccerlationY = PLAYER_JUMP_SPEED * deltaSeconds;
-  else if (fabsf(playerAccerlationY) > CALCULATION_TRESHOLD)
-    playerAccerlationY = -playerAccerlationY * FLOOR_BOUNCYNESS;
-  else playerAccerlationY = 0;
-
-  //Apply friction to the current player accerlation (on the X and Z axis).
-  playerAccerlationX -= playerAccerlationX * (deltaSeconds * PLAYER_FRICTION);
-  playerAccerlationZ -= playerAccerlationZ * (deltaSeconds * PLAYER_FRICTION);
-
-  //Calculate the new player position and make that the new position if it 
-  //doesn't collide with any fields that are not just "floor". If the player
-  //collides with a wall or another object, invert the accerlation to give us
-  //a small bounce effect.
-  float newPlayerX = playerX + playerAccerlationX;
-  float newPlayerY = MAX(0, playerY + playerAccerlationY);
-  float newPlayerZ = playerZ + playerAccerlationZ;
-
-  Field newPlayerField = Game_getMapFieldByPosition(newPlayerX, newPlayerZ);
-  if (newPlayerField <= 0)
-  {
-    playerX = newPlayerX;
-    playerZ = newPlayerZ;
+  for (int level = 0; level < self->levels; level++)
+  {
+    for (int x = band->startX; x < band->endX; x++)
+    {
+      for (int z = 0; z < self->depth; z++)
+      {
+        int index = (level * self->width + x) * self->depth + z;
+        Field field = self->fields[index];
+
+        if (field == Item && Analysis_isInteractable(self, x, level, z))
+          band->reachableItemCount++;
+        else if (field == Goal && Analysis_isInteractable(self, x, level, z))
+          band->reachableGoalCount++;
+        if (!Analysis_isWalkable(field)) continue;
+
+        if (self->parents[index] == index) band->regionCount++;
+        if (self->spawnRoot >= 0 && Analysis_findWithoutCompression(
+          self->parents, index) == self->spawnRoot)
+          band->reachableFieldCount++;
+      }
+    }
   }
-  else
+}
+
+//Analyzes the connectivity of a map: Every walkable field is assigned to a
+//region with a union-find forest, which is built for bands of the map in
+//parallel, and the bands are merged along their borders afterwards.
+//fields: The fields of the map (level-major, then X-major).
+//width: The width of the map (in fields).
+//depth: The depth of the map (in fields).
+//levels: The amount of levels of the map.
+//pool: The pool which is used to analyze the bands in parallel.
+//Returns the results of the analysis.
+//Terminates the application if the map is too big to be analyzed.
+MapAnalysis Analysis_analyzeMap(const Field *fields, int width, int depth,
+  int levels, WorkerPool *pool)
+{
+  MapAnalysis result;
+  AnalysisContext context;
+  double startTime = Common_getTimeSeconds();
+
+  if ((double)width * depth * levels >= 2147483647.0)
+    Common_terminate("ANALYSIS", "The map is too big to be analyzed.");
+
+  //Having a few bands more than threads helps to even out the workload, but
+  //every band adds another border to the merge step.
+  context.fields = fields;
+  context.width = width;
+  context.depth = depth;
+  context.levels = levels;
+  context.bandCount = MAX(1, MIN(width, (pool->threadCount + 1) * 4));
+  context.spawnRoot = -1;
+  context.parents = (int *)Common_allocate(
+    sizeof(int) * (size_t)width * depth * levels);
+  context.bands = (AnalysisBand *)Common_allocate(
+    sizeof(AnalysisBand) * context.bandCount);
+
+  for (int i = 0; i < context.bandCount; i++)
   {
-    playerAccerlationX = -playerAccerlationX;
-    playerAccerlationZ = -playerAccerlationZ;
-    playerX += playerAccerlationX;
-    playerZ += playerAccerlationZ;
+    AnalysisBand *band = &context.bands[i];
+    memset(band, 0, sizeof(AnalysisBand));
+    band->startX = (int)((long long)width * i / context.bandCount);
+    band->endX = (int)((long long)width * (i + 1) / context.bandCount);
+    band->spawnIndex = -1;
   }
 
-  playerY = newPlayerY;
+  WorkerPool_parallelFor(pool, context.bandCount, Analysis_labelBand,
+    &context);
+  double labelTime = Common_getTimeSeconds();
 
-  //If the player hits the interaction key and is close to the quest item, the
-  //item will be picked up. If he's currently carrying the item and is close
-  //to the goal, the item will be dropped into the goal and the game is done.
-  if (inputAction)
+  //Connect the regions along the borders between the bands.
+  for (int i = 1; i < context.bandCount; i++)
   {
-    int currentPlayerFieldX, currentPlayerFieldZ;
-    Game_getMapFieldIndiciesByPosition(playerX, playerZ,
-      &currentPlayerFieldX, &currentPlayerFieldZ);
-
-    for (int probeFieldX = currentPlayerFieldX - 1;
-      probeFieldX <= currentPlayerFieldX + 1; probeFieldX++)
+    int x = context.bands[i].startX;
+    for (int level = 0; level < levels; level++)
     {
-      for (int probeFieldZ = currentPlayerFieldZ - 1;
-        probeFieldZ <= currentPlayerFieldZ + 1; probeFieldZ++)
+      for (int z = 0; z < depth; z++)
       {
-        Field probedField =
-          Game_getMapFieldByIndicies(probeFieldX, probeFieldZ);
-
-        if (probedField == Item && itemState == Initial)
-          itemState = Held;
-        else if (probedField == Goal && itemState == Held)
-          itemState = Dropped;
+        int index = (level * width + x) * depth + z;
+        if (Analysis_isWalkable(fields[index]) &&
+          Analysis_isWalkable(fields[index - depth]))
+          Analysis_union(context.parents, index, index - depth);
       }
     }
   }
 
-  glutPostRedisplay();
+  for (int i = 0; i < context.bandCount && context.spawnRoot < 0; i++)
+    if (context.bands[i].spawnIndex >= 0)
+      context.spawnRoot =
+        Analysis_find(context.parents, context.bands[i].spawnIndex);
+  double mergeTime = Common_getTimeSeconds();
 
-  lastUpdateTime = currentUpdateTime;
+  WorkerPool_parallelFor(pool, context.bandCount, Analysis_countBand,
+    &context);
+  double countTime = Common_getTimeSeconds();
 
-  //I wonder what that mandatory value should really be used for...
-  glutTimerFunc(UPDATE_TIMEOUT_MS, Game_onUpdate, 42);
+  memset(&result, 0, sizeof(MapAnalysis));
+  for (int i = 0; i < context.bandCount; i++)
+  {
+    const AnalysisBand *band = &context.bands[i];
+    result.walkableFieldCount += band->walkableFieldCount;
+    result.reachableFieldCount += band->reachableFieldCount;
+    result.regionCount += band->regionCount;
+    result.deadEndCount += band->deadEndCount;
+    result.liftCount += band->liftCount;
+    result.itemCount += band->itemCount;
+    result.reachableItemCount += band->reachableItemCount;
+    result.goalCount += band->goalCount;
+    result.reachableGoalCount += band->reachableGoalCount;
+  }
+  result.hasSpawnPoint = context.spawnRoot >= 0;
+  result.bandCount = context.bandCount;
+  result.threadCount = MIN(pool->threadCount + 1, context.bandCount);
+  result.memoryBytes = sizeof(int) * (size_t)width * depth * levels +
+    sizeof(AnalysisBand) * context.bandCount;
+  result.labelSeconds = labelTime - startTime;
+  result.mergeSeconds = mergeTime - labelTime;
+  result.countSeconds = countTime - mergeTime;
+  result.totalSeconds = countTime - startTime;
+
+  free(context.parents);
+  free(context.bands);
+
+  return result;
+}
+
+//Checks whether a map can be completed: It needs a spawn point and at least
+//one quest item and goal - and all of them need to be reachable.
+//self: A pointer to the analysis results.
+bool Analysis_isValid(const MapAnalysis *self)
+{
+  return self->hasSpawnPoint && self->itemCount > 0 && self->goalCount > 0 &&
+    self->reachableItemCount == self->itemCount &&
+    self->reachableGoalCount == self->goalCount;
+}
+
+//Prints the results of a map analysis.
+//self: A pointer to the analysis results.
+void Analysis_print(const MapAnalysis *self)
+{
+  printf("Map analysis: %s. %llu walkable fields in %d regions, %llu of them "
+    "reachable from the spawn point. %d dead ends, %d lifts, %d/%d quest "
+    "items and %d/%d goals reachable.\n",
+    Analysis_isValid(self) ? "valid" : "INVALID",
+    (unsigned long long)self->walkableFieldCount, self->regionCount,
+    (unsigned long long)self->reachableFieldCount, self->deadEndCount,
+    self->liftCount, self->reachableItemCount, self->itemCount,
+    self->reachableGoalCount, self->goalCount);
+  printf("Map analysis took %.3f ms (labelling %.3f ms, merging %.3f ms, "
+    "counting %.3f ms) with %d bands on %d threads, using %.1f KiB.\n",
+    self->totalSeconds * 1000.0, self->labelSeconds * 1000.0,
+    self->mergeSeconds * 1000.0, self->countSeconds * 1000.0,
+    self->bandCount, self->threadCount, self->memoryBytes / 1024.0);
 }
 
 //=============================================================================
-// Main function.
+// Navigation: Distance fields towards the quest items and the goal.
 //=============================================================================
 
-int main(int argc, char **argv)
+//The distance of fields from which no target field can be reached.
+#define NAVIGATION_UNREACHABLE UINT32_MAX
+
+//Provides a read-only view on the fields of a (finite) map.
+typedef struct
 {
-  printf("** GemQuest **\n");
-  printf("Find the magic gem and yeet it into the GemContainer(TM)!\n");
-  printf("Move: WASD, Jump: Space, Interact: E, Look: Mouse, Exit: ESC.\n");
-  printf("Hint: If you can't move, click once with your left mouse button.\n");
-  printf("Run game in fullscreen ('f') or window ('w'): ");
-  int c = getchar();
+  //The fields (level-major, then X-major), which aren't owned by the view.
+  const Field *fields;
+  int width, depth, levels;
+} MapGrid;
+
+//Provides the distances (in steps between adjacent walkable fields or through
+//lifts) of all fields of a map to the closest field of a target type, which
+//allows finding the next step towards the target from any field in O(1).
+typedef struct
+{
+  //The field type the distances lead to.
+  Field target;
+  //The map the distances are calculated for.
+  MapGrid grid;
+  //The distance of every field (in the same layout as the fields), which is 0
+  //for the target fields and NAVIGATION_UNREACHABLE for unreachable fields.
+  uint32_t *distances;
+} DistanceField;
+
+//Contains a field index and a distance during the updates of a DistanceField.
+typedef struct
+{
+  int index;
+  uint32_t distance;
+} NavigationEntry;
+
+//Provides a growable array of NavigationEntry instances.
+typedef struct
+{
+  NavigationEntry *entries;
+  int count, capacity;
+} NavigationList;
+
+//The distance fields towards the quest items and the goal of the current map
+//(only available for finite maps, after the game was loaded).
+DistanceField itemDistanceField, goalDistanceField;
+
+//Appends an entry to a NavigationList, which grows if it's full.
+//self: A pointer to the list (initialized with zeros).
+//index: The field index.
+//distance: The distance.
+void NavigationList_push(NavigationList *self, int index, uint32_t distance)
+{
+  if (self->count == self->capacity)
+  {
+    int newCapacity = MAX(64, self->capacity * 2);
+    NavigationEntry *newEntries = (NavigationEntry *)Common_allocate(
+      sizeof(NavigationEntry) * newCapacity);
+    if (self->count > 0)
+      memcpy(newEntries, self->entries, sizeof(NavigationEntry) * self->count);
+    free(self->entries);
+    self->entries = newEntries;
+    self->capacity = newCapacity;
+  }
+
+  self->entries[self->count].index = index;
+  self->entries[self->count].distance = distance;
+  self->count++;
+}
+
+//Compares two NavigationEntry instances by their distance (for qsort).
+int NavigationList_compareDistances(const void *a, const void *b)
+{
+  uint32_t distanceA = ((const NavigationEntry *)a)->distance;
+  uint32_t distanceB = ((const NavigationEntry *)b)->distance;
+  return distanceA < distanceB ? -1 : (distanceA > distanceB ? 1 : 0);
+}
+
+//Initializes a MapGrid instance.
+//self: A pointer to the (uninitialized) view.
+//fields: The fields of the map (level-major, then X-major).
+//width, depth: The size of a level of the map (in fields).
+//levels: The amount of levels of the map.
+void MapGrid_initialize(MapGrid *self, const Field *fields, int width,
+  int depth, int levels)
+{
+  self->fields = fields;
+  self->width = width;
+  self->depth = depth;
+  self->levels = levels;
+}
+
+//Gets the indicies of the fields a field is connected to: the (up to four)
+//adjacent fields on the same level and the lift above or below - if the
+//field itself is a lift which takes the player there and back (see
+//"Analysis_isTwoWayLift"). The connections are used in both directions, so
+//lifts which only go up are left out. Whether these fields can be walked on
+//isn't checked.
+//self: A pointer to the map view.
+//index: The index of the field.
+//neighbours: The target for at most six field indicies.
+//Returns the amount of neighbour fields.
+int MapGrid_getNeighbours(const MapGrid *self, int index, int *neighbours)
+{
+  const int levelSize = self->width * self->depth;
+  int level = index / levelSize;
+  int x = (index % levelSize) / self->depth, z = index % self->depth;
+  int count = 0;
+
+  if (x > 0) neighbours[count++] = index - self->depth;
+  if (x + 1 < self->width) neighbours[count++] = index + self->depth;
+  if (z > 0) neighbours[count++] = index - 1;
+  if (z + 1 < self->depth) neighbours[count++] = index + 1;
+
+  if (self->fields[index] == Lift)
+  {
+    if (level > 0 && Analysis_isTwoWayLift(self->fields, self->width,
+      self->depth, self->levels, index - levelSize))
+      neighbours[count++] = index - levelSize;
+    if (Analysis_isTwoWayLift(self->fields, self->width, self->depth,
+      self->levels, index))
+      neighbours[count++] = index + levelSize;
+  }
+
+  return count;
+}
+
+//Calculates the distance of a field from the distances of its neighbours.
+//self: A pointer to the distance field.
+//index: The index of the field.
+uint32_t DistanceField_getLocalDistance(const DistanceField *self, int index)
+{
+  int neighbours[6];
+  uint32_t distance = NAVIGATION_UNREACHABLE;
+
+  if (self->grid.fields[index] == self->target) return 0;
+  if (!Analysis_isWalkable(self->grid.fields[index])) return distance;
+
+  int neighbourCount = MapGrid_getNeighbours(&self->grid, index, neighbours);
+  for (int i = 0; i < neighbourCount; i++)
+    if (self->distances[neighbours[i]] != NAVIGATION_UNREACHABLE)
+      distance = MIN(distance, self->distances[neighbours[i]] + 1);
+
+  return distance;
+}
+
+//Propagates lowered distances through the map (in order of their distance,
+//like a breadth-first search with multiple start fields).
+//self: A pointer to the distance field.
+//seeds: The fields with their new (lower) distances, sorted by distance.
+//queue: An empty list used as queue.
+void DistanceField_propagate(DistanceField *self, const NavigationList *seeds,
+  NavigationList *queue)
+{
+  int neighbours[6];
+  int nextSeed = 0, queueHead = 0;
+
+  while (nextSeed < seeds->count || queueHead < queue->count)
+  {
+    //As both the seeds and the queue are sorted by distance, merging them
+    //keeps the fields in order of their distance.
+    NavigationEntry entry;
+    if (queueHead >= queue->count || (nextSeed < seeds->count &&
+      seeds->entries[nextSeed].distance <=
+      queue->entries[queueHead].distance))
+    {
+      entry = seeds->entries[nextSeed++];
+      if (entry.distance >= self->distances[entry.index]) continue;
+      self->distances[entry.index] = entry.distance;
+    }
+    else entry = queue->entries[queueHead++];
+
+    int neighbourCount =
+      MapGrid_getNeighbours(&self->grid, entry.index, neighbours);
+    for (int i = 0; i < neighbourCount; i++)
+    {
+      int neighbour = neighbours[i];
+      if (self->distances[neighbour] > entry.distance + 1 &&
+        Analysis_isWalkable(self->grid.fields[neighbour]))
+      {
+        self->distances[neighbour] = entry.distance + 1;
+        NavigationList_push(queue, neighbour, entry.distance + 1);
+      }
+    }
+  }
+}
+
+//Initializes a distance field and calculates the distances of all fields.
+//self: A pointer to the (uninitialized) distance field.
+//target: The field type the distances should lead to.
+//fields: The fields of the map (level-major, then X-major), which need to
+//stay available until the distance field is destroyed.
+//width, depth: The size of a level of the map (in fields).
+//levels: The amount of levels of the map.
+void DistanceField_initialize(DistanceField *self, Field target,
+  const Field *fields, int width, int depth, int levels)
+{
+  const int fieldCount = width * depth * levels;
+  NavigationList seeds, queue;
+  memset(&seeds, 0, sizeof(NavigationList));
+  memset(&queue, 0, sizeof(NavigationList));
+
+  self->target = target;
+  MapGrid_initialize(&self->grid, fields, width, depth, levels);
+  self->distances = (uint32_t *)Common_allocate(sizeof(uint32_t) * fieldCount);
+
+  for (int i = 0; i < fieldCount; i++)
+  {
+    self->distances[i] = NAVIGATION_UNREACHABLE;
+    if (fields[i] == target) NavigationList_push(&seeds, i, 0);
+  }
+
+  DistanceField_propagate(self, &seeds, &queue);
+
+  free(seeds.entries);
+  free(queue.entries);
+}
+
+//Releases the resources of a distance field.
+void DistanceField_destroy(DistanceField *self)
+{
+  free(self->distances);
+  self->distances = NULL;
+}
+
+//Updates the distances after a single field was changed. Only the fields
+//whose distance actually changes are visited: if the distance of the changed
+//field increased, all fields which depended on it (and have no other
+//neighbour with the same distance) are invalidated first and then calculated
+//again from the remaining fields around them.
+//self: A pointer to the distance field.
+//index: The index of the changed field.
+void DistanceField_updateField(DistanceField *self, int index)
+{
+  NavigationList seeds, queue;
+  int neighbours[6], supportNeighbours[6];
+  uint32_t oldDistance = self->distances[index];
+  uint32_t newDistance = DistanceField_getLocalDistance(self, index);
+
+  if (newDistance == oldDistance) return;
+
+  memset(&seeds, 0, sizeof(NavigationList));
+  memset(&queue, 0, sizeof(NavigationList));
+
+  if (newDistance < oldDistance)
+    NavigationList_push(&seeds, index, newDistance);
+  else
+  {
+    //The queue contains the invalidated fields with their previous distance.
+    self->distances[index] = NAVIGATION_UNREACHABLE;
+    NavigationList_push(&queue, index, oldDistance);
+
+    for (int i = 0; i < queue.count; i++)
+    {
+      NavigationEntry entry = queue.entries[i];
+      int neighbourCount =
+        MapGrid_getNeighbours(&self->grid, entry.index, neighbours);
+
+      for (int j = 0; j < neighbourCount; j++)
+      {
+        int neighbour = neighbours[j];
+        uint32_t distance = self->distances[neighbour];
+        if (distance == NAVIGATION_UNREACHABLE ||
+          distance != entry.distance + 1) continue;
+
+        bool isSupported = false;
+        int supportCount =
+          MapGrid_getNeighbours(&self->grid, neighbour, supportNeighbours);
+        for (int k = 0; k < supportCount && !isSupported; k++)
+          isSupported = self->distances[supportNeighbours[k]] + 1 == distance;
+
+        if (!isSupported)
+        {
+          self->distances[neighbour] = NAVIGATION_UNREACHABLE;
+          NavigationList_push(&queue, neighbour, distance);
+        }
+      }
+    }
+
+    for (int i = 0; i < queue.count; i++)
+    {
+      uint32_t distance =
+        DistanceField_getLocalDistance(self, queue.entries[i].index);
+      if (distance != NAVIGATION_UNREACHABLE)
+        NavigationList_push(&seeds, queue.entries[i].index, distance);
+    }
+    qsort(seeds.entries, seeds.count, sizeof(NavigationEntry),
+      NavigationList_compareDistances);
+    queue.count = 0;
+  }
+
+  DistanceField_propagate(self, &seeds, &queue);
+
+  free(seeds.entries);
+  free(queue.entries);
+}
+
+//Updates the distances after a field of the map was changed.
+//self: A pointer to the distance field.
+//x, level, z: The indicies of the changed field.
+void DistanceField_onFieldChanged(DistanceField *self, int x, int level, int z)
+{
+  const int levelSize = self->grid.width * self->grid.depth;
+  int index = (level * self->grid.width + x) * self->grid.depth + z;
+
+  //A changed lift might also have connected or disconnected the lifts above
+  //and below (and the two lifts below, as their shaft continues upwards
+  //now), whose distances need to be checked too.
+  DistanceField_updateField(self, index);
+  if (level > 1) DistanceField_updateField(self, index - 2 * levelSize);
+  if (level > 0) DistanceField_updateField(self, index - levelSize);
+  if (level + 1 < self->grid.levels)
+    DistanceField_updateField(self, index + levelSize);
+}
+
+//Gets the distance of a field to the closest target field.
+//self: A pointer to the distance field.
+//x, level, z: The indicies of the field (within the map boundaries).
+//Returns the distance in steps or NAVIGATION_UNREACHABLE.
+uint32_t DistanceField_getDistance(const DistanceField *self, int x,
+  int level, int z)
+{
+  return self->distances[(level * self->grid.width + x) * self->grid.depth + z];
+}
+
+//Gets the next field on a shortest path from a field to the closest target.
+//self: A pointer to the distance field.
+//x, level, z: The indicies of the field (within the map boundaries).
+//nextX, nextLevel, nextZ: Pointers to store the indicies of the next field
+//into - which is the target field itself for fields right next to it.
+//Returns false if the field is a target field or no target can be reached.
+bool DistanceField_getNextStep(const DistanceField *self, int x, int level,
+  int z, int *nextX, int *nextLevel, int *nextZ)
+{
+  const int levelSize = self->grid.width * self->grid.depth;
+  int index = (level * self->grid.width + x) * self->grid.depth + z;
+  int neighbours[6];
+  uint32_t distance = self->distances[index];
+
+  if (distance == 0 || distance == NAVIGATION_UNREACHABLE) return false;
+
+  int neighbourCount = MapGrid_getNeighbours(&self->grid, index, neighbours);
+  for (int i = 0; i < neighbourCount; i++)
+  {
+    if (self->distances[neighbours[i]] + 1 == distance)
+    {
+      *nextLevel = neighbours[i] / levelSize;
+      *nextX = (neighbours[i] % levelSize) / self->grid.depth;
+      *nextZ = neighbours[i] % self->grid.depth;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//Calculates the distance fields towards the quest items and the goal of the
+//current map and prints how long that took.
+void Navigation_initialize(void)
+{
+  double startTime = Common_getTimeSeconds();
+
+  DistanceField_initialize(&itemDistanceField, Item, map, mapWidth, mapDepth,
+    mapLevels);
+  DistanceField_initialize(&goalDistanceField, Goal, map, mapWidth, mapDepth,
+    mapLevels);
+
+  printf("Navigation: Distance fields calculated in %.3f ms, using %.1f KiB.\n",
+    (Common_getTimeSeconds() - startTime) * 1000.0,
+    2.0 * sizeof(uint32_t) * mapWidth * mapDepth * mapLevels / 1024.0);
+}
+
+//Updates the distance fields (if they're available) after a field of the
+//current map was changed.
+//x, level, z: The indicies of the changed field.
+void Navigation_onFieldChanged(int x, int level, int z)
+{
+  if (itemDistanceField.distances == NULL) return;
+
+  DistanceField_onFieldChanged(&itemDistanceField, x, level, z);
+  DistanceField_onFieldChanged(&goalDistanceField, x, level, z);
+}
+
+//Releases the distance fields.
+void Navigation_destroy(void)
+{
+  DistanceField_destroy(&itemDistanceField);
+  DistanceField_destroy(&goalDistanceField);
+}
+
+//=============================================================================
+// Pathfinding: Point-to-point paths with A* and hierarchical A* (HPA*).
+//=============================================================================
+
+//The edge length of the clusters of the hierarchical pathfinder in fields.
+#define HPA_CLUSTER_SIZE CHUNK_SIZE
+#define HPA_CLUSTER_FIELD_COUNT (HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE)
+
+//Provides the A* search on the fields of a map, which is the reference for
+//the hierarchical pathfinder.
+typedef struct
+{
+  MapGrid grid;
+  //The search state of every field, which is only valid if the generation of
+  //the field matches the generation of the current search - so that the
+  //state doesn't need to be reset for every search.
+  uint32_t *costs, *generations;
+  int *parents;
+  uint32_t generation;
+  //The open list as binary heap, sorted by the estimated path length.
+  NavigationList open;
+  //The amount of fields expanded by all searches so far.
+  long long expandedFieldCount;
+} GridPathfinder;
+
+//An edge of the abstract graph of the hierarchical pathfinder.
+typedef struct
+{
+  int from, to;
+  uint32_t cost;
+} PathEdge;
+
+//Provides the hierarchical pathfinder: The map is divided into clusters of
+//HPA_CLUSTER_SIZE x HPA_CLUSTER_SIZE fields. The fields where neighbour
+//clusters are connected (one per gap in the border between them, and both
+//ends of every lift) are the nodes of an abstract graph, whose edges are the
+//connections between the clusters and the precalculated shortest paths
+//between the nodes inside of every cluster. Searches only use the abstract
+//graph - the path between two nodes is only calculated when needed.
+//Once built, the pathfinder is read-only and can be shared between threads.
+typedef struct
+{
+  MapGrid grid;
+  int clusterCountX, clusterCountZ, clusterCount;
+  //The fields of the nodes, sorted by their cluster.
+  int *nodeFields;
+  int nodeCount;
+  //The index of the first node of every cluster (and the node count).
+  int *clusterFirstNodes;
+  //The edges of every node: the edges of the node n are the ones from
+  //nodeFirstEdges[n] to nodeFirstEdges[n + 1].
+  int *nodeFirstEdges, *edgeTargets;
+  uint32_t *edgeCosts;
+  int edgeCount;
+} HierarchicalPathfinder;
+
+//Contains the state of a search with a HierarchicalPathfinder. Every thread
+//searching at the same time needs its own instance.
+typedef struct
+{
+  //The search state of every node (see GridPathfinder).
+  uint32_t *costs, *generations;
+  int *parents;
+  uint32_t generation;
+  NavigationList open;
+  //The distances from the start and the goal field to all fields of their
+  //clusters.
+  uint32_t startDistances[HPA_CLUSTER_FIELD_COUNT];
+  uint32_t goalDistances[HPA_CLUSTER_FIELD_COUNT];
+} HierarchicalPathSearch;
+
+//Adds an entry to a NavigationList used as binary min-heap.
+//self: A pointer to the heap.
+//index: The field or node index.
+//priority: The priority of the entry (stored as distance of the entry).
+void NavigationList_pushHeap(NavigationList *self, int index,
+  uint32_t priority)
+{
+  NavigationList_push(self, index, priority);
+
+  for (int child = self->count - 1; child > 0;)
+  {
+    int parent = (child - 1) / 2;
+    if (self->entries[parent].distance <= self->entries[child].distance)
+      break;
+    NavigationEntry swap = self->entries[parent];
+    self->entries[parent] = self->entries[child];
+    self->entries[child] = swap;
+    child = parent;
+  }
+}
+
+//Removes the entry with the lowest priority from a NavigationList used as
+//binary min-heap.
+//self: A pointer to the (non-empty) heap.
+//Returns the removed entry.
+NavigationEntry NavigationList_popHeap(NavigationList *self)
+{
+  NavigationEntry top = self->entries[0];
+  self->entries[0] = self->entries[--self->count];
+
+  for (int parent = 0;;)
+  {
+    int smallest = parent, left = parent * 2 + 1, right = parent * 2 + 2;
+    if (left < self->count &&
+      self->entries[left].distance < self->entries[smallest].distance)
+      smallest = left;
+    if (right < self->count &&
+      self->entries[right].distance < self->entries[smallest].distance)
+      smallest = right;
+    if (smallest == parent) break;
+    NavigationEntry swap = self->entries[parent];
+    self->entries[parent] = self->entries[smallest];
+    self->entries[smallest] = swap;
+    parent = smallest;
+  }
+
+  return top;
+}
+
+//Estimates the path length between two fields without ever overestimating
+//it (the Manhattan distance, where changing the level takes one step).
+//self: A pointer to the map view.
+//a, b: The indicies of the fields.
+uint32_t MapGrid_estimateDistance(const MapGrid *self, int a, int b)
+{
+  const int levelSize = self->width * self->depth;
+  int levelA = a / levelSize, levelB = b / levelSize;
+  int xA = (a % levelSize) / self->depth, xB = (b % levelSize) / self->depth;
+  int zA = a % self->depth, zB = b % self->depth;
+  return (uint32_t)(abs(levelA - levelB) + abs(xA - xB) + abs(zA - zB));
+}
+
+//Stores the fields of a path into a list, which is built backwards from the
+//parents of the fields and then reversed.
+//path: The target list, which is cleared first. The distance of every entry
+//is the step index.
+//parents: The parent of every field or node index (-1 for the first one).
+//fields: The field of every node index or NULL if the indicies are fields.
+//last: The index of the last field or node of the path.
+void Pathfinding_storePath(NavigationList *path, const int *parents,
+  const int *fields, int last)
+{
+  path->count = 0;
+  for (int index = last; index >= 0; index = parents[index])
+    NavigationList_push(path, fields != NULL ? fields[index] : index, 0);
+
+  for (int i = 0; i < path->count / 2; i++)
+  {
+    NavigationEntry swap = path->entries[i];
+    path->entries[i] = path->entries[path->count - 1 - i];
+    path->entries[path->count - 1 - i] = swap;
+  }
+  for (int i = 0; i < path->count; i++) path->entries[i].distance = i;
+}
+
+//Initializes a GridPathfinder instance.
+//self: A pointer to the (uninitialized) pathfinder.
+//fields, width, depth, levels: The map (see "MapGrid_initialize").
+void GridPathfinder_initialize(GridPathfinder *self, const Field *fields,
+  int width, int depth, int levels)
+{
+  const size_t fieldCount = (size_t)width * depth * levels;
+
+  MapGrid_initialize(&self->grid, fields, width, depth, levels);
+  self->costs = (uint32_t *)Common_allocate(sizeof(uint32_t) * fieldCount);
+  self->generations =
+    (uint32_t *)Common_allocate(sizeof(uint32_t) * fieldCount);
+  self->parents = (int *)Common_allocate(sizeof(int) * fieldCount);
+  memset(self->generations, 0, sizeof(uint32_t) * fieldCount);
+  self->generation = 0;
+  memset(&self->open, 0, sizeof(NavigationList));
+  self->expandedFieldCount = 0;
+}
+
+//Releases the resources of a GridPathfinder instance.
+void GridPathfinder_destroy(GridPathfinder *self)
+{
+  free(self->costs);
+  free(self->generations);
+  free(self->parents);
+  free(self->open.entries);
+}
+
+//Finds a shortest path between two walkable fields.
+//self: A pointer to the pathfinder.
+//start: The index of the start field.
+//goal: The index of the goal field.
+//path: The list to store the fields of the path into or NULL.
+//Returns the length of the path or NAVIGATION_UNREACHABLE.
+uint32_t GridPathfinder_findPath(GridPathfinder *self, int start, int goal,
+  NavigationList *path)
+{
+  const MapGrid *grid = &self->grid;
+  int neighbours[6];
+
+  if (!Analysis_isWalkable(grid->fields[start]) ||
+    !Analysis_isWalkable(grid->fields[goal])) return NAVIGATION_UNREACHABLE;
+
+  self->generation++;
+  self->open.count = 0;
+  self->costs[start] = 0;
+  self->parents[start] = -1;
+  self->generations[start] = self->generation;
+  NavigationList_pushHeap(&self->open, start,
+    MapGrid_estimateDistance(grid, start, goal));
+
+  while (self->open.count > 0)
+  {
+    NavigationEntry entry = NavigationList_popHeap(&self->open);
+    uint32_t cost = self->costs[entry.index];
+
+    //Fields can be in the heap several times - only the entry with the
+    //lowest cost is expanded.
+    if (entry.distance > cost + MapGrid_estimateDistance(grid, entry.index,
+      goal)) continue;
+
+    if (entry.index == goal)
+    {
+      if (path != NULL) Pathfinding_storePath(path, self->parents, NULL, goal);
+      return cost;
+    }
+    self->expandedFieldCount++;
+
+    int neighbourCount = MapGrid_getNeighbours(grid, entry.index, neighbours);
+    for (int i = 0; i < neighbourCount; i++)
+    {
+      int neighbour = neighbours[i];
+      if (!Analysis_isWalkable(grid->fields[neighbour])) continue;
+      if (self->generations[neighbour] == self->generation &&
+        self->costs[neighbour] <= cost + 1) continue;
+
+      self->generations[neighbour] = self->generation;
+      self->costs[neighbour] = cost + 1;
+      self->parents[neighbour] = entry.index;
+      NavigationList_pushHeap(&self->open, neighbour,
+        cost + 1 + MapGrid_estimateDistance(grid, neighbour, goal));
+    }
+  }
+
+  return NAVIGATION_UNREACHABLE;
+}
+
+//Gets the index of the cluster of a field.
+//self: A pointer to the pathfinder.
+//field: The index of the field.
+int HierarchicalPathfinder_getCluster(const HierarchicalPathfinder *self,
+  int field)
+{
+  const int levelSize = self->grid.width * self->grid.depth;
+  int x = (field % levelSize) / self->grid.depth, z = field % self->grid.depth;
+  return (field / levelSize) * self->clusterCountX * self->clusterCountZ +
+    (x / HPA_CLUSTER_SIZE) * self->clusterCountZ + z / HPA_CLUSTER_SIZE;
+}
+
+//Gets the index of a field inside of its cluster.
+//self: A pointer to the pathfinder.
+//field: The index of the field.
+int HierarchicalPathfinder_getLocalIndex(const HierarchicalPathfinder *self,
+  int field)
+{
+  int x = (field % (self->grid.width * self->grid.depth)) / self->grid.depth;
+  int z = field % self->grid.depth;
+  return (x % HPA_CLUSTER_SIZE) * HPA_CLUSTER_SIZE + z % HPA_CLUSTER_SIZE;
+}
+
+//Calculates the distances from a field to all fields of its cluster, only
+//using paths inside of the cluster (a breadth-first search).
+//self: A pointer to the pathfinder.
+//field: The index of the start field.
+//distances: The target for HPA_CLUSTER_FIELD_COUNT distances (by local index).
+//parents: The target for HPA_CLUSTER_FIELD_COUNT parents (the local index of
+//the previous field on the path, -1 for the start field) or NULL.
+void HierarchicalPathfinder_searchCluster(const HierarchicalPathfinder *self,
+  int field, uint32_t *distances, int *parents)
+{
+  const int levelSize = self->grid.width * self->grid.depth;
+  int queue[HPA_CLUSTER_FIELD_COUNT];
+  int queueHead = 0, queueCount = 0;
+
+  //The field index of the local index 0 and the size of the cluster, which
+  //might be smaller on the border of the map.
+  int x = (field % levelSize) / self->grid.depth, z = field % self->grid.depth;
+  int originX = x - x % HPA_CLUSTER_SIZE, originZ = z - z % HPA_CLUSTER_SIZE;
+  int origin = (field / levelSize) * levelSize + originX * self->grid.depth +
+    originZ;
+  int sizeX = MIN(HPA_CLUSTER_SIZE, self->grid.width - originX);
+  int sizeZ = MIN(HPA_CLUSTER_SIZE, self->grid.depth - originZ);
+
+  for (int i = 0; i < HPA_CLUSTER_FIELD_COUNT; i++)
+    distances[i] = NAVIGATION_UNREACHABLE;
+
+  int start = (x - originX) * HPA_CLUSTER_SIZE + (z - originZ);
+  distances[start] = 0;
+  if (parents != NULL) parents[start] = -1;
+  queue[queueCount++] = start;
+
+  while (queueHead < queueCount)
+  {
+    int local = queue[queueHead++];
+    int localX = local / HPA_CLUSTER_SIZE, localZ = local % HPA_CLUSTER_SIZE;
+    int neighbours[4], neighbourCount = 0;
+    if (localX > 0) neighbours[neighbourCount++] = local - HPA_CLUSTER_SIZE;
+    if (localX + 1 < sizeX)
+      neighbours[neighbourCount++] = local + HPA_CLUSTER_SIZE;
+    if (localZ > 0) neighbours[neighbourCount++] = local - 1;
+    if (localZ + 1 < sizeZ) neighbours[neighbourCount++] = local + 1;
+
+    for (int i = 0; i < neighbourCount; i++)
+    {
+      int neighbour = neighbours[i];
+      if (distances[neighbour] != NAVIGATION_UNREACHABLE ||
+        !Analysis_isWalkable(self->grid.fields[origin +
+          (neighbour / HPA_CLUSTER_SIZE) * self->grid.depth +
+          neighbour % HPA_CLUSTER_SIZE])) continue;
+      distances[neighbour] = distances[local] + 1;
+      if (parents != NULL) parents[neighbour] = local;
+      queue[queueCount++] = neighbour;
+    }
+  }
+}
+
+//Gets the node of a field.
+//self: A pointer to the pathfinder.
+//field: The index of the field.
+//Returns the index of the node or -1 if the field isn't a node.
+int HierarchicalPathfinder_findNode(const HierarchicalPathfinder *self,
+  int field)
+{
+  int cluster = HierarchicalPathfinder_getCluster(self, field);
+  int low = self->clusterFirstNodes[cluster];
+  int high = self->clusterFirstNodes[cluster + 1] - 1;
+
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+    if (self->nodeFields[middle] == field) return middle;
+    else if (self->nodeFields[middle] < field) low = middle + 1;
+    else high = middle - 1;
+  }
+
+  return -1;
+}
+
+//Compares two node candidates (with the field index as index and the
+//cluster as distance) by their cluster and field (for qsort).
+int HierarchicalPathfinder_compareNodes(const void *a, const void *b)
+{
+  const NavigationEntry *nodeA = (const NavigationEntry *)a;
+  const NavigationEntry *nodeB = (const NavigationEntry *)b;
+  if (nodeA->distance != nodeB->distance)
+    return nodeA->distance < nodeB->distance ? -1 : 1;
+  return nodeA->index < nodeB->index ? -1 : (nodeA->index > nodeB->index);
+}
+
+//Compares two edges by their start node (for qsort).
+int HierarchicalPathfinder_compareEdges(const void *a, const void *b)
+{
+  const PathEdge *edgeA = (const PathEdge *)a, *edgeB = (const PathEdge *)b;
+  return edgeA->from < edgeB->from ? -1 : (edgeA->from > edgeB->from);
+}
+
+//Adds a connection between two fields of different clusters (which become
+//nodes) to the lists of a pathfinder which is initialized.
+//self: A pointer to the pathfinder.
+//a, b: The indicies of the connected fields.
+//nodes: The list of node candidates.
+//connections: The list of connections (stored as index and distance).
+void HierarchicalPathfinder_addConnection(const HierarchicalPathfinder *self,
+  int a, int b, NavigationList *nodes, NavigationList *connections)
+{
+  NavigationList_push(nodes, a, HierarchicalPathfinder_getCluster(self, a));
+  NavigationList_push(nodes, b, HierarchicalPathfinder_getCluster(self, b));
+  NavigationList_push(connections, a, (uint32_t)b);
+}
+
+//Gets a field next to a border between clusters.
+//self: A pointer to the pathfinder.
+//level: The level of the field.
+//border: 0 for borders between X coordinates, 1 for Z coordinates.
+//line: The X (or Z) coordinate of the field.
+//position: The Z (or X) coordinate of the field.
+//Returns the index of the field.
+int HierarchicalPathfinder_getBorderField(const HierarchicalPathfinder *self,
+  int level, int border, int line, int position)
+{
+  if (border == 0)
+    return (level * self->grid.width + line) * self->grid.depth + position;
+  else return (level * self->grid.width + position) * self->grid.depth + line;
+}
+
+//Initializes a hierarchical pathfinder and builds its abstract graph.
+//self: A pointer to the (uninitialized) pathfinder.
+//fields, width, depth, levels: The map (see "MapGrid_initialize").
+void HierarchicalPathfinder_initialize(HierarchicalPathfinder *self,
+  const Field *fields, int width, int depth, int levels)
+{
+  NavigationList nodes, connections;
+  memset(&nodes, 0, sizeof(NavigationList));
+  memset(&connections, 0, sizeof(NavigationList));
+
+  MapGrid_initialize(&self->grid, fields, width, depth, levels);
+  self->clusterCountX = (width + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+  self->clusterCountZ = (depth + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+  self->clusterCount = self->clusterCountX * self->clusterCountZ * levels;
+
+  //Find the connections between the clusters: On every cluster border, each
+  //gap (a run of walkable fields on both sides) gets one connection in its
+  //middle - the lifts connect the clusters of different levels.
+  for (int level = 0; level < levels; level++)
+  {
+    for (int border = 0; border < 2; border++)
+    {
+      //The border between the fields (x, z) and (x + 1, z) or (x, z + 1).
+      int lineCount = border == 0 ? width : depth;
+      int lineLength = border == 0 ? depth : width;
+      for (int line = HPA_CLUSTER_SIZE - 1; line + 1 < lineCount;
+        line += HPA_CLUSTER_SIZE)
+      {
+        int gapStart = -1;
+        for (int i = 0; i <= lineLength; i++)
+        {
+          bool isOpen = i < lineLength &&
+            Analysis_isWalkable(fields[HierarchicalPathfinder_getBorderField(
+              self, level, border, line, i)]) &&
+            Analysis_isWalkable(fields[HierarchicalPathfinder_getBorderField(
+              self, level, border, line + 1, i)]);
+
+          //Gaps are split where the clusters along the border change.
+          if (gapStart >= 0 && (!isOpen || i % HPA_CLUSTER_SIZE == 0))
+          {
+            int middle = (gapStart + i - 1) / 2;
+            HierarchicalPathfinder_addConnection(self,
+              HierarchicalPathfinder_getBorderField(self, level, border, line,
+                middle), HierarchicalPathfinder_getBorderField(self, level,
+                border, line + 1, middle), &nodes, &connections);
+            gapStart = -1;
+          }
+          if (isOpen && gapStart < 0) gapStart = i;
+        }
+      }
+    }
+
+    if (level + 1 < levels)
+    {
+      for (int i = level * width * depth; i < (level + 1) * width * depth; i++)
+        if (Analysis_isTwoWayLift(fields, width, depth, levels, i))
+          HierarchicalPathfinder_addConnection(self, i, i + width * depth,
+            &nodes, &connections);
+    }
+  }
+
+  //Sort the nodes by their cluster and remove duplicates (fields which are
+  //part of several connections).
+  qsort(nodes.entries, nodes.count, sizeof(NavigationEntry),
+    HierarchicalPathfinder_compareNodes);
+  self->nodeFields = (int *)Common_allocate(sizeof(int) * nodes.count);
+  self->clusterFirstNodes =
+    (int *)Common_allocate(sizeof(int) * (self->clusterCount + 1));
+  self->nodeCount = 0;
+  for (int i = 0; i < nodes.count; i++)
+    if (i == 0 || nodes.entries[i].index != nodes.entries[i - 1].index)
+      self->nodeFields[self->nodeCount++] = nodes.entries[i].index;
+
+  for (int cluster = 0, node = 0; cluster <= self->clusterCount; cluster++)
+  {
+    while (node < self->nodeCount && HierarchicalPathfinder_getCluster(self,
+      self->nodeFields[node]) < cluster) node++;
+    self->clusterFirstNodes[cluster] = node;
+  }
+
+  //Every connection results in two edges, every cluster with n nodes in at
+  //most n * (n - 1) edges between them.
+  int maxEdgeCount = connections.count * 2;
+  for (int cluster = 0; cluster < self->clusterCount; cluster++)
+  {
+    int count = self->clusterFirstNodes[cluster + 1] -
+      self->clusterFirstNodes[cluster];
+    maxEdgeCount += count * (count - 1);
+  }
+
+  PathEdge *edges =
+    (PathEdge *)Common_allocate(sizeof(PathEdge) * MAX(1, maxEdgeCount));
+  self->edgeCount = 0;
+  for (int i = 0; i < connections.count; i++)
+  {
+    int a = HierarchicalPathfinder_findNode(self, connections.entries[i].index);
+    int b = HierarchicalPathfinder_findNode(self,
+      (int)connections.entries[i].distance);
+    edges[self->edgeCount].from = a;
+    edges[self->edgeCount].to = b;
+    edges[self->edgeCount++].cost = 1;
+    edges[self->edgeCount].from = b;
+    edges[self->edgeCount].to = a;
+    edges[self->edgeCount++].cost = 1;
+  }
+
+  uint32_t distances[HPA_CLUSTER_FIELD_COUNT];
+  for (int cluster = 0; cluster < self->clusterCount; cluster++)
+  {
+    int first = self->clusterFirstNodes[cluster];
+    int last = self->clusterFirstNodes[cluster + 1];
+    for (int from = first; from < last; from++)
+    {
+      HierarchicalPathfinder_searchCluster(self, self->nodeFields[from],
+        distances, NULL);
+      for (int to = first; to < last; to++)
+      {
+        uint32_t distance = distances[HierarchicalPathfinder_getLocalIndex(
+          self, self->nodeFields[to])];
+        if (to == from || distance == NAVIGATION_UNREACHABLE) continue;
+        edges[self->edgeCount].from = from;
+        edges[self->edgeCount].to = to;
+        edges[self->edgeCount++].cost = distance;
+      }
+    }
+  }
+
+  qsort(edges, self->edgeCount, sizeof(PathEdge),
+    HierarchicalPathfinder_compareEdges);
+  self->nodeFirstEdges =
+    (int *)Common_allocate(sizeof(int) * (self->nodeCount + 1));
+  self->edgeTargets = (int *)Common_allocate(sizeof(int) * MAX(1,
+    self->edgeCount));
+  self->edgeCosts = (uint32_t *)Common_allocate(sizeof(uint32_t) * MAX(1,
+    self->edgeCount));
+  for (int node = 0, edge = 0; node <= self->nodeCount; node++)
+  {
+    while (edge < self->edgeCount && edges[edge].from < node) edge++;
+    self->nodeFirstEdges[node] = edge;
+  }
+  for (int i = 0; i < self->edgeCount; i++)
+  {
+    self->edgeTargets[i] = edges[i].to;
+    self->edgeCosts[i] = edges[i].cost;
+  }
+
+  free(edges);
+  free(nodes.entries);
+  free(connections.entries);
+}
+
+//Releases the resources of a HierarchicalPathfinder instance.
+void HierarchicalPathfinder_destroy(HierarchicalPathfinder *self)
+{
+  free(self->nodeFields);
+  free(self->clusterFirstNodes);
+  free(self->nodeFirstEdges);
+  free(self->edgeTargets);
+  free(self->edgeCosts);
+}
+
+//Gets the amount of memory used by the abstract graph of a pathfinder.
+size_t HierarchicalPathfinder_getMemorySize(const HierarchicalPathfinder *self)
+{
+  return sizeof(int) * (self->nodeCount * 2 + 1 + self->clusterCount + 1) +
+    (sizeof(int) + sizeof(uint32_t)) * self->edgeCount;
+}
+
+//Initializes a HierarchicalPathSearch instance for a pathfinder.
+//self: A pointer to the (uninitialized) search.
+//pathfinder: A pointer to the (initialized) pathfinder.
+void HierarchicalPathSearch_initialize(HierarchicalPathSearch *self,
+  const HierarchicalPathfinder *pathfinder)
+{
+  int nodeCount = MAX(1, pathfinder->nodeCount);
+  self->costs = (uint32_t *)Common_allocate(sizeof(uint32_t) * nodeCount);
+  self->generations = (uint32_t *)Common_allocate(sizeof(uint32_t) * nodeCount);
+  self->parents = (int *)Common_allocate(sizeof(int) * nodeCount);
+  memset(self->generations, 0, sizeof(uint32_t) * nodeCount);
+  self->generation = 0;
+  memset(&self->open, 0, sizeof(NavigationList));
+}
+
+//Releases the resources of a HierarchicalPathSearch instance.
+void HierarchicalPathSearch_destroy(HierarchicalPathSearch *self)
+{
+  free(self->costs);
+  free(self->generations);
+  free(self->parents);
+  free(self->open.entries);
+}
+
+//Appends the shortest path between two fields of the same cluster (only
+//using fields of that cluster) to a path, without the first field.
+//self: A pointer to the pathfinder.
+//from, to: The indicies of the fields.
+//path: The path to append the fields to.
+void HierarchicalPathfinder_appendClusterPath(
+  const HierarchicalPathfinder *self, int from, int to, NavigationList *path)
+{
+  uint32_t distances[HPA_CLUSTER_FIELD_COUNT];
+  int parents[HPA_CLUSTER_FIELD_COUNT], localPath[HPA_CLUSTER_FIELD_COUNT];
+  int length = 0;
+
+  HierarchicalPathfinder_searchCluster(self, from, distances, parents);
+
+  //The local indicies are converted back to field indicies by their offset
+  //to the local index of the target field.
+  int toLocal = HierarchicalPathfinder_getLocalIndex(self, to);
+  for (int local = toLocal; parents[local] >= 0; local = parents[local])
+    localPath[length++] = local;
+
+  for (int i = length - 1; i >= 0; i--)
+  {
+    int offsetX = localPath[i] / HPA_CLUSTER_SIZE - toLocal / HPA_CLUSTER_SIZE;
+    int offsetZ = localPath[i] % HPA_CLUSTER_SIZE - toLocal % HPA_CLUSTER_SIZE;
+    NavigationList_push(path, to + offsetX * self->grid.depth + offsetZ,
+      path->count);
+  }
+}
+
+//Finds a path between two walkable fields with the abstract graph. The
+//path is only refined into single fields if requested.
+//self: A pointer to the pathfinder.
+//search: A pointer to the search state of the calling thread.
+//start: The index of the start field.
+//goal: The index of the goal field.
+//path: The list to store the fields of the path into or NULL.
+//Returns the length of the path or NAVIGATION_UNREACHABLE.
+uint32_t HierarchicalPathfinder_findPath(const HierarchicalPathfinder *self,
+  HierarchicalPathSearch *search, int start, int goal, NavigationList *path)
+{
+  if (!Analysis_isWalkable(self->grid.fields[start]) ||
+    !Analysis_isWalkable(self->grid.fields[goal]))
+    return NAVIGATION_UNREACHABLE;
+
+  int startCluster = HierarchicalPathfinder_getCluster(self, start);
+  int goalCluster = HierarchicalPathfinder_getCluster(self, goal);
+  HierarchicalPathfinder_searchCluster(self, start, search->startDistances,
+    NULL);
+  HierarchicalPathfinder_searchCluster(self, goal, search->goalDistances,
+    NULL);
+
+  //If both fields are in the same cluster, the path inside of the cluster is
+  //a candidate - but a path leaving the cluster might still be shorter.
+  uint32_t bestCost = NAVIGATION_UNREACHABLE;
+  int bestNode = -1;
+  if (startCluster == goalCluster)
+    bestCost = search->startDistances[
+      HierarchicalPathfinder_getLocalIndex(self, goal)];
+
+  search->generation++;
+  search->open.count = 0;
+  for (int node = self->clusterFirstNodes[startCluster];
+    node < self->clusterFirstNodes[startCluster + 1]; node++)
+  {
+    uint32_t cost = search->startDistances[
+      HierarchicalPathfinder_getLocalIndex(self, self->nodeFields[node])];
+    if (cost == NAVIGATION_UNREACHABLE) continue;
+    search->costs[node] = cost;
+    search->parents[node] = -1;
+    search->generations[node] = search->generation;
+    NavigationList_pushHeap(&search->open, node, cost +
+      MapGrid_estimateDistance(&self->grid, self->nodeFields[node], goal));
+  }
+
+  while (search->open.count > 0)
+  {
+    NavigationEntry entry = NavigationList_popHeap(&search->open);
+    int node = entry.index;
+    uint32_t cost = search->costs[node];
+
+    if (entry.distance >= bestCost) break;
+    if (entry.distance > cost +
+      MapGrid_estimateDistance(&self->grid, self->nodeFields[node], goal))
+      continue;
+
+    if (node >= self->clusterFirstNodes[goalCluster] &&
+      node < self->clusterFirstNodes[goalCluster + 1])
+    {
+      uint32_t goalDistance = search->goalDistances[
+        HierarchicalPathfinder_getLocalIndex(self, self->nodeFields[node])];
+      if (goalDistance != NAVIGATION_UNREACHABLE &&
+        cost + goalDistance < bestCost)
+      {
+        bestCost = cost + goalDistance;
+        bestNode = node;
+      }
+    }
+
+    for (int edge = self->nodeFirstEdges[node];
+      edge < self->nodeFirstEdges[node + 1]; edge++)
+    {
+      int target = self->edgeTargets[edge];
+      uint32_t targetCost = cost + self->edgeCosts[edge];
+      if (search->generations[target] == search->generation &&
+        search->costs[target] <= targetCost) continue;
+
+      search->generations[target] = search->generation;
+      search->costs[target] = targetCost;
+      search->parents[target] = node;
+      NavigationList_pushHeap(&search->open, target, targetCost +
+        MapGrid_estimateDistance(&self->grid, self->nodeFields[target], goal));
+    }
+  }
+
+  if (path == NULL || bestCost == NAVIGATION_UNREACHABLE) return bestCost;
+
+  //Refine the path: the nodes are connected either by a path inside of their
+  //cluster or directly (if they're in different clusters).
+  path->count = 0;
+  NavigationList_push(path, start, 0);
+  if (bestNode < 0) HierarchicalPathfinder_appendClusterPath(self, start,
+    goal, path);
+  else
+  {
+    NavigationList nodes;
+    memset(&nodes, 0, sizeof(NavigationList));
+    Pathfinding_storePath(&nodes, search->parents, self->nodeFields,
+      bestNode);
+    int previous = start;
+    for (int i = 0; i <= nodes.count; i++)
+    {
+      int next = i < nodes.count ? nodes.entries[i].index : goal;
+      if (HierarchicalPathfinder_getCluster(self, previous) ==
+        HierarchicalPathfinder_getCluster(self, next))
+        HierarchicalPathfinder_appendClusterPath(self, previous, next, path);
+      else NavigationList_push(path, next, path->count);
+      previous = next;
+    }
+    free(nodes.entries);
+  }
+
+  return bestCost;
+}
+
+//=============================================================================
+// Collision: Circles swept through the fields of the map.
+//=============================================================================
+
+//The distance kept between moving circles and the fields they touch.
+#define COLLISION_SKIN 0.001f
+
+//Checks if a field blocks movement (fields outside of the map do).
+//grid: A pointer to the map view.
+//x, level, z: The indicies of the field.
+bool Collision_isBlocking(const MapGrid *grid, int x, int level, int z)
+{
+  if (x < 0 || x >= grid->width || z < 0 || z >= grid->depth) return true;
+  return !Analysis_isWalkable(grid->fields[((size_t)level * grid->width + x) *
+    grid->depth + z]);
+}
+
+//Calculates when a moving circle touches a field for the first time (the
+//field, grown by the radius with rounded corners, is hit by a ray).
+//x, z: The position of the center of the circle at time 0.
+//moveX, moveZ: The movement of the circle until time 1.
+//fieldX, fieldZ: The indicies of the field.
+//radius: The radius of the circle (smaller than 0.5).
+//time: The pointer to store the time of the contact into.
+//normalX, normalZ: The pointers to store the direction from the field to the
+//circle at the time of the contact into.
+//Returns true if the circle touches the field between time 0 and 1 (while
+//moving towards it), false otherwise.
+bool Collision_intersectField(float x, float z, float moveX, float moveZ,
+  int fieldX, int fieldZ, float radius, float *time, float *normalX,
+  float *normalZ)
+{
+  float origins[2], moves[2], centers[2], enterTime = -1e30f, exitTime = 1e30f;
+  int enterAxis = 0;
+  origins[0] = x;
+  origins[1] = z;
+  moves[0] = moveX;
+  moves[1] = moveZ;
+  centers[0] = (float)fieldX;
+  centers[1] = (float)fieldZ;
+
+  //Intersect the ray with the slabs of the grown field on both axes.
+  for (int axis = 0; axis < 2; axis++)
+  {
+    float low = centers[axis] - 0.5f - radius;
+    float high = centers[axis] + 0.5f + radius;
+    if (fabsf(moves[axis]) < EPSILON)
+    {
+      if (origins[axis] <= low || origins[axis] >= high) return false;
+      continue;
+    }
+
+    float lowTime = (low - origins[axis]) / moves[axis];
+    float highTime = (high - origins[axis]) / moves[axis];
+    float nearTime = MIN(lowTime, highTime), farTime = MAX(lowTime, highTime);
+    if (nearTime > enterTime)
+    {
+      enterTime = nearTime;
+      enterAxis = axis;
+    }
+    exitTime = MIN(exitTime, farTime);
+  }
+  if (enterTime >= exitTime || exitTime <= 0.0f || enterTime > 1.0f)
+    return false;
+
+  //If the ray enters the grown field next to a corner of the field, the
+  //circle actually hits the rounded corner (or misses it).
+  float contactTime = MAX(0.0f, enterTime);
+  float contact[2], corner[2];
+  bool isCorner = true;
+  for (int axis = 0; axis < 2; axis++)
+  {
+    contact[axis] = origins[axis] + moves[axis] * contactTime;
+    corner[axis] = MAX(centers[axis] - 0.5f, MIN(centers[axis] + 0.5f,
+      contact[axis]));
+    isCorner &= contact[axis] != corner[axis];
+  }
+
+  if (isCorner)
+  {
+    //Solve |origin + move * t - corner| = radius for the earlier t.
+    float offsetX = x - corner[0], offsetZ = z - corner[1];
+    float a = moveX * moveX + moveZ * moveZ;
+    float b = offsetX * moveX + offsetZ * moveZ;
+    float c = offsetX * offsetX + offsetZ * offsetZ - radius * radius;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f || a < EPSILON * EPSILON) return false;
+    contactTime = MAX(0.0f, (-b - sqrtf(discriminant)) / a);
+    if (contactTime > 1.0f || (-b + sqrtf(discriminant)) / a <= 0.0f)
+      return false;
+
+    *normalX = x + moveX * contactTime - corner[0];
+    *normalZ = z + moveZ * contactTime - corner[1];
+    float length = sqrtf(*normalX * *normalX + *normalZ * *normalZ);
+    if (length < EPSILON) return false;
+    *normalX /= length;
+    *normalZ /= length;
+  }
+  else if (enterTime < 0.0f)
+  {
+    //Circles which already overlap the side of the field are pushed out on
+    //the axis they overlap least - the one of the side they're at.
+    bool isSideX = fabsf(x - centers[0]) >= fabsf(z - centers[1]);
+    *normalX = isSideX ? (x > centers[0] ? 1.0f : -1.0f) : 0.0f;
+    *normalZ = isSideX ? 0.0f : (z > centers[1] ? 1.0f : -1.0f);
+  }
+  else
+  {
+    *normalX = enterAxis == 0 ? (moveX > 0 ? -1.0f : 1.0f) : 0.0f;
+    *normalZ = enterAxis == 1 ? (moveZ > 0 ? -1.0f : 1.0f) : 0.0f;
+  }
+
+  //Circles which already touch the field may still move away from it.
+  if (moveX * *normalX + moveZ * *normalZ >= 0.0f) return false;
+  *time = contactTime;
+  return true;
+}
+
+//Calculates when a moving circle touches a blocking field for the first
+//time. The fields crossed by the center of the circle are traversed in order
+//(with a DDA) - as the radius is smaller than half a field, only the fields
+//around them can be touched.
+//grid: A pointer to the map view.
+//x, level, z: The position of the center of the circle at time 0.
+//moveX, moveZ: The movement of the circle until time 1.
+//radius: The radius of the circle (smaller than 0.5).
+//time: The pointer to store the time of the first contact into.
+//normalX, normalZ: The pointers to store the direction from the touched
+//field to the circle into.
+//Returns the amount of traversed fields or 0 if no field was touched.
+int Collision_castCircle(const MapGrid *grid, float x, int level, float z,
+  float moveX, float moveZ, float radius, float *time, float *normalX,
+  float *normalZ)
+{
+  int fieldX = (int)floorf(x + 0.5f), fieldZ = (int)floorf(z + 0.5f);
+  int stepX = moveX > 0 ? 1 : -1, stepZ = moveZ > 0 ? 1 : -1;
+  //The times when the center crosses the next field border on each axis and
+  //how long it takes to cross a field.
+  float deltaTimeX = fabsf(moveX) > EPSILON ? 1.0f / fabsf(moveX) : 1e30f;
+  float deltaTimeZ = fabsf(moveZ) > EPSILON ? 1.0f / fabsf(moveZ) : 1e30f;
+  float nextTimeX = deltaTimeX * (moveX > 0 ? fieldX + 0.5f - x :
+    x - (fieldX - 0.5f));
+  float nextTimeZ = deltaTimeZ * (moveZ > 0 ? fieldZ + 0.5f - z :
+    z - (fieldZ - 0.5f));
+  float bestTime = 2.0f, fieldTime = 0.0f;
+  int fieldCount = 0;
+
+  //Every contact happens while the center is in a field next to the touched
+  //field, so the traversal ends with the field the first contact is in.
+  while (fieldTime <= MIN(1.0f, bestTime))
+  {
+    fieldCount++;
+    for (int neighbourX = fieldX - 1; neighbourX <= fieldX + 1; neighbourX++)
+    {
+      for (int neighbourZ = fieldZ - 1; neighbourZ <= fieldZ + 1; neighbourZ++)
+      {
+        float contactTime, contactNormalX, contactNormalZ;
+        if (!Collision_isBlocking(grid, neighbourX, level, neighbourZ) ||
+          !Collision_intersectField(x, z, moveX, moveZ, neighbourX, neighbourZ,
+            radius, &contactTime, &contactNormalX, &contactNormalZ) ||
+          contactTime >= bestTime) continue;
+        bestTime = contactTime;
+        *normalX = contactNormalX;
+        *normalZ = contactNormalZ;
+      }
+    }
+
+    if (nextTimeX < nextTimeZ)
+    {
+      fieldTime = nextTimeX;
+      nextTimeX += deltaTimeX;
+      fieldX += stepX;
+    }
+    else
+    {
+      fieldTime = nextTimeZ;
+      nextTimeZ += deltaTimeZ;
+      fieldZ += stepZ;
+    }
+  }
+
+  if (bestTime > 1.0f) return 0;
+  *time = bestTime;
+  return fieldCount;
+}
+
+//Moves a circle through the map until it touches a blocking field and lets
+//it slide along that field with the remaining movement, so that no movement
+//(no matter how fast) can pass through walls.
+//grid: A pointer to the map view.
+//x, z: The pointers to the position of the center of the circle.
+//level: The level of the circle.
+//moveX, moveZ: The movement (in fields).
+//radius: The radius of the circle (smaller than 0.5).
+//normalX, normalZ: The pointers to store the direction away from the last
+//touched field into or NULL.
+//Returns true if the circle touched a field, false otherwise.
+bool Collision_sweepCircle(const MapGrid *grid, float *x, int level, float *z,
+  float moveX, float moveZ, float radius, float *normalX, float *normalZ)
+{
+  bool collided = false;
+
+  //Sliding into a corner touches up to two walls, the third attempt stops.
+  for (int attempt = 0; attempt < 3; attempt++)
+  {
+    float time, contactNormalX, contactNormalZ;
+    if (fabsf(moveX) < EPSILON && fabsf(moveZ) < EPSILON) break;
+    if (Collision_castCircle(grid, *x, level, *z, moveX, moveZ, radius, &time,
+      &contactNormalX, &contactNormalZ) == 0)
+    {
+      *x += moveX;
+      *z += moveZ;
+      break;
+    }
+
+    //Stop right before the contact and slide with the remaining movement.
+    *x += moveX * time + contactNormalX * COLLISION_SKIN;
+    *z += moveZ * time + contactNormalZ * COLLISION_SKIN;
+    moveX *= 1.0f - time;
+    moveZ *= 1.0f - time;
+    float moveIntoField = moveX * contactNormalX + moveZ * contactNormalZ;
+    moveX -= moveIntoField * contactNormalX;
+    moveZ -= moveIntoField * contactNormalZ;
+
+    if (normalX != NULL) *normalX = contactNormalX;
+    if (normalZ != NULL) *normalZ = contactNormalZ;
+    collided = true;
+  }
+
+  return collided;
+}
+
+//The view of the current map which the players collide with (only valid if
+//isCollisionEnabled is true). It reads the fields of the map directly, so it
+//doesn't need to be updated when a field changes.
+MapGrid collisionGrid;
+//Specifies whether the players collide with the swept circle (in finite
+//maps) instead of only testing the field of their new position.
+bool isCollisionEnabled = false;
+
+//Enables the swept-circle collision with the current map.
+void Collision_initialize(void)
+{
+  MapGrid_initialize(&collisionGrid, map, mapWidth, mapDepth, mapLevels);
+  isCollisionEnabled = true;
+}
+
+//Disables the swept-circle collision again.
+void Collision_destroy(void)
+{
+  isCollisionEnabled = false;
+}
+
+//=============================================================================
+// Sight: Batched line-of-sight tests between the fields of a map.
+//=============================================================================
+
+//The amount of rays which are traversed together (see
+//"SightGrid_testRange").
+#define SIGHT_PACKET_SIZE 256
+
+//Describes a line of sight from the center of one field to the center of
+//another field on the same level.
+typedef struct
+{
+  int fromX, fromZ, toX, toZ, level;
+} SightRay;
+
+//Contains one bit per field of a map, set for fields which block the sight
+//(the ones which aren't walkable) - which is small enough to stay in the
+//cache even for big maps.
+//Use "SightGrid_initialize" before using an instance.
+typedef struct
+{
+  uint32_t *opaqueBits;
+  int width, depth, levelCount;
+} SightGrid;
+
+//Updates the bit of a field.
+//self: A pointer to the grid.
+//fields: The fields of the map.
+//x, level, z: The indicies of the field.
+void SightGrid_onFieldChanged(SightGrid *self, const Field *fields, int x,
+  int level, int z)
+{
+  size_t index = ((size_t)level * self->width + x) * self->depth + z;
+  if (Analysis_isWalkable(fields[index]))
+    self->opaqueBits[index / 32] &= ~(1u << (index % 32));
+  else self->opaqueBits[index / 32] |= 1u << (index % 32);
+}
+
+//Initializes a SightGrid instance.
+//self: A pointer to the (uninitialized) grid.
+//fields, width, depth, levels: The map (see "MapGrid_initialize").
+void SightGrid_initialize(SightGrid *self, const Field *fields, int width,
+  int depth, int levels)
+{
+  const size_t fieldCount = (size_t)width * depth * levels;
+  const size_t wordCount = fieldCount / 32 + 1;
+
+  self->width = width;
+  self->depth = depth;
+  self->levelCount = levels;
+  self->opaqueBits = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    wordCount);
+
+  for (size_t word = 0; word < wordCount; word++)
+  {
+    uint32_t bits = 0;
+    for (size_t i = word * 32; i < MIN(fieldCount, word * 32 + 32); i++)
+      bits |= (uint32_t)!Analysis_isWalkable(fields[i]) << (i % 32);
+    self->opaqueBits[word] = bits;
+  }
+}
+
+//Releases the resources of a SightGrid instance.
+//self: A pointer to the grid.
+void SightGrid_destroy(SightGrid *self)
+{
+  free(self->opaqueBits);
+  self->opaqueBits = NULL;
+}
+
+//Checks if a field blocks the sight.
+//self: A pointer to the grid.
+//index: The index of the field in the map.
+int SightGrid_isOpaque(const SightGrid *self, int index)
+{
+  return (self->opaqueBits[index >> 5] >> (index & 31)) & 1;
+}
+
+//Checks if the center of one field can be seen from the center of another
+//field: the fields crossed by the line between them (without the two fields
+//themselves) must not block the sight. Where the line passes exactly 
+//through a corner, it's only blocked if both fields next to the corner 
+//block the sight (so that the result is the same in both directions).
+//The fields are traversed with an integer DDA: the decision is the 
+//difference between the times when the line crosses the next border on the
+//X and the Z axis (scaled by 2 * deltaX * deltaZ, so that it stays exact).
+//self: A pointer to the grid.
+//ray: A pointer to the ray, which needs to be inside of the map.
+bool SightGrid_testRay(const SightGrid *self, const SightRay *ray)
+{
+  int deltaX = abs(ray->toX - ray->fromX), deltaZ = abs(ray->toZ - ray->fromZ);
+  int strideX = ray->toX > ray->fromX ? self->depth : -self->depth;
+  int strideZ = ray->toZ > ray->fromZ ? 1 : -1;
+  int index = (ray->level * self->width + ray->fromX) * self->depth +
+    ray->fromZ;
+  int decision = deltaZ - deltaX, remaining = deltaX + deltaZ;
+
+  while (remaining > 0)
+  {
+    if (decision == 0)
+    {
+      if (SightGrid_isOpaque(self, index + strideX) &&
+        SightGrid_isOpaque(self, index + strideZ)) return false;
+      index += strideX + strideZ;
+      decision += 2 * (deltaZ - deltaX);
+      remaining -= 2;
+    }
+    else if (decision < 0)
+    {
+      index += strideX;
+      decision += 2 * deltaZ;
+      remaining--;
+    }
+    else
+    {
+      index += strideZ;
+      decision -= 2 * deltaX;
+      remaining--;
+    }
+    if (remaining > 0 && SightGrid_isOpaque(self, index)) return false;
+  }
+
+  return true;
+}
+
+//The state of a packet of rays which are traversed together (see
+//"SightGrid_testRange"), one array per value with one lane per ray.
+typedef struct
+{
+  //The index of every ray and the index of its current field (see
+  //"SightGrid_testRay").
+  int rays[SIGHT_PACKET_SIZE], indicies[SIGHT_PACKET_SIZE];
+  int stridesX[SIGHT_PACKET_SIZE], stridesZ[SIGHT_PACKET_SIZE];
+  int decisions[SIGHT_PACKET_SIZE], remaining[SIGHT_PACKET_SIZE];
+  int decisionStepsX[SIGHT_PACKET_SIZE], decisionStepsZ[SIGHT_PACKET_SIZE];
+  //The lanes of the rays which weren't blocked and didn't reach their
+  //target yet.
+  int active[SIGHT_PACKET_SIZE];
+} SightPacket;
+
+//Tests a range of rays (see "SightGrid_testRay") in packets of
+//SIGHT_PACKET_SIZE rays: every pass takes one step of all active rays of a
+//packet without branches, so the lookups of different rays don't wait for
+//each other and there are no mispredicted branches - which a single ray
+//has on almost every step, as its direction changes irregularly and most
+//rays in a maze are blocked after a few fields. The lanes of the rays which
+//are done are dropped from the active lanes after every step, so a pass
+//only visits the rays which are still active.
+//self: A pointer to the grid.
+//rays: The rays, which need to be inside of the map.
+//first: The index of the first ray.
+//last: The index after the last ray.
+//results: The target for the results (1 if visible, 0 otherwise).
+void SightGrid_testRange(const SightGrid *self, const SightRay *rays,
+  int first, int last, uint8_t *results)
+{
+  SightPacket packet;
+
+  for (int packetFirst = first; packetFirst < last;
+    packetFirst += SIGHT_PACKET_SIZE)
+  {
+    int packetLast = MIN(last, packetFirst + SIGHT_PACKET_SIZE);
+    int activeCount = 0;
+
+    //Rays which don't cross any other fields are visible right away.
+    for (int i = packetFirst; i < packetLast; i++)
+    {
+      const SightRay *ray = &rays[i];
+      int deltaX = abs(ray->toX - ray->fromX);
+      int deltaZ = abs(ray->toZ - ray->fromZ);
+      packet.active[activeCount] = activeCount;
+      packet.rays[activeCount] = i;
+      packet.indicies[activeCount] = (ray->level * self->width +
+        ray->fromX) * self->depth + ray->fromZ;
+      packet.stridesX[activeCount] = ray->toX > ray->fromX ? self->depth :
+        -self->depth;
+      packet.stridesZ[activeCount] = ray->toZ > ray->fromZ ? 1 : -1;
+      packet.decisions[activeCount] = deltaZ - deltaX;
+      packet.remaining[activeCount] = deltaX + deltaZ;
+      packet.decisionStepsX[activeCount] = 2 * deltaZ;
+      packet.decisionStepsZ[activeCount] = 2 * deltaX;
+      results[i] = 1;
+      activeCount += deltaX + deltaZ > 0;
+    }
+
+    while (activeCount > 0)
+    {
+      int nextCount = 0;
+      for (int i = 0; i < activeCount; i++)
+      {
+        int lane = packet.active[i];
+        int index = packet.indicies[lane], decision = packet.decisions[lane];
+        int isStepX = decision <= 0, isStepZ = decision >= 0;
+        int isCorner = isStepX & isStepZ;
+        int strideX = packet.stridesX[lane] * isStepX;
+        int strideZ = packet.stridesZ[lane] * isStepZ;
+
+        int isBlocked = isCorner &
+          SightGrid_isOpaque(self, index + strideX * isCorner) &
+          SightGrid_isOpaque(self, index + strideZ * isCorner);
+        index += strideX + strideZ;
+        int remaining = packet.remaining[lane] - isStepX - isStepZ;
+        isBlocked |= (remaining > 0) & SightGrid_isOpaque(self, index);
+        results[packet.rays[lane]] = (uint8_t)!isBlocked;
+
+        packet.indicies[lane] = index;
+        packet.decisions[lane] = decision + packet.decisionStepsX[lane] *
+          isStepX - packet.decisionStepsZ[lane] * isStepZ;
+        packet.remaining[lane] = remaining;
+        packet.active[nextCount] = lane;
+        nextCount += (remaining > 0) & !isBlocked;
+      }
+      activeCount = nextCount;
+    }
+  }
+}
+
+//Describes how rays are split into blocks which are tested on the worker
+//pool.
+typedef struct
+{
+  const SightGrid *grid;
+  const SightRay *rays;
+  uint8_t *results;
+  int count, blockSize;
+} SightBlocks;
+
+//Tests one block of rays (for parallelFor).
+//data: A pointer to a SightBlocks instance.
+//index: The index of the block.
+void SightGrid_testBlock(void *data, int index)
+{
+  SightBlocks *blocks = (SightBlocks *)data;
+  int first = index * blocks->blockSize;
+  SightGrid_testRange(blocks->grid, blocks->rays, first,
+    MIN(blocks->count, first + blocks->blockSize), blocks->results);
+}
+
+//Tests many rays (see "SightGrid_testRay"), in blocks on the worker pool if
+//one is given.
+//self: A pointer to the grid.
+//pool: The worker pool or NULL to test all rays on the calling thread.
+//rays: The rays, which need to be inside of the map.
+//count: The amount of rays.
+//results: The target for the results (1 if visible, 0 otherwise).
+void SightGrid_testRays(const SightGrid *self, WorkerPool *pool,
+  const SightRay *rays, int count, uint8_t *results)
+{
+  if (pool == NULL) SightGrid_testRange(self, rays, 0, count, results);
+  else
+  {
+    SightBlocks blocks;
+    int blockCount = MAX(1, MIN((pool->threadCount + 1) * 4, count / 1024));
+
+    blocks.grid = self;
+    blocks.rays = rays;
+    blocks.results = results;
+    blocks.count = count;
+    blocks.blockSize = (count + blockCount - 1) / blockCount;
+    WorkerPool_parallelFor(pool, blockCount, SightGrid_testBlock, &blocks);
+  }
+}
+
+//Tests a ray like "SightGrid_testRay", but directly on the fields of the
+//map and with the times of the crossed borders as floats - a simple 
+//reference for testing the other implementations. The times are calculated
+//from integers, so that equal times (at corners) are exactly equal - and
+//different times stay different for rays shorter than 1000 fields.
+//fields, width, depth: The map (see "MapGrid_initialize").
+//ray: A pointer to the ray, which needs to be inside of the map.
+bool Sight_testRayReference(const Field *fields, int width, int depth,
+  const SightRay *ray)
+{
+  int x = ray->fromX, z = ray->fromZ, crossedX = 0, crossedZ = 0;
+  int deltaX = abs(ray->toX - x), deltaZ = abs(ray->toZ - z);
+  int stepX = ray->toX > x ? 1 : -1, stepZ = ray->toZ > z ? 1 : -1;
+  const Field *level = &fields[(size_t)ray->level * width * depth];
+
+  while (x != ray->toX || z != ray->toZ)
+  {
+    float timeX = crossedX < deltaX ?
+      (float)(2 * crossedX + 1) / (float)(2 * deltaX) : 2.0f;
+    float timeZ = crossedZ < deltaZ ?
+      (float)(2 * crossedZ + 1) / (float)(2 * deltaZ) : 2.0f;
+
+    if (timeX == timeZ)
+    {
+      if (!Analysis_isWalkable(level[(x + stepX) * depth + z]) &&
+        !Analysis_isWalkable(level[x * depth + z + stepZ])) return false;
+      x += stepX;
+      z += stepZ;
+      crossedX++;
+      crossedZ++;
+    }
+    else if (timeX < timeZ)
+    {
+      x += stepX;
+      crossedX++;
+    }
+    else
+    {
+      z += stepZ;
+      crossedZ++;
+    }
+
+    if ((x != ray->toX || z != ray->toZ) &&
+      !Analysis_isWalkable(level[x * depth + z])) return false;
+  }
+
+  return true;
+}
+
+//=============================================================================
+// SpatialHash: Neighbour queries for many moving entities.
+//=============================================================================
+
+//Sorts entities into the cells of a uniform grid, where every cell is mapped
+//to one of a power of two amount of buckets by a hash of its indicies - so
+//that the memory only depends on the amount of entities, not on the size of
+//the map. Entities are identified by their index (below the capacity).
+//The hash can be updated in two ways: rebuilding it from scratch with a 
+//counting sort every update (see "SpatialHash_rebuild"), which stores the 
+//entities of a bucket next to each other so that queries read them 
+//sequentially - or by inserting, removing and moving single entities in
+//constant time (see "SpatialHash_insert"), which keeps a linked list of
+//entities for every bucket. Rebuilding is faster when most entities move.
+//Use "SpatialHash_initialize" before using an instance.
+typedef struct
+{
+  float cellSize, inverseCellSize;
+  int bucketCount;
+  //The amount of entities in the hash and the maximum amount.
+  int count, capacity;
+
+  //The index of the first entry of every bucket, followed by the amount of
+  //entries - so the entries of bucket i are the ones from bucketStarts[i] to
+  //bucketStarts[i + 1].
+  int *bucketStarts;
+  //The entity index, the position and the cell of every entry, sorted by
+  //bucket.
+  int *entries;
+  float *entriesX, *entriesZ;
+  int *entryLevels, *entryCellsX, *entryCellsZ;
+  //true if the entries are up to date (as no entity was changed since the
+  //last rebuild).
+  bool isSorted;
+
+  //The first entity of every bucket and the next and previous entity of
+  //every entity in its bucket (or -1).
+  int *bucketHeads, *nextEntities, *previousEntities;
+  //The position and the cell of every entity.
+  float *positionsX, *positionsZ;
+  int *levels, *cellsX, *cellsZ;
+  //true if the linked lists are up to date (they're only created when
+  //single entities are changed).
+  bool isLinked;
+
+  //The bucket of every entity, or -1 if the entity isn't in the hash.
+  int *buckets;
+} SpatialHash;
+
+//Initializes a SpatialHash instance.
+//self: A pointer to the (uninitialized) hash.
+//cellSize: The size of the cells (in units) - queries are fastest when their
+//radius is about the cell size.
+//capacity: The maximum amount of entities.
+void SpatialHash_initialize(SpatialHash *self, float cellSize, int capacity)
+{
+  self->cellSize = cellSize;
+  self->inverseCellSize = 1.0f / cellSize;
+  self->capacity = MAX(1, capacity);
+  self->count = 0;
+  self->isSorted = true;
+  self->isLinked = false;
+
+  //Twice as many buckets as entities keep collisions between cells rare.
+  self->bucketCount = 1;
+  while (self->bucketCount < self->capacity * 2) self->bucketCount *= 2;
+
+  const size_t intsSize = sizeof(int) * self->capacity;
+  const size_t floatsSize = sizeof(float) * self->capacity;
+  self->bucketStarts = (int *)Common_allocate(sizeof(int) *
+    (self->bucketCount + 1));
+  self->entries = (int *)Common_allocate(intsSize);
+  self->entriesX = (float *)Common_allocate(floatsSize);
+  self->entriesZ = (float *)Common_allocate(floatsSize);
+  self->entryLevels = (int *)Common_allocate(intsSize);
+  self->entryCellsX = (int *)Common_allocate(intsSize);
+  self->entryCellsZ = (int *)Common_allocate(intsSize);
+  self->bucketHeads = (int *)Common_allocate(sizeof(int) *
+    self->bucketCount);
+  self->nextEntities = (int *)Common_allocate(intsSize);
+  self->previousEntities = (int *)Common_allocate(intsSize);
+  self->positionsX = (float *)Common_allocate(floatsSize);
+  self->positionsZ = (float *)Common_allocate(floatsSize);
+  self->levels = (int *)Common_allocate(intsSize);
+  self->cellsX = (int *)Common_allocate(intsSize);
+  self->cellsZ = (int *)Common_allocate(intsSize);
+  self->buckets = (int *)Common_allocate(intsSize);
+  memset(self->bucketStarts, 0, sizeof(int) * (self->bucketCount + 1));
+}
+
+//Releases the resources of a SpatialHash instance.
+//self: A pointer to the hash.
+void SpatialHash_destroy(SpatialHash *self)
+{
+  free(self->bucketStarts);
+  free(self->entries);
+  free(self->entriesX);
+  free(self->entriesZ);
+  free(self->entryLevels);
+  free(self->entryCellsX);
+  free(self->entryCellsZ);
+  free(self->bucketHeads);
+  free(self->nextEntities);
+  free(self->previousEntities);
+  free(self->positionsX);
+  free(self->positionsZ);
+  free(self->levels);
+  free(self->cellsX);
+  free(self->cellsZ);
+  free(self->buckets);
+  self->bucketStarts = NULL;
+  self->count = 0;
+}
+
+//Gets the bucket of a cell.
+//self: A pointer to the hash.
+//cellX, level, cellZ: The indicies of the cell.
+int SpatialHash_getBucket(const SpatialHash *self, int cellX, int level,
+  int cellZ)
+{
+  uint32_t hash = (uint32_t)cellX * 73856093u ^ (uint32_t)cellZ * 19349663u ^
+    (uint32_t)level * 83492791u;
+  return (int)((hash ^ (hash >> 16)) & (uint32_t)(self->bucketCount - 1));
+}
+
+//Gets the index of the cell a coordinate is in along one axis (rounded down
+//without floorf, which is a library call on many compilers).
+//self: A pointer to the hash.
+//position: The coordinate.
+int SpatialHash_getCell(const SpatialHash *self, float position)
+{
+  float cell = position * self->inverseCellSize;
+  int truncated = (int)cell;
+  return truncated - (cell < (float)truncated);
+}
+
+//Sorts all entities into the hash again, replacing the previous entities.
+//self: A pointer to the hash.
+//count: The amount of entities (at most the capacity of the hash), which
+//get the indicies from 0 to count - 1.
+//positionsX, levels, positionsZ: The positions of the entities.
+void SpatialHash_rebuild(SpatialHash *self, int count,
+  const float *positionsX, const int *levels, const float *positionsZ)
+{
+  self->count = MIN(count, self->capacity);
+  self->isSorted = true;
+  self->isLinked = false;
+  memset(self->bucketStarts, 0, sizeof(int) * (self->bucketCount + 1));
+
+  //Count the entities of every bucket, then turn the counts into the index
+  //after the last entry of every bucket...
+  //The cells are kept in the arrays of the linked lists in the meantime.
+  for (int i = 0; i < self->count; i++)
+  {
+    self->cellsX[i] = SpatialHash_getCell(self, positionsX[i]);
+    self->cellsZ[i] = SpatialHash_getCell(self, positionsZ[i]);
+    int bucket = SpatialHash_getBucket(self, self->cellsX[i], levels[i],
+      self->cellsZ[i]);
+    self->buckets[i] = bucket;
+    self->bucketStarts[bucket]++;
+  }
+  for (int i = 1; i < self->bucketCount; i++)
+    self->bucketStarts[i] += self->bucketStarts[i - 1];
+  self->bucketStarts[self->bucketCount] = self->count;
+
+  //...and fill the buckets from the back, so that every bucket start ends up
+  //at its first entry (and the entities stay in order within a bucket).
+  for (int i = self->count - 1; i >= 0; i--)
+  {
+    int entry = --self->bucketStarts[self->buckets[i]];
+    self->entries[entry] = i;
+    self->entriesX[entry] = positionsX[i];
+    self->entriesZ[entry] = positionsZ[i];
+    self->entryLevels[entry] = levels[i];
+    self->entryCellsX[entry] = self->cellsX[i];
+    self->entryCellsZ[entry] = self->cellsZ[i];
+  }
+}
+
+//Adds an entity to the front of the linked list of a bucket.
+//self: A pointer to the hash (with up-to-date linked lists).
+//entity: The index of the entity, which isn't in any list.
+//bucket: The index of the bucket.
+void SpatialHash_link(SpatialHash *self, int entity, int bucket)
+{
+  int next = self->bucketHeads[bucket];
+  self->nextEntities[entity] = next;
+  self->previousEntities[entity] = -1;
+  if (next >= 0) self->previousEntities[next] = entity;
+  self->bucketHeads[bucket] = entity;
+  self->buckets[entity] = bucket;
+}
+
+//Removes an entity from the linked list of its bucket.
+//self: A pointer to the hash (with up-to-date linked lists).
+//entity: The index of the entity, which is in the hash.
+void SpatialHash_unlink(SpatialHash *self, int entity)
+{
+  int next = self->nextEntities[entity];
+  int previous = self->previousEntities[entity];
+  if (previous >= 0) self->nextEntities[previous] = next;
+  else self->bucketHeads[self->buckets[entity]] = next;
+  if (next >= 0) self->previousEntities[next] = previous;
+  self->buckets[entity] = -1;
+}
+
+//Creates the linked lists from the sorted entries, if they aren't up to
+//date already - which is needed once after every rebuild.
+//self: A pointer to the hash.
+void SpatialHash_prepareChanges(SpatialHash *self)
+{
+  if (self->isLinked) return;
+
+  memset(self->bucketHeads, -1, sizeof(int) * self->bucketCount);
+  for (int i = self->count; i < self->capacity; i++) self->buckets[i] = -1;
+
+  //Going backwards keeps the order of the entries within the buckets.
+  for (int entry = self->count - 1; entry >= 0; entry--)
+  {
+    int entity = self->entries[entry];
+    self->positionsX[entity] = self->entriesX[entry];
+    self->positionsZ[entity] = self->entriesZ[entry];
+    self->levels[entity] = self->entryLevels[entry];
+    self->cellsX[entity] = self->entryCellsX[entry];
+    self->cellsZ[entity] = self->entryCellsZ[entry];
+    SpatialHash_link(self, entity, self->buckets[entity]);
+  }
+
+  self->isLinked = true;
+}
+
+//Moves an entity to another position, or inserts it if it isn't in the hash
+//yet. Takes constant time.
+//self: A pointer to the hash.
+//entity: The index of the entity (below the capacity of the hash).
+//x, level, z: The new position.
+void SpatialHash_move(SpatialHash *self, int entity, float x, int level,
+  float z)
+{
+  SpatialHash_prepareChanges(self);
+  self->isSorted = false;
+
+  int cellX = SpatialHash_getCell(self, x);
+  int cellZ = SpatialHash_getCell(self, z);
+  int bucket = SpatialHash_getBucket(self, cellX, level, cellZ);
+  self->positionsX[entity] = x;
+  self->positionsZ[entity] = z;
+  self->levels[entity] = level;
+  self->cellsX[entity] = cellX;
+  self->cellsZ[entity] = cellZ;
+
+  //Entities only change the list when they move into another bucket.
+  if (self->buckets[entity] == bucket) return;
+  if (self->buckets[entity] >= 0) SpatialHash_unlink(self, entity);
+  else self->count++;
+  SpatialHash_link(self, entity, bucket);
+}
+
+//Inserts an entity into the hash (or moves it, if it's in the hash already).
+//Takes constant time.
+//self: A pointer to the hash.
+//entity: The index of the entity (below the capacity of the hash).
+//x, level, z: The position of the entity.
+void SpatialHash_insert(SpatialHash *self, int entity, float x, int level,
+  float z)
+{
+  SpatialHash_move(self, entity, x, level, z);
+}
+
+//Removes an entity from the hash (if it's in there). Takes constant time.
+//self: A pointer to the hash.
+//entity: The index of the entity (below the capacity of the hash).
+void SpatialHash_remove(SpatialHash *self, int entity)
+{
+  SpatialHash_prepareChanges(self);
+  if (self->buckets[entity] < 0) return;
+
+  self->isSorted = false;
+  SpatialHash_unlink(self, entity);
+  self->count--;
+}
+
+//Checks if the position of an entity matches a query (see 
+//"SpatialHash_collect").
+bool SpatialHash_isInQuery(float x, int level, float z, int cellX, int cellZ,
+  int queryLevel, int queryCellX, int queryCellZ, float minX, float minZ,
+  float maxX, float maxZ, float centerX, float centerZ, float radiusSquared)
+{
+  float offsetX = x - centerX, offsetZ = z - centerZ;
+  return level == queryLevel && cellX == queryCellX && cellZ == queryCellZ &&
+    x >= minX && x <= maxX && z >= minZ && z <= maxZ &&
+    offsetX * offsetX + offsetZ * offsetZ <= radiusSquared;
+}
+
+//Finds the entities within a box which are also within a radius around a
+//position (see "SpatialHash_queryRadius" and "SpatialHash_queryBox").
+//self: A pointer to the hash.
+//level: The level of the entities.
+//minX, minZ, maxX, maxZ: The box (with the borders).
+//centerX, centerZ, radiusSquared: The circle (with the border).
+//results: The target for the entity indicies (in no particular order).
+//capacity: The maximum amount of entities to find.
+//Returns the amount of found entities.
+int SpatialHash_collect(const SpatialHash *self, int level, float minX,
+  float minZ, float maxX, float maxZ, float centerX, float centerZ,
+  float radiusSquared, int *results, int capacity)
+{
+  int firstCellX = SpatialHash_getCell(self, minX);
+  int lastCellX = SpatialHash_getCell(self, maxX);
+  int firstCellZ = SpatialHash_getCell(self, minZ);
+  int lastCellZ = SpatialHash_getCell(self, maxZ);
+  int count = 0;
+
+  //Different cells can share a bucket, so only the entities of the visited
+  //cell are taken (which also prevents finding an entity twice).
+  for (int cellX = firstCellX; cellX <= lastCellX; cellX++)
+  {
+    for (int cellZ = firstCellZ; cellZ <= lastCellZ; cellZ++)
+    {
+      int bucket = SpatialHash_getBucket(self, cellX, level, cellZ);
+
+      if (self->isSorted)
+      {
+        for (int entry = self->bucketStarts[bucket];
+          entry < self->bucketStarts[bucket + 1]; entry++)
+        {
+          if (!SpatialHash_isInQuery(self->entriesX[entry],
+            self->entryLevels[entry], self->entriesZ[entry],
+            self->entryCellsX[entry], self->entryCellsZ[entry], level, cellX,
+            cellZ, minX, minZ, maxX, maxZ, centerX, centerZ, radiusSquared))
+            continue;
+          if (count == capacity) return count;
+          results[count++] = self->entries[entry];
+        }
+      }
+      else
+      {
+        for (int entity = self->bucketHeads[bucket]; entity >= 0;
+          entity = self->nextEntities[entity])
+        {
+          if (!SpatialHash_isInQuery(self->positionsX[entity],
+            self->levels[entity], self->positionsZ[entity],
+            self->cellsX[entity], self->cellsZ[entity], level, cellX, cellZ,
+            minX, minZ, maxX, maxZ, centerX, centerZ, radiusSquared))
+            continue;
+          if (count == capacity) return count;
+          results[count++] = entity;
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+//Finds the entities within a radius around a position.
+//self: A pointer to the hash.
+//x, level, z: The position.
+//radius: The maximum distance of the entities to the position (in units).
+//results: The target for the entity indicies (in no particular order).
+//capacity: The maximum amount of entities to find.
+//Returns the amount of found entities.
+int SpatialHash_queryRadius(const SpatialHash *self, float x, int level,
+  float z, float radius, int *results, int capacity)
+{
+  return SpatialHash_collect(self, level, x - radius, z - radius, x + radius,
+    z + radius, x, z, radius * radius, results, capacity);
+}
+
+//Finds the entities within a box.
+//self: A pointer to the hash.
+//minX, level, minZ: The corner of the box with the smallest coordinates.
+//maxX, maxZ: The corner of the box with the largest coordinates.
+//results: The target for the entity indicies (in no particular order).
+//capacity: The maximum amount of entities to find.
+//Returns the amount of found entities.
+int SpatialHash_queryBox(const SpatialHash *self, float minX, int level,
+  float minZ, float maxX, float maxZ, int *results, int capacity)
+{
+  //An infinite radius doesn't restrict the box any further.
+  return SpatialHash_collect(self, level, minX, minZ, maxX, maxZ, minX, minZ,
+    INFINITY, results, capacity);
+}
+
+//=============================================================================
+// Npc: Maze dwellers which wander around and chase the player.
+//=============================================================================
+
+//The radius of a maze dweller used for collisions with walls (in units).
+#define NPC_RADIUS 0.15f
+//In units/second, without any friction (like PLAYER_MAX_SPEED).
+#define NPC_MAX_SPEED 0.1f
+//Maze dwellers hop while they're chasing the player (like PLAYER_JUMP_SPEED).
+#define NPC_JUMP_SPEED 0.6f
+//The maximum change of the wandering direction (in radians/second).
+#define NPC_WANDER_TURN_SPEED 4.0f
+//Maze dwellers closer to the player than this (in units) chase the player.
+#define NPC_CHASE_DISTANCE 5.0f
+//The maximum time (in seconds) one update of the maze dwellers simulates.
+#define NPC_MAX_DELTA_SECONDS 0.1f
+//The scale of the crystal mesh maze dwellers are drawn with.
+#define NPC_MESH_SCALE 0.35f
+//The distance (in units) in which other maze dwellers are avoided.
+#define NPC_AVOIDANCE_DISTANCE 1.0f
+//The maximum amount of other maze dwellers avoided at once.
+#define NPC_MAX_NEIGHBOURS 10
+//The amount of updates in which collisions with other maze dwellers are
+//predicted - with more, maze dwellers avoid each other earlier.
+#define NPC_AVOIDANCE_HORIZON 20.0f
+//Smaller values are treated as 0 by the avoidance.
+#define NPC_AVOIDANCE_EPSILON 0.00001f
+
+typedef enum
+{
+  NpcWandering = 0,
+  NpcChasing = 1
+} NpcState;
+
+//Contains the state of all maze dwellers as structure of arrays, so that the
+//update loops only touch the values they need and can be vectorized.
+typedef struct
+{
+  int count;
+  float *positionsX, *positionsY, *positionsZ;
+  float *velocitiesX, *velocitiesY, *velocitiesZ;
+  //The (normalized) direction wandering maze dwellers move into.
+  float *headingsX, *headingsZ;
+  int *levels;
+  uint8_t *states;
+  //The state of the random number generator of every maze dweller.
+  uint32_t *randoms;
+  //The blocking bits of the 3x3 fields around the field every maze dweller
+  //was in during the last update (see "NpcPopulation_getNeighbourhood").
+  uint16_t *neighbourhoods;
+  int *neighbourhoodFieldsX, *neighbourhoodFieldsZ;
+  //true if the map was changed, so that all neighbourhoods are outdated.
+  bool neighbourhoodsInvalid;
+  //One bit per field of the map, set for blocking fields - which is small
+  //enough to stay in the cache even for big maps. The map is surrounded by
+  //a border of blocking fields, so that lookups don't need bounds checks.
+  uint32_t *blockingBits;
+  int width, depth, levelCount;
+  //true if maze dwellers avoid each other (see "NpcPopulation_avoid"), the
+  //spatial hash used to find the other maze dwellers around them and the
+  //calculated velocities.
+  bool isAvoiding;
+  SpatialHash hash;
+  float *avoidanceVelocitiesX, *avoidanceVelocitiesZ;
+} NpcPopulation;
+
+//The amount of maze dwellers to spawn in finite maps (see "--npcs").
+int npcCount = 0;
+NpcPopulation npcPopulation;
+ShaderProgram instancedShaderProgram;
+BufferedMesh npcMesh;
+
+//Gets the index of the blocking bit of a field.
+//self: A pointer to the population.
+//x, level, z: The indicies of the field (from -1 to the width or depth).
+int NpcPopulation_getBitIndex(const NpcPopulation *self, int x, int level,
+  int z)
+{
+  return (level * (self->width + 2) + x + 1) * (self->depth + 2) + z + 1;
+}
+
+//Updates the blocking bit of a field.
+//self: A pointer to the population.
+//fields: The fields of the map.
+//x, level, z: The indicies of the field.
+void NpcPopulation_updateBlockingBit(NpcPopulation *self, const Field *fields,
+  int x, int level, int z)
+{
+  int index = NpcPopulation_getBitIndex(self, x, level, z);
+  bool isBlocking = x < 0 || x >= self->width || z < 0 || z >= self->depth ||
+    !Analysis_isWalkable(fields[(level * self->width + x) * self->depth + z]);
+
+  if (isBlocking) self->blockingBits[index / 32] |= 1u << (index % 32);
+  else self->blockingBits[index / 32] &= ~(1u << (index % 32));
+}
+
+//Checks if a field blocks maze dwellers.
+//self: A pointer to the population.
+//x, level, z: The indicies of the field (from -1 to the width or depth).
+bool NpcPopulation_isBlocking(const NpcPopulation *self, int x, int level,
+  int z)
+{
+  int index = NpcPopulation_getBitIndex(self, x, level, z);
+  return (self->blockingBits[index / 32] >> (index % 32)) & 1;
+}
+
+//Initializes a NpcPopulation instance and spawns the maze dwellers on 
+//random walkable fields.
+//self: A pointer to the (uninitialized) population.
+//fields, width, depth, levels: The map (see "MapGrid_initialize").
+//count: The amount of maze dwellers.
+//seed: The seed for the spawn points and the behaviour.
+//Terminates the application if the map doesn't contain walkable fields.
+void NpcPopulation_initialize(NpcPopulation *self, const Field *fields,
+  int width, int depth, int levels, int count, uint32_t seed)
+{
+  const int fieldCount = width * depth * levels;
+  const size_t floatsSize = sizeof(float) * MAX(1, count);
+  uint32_t random = seed != 0 ? seed : 1;
+
+  self->count = count;
+  self->width = width;
+  self->depth = depth;
+  self->levelCount = levels;
+  self->positionsX = (float *)Common_allocate(floatsSize);
+  self->positionsY = (float *)Common_allocate(floatsSize);
+  self->positionsZ = (float *)Common_allocate(floatsSize);
+  self->velocitiesX = (float *)Common_allocate(floatsSize);
+  self->velocitiesY = (float *)Common_allocate(floatsSize);
+  self->velocitiesZ = (float *)Common_allocate(floatsSize);
+  self->headingsX = (float *)Common_allocate(floatsSize);
+  self->headingsZ = (float *)Common_allocate(floatsSize);
+  self->levels = (int *)Common_allocate(sizeof(int) * MAX(1, count));
+  self->states = (uint8_t *)Common_allocate(MAX(1, count));
+  self->randoms = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    MAX(1, count));
+  self->neighbourhoods = (uint16_t *)Common_allocate(sizeof(uint16_t) *
+    MAX(1, count));
+  self->neighbourhoodFieldsX = (int *)Common_allocate(sizeof(int) *
+    MAX(1, count));
+  self->neighbourhoodFieldsZ = (int *)Common_allocate(sizeof(int) *
+    MAX(1, count));
+  self->neighbourhoodsInvalid = true;
+  self->blockingBits = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    ((width + 2) * (depth + 2) * levels / 32 + 1));
+  self->isAvoiding = true;
+  SpatialHash_initialize(&self->hash, NPC_AVOIDANCE_DISTANCE, count);
+  self->avoidanceVelocitiesX = (float *)Common_allocate(floatsSize);
+  self->avoidanceVelocitiesZ = (float *)Common_allocate(floatsSize);
+
+  for (int level = 0; level < levels; level++)
+    for (int x = -1; x <= width; x++)
+      for (int z = -1; z <= depth; z++)
+        NpcPopulation_updateBlockingBit(self, fields, x, level, z);
+
+  for (int i = 0; i < count; i++)
+  {
+    int index = 0, attempt = 0;
+    do index = (int)(Maze_random(&random) % fieldCount);
+    while (!Analysis_isWalkable(fields[index]) && ++attempt < 1000000);
+    if (attempt == 1000000) Common_terminate("LOADING",
+      "The map doesn't contain fields for the maze dwellers to spawn on.");
+
+    float angle = (Maze_random(&random) % 3600) * (2.0f * PI / 3600.0f);
+    self->positionsX[i] = (float)((index % (width * depth)) / depth);
+    self->positionsY[i] = 0.0f;
+    self->positionsZ[i] = (float)(index % depth);
+    self->velocitiesX[i] = 0.0f;
+    self->velocitiesY[i] = 0.0f;
+    self->velocitiesZ[i] = 0.0f;
+    self->headingsX[i] = cosf(angle);
+    self->headingsZ[i] = sinf(angle);
+    self->levels[i] = index / (width * depth);
+    self->states[i] = NpcWandering;
+    self->randoms[i] = Maze_random(&random) | 1;
+  }
+}
+
+//Releases the resources of a NpcPopulation instance.
+void NpcPopulation_destroy(NpcPopulation *self)
+{
+  free(self->positionsX);
+  free(self->positionsY);
+  free(self->positionsZ);
+  free(self->velocitiesX);
+  free(self->velocitiesY);
+  free(self->velocitiesZ);
+  free(self->headingsX);
+  free(self->headingsZ);
+  free(self->levels);
+  free(self->states);
+  free(self->randoms);
+  free(self->neighbourhoods);
+  free(self->neighbourhoodFieldsX);
+  free(self->neighbourhoodFieldsZ);
+  free(self->blockingBits);
+  free(self->avoidanceVelocitiesX);
+  free(self->avoidanceVelocitiesZ);
+  SpatialHash_destroy(&self->hash);
+  self->count = 0;
+  self->blockingBits = NULL;
+}
+
+//Gets the blocking bits of the 3x3 fields around a field, where the bit 
+//(offsetX + 1) * 3 + offsetZ + 1 belongs to the field (x + offsetX, 
+//z + offsetZ).
+//self: A pointer to the population.
+//x, level, z: The indicies of the field in the center.
+uint16_t NpcPopulation_getNeighbourhood(const NpcPopulation *self, int x,
+  int level, int z)
+{
+  uint16_t neighbourhood = 0;
+  for (int offsetX = -1; offsetX <= 1; offsetX++)
+    for (int offsetZ = -1; offsetZ <= 1; offsetZ++)
+      if (NpcPopulation_isBlocking(self, x + offsetX, level, z + offsetZ))
+        neighbourhood |= 1 << ((offsetX + 1) * 3 + offsetZ + 1);
+  return neighbourhood;
+}
+
+//Steers a range of maze dwellers: wanderers change their direction 
+//randomly, maze dwellers close to the target chase it. They accelerate,
+//jump and fall like the player. Works without branches or library calls, so
+//that the loop can be vectorized.
+//self: A pointer to the population.
+//first: The index of the first maze dweller to update.
+//last: The index after the last maze dweller to update.
+//deltaSeconds: The time since the last update.
+//targetX, targetLevel, targetZ: The position of the player.
+void NpcPopulation_steer(NpcPopulation *self, int first, int last,
+  float deltaSeconds, float targetX, int targetLevel, float targetZ)
+{
+  //Longer updates would let the friction overshoot (and maze dwellers move
+  //further than one field).
+  deltaSeconds = MIN(deltaSeconds, NPC_MAX_DELTA_SECONDS);
+  const float turnScale =
+    NPC_WANDER_TURN_SPEED * 2.0f * deltaSeconds / 65536.0f;
+  const float acceleration = deltaSeconds * NPC_MAX_SPEED;
+  const float friction = deltaSeconds * PLAYER_FRICTION;
+
+  for (int i = first; i < last; i++)
+  {
+    uint32_t random = self->randoms[i];
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    self->randoms[i] = random;
+
+    //Turning by a small angle is approximated with a shear, which is then
+    //normalized again (with one Newton step, as the length is close to 1).
+    float turn = (float)((int)(random >> 16) - 32768) * turnScale;
+    float headingX = self->headingsX[i] - self->headingsZ[i] * turn;
+    float headingZ = self->headingsZ[i] + self->headingsX[i] * turn;
+    float headingScale =
+      1.5f - 0.5f * (headingX * headingX + headingZ * headingZ);
+    headingX *= headingScale;
+    headingZ *= headingScale;
+
+    //Chasing maze dwellers accelerate towards the target - the closer they
+    //are, the more carefully.
+    float x = self->positionsX[i], z = self->positionsZ[i];
+    float toTargetX = (targetX - x) * (1.0f / NPC_CHASE_DISTANCE);
+    float toTargetZ = (targetZ - z) * (1.0f / NPC_CHASE_DISTANCE);
+    bool chasing = (toTargetX * toTargetX + toTargetZ * toTargetZ < 1.0f) &
+      (self->levels[i] == targetLevel);
+    self->states[i] = chasing ? NpcChasing : NpcWandering;
+
+    float velocityX = self->velocitiesX[i] +
+      (chasing ? toTargetX : headingX) * acceleration;
+    float velocityZ = self->velocitiesZ[i] +
+      (chasing ? toTargetZ : headingZ) * acceleration;
+    velocityX -= velocityX * friction;
+    velocityZ -= velocityZ * friction;
+
+    //The same vertical movement as the player (see "Game_onUpdate").
+    float velocityY = self->velocitiesY[i];
+    bool airborne = self->positionsY[i] > CALCULATION_TRESHOLD;
+    float bounce = fabsf(velocityY) > CALCULATION_TRESHOLD ?
+      -velocityY * FLOOR_BOUNCYNESS : 0.0f;
+    velocityY = airborne ? velocityY - PLAYER_GRAVITY * deltaSeconds :
+      (chasing ? NPC_JUMP_SPEED * deltaSeconds : bounce);
+    self->velocitiesY[i] = velocityY;
+    self->positionsY[i] = MAX(0.0f, self->positionsY[i] + velocityY);
+
+    self->velocitiesX[i] = velocityX;
+    self->velocitiesZ[i] = velocityZ;
+    self->headingsX[i] = headingX;
+    self->headingsZ[i] = headingZ;
+  }
+}
+
+//Moves a range of maze dwellers by their velocities, where they bounce off
+//walls (testing the fields at their radius separately on both axes, as they
+//move less than one field per update). The walls around every maze dweller
+//are cached, so that the blocking bits only need to be read when it enters
+//another field.
+//self: A pointer to the population.
+//first: The index of the first maze dweller to move.
+//last: The index after the last maze dweller to move.
+void NpcPopulation_move(NpcPopulation *self, int first, int last)
+{
+  //Positions are never further outside of the map than the radius, so the
+  //field indicies are rounded without floorf (which is a library call on 
+  //many compilers).
+  for (int i = first; i < last; i++)
+  {
+    int fieldX = (int)(self->positionsX[i] + 1.5f) - 1;
+    int fieldZ = (int)(self->positionsZ[i] + 1.5f) - 1;
+    if (fieldX == self->neighbourhoodFieldsX[i] &&
+      fieldZ == self->neighbourhoodFieldsZ[i] &&
+      !self->neighbourhoodsInvalid) continue;
+    self->neighbourhoodFieldsX[i] = fieldX;
+    self->neighbourhoodFieldsZ[i] = fieldZ;
+    self->neighbourhoods[i] = NpcPopulation_getNeighbourhood(self, fieldX,
+      self->levels[i], fieldZ);
+  }
+
+  //The movement works without branches or library calls as well.
+  for (int i = first; i < last; i++)
+  {
+    float x = self->positionsX[i], z = self->positionsZ[i];
+    float velocityX = self->velocitiesX[i], velocityZ = self->velocitiesZ[i];
+    float headingX = self->headingsX[i], headingZ = self->headingsZ[i];
+
+    //Test the fields at the edges of the moved circle on the X axis, then
+    //on the Z axis (with the new X position) in the cached neighbourhood.
+    //Blocked movements are reverted arithmetically, as branches would be
+    //mispredicted all the time.
+    int neighbourhood = self->neighbourhoods[i];
+    int fieldX = self->neighbourhoodFieldsX[i];
+    int fieldZ = self->neighbourhoodFieldsZ[i];
+    int edgeX = (int)(x + velocityX + copysignf(NPC_RADIUS, velocityX) +
+      1.5f) - fieldX;
+    int lowZ = (int)(z - NPC_RADIUS + 1.5f) - fieldZ;
+    int highZ = (int)(z + NPC_RADIUS + 1.5f) - fieldZ;
+    float blockedX = (float)(((neighbourhood >> (edgeX * 3 + lowZ)) |
+      (neighbourhood >> (edgeX * 3 + highZ))) & 1);
+    x += velocityX * (1.0f - blockedX);
+    velocityX *= 1.0f - 2.0f * blockedX;
+    headingX *= 1.0f - 2.0f * blockedX;
+
+    int edgeZ = (int)(z + velocityZ + copysignf(NPC_RADIUS, velocityZ) +
+      1.5f) - fieldZ;
+    int lowX = (int)(x - NPC_RADIUS + 1.5f) - fieldX;
+    int highX = (int)(x + NPC_RADIUS + 1.5f) - fieldX;
+    float blockedZ = (float)(((neighbourhood >> (lowX * 3 + edgeZ)) |
+      (neighbourhood >> (highX * 3 + edgeZ))) & 1);
+    z += velocityZ * (1.0f - blockedZ);
+    velocityZ *= 1.0f - 2.0f * blockedZ;
+    headingZ *= 1.0f - 2.0f * blockedZ;
+
+    self->positionsX[i] = x;
+    self->positionsZ[i] = z;
+    self->velocitiesX[i] = velocityX;
+    self->velocitiesZ[i] = velocityZ;
+    self->headingsX[i] = headingX;
+    self->headingsZ[i] = headingZ;
+  }
+}
+
+//A half-plane of velocities for the local avoidance (see
+//"NpcPopulation_avoid"): the line through the point in the direction, where
+//the velocities on the left side of the line are allowed.
+typedef struct
+{
+  float pointX, pointZ, directionX, directionZ;
+} NpcAvoidanceLine;
+
+//Gets the cross product (the determinant) of two vectors on the XZ plane,
+//which is positive if b points to the left of a.
+float NpcAvoidance_cross(float aX, float aZ, float bX, float bZ)
+{
+  return aX * bZ - aZ * bX;
+}
+
+//Finds the velocity on a line which is closest to an optimal velocity (or
+//furthest in an optimal direction) and satisfies the lines before it and the
+//maximum speed.
+//lines: The lines.
+//lineIndex: The index of the line the velocity is searched on.
+//maxSpeed: The maximum length of the velocity.
+//optimalX, optimalZ: The optimal velocity or direction.
+//isDirection: true if the optimal velocity is a (normalized) direction.
+//resultX, resultZ: The target for the velocity.
+//Returns false if there's no such velocity (the result is unchanged then).
+bool NpcAvoidance_solveOnLine(const NpcAvoidanceLine *lines, int lineIndex,
+  float maxSpeed, float optimalX, float optimalZ, bool isDirection,
+  float *resultX, float *resultZ)
+{
+  const NpcAvoidanceLine *line = &lines[lineIndex];
+  float dot = line->pointX * line->directionX +
+    line->pointZ * line->directionZ;
+  float discriminant = dot * dot + maxSpeed * maxSpeed -
+    (line->pointX * line->pointX + line->pointZ * line->pointZ);
+  if (discriminant < 0.0f) return false;
+
+  //The part of the line within the maximum speed is narrowed down by the
+  //lines before it.
+  float root = sqrtf(discriminant);
+  float left = -dot - root, right = -dot + root;
+  for (int i = 0; i < lineIndex; i++)
+  {
+    float denominator = NpcAvoidance_cross(line->directionX,
+      line->directionZ, lines[i].directionX, lines[i].directionZ);
+    float numerator = NpcAvoidance_cross(lines[i].directionX,
+      lines[i].directionZ, line->pointX - lines[i].pointX,
+      line->pointZ - lines[i].pointZ);
+
+    //Parallel lines either exclude the whole line or nothing of it.
+    if (fabsf(denominator) <= NPC_AVOIDANCE_EPSILON)
+    {
+      if (numerator < 0.0f) return false;
+      continue;
+    }
+
+    float t = numerator / denominator;
+    if (denominator >= 0.0f) right = MIN(right, t);
+    else left = MAX(left, t);
+    if (left > right) return false;
+  }
+
+  float t;
+  if (isDirection) t = optimalX * line->directionX +
+    optimalZ * line->directionZ > 0.0f ? right : left;
+  else t = MAX(left, MIN(right, line->directionX * (optimalX - line->pointX) +
+    line->directionZ * (optimalZ - line->pointZ)));
+  *resultX = line->pointX + t * line->directionX;
+  *resultZ = line->pointZ + t * line->directionZ;
+  return true;
+}
+
+//Finds the velocity which satisfies all lines and the maximum speed and is
+//closest to an optimal velocity (or furthest in an optimal direction).
+//lines, count: The lines.
+//maxSpeed, optimalX, optimalZ, isDirection: See "NpcAvoidance_solveOnLine".
+//resultX, resultZ: The target for the velocity.
+//Returns the amount of lines or the index of the first line which couldn't
+//be satisfied (the result then satisfies the lines before it).
+int NpcAvoidance_solve(const NpcAvoidanceLine *lines, int count,
+  float maxSpeed, float optimalX, float optimalZ, bool isDirection,
+  float *resultX, float *resultZ)
+{
+  float optimalLength = sqrtf(optimalX * optimalX + optimalZ * optimalZ);
+  float scale = isDirection ? maxSpeed :
+    (optimalLength > maxSpeed ? maxSpeed / optimalLength : 1.0f);
+  *resultX = optimalX * scale;
+  *resultZ = optimalZ * scale;
+
+  //The velocity only changes when it violates a line - it's then moved onto
+  //that line (as close to the optimum as the previous lines allow).
+  for (int i = 0; i < count; i++)
+  {
+    if (NpcAvoidance_cross(lines[i].directionX, lines[i].directionZ,
+      lines[i].pointX - *resultX, lines[i].pointZ - *resultZ) > 0.0f &&
+      !NpcAvoidance_solveOnLine(lines, i, maxSpeed, optimalX, optimalZ,
+        isDirection, resultX, resultZ)) return i;
+  }
+
+  return count;
+}
+
+//Finds the velocity which violates the lines the least (by the largest
+//distance to a line), if a maze dweller is so crowded that not all lines can
+//be satisfied.
+//lines, count: The lines.
+//firstFailed: The index of the first line which couldn't be satisfied.
+//maxSpeed: The maximum length of the velocity.
+//resultX, resultZ: The velocity satisfying the lines before the first failed
+//one, which is replaced by the result.
+void NpcAvoidance_solveCrowded(const NpcAvoidanceLine *lines, int count,
+  int firstFailed, float maxSpeed, float *resultX, float *resultZ)
+{
+  NpcAvoidanceLine projectedLines[NPC_MAX_NEIGHBOURS];
+  float distance = 0.0f;
+
+  for (int i = firstFailed; i < count; i++)
+  {
+    const NpcAvoidanceLine *line = &lines[i];
+    if (NpcAvoidance_cross(line->directionX, line->directionZ,
+      line->pointX - *resultX, line->pointZ - *resultZ) <= distance) continue;
+
+    //The previous lines are projected onto this one (as the lines where
+    //both are violated equally), so that the velocity is moved as far as
+    //possible to the allowed side of this line without violating the
+    //previous lines more than this one.
+    int projectedCount = 0;
+    for (int j = 0; j < i; j++)
+    {
+      NpcAvoidanceLine *projected = &projectedLines[projectedCount];
+      float determinant = NpcAvoidance_cross(line->directionX,
+        line->directionZ, lines[j].directionX, lines[j].directionZ);
+
+      if (fabsf(determinant) > NPC_AVOIDANCE_EPSILON)
+      {
+        float t = NpcAvoidance_cross(lines[j].directionX,
+          lines[j].directionZ, line->pointX - lines[j].pointX,
+          line->pointZ - lines[j].pointZ) / determinant;
+        projected->pointX = line->pointX + t * line->directionX;
+        projected->pointZ = line->pointZ + t * line->directionZ;
+      }
+      //Parallel lines pointing the same way don't restrict the velocity.
+      else if (line->directionX * lines[j].directionX +
+        line->directionZ * lines[j].directionZ > 0.0f) continue;
+      else
+      {
+        projected->pointX = 0.5f * (line->pointX + lines[j].pointX);
+        projected->pointZ = 0.5f * (line->pointZ + lines[j].pointZ);
+      }
+
+      float directionX = lines[j].directionX - line->directionX;
+      float directionZ = lines[j].directionZ - line->directionZ;
+      float length = sqrtf(directionX * directionX + directionZ * directionZ);
+      projected->directionX = directionX / length;
+      projected->directionZ = directionZ / length;
+      projectedCount++;
+    }
+
+    //The projected lines can only fail because of rounding errors - the
+    //velocity stays the same then.
+    float previousX = *resultX, previousZ = *resultZ;
+    if (NpcAvoidance_solve(projectedLines, projectedCount, maxSpeed,
+      -line->directionZ, line->directionX, true, resultX, resultZ) <
+      projectedCount)
+    {
+      *resultX = previousX;
+      *resultZ = previousZ;
+    }
+    distance = NpcAvoidance_cross(line->directionX, line->directionZ,
+      line->pointX - *resultX, line->pointZ - *resultZ);
+  }
+}
+
+//Calculates the velocities of a range of maze dwellers which avoid the other
+//maze dwellers around them with optimal reciprocal collision avoidance
+//(ORCA): every neighbour excludes a half-plane of velocities which would
+//lead to a collision within NPC_AVOIDANCE_HORIZON updates - where both maze
+//dwellers take half of the responsibility - and the velocity closest to the
+//current one in all half-planes is found with a small linear program.
+//Only the positions, the velocities and the spatial hash are read, so that
+//all ranges can be processed at the same time.
+//self: A pointer to the population (with an up-to-date spatial hash).
+//first: The index of the first maze dweller.
+//last: The index after the last maze dweller.
+void NpcPopulation_avoid(NpcPopulation *self, int first, int last)
+{
+  const float combinedRadius = 2.0f * NPC_RADIUS;
+  const float inverseHorizon = 1.0f / NPC_AVOIDANCE_HORIZON;
+  //The velocity where the acceleration and the friction cancel each other
+  //out (the velocities are in units per update).
+  const float maxSpeed = NPC_MAX_SPEED / PLAYER_FRICTION;
+  int neighbours[NPC_MAX_NEIGHBOURS + 1];
+  NpcAvoidanceLine lines[NPC_MAX_NEIGHBOURS];
+
+  for (int i = first; i < last; i++)
+  {
+    float x = self->positionsX[i], z = self->positionsZ[i];
+    float velocityX = self->velocitiesX[i], velocityZ = self->velocitiesZ[i];
+    int neighbourCount = SpatialHash_queryRadius(&self->hash, x,
+      self->levels[i], z, NPC_AVOIDANCE_DISTANCE, neighbours,
+      NPC_MAX_NEIGHBOURS + 1);
+    int lineCount = 0;
+
+    for (int n = 0; n < neighbourCount && lineCount < NPC_MAX_NEIGHBOURS;
+      n++)
+    {
+      int j = neighbours[n];
+      if (j == i) continue;
+
+      float offsetX = self->positionsX[j] - x;
+      float offsetZ = self->positionsZ[j] - z;
+      float relativeX = velocityX - self->velocitiesX[j];
+      float relativeZ = velocityZ - self->velocitiesZ[j];
+      float distanceSquared = offsetX * offsetX + offsetZ * offsetZ;
+      NpcAvoidanceLine *line = &lines[lineCount++];
+      float changeX, changeZ;
+
+      //The velocity obstacle is a cone towards the neighbour, cut off by a
+      //circle at the horizon - the relative velocity is moved to the closest
+      //point on its border (the change), where w is the relative velocity
+      //relative to the center of that circle.
+      if (distanceSquared > combinedRadius * combinedRadius)
+      {
+        float wX = relativeX - inverseHorizon * offsetX;
+        float wZ = relativeZ - inverseHorizon * offsetZ;
+        float wLengthSquared = wX * wX + wZ * wZ;
+        float dot = wX * offsetX + wZ * offsetZ;
+
+        if (dot < 0.0f &&
+          dot * dot > combinedRadius * combinedRadius * wLengthSquared)
+        {
+          float wLength = sqrtf(wLengthSquared);
+          float unitX = wX / wLength, unitZ = wZ / wLength;
+          line->directionX = unitZ;
+          line->directionZ = -unitX;
+          changeX = (combinedRadius * inverseHorizon - wLength) * unitX;
+          changeZ = (combinedRadius * inverseHorizon - wLength) * unitZ;
+        }
+        else
+        {
+          float leg = sqrtf(distanceSquared - combinedRadius * combinedRadius);
+          if (NpcAvoidance_cross(offsetX, offsetZ, wX, wZ) > 0.0f)
+          {
+            line->directionX = (offsetX * leg - offsetZ * combinedRadius) /
+              distanceSquared;
+            line->directionZ = (offsetX * combinedRadius + offsetZ * leg) /
+              distanceSquared;
+          }
+          else
+          {
+            line->directionX = -(offsetX * leg + offsetZ * combinedRadius) /
+              distanceSquared;
+            line->directionZ = -(offsetZ * leg - offsetX * combinedRadius) /
+              distanceSquared;
+          }
+          float dot = relativeX * line->directionX +
+            relativeZ * line->directionZ;
+          changeX = dot * line->directionX - relativeX;
+          changeZ = dot * line->directionZ - relativeZ;
+        }
+      }
+      //Overlapping maze dwellers are pushed apart within one update. Ones
+      //at the same position with the same velocity are pushed apart along
+      //the X axis (in opposite directions, by their indicies).
+      else
+      {
+        float wX = relativeX - offsetX, wZ = relativeZ - offsetZ;
+        float wLength = sqrtf(wX * wX + wZ * wZ);
+        float unitX = wLength > NPC_AVOIDANCE_EPSILON ? wX / wLength :
+          (i < j ? -1.0f : 1.0f);
+        float unitZ = wLength > NPC_AVOIDANCE_EPSILON ? wZ / wLength : 0.0f;
+        line->directionX = unitZ;
+        line->directionZ = -unitX;
+        changeX = (combinedRadius - wLength) * unitX;
+        changeZ = (combinedRadius - wLength) * unitZ;
+      }
+
+      line->pointX = velocityX + 0.5f * changeX;
+      line->pointZ = velocityZ + 0.5f * changeZ;
+    }
+
+    //Maze dwellers without neighbours keep their velocity.
+    if (lineCount > 0)
+    {
+      int failed = NpcAvoidance_solve(lines, lineCount, maxSpeed, velocityX,
+        velocityZ, false, &velocityX, &velocityZ);
+      if (failed < lineCount) NpcAvoidance_solveCrowded(lines, lineCount,
+        failed, maxSpeed, &velocityX, &velocityZ);
+    }
+    self->avoidanceVelocitiesX[i] = velocityX;
+    self->avoidanceVelocitiesZ[i] = velocityZ;
+  }
+}
+
+//Collects the instance attributes (see the instanced shader) of the maze
+//dwellers close to a position.
+//self: A pointer to the population.
+//x, level, z: The position.
+//radius: The maximum distance to the position (in units).
+//instances: The target for 4 floats per maze dweller.
+//capacity: The maximum amount of maze dwellers to collect.
+//Returns the amount of collected maze dwellers.
+int NpcPopulation_getInstances(const NpcPopulation *self, float x, int level,
+  float z, float radius, float *instances, int capacity)
+{
+  int count = 0;
+
+  for (int i = 0; i < self->count && count < capacity; i++)
+  {
+    float offsetX = self->positionsX[i] - x, offsetZ = self->positionsZ[i] - z;
+    if (self->levels[i] != level ||
+      offsetX * offsetX + offsetZ * offsetZ > radius * radius) continue;
+    instances[count * 4] = self->positionsX[i];
+    instances[count * 4 + 1] = level * LEVEL_HEIGHT + self->positionsY[i];
+    instances[count * 4 + 2] = self->positionsZ[i];
+    instances[count * 4 + 3] = atan2f(self->headingsX[i], self->headingsZ[i]);
+    count++;
+  }
+
+  return count;
+}
+
+//Describes how the maze dwellers are split into blocks which are updated on
+//the worker pool, and which parts of the update are done.
+typedef struct
+{
+  NpcPopulation *population;
+  int blockSize;
+  float deltaSeconds, targetX, targetZ;
+  int targetLevel;
+  bool isSteering, isMoving;
+} NpcUpdateBlocks;
+
+//Updates one block of maze dwellers (for parallelFor).
+//data: A pointer to a NpcUpdateBlocks instance.
+//index: The index of the block.
+void NpcPopulation_updateBlock(void *data, int index)
+{
+  NpcUpdateBlocks *blocks = (NpcUpdateBlocks *)data;
+  int first = index * blocks->blockSize;
+  int last = MIN(blocks->population->count, first + blocks->blockSize);
+
+  if (blocks->isSteering) NpcPopulation_steer(blocks->population, first,
+    last, blocks->deltaSeconds, blocks->targetX, blocks->targetLevel,
+    blocks->targetZ);
+  if (blocks->isMoving) NpcPopulation_move(blocks->population, first, last);
+}
+
+//Calculates the avoiding velocities of one block of maze dwellers (for
+//parallelFor).
+//data: A pointer to a NpcUpdateBlocks instance.
+//index: The index of the block.
+void NpcPopulation_avoidBlock(void *data, int index)
+{
+  NpcUpdateBlocks *blocks = (NpcUpdateBlocks *)data;
+  int first = index * blocks->blockSize;
+  NpcPopulation_avoid(blocks->population, first,
+    MIN(blocks->population->count, first + blocks->blockSize));
+}
+
+//Runs a function for all blocks of maze dwellers.
+//pool: The worker pool or NULL to run the function on the calling thread
+//(with one block).
+//blockCount: The amount of blocks.
+//function: The function (see "WorkerPool_parallelFor").
+//blocks: A pointer to the NpcUpdateBlocks.
+void NpcPopulation_runBlocks(WorkerPool *pool, int blockCount,
+  void (*function)(void *, int), NpcUpdateBlocks *blocks)
+{
+  if (pool == NULL) function(blocks, 0);
+  else WorkerPool_parallelFor(pool, blockCount, function, blocks);
+}
+
+//Updates all maze dwellers, in blocks on the worker pool if one is given.
+//If they avoid each other, they are steered first, then the avoiding 
+//velocities are calculated from the steered ones (as the velocities they
+//prefer) and then they are moved with the avoiding velocities.
+//self: A pointer to the population.
+//pool: The worker pool or NULL to update all maze dwellers on the calling 
+//thread.
+//deltaSeconds, targetX, targetLevel, targetZ: See "NpcPopulation_steer".
+void NpcPopulation_updateAll(NpcPopulation *self, WorkerPool *pool,
+  float deltaSeconds, float targetX, int targetLevel, float targetZ)
+{
+  NpcUpdateBlocks blocks;
+  int blockCount = pool == NULL ? 1 :
+    MAX(1, MIN((pool->threadCount + 1) * 4, self->count / 1024));
+  bool isAvoiding = self->isAvoiding && self->count > 0;
+
+  blocks.population = self;
+  blocks.blockSize = (self->count + blockCount - 1) / blockCount;
+  blocks.deltaSeconds = deltaSeconds;
+  blocks.targetX = targetX;
+  blocks.targetLevel = targetLevel;
+  blocks.targetZ = targetZ;
+  blocks.isSteering = true;
+  blocks.isMoving = !isAvoiding;
+  NpcPopulation_runBlocks(pool, blockCount, NpcPopulation_updateBlock,
+    &blocks);
+
+  if (isAvoiding)
+  {
+    SpatialHash_rebuild(&self->hash, self->count, self->positionsX,
+      self->levels, self->positionsZ);
+    NpcPopulation_runBlocks(pool, blockCount, NpcPopulation_avoidBlock,
+      &blocks);
+
+    float *velocitiesX = self->velocitiesX, *velocitiesZ = self->velocitiesZ;
+    self->velocitiesX = self->avoidanceVelocitiesX;
+    self->velocitiesZ = self->avoidanceVelocitiesZ;
+    self->avoidanceVelocitiesX = velocitiesX;
+    self->avoidanceVelocitiesZ = velocitiesZ;
+
+    blocks.isSteering = false;
+    blocks.isMoving = true;
+    NpcPopulation_runBlocks(pool, blockCount, NpcPopulation_updateBlock,
+      &blocks);
+  }
+
+  self->neighbourhoodsInvalid = false;
+}
+
+//Spawns the maze dwellers requested with "--npcs" (in finite maps) and 
+//prepares drawing them.
+//seed: The seed for the spawn points and the behaviour.
+void Npc_initialize(uint32_t seed)
+{
+  if (npcCount <= 0) return;
+  if (!GLEW_ARB_instanced_arrays) Common_terminate("LOADING",
+    "Maze dwellers require instanced drawing, which isn't supported.");
+
+  NpcPopulation_initialize(&npcPopulation, map, mapWidth, mapDepth, mapLevels,
+    npcCount, seed);
+  instancedShaderProgram = ShaderProgram_createInstanced(false);
+  npcMesh = BufferedMesh_create(crystalMeshData, LENGTHOF(crystalMeshData),
+    instancedShaderProgram);
+  printf("Spawned %d maze dwellers.\n", npcCount);
+}
+
+//Updates the blocking bits of the maze dwellers (if there are any) after a
+//field of the current map was changed.
+//x, level, z: The indicies of the changed field.
+void Npc_onFieldChanged(int x, int level, int z)
+{
+  if (npcPopulation.blockingBits == NULL) return;
+
+  NpcPopulation_updateBlockingBit(&npcPopulation, map, x, level, z);
+  npcPopulation.neighbourhoodsInvalid = true;
+}
+
+//Draws the maze dweller instances recorded in a render packet with the
+//instanced shader.
+//packet: A pointer to the packet of the current frame.
+void Npc_draw(const RenderPacket *packet)
+{
+  if (npcPopulation.count == 0) return;
+
+  BufferedMesh_updateInstances(&npcMesh, packet->instances,
+    packet->instanceCount, instancedShaderProgram);
+
+  //Uniforms are stored per program, so the ones which change every frame
+  //need to be set on the instanced shader as well.
+  glUseProgram(instancedShaderProgram.handle);
+  ShaderProgram_setUniformValue_Matrix4x4(
+    instancedShaderProgram.uniformLocation_view, &packet->view);
+  ShaderProgram_setUniformValue_float(
+    instancedShaderProgram.uniformLocation_currentTimeMs,
+    packet->currentTimeMs);
+  ShaderProgram_setUniformValue_float(
+    instancedShaderProgram.uniformLocation_brightness, packet->brightness);
+  ShaderProgram_setUniformValue_vec3(
+    instancedShaderProgram.uniformLocation_viewerPosition, packet->viewerX,
+    packet->viewerY, packet->viewerZ);
+  ShaderProgram_setUniformValue_float(
+    instancedShaderProgram.uniformLocation_fadeDistance, FADE_DISTANCE);
+  ShaderProgram_setUniformValue_float(
+    instancedShaderProgram.uniformLocation_instanceScale, NPC_MESH_SCALE);
+  BufferedMesh_drawInstanced(&npcMesh);
+  glUseProgram(shaderProgram.handle);
+}
+
+//Releases the maze dwellers and their drawing resources.
+void Npc_destroy(void)
+{
+  if (npcPopulation.count == 0) return;
+
+  NpcPopulation_destroy(&npcPopulation);
+  BufferedMesh_destroy(&npcMesh);
+  ShaderProgram_destroy(&instancedShaderProgram);
+}
+
+//=============================================================================
+// Pickup: The quest items and goals the player can interact with.
+//=============================================================================
+
+//The size of the cells of the pickup hash (in units) - pickups are rare, so
+//the cells can be larger than the area around the player which is searched.
+#define PICKUP_CELL_SIZE 4.0f
+//The maximum amount of pickups found around the player at once.
+#define PICKUP_MAX_NEARBY 16
+
+//The quest items and goals of the current (finite) map in a spatial hash,
+//so that the ones around the player are found without reading the map.
+SpatialHash pickupHash;
+//The field type of every pickup (by entity index) and the entity indicies
+//which aren't used.
+Field *pickupFields = NULL;
+int *freePickups = NULL;
+int freePickupCount = 0;
+
+//Checks if a field type can be picked up or interacted with.
+//field: The field type.
+bool Pickup_isPickup(Field field)
+{
+  return field == Item || field == Goal;
+}
+
+//Inserts all quest items and goals of the current map into the pickup hash,
+//with room for as many more.
+void Pickup_initialize(void)
+{
+  const int fieldCount = mapWidth * mapDepth * mapLevels;
+  int count = 0;
+  for (int i = 0; i < fieldCount; i++) count += Pickup_isPickup(map[i]);
+
+  const int capacity = count * 2 + PICKUP_MAX_NEARBY;
+  SpatialHash_initialize(&pickupHash, PICKUP_CELL_SIZE, capacity);
+  pickupFields = (Field *)Common_allocate(sizeof(Field) * capacity);
+  freePickups = (int *)Common_allocate(sizeof(int) * capacity);
+  freePickupCount = 0;
+  for (int i = capacity - 1; i >= count; i--)
+    freePickups[freePickupCount++] = i;
+
+  for (int i = 0, entity = 0; i < fieldCount; i++)
+  {
+    if (!Pickup_isPickup(map[i])) continue;
+    pickupFields[entity] = map[i];
+    SpatialHash_insert(&pickupHash, entity++,
+      (float)((i % (mapWidth * mapDepth)) / mapDepth),
+      i / (mapWidth * mapDepth), (float)(i % mapDepth));
+  }
+}
+
+//Releases the pickup hash (if it's available).
+void Pickup_destroy(void)
+{
+  if (pickupFields == NULL) return;
+
+  SpatialHash_destroy(&pickupHash);
+  free(pickupFields);
+  free(freePickups);
+  pickupFields = NULL;
+  freePickups = NULL;
+}
+
+//Updates the pickup hash (if it's available) after a field of the current
+//map was changed. If there's no room for another pickup, the hash is 
+//created again from the map.
+//x, level, z: The indicies of the changed field.
+void Pickup_onFieldChanged(int x, int level, int z)
+{
+  if (pickupFields == NULL) return;
+
+  int found[PICKUP_MAX_NEARBY];
+  int foundCount = SpatialHash_queryBox(&pickupHash, (float)x, level,
+    (float)z, (float)x, (float)z, found, LENGTHOF(found));
+  for (int i = 0; i < foundCount; i++)
+  {
+    SpatialHash_remove(&pickupHash, found[i]);
+    freePickups[freePickupCount++] = found[i];
+  }
+
+  Field field = map[((size_t)level * mapWidth + x) * mapDepth + z];
+  if (!Pickup_isPickup(field)) return;
+  else if (freePickupCount == 0)
+  {
+    Pickup_destroy();
+    Pickup_initialize();
+    return;
+  }
+
+  int entity = freePickups[--freePickupCount];
+  pickupFields[entity] = field;
+  SpatialHash_insert(&pickupHash, entity, (float)x, level, (float)z);
+}
+
+//Checks if there's a pickup of a specific type on the 3x3 fields around a
+//field.
+//x, level, z: The indicies of the field in the center.
+//field: The field type of the pickup.
+bool Pickup_isNearby(int x, int level, int z, Field field)
+{
+  int found[PICKUP_MAX_NEARBY];
+  int foundCount = SpatialHash_queryBox(&pickupHash, (float)(x - 1), level,
+    (float)(z - 1), (float)(x + 1), (float)(z + 1), found, LENGTHOF(found));
+  for (int i = 0; i < foundCount; i++)
+    if (pickupFields[found[i]] == field) return true;
+  return false;
+}
+
+//=============================================================================
+// World: Chunk cache, background chunk generation and chunk meshes.
+//=============================================================================
+
+//Defines an enum of valid states of a slot in the chunk cache.
+typedef enum
+{
+  //The slot doesn't contain a chunk.
+  ChunkEmpty,
+  //The chunk is currently generated (and meshed) by a worker thread.
+  ChunkGenerating,
+  //The fields and the mesh of the chunk are available.
+  ChunkLoaded
+} ChunkState;
+
+//The edge length of the fields of a chunk including the adjacent fields of
+//its neighbours, which are required to decide which wall faces are visible.
+#define CHUNK_PADDED_SIZE (CHUNK_SIZE + 2)
+
+//Provides a slot in the chunk cache.
+typedef struct
+{
+  int chunkX, level, chunkZ;
+  ChunkState state;
+  //true if the fields of the chunk (or the fields of its neighbours next to
+  //its border) were changed since the chunk was meshed.
+  bool isDirty;
+  //Incremented every time the slot is assigned to a chunk, so that the results
+  //of jobs for chunks which were evicted in the meantime can be discarded.
+  unsigned int generation;
+  Field fields[CHUNK_SIZE * CHUNK_SIZE];
+  BufferedMesh mesh;
+} Chunk;
+
+//Provides a chunk generation job, which is created on the main thread,
+//processed by a worker thread and then handed back to the main thread.
+typedef struct ChunkJob
+{
+  Chunk *target;
+  unsigned int generation;
+  int chunkX, level, chunkZ;
+  //true if the fields need to be generated by the worker thread, false if they
+  //were already copied from the map by the main thread.
+  bool generateFields;
+  //The fields of the chunk, surrounded by the adjacent neighbour fields.
+  Field fields[CHUNK_PADDED_SIZE * CHUNK_PADDED_SIZE];
+  //The fields of the chunk on the level below (only lifts are relevant here).
+  Field fieldsBelow[CHUNK_SIZE * CHUNK_SIZE];
+  //The amount of fields (along the X/Z axis) inside the map boundaries.
+  int validWidth, validDepth;
+  float *vertexData;
+  int vertexDataLength;
+  double processingSeconds;
+  struct ChunkJob *next;
+} ChunkJob;
+
+//true to generate an endless maze instead of using the fixed map.
+bool endlessMode = false;
+//The seed of the endless maze.
+uint32_t mapSeed = 0;
+
+WorkerPool workerPool;
+
+//The chunk cache, where each chunk has a fixed slot (its chunk indicies modulo
+//CHUNK_CACHE_WIDTH and its level modulo CHUNK_CACHE_LEVELS). As only the
+//chunks around the player are kept loaded, two required chunks never share
+//the same slot.
+Chunk chunks[CHUNK_CACHE_LEVELS * CHUNK_CACHE_WIDTH * CHUNK_CACHE_WIDTH];
+
+//The jobs which were processed by the worker threads, but not yet integrated
+//into the chunk cache by the main thread.
+ChunkJob *finishedChunkJobs = NULL;
+Mutex finishedChunkJobsMutex;
+
+//Streaming statistics, which are printed regularily in the endless mode.
+unsigned int streamedChunkCount = 0;
+double streamedChunkSeconds = 0, lastStreamingStatisticsTime = 0;
+
+//Re-meshing statistics since the last time the statistics were printed.
+unsigned int remeshedChunkCount = 0, remeshUpdateCount = 0;
+double remeshSeconds = 0, maxRemeshSecondsPerUpdate = 0;
+size_t remeshUploadedBytes = 0;
+
+//Contains a chunk which is re-meshed on the worker pool and a buffer for its
+//vertex data, which only ever grows.
+typedef struct
+{
+  Chunk *chunk;
+  float *vertexData;
+  int vertexDataCapacity, vertexDataLength;
+} RemeshJob;
+
+//The chunks which are re-meshed in parallel (one for every thread).
+RemeshJob *remeshJobs = NULL;
+int remeshJobCount = 0;
+
+//The amount of walls which are toggled randomly every update (see
+//"World_toggleRandomWalls") to stress-test re-meshing, or 0 to disable that.
+int stressWallCount = 0;
+uint32_t stressRandomState = 1;
+
+//Divides two integers and rounds the result towards negative infinity.
+int World_floorDivide(int value, int divisor)
+{
+  int quotient = value / divisor;
+  if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) quotient--;
+  return quotient;
+}
+
+//Gets the (non-negative) remainder of a floored division.
+int World_floorModulo(int value, int divisor)
+{
+  return value - World_floorDivide(value, divisor) * divisor;
+}
+
+//Gets the cache slot of a chunk (which may currently contain another chunk).
+//chunkX: The X index of the chunk.
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk.
+Chunk *World_getChunkSlot(int chunkX, int level, int chunkZ)
+{
+  return &chunks[(World_floorModulo(level, CHUNK_CACHE_LEVELS) *
+    CHUNK_CACHE_WIDTH + World_floorModulo(chunkX, CHUNK_CACHE_WIDTH)) *
+    CHUNK_CACHE_WIDTH + World_floorModulo(chunkZ, CHUNK_CACHE_WIDTH)];
+}
+
+//Checks whether a cache slot is assigned to a specific chunk.
+//chunk: A pointer to the cache slot.
+//chunkX: The X index of the chunk.
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk.
+//loadedOnly: true to only accept chunks which are loaded completely.
+bool World_isChunk(const Chunk *chunk, int chunkX, int level, int chunkZ,
+  bool loadedOnly)
+{
+  return (loadedOnly ? chunk->state == ChunkLoaded :
+    chunk->state != ChunkEmpty) && chunk->chunkX == chunkX &&
+    chunk->level == level && chunk->chunkZ == chunkZ;
+}
+
+//Gets the field type at specific field indicies from the chunk cache.
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+//Returns Wall if the chunk containing the field isn't loaded (yet).
+Field World_getField(int x, int level, int z)
+{
+  int chunkX = World_floorDivide(x, CHUNK_SIZE);
+  int chunkZ = World_floorDivide(z, CHUNK_SIZE);
+  const Chunk *chunk = World_getChunkSlot(chunkX, level, chunkZ);
+
+  if (!World_isChunk(chunk, chunkX, level, chunkZ, true)) return Wall;
+
+  return chunk->fields[(x - chunkX * CHUNK_SIZE) * CHUNK_SIZE +
+    (z - chunkZ * CHUNK_SIZE)];
+}
+
+//Gets the field type at specific field indicies for meshing a chunk.
+//Unlike "World_getField", unknown fields (outside of the map or in chunks
+//which aren't loaded) are treated as floor tiles, so that the faces of the
+//walls next to them are never left out.
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+Field World_getFieldForMeshing(int x, int level, int z)
+{
+  if (level < 0 || level >= mapLevels) return Tile;
+  else if (endlessMode)
+  {
+    int chunkX = World_floorDivide(x, CHUNK_SIZE);
+    int chunkZ = World_floorDivide(z, CHUNK_SIZE);
+    if (!World_isChunk(World_getChunkSlot(chunkX, level, chunkZ), chunkX,
+      level, chunkZ, true)) return Tile;
+    return World_getField(x, level, z);
+  }
+  else if (x < 0 || x >= mapWidth || z < 0 || z >= mapDepth) return Tile;
+  else return map[((size_t)level * mapWidth + x) * mapDepth + z];
+}
+
+//Marks the chunk containing a field as dirty (if it's loaded or currently
+//generated), so that it's re-meshed during one of the next updates.
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+void World_markChunkDirty(int x, int level, int z)
+{
+  int chunkX = World_floorDivide(x, CHUNK_SIZE);
+  int chunkZ = World_floorDivide(z, CHUNK_SIZE);
+  Chunk *chunk = World_getChunkSlot(chunkX, level, chunkZ);
+
+  if (World_isChunk(chunk, chunkX, level, chunkZ, false))
+    chunk->isDirty = true;
+}
+
+//Changes the field type at specific field indicies and marks the affected
+//chunks as dirty - which includes the neighbour chunks if the field is on the
+//border of its chunk, as the visible wall faces of these chunks may change,
+//and the chunk above, which leaves a hole in the floor above lifts.
+//In the endless mode, only fields of loaded chunks can be changed - and these
+//changes are lost when the chunk is evicted from the cache.
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+//field: The new field type.
+//Returns true if the field was changed, false otherwise.
+bool World_setField(int x, int level, int z, Field field)
+{
+  if (level < 0 || level >= mapLevels) return false;
+  else if (endlessMode)
+  {
+    int chunkX = World_floorDivide(x, CHUNK_SIZE);
+    int chunkZ = World_floorDivide(z, CHUNK_SIZE);
+    Chunk *chunk = World_getChunkSlot(chunkX, level, chunkZ);
+    if (!World_isChunk(chunk, chunkX, level, chunkZ, true)) return false;
+    chunk->fields[(x - chunkX * CHUNK_SIZE) * CHUNK_SIZE +
+      (z - chunkZ * CHUNK_SIZE)] = field;
+  }
+  else
+  {
+    if (x < 0 || x >= mapWidth || z < 0 || z >= mapDepth) return false;
+    map[((size_t)level * mapWidth + x) * mapDepth + z] = field;
+    Navigation_onFieldChanged(x, level, z);
+    Npc_onFieldChanged(x, level, z);
+    Pickup_onFieldChanged(x, level, z);
+  }
+
+  World_markChunkDirty(x, level, z);
+  World_markChunkDirty(x - 1, level, z);
+  World_markChunkDirty(x + 1, level, z);
+  World_markChunkDirty(x, level, z - 1);
+  World_markChunkDirty(x, level, z + 1);
+  World_markChunkDirty(x, level + 1, z);
+  return true;
+}
+
+//Copies the vertices of a mesh into a vertex buffer and translates them.
+//target: The position in the target buffer (or NULL to only count floats).
+//meshData: The vertex data of the mesh in the format XYZRGB.
+//meshDataLength: The amount of float elements in meshData.
+//offsetX: The translation on the X axis.
+//offsetY: The translation on the Y axis.
+//offsetZ: The translation on the Z axis.
+//Returns the amount of float elements which were (or would be) written.
+int World_appendMesh(float *target, const float *meshData, int meshDataLength,
+  float offsetX, float offsetY, float offsetZ)
+{
+  if (target != NULL)
+  {
+    for (int i = 0; i < meshDataLength; i += FLOATS_PER_VERTEX)
+    {
+      target[i + 0] = meshData[i + 0] + offsetX;
+      target[i + 1] = meshData[i + 1] + offsetY;
+      target[i + 2] = meshData[i + 2] + offsetZ;
+      target[i + 3] = meshData[i + 3];
+      target[i + 4] = meshData[i + 4];
+      target[i + 5] = meshData[i + 5];
+    }
+  }
+
+  return meshDataLength;
+}
+
+//Copies the vertices of the wall mesh into a vertex buffer and translates
+//them, leaving out the triangles which can't be seen: the ones on the bottom
+//and the ones on a side which is covered by an adjacent wall.
+//target: The position in the target buffer (or NULL to only count floats).
+//offsetX: The translation on the X axis.
+//offsetY: The translation on the Y axis.
+//offsetZ: The translation on the Z axis.
+//wallsCovering: The adjacent walls as flags (1: -X, 2: +X, 4: -Z, 8: +Z).
+//Returns the amount of float elements which were (or would be) written.
+int World_appendWallMesh(float *target, float offsetX, float offsetY,
+  float offsetZ, int wallsCovering)
+{
+  const int floatsPerTriangle = 3 * FLOATS_PER_VERTEX;
+  int length = 0;
+
+  for (int i = 0; i < (int)LENGTHOF(wallMeshData); i += floatsPerTriangle)
+  {
+    const float *triangle = wallMeshData + i;
+    const float *v0 = triangle, *v1 = triangle + FLOATS_PER_VERTEX,
+      *v2 = triangle + 2 * FLOATS_PER_VERTEX;
+
+    //A triangle is on a side of the cube if all vertices share the same
+    //coordinate on the axis of that side.
+    bool isBottom = v0[1] == 0 && v1[1] == 0 && v2[1] == 0;
+    bool isOnX = v0[0] == v1[0] && v1[0] == v2[0] && fabsf(v0[0]) == 0.5f;
+    bool isOnZ = v0[2] == v1[2] && v1[2] == v2[2] && fabsf(v0[2]) == 0.5f;
+
+    if (isBottom) continue;
+    if (isOnX && (wallsCovering & (v0[0] < 0 ? 1 : 2))) continue;
+    if (isOnZ && (wallsCovering & (v0[2] < 0 ? 4 : 8))) continue;
+
+    length += World_appendMesh(target != NULL ? target + length : NULL,
+      triangle, floatsPerTriangle, offsetX, offsetY, offsetZ);
+  }
+
+  return length;
+}
+
+//Builds the static geometry of a chunk (in world coordinates) - everything
+//besides the quest item, which is animated and drawn separately.
+//fields: The fields of the chunk including the adjacent fields of the
+//neighbour chunks (CHUNK_PADDED_SIZE * CHUNK_PADDED_SIZE fields, X-major).
+//fieldsBelow: The fields of the chunk on the level below (not padded). Lifts
+//which lead down have no floor, so that the level below can be seen.
+//chunkX: The X index of the chunk.
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk.
+//validWidth: The amount of fields (along the X axis) which should be meshed.
+//validDepth: The amount of fields (along the Z axis) which should be meshed.
+//vertexData: The target buffer or NULL to only count the required floats.
+//Returns the amount of float elements which were (or would be) written.
+int World_buildChunkMesh(const Field *fields, const Field *fieldsBelow,
+  int chunkX, int level, int chunkZ, int validWidth, int validDepth,
+  float *vertexData)
+{
+  int length = 0;
+  float fieldY = level * LEVEL_HEIGHT;
+
+  for (int localX = 0; localX < validWidth; localX++)
+  {
+    for (int localZ = 0; localZ < validDepth; localZ++)
+    {
+      const int index = (localX + 1) * CHUNK_PADDED_SIZE + (localZ + 1);
+      Field field = fields[index];
+      float fieldX = (float)(chunkX * CHUNK_SIZE + localX);
+      float fieldZ = (float)(chunkZ * CHUNK_SIZE + localZ);
+      float *target = vertexData != NULL ? vertexData + length : NULL;
+
+      //Drawing the floor under a wall cube isn't required - with the other
+      //field types, it is.
+      if (field != Wall && !(field == Lift &&
+        fieldsBelow[localX * CHUNK_SIZE + localZ] == Lift))
+      {
+        length += World_appendMesh(target, floorMeshData,
+          LENGTHOF(floorMeshData), fieldX, fieldY, fieldZ);
+        target = vertexData != NULL ? vertexData + length : NULL;
+      }
+
+      if (field == Wall)
+      {
+        int wallsCovering =
+          (fields[index - CHUNK_PADDED_SIZE] == Wall ? 1 : 0) |
+          (fields[index + CHUNK_PADDED_SIZE] == Wall ? 2 : 0) |
+          (fields[index - 1] == Wall ? 4 : 0) |
+          (fields[index + 1] == Wall ? 8 : 0);
+        length += World_appendWallMesh(target, fieldX, fieldY, fieldZ,
+          wallsCovering);
+      }
+      else if (field == Arch || field == Lift)
+        length += World_appendMesh(target, archMeshData,
+          LENGTHOF(archMeshData), fieldX, fieldY, fieldZ);
+      else if (field == Goal)
+        length += World_appendMesh(target, tubeMeshData,
+          LENGTHOF(tubeMeshData), fieldX, fieldY, fieldZ);
+    }
+  }
+
+  return length;
+}
+
+//Processes a ChunkJob (on a worker thread) and hands it back to the main
+//thread afterwards.
+//jobPointer: A pointer to the ChunkJob.
+void World_processChunkJob(void *jobPointer)
+{
+  ChunkJob *job = (ChunkJob *)jobPointer;
+  double startTime = Common_getTimeSeconds();
+
+  if (job->generateFields)
+  {
+    //The neighbour chunks might not be generated yet, so their adjacent fields
+    //are unknown - these are treated like floor tiles, so that the walls on
+    //the chunk border are never missing a face.
+    Field generatedFields[CHUNK_SIZE * CHUNK_SIZE];
+    Maze_generateChunk(mapSeed, job->chunkX, job->level, job->chunkZ,
+      mapLevels, generatedFields);
+
+    for (int i = 0; i < CHUNK_PADDED_SIZE * CHUNK_PADDED_SIZE; i++)
+      job->fields[i] = Tile;
+    for (int localX = 0; localX < CHUNK_SIZE; localX++)
+      memcpy(&job->fields[(localX + 1) * CHUNK_PADDED_SIZE + 1],
+        &generatedFields[localX * CHUNK_SIZE], sizeof(Field) * CHUNK_SIZE);
+
+    //The lifts of the level below are known without generating it.
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+      job->fieldsBelow[i] = Tile;
+    if (job->level > 0)
+      job->fieldsBelow[Maze_getLiftIndex(mapSeed, job->chunkX, job->level - 1,
+        job->chunkZ)] = Lift;
+    if (job->level > 1)
+      job->fieldsBelow[Maze_getLiftIndex(mapSeed, job->chunkX, job->level - 2,
+        job->chunkZ)] = Lift;
+  }
+
+  job->vertexDataLength = World_buildChunkMesh(job->fields, job->fieldsBelow,
+    job->chunkX, job->level, job->chunkZ, job->validWidth, job->validDepth,
+    NULL);
+  job->vertexData = (float *)Common_allocate(
+    sizeof(float) * job->vertexDataLength);
+  World_buildChunkMesh(job->fields, job->fieldsBelow, job->chunkX, job->level,
+    job->chunkZ, job->validWidth, job->validDepth, job->vertexData);
+
+  job->processingSeconds = Common_getTimeSeconds() - startTime;
+
+  Mutex_lock(&finishedChunkJobsMutex);
+  job->next = finishedChunkJobs;
+  finishedChunkJobs = job;
+  Mutex_unlock(&finishedChunkJobsMutex);
+}
+
+//Moves the chunks finished by the worker threads into the chunk cache and
+//uploads their meshes. Must be called on the thread owning the GL context.
+void World_integrateFinishedChunks(void)
+{
+  Mutex_lock(&finishedChunkJobsMutex);
+  ChunkJob *job = finishedChunkJobs;
+  finishedChunkJobs = NULL;
+  Mutex_unlock(&finishedChunkJobsMutex);
+
+  while (job != NULL)
+  {
+    ChunkJob *next = job->next;
+    Chunk *chunk = job->target;
+
+    if (chunk->generation == job->generation &&
+      chunk->state == ChunkGenerating)
+    {
+      for (int localX = 0; localX < CHUNK_SIZE; localX++)
+        memcpy(&chunk->fields[localX * CHUNK_SIZE],
+          &job->fields[(localX + 1) * CHUNK_PADDED_SIZE + 1],
+          sizeof(Field) * CHUNK_SIZE);
+      chunk->mesh = BufferedMesh_create(job->vertexData,
+        job->vertexDataLength, shaderProgram);
+      chunk->state = ChunkLoaded;
+
+      streamedChunkCount++;
+      streamedChunkSeconds += job->processingSeconds;
+    }
+
+    free(job->vertexData);
+    free(job);
+    job = next;
+  }
+}
+
+//Gets the range of fields of a chunk which are inside the map boundaries.
+//chunkX: The X index of the chunk.
+//chunkZ: The Z index of the chunk.
+//validWidth: The pointer to store the amount of fields along the X axis.
+//validDepth: The pointer to store the amount of fields along the Z axis.
+void World_getValidChunkSize(int chunkX, int chunkZ, int *validWidth,
+  int *validDepth)
+{
+  *validWidth = endlessMode ? CHUNK_SIZE :
+    MIN(CHUNK_SIZE, mapWidth - chunkX * CHUNK_SIZE);
+  *validDepth = endlessMode ? CHUNK_SIZE :
+    MIN(CHUNK_SIZE, mapDepth - chunkZ * CHUNK_SIZE);
+}
+
+//Copies the fields of a chunk (including the adjacent fields of the
+//neighbour chunks) and the fields of the chunk below from the map or the
+//chunk cache.
+//chunkX: The X index of the chunk.
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk.
+//fields: The target for the padded fields of the chunk.
+//fieldsBelow: The target for the fields of the chunk below.
+void World_copyFieldsForMeshing(int chunkX, int level, int chunkZ,
+  Field *fields, Field *fieldsBelow)
+{
+  for (int localX = -1; localX <= CHUNK_SIZE; localX++)
+    for (int localZ = -1; localZ <= CHUNK_SIZE; localZ++)
+      fields[(localX + 1) * CHUNK_PADDED_SIZE + (localZ + 1)] =
+        World_getFieldForMeshing(chunkX * CHUNK_SIZE + localX, level,
+          chunkZ * CHUNK_SIZE + localZ);
+
+  for (int localX = 0; localX < CHUNK_SIZE; localX++)
+    for (int localZ = 0; localZ < CHUNK_SIZE; localZ++)
+      fieldsBelow[localX * CHUNK_SIZE + localZ] = World_getFieldForMeshing(
+        chunkX * CHUNK_SIZE + localX, level - 1, chunkZ * CHUNK_SIZE + localZ);
+}
+
+//Assigns a chunk to its cache slot (evicting the previous chunk) and starts
+//generating it.
+//chunkX: The X index of the chunk.
+//level: The level of the chunk.
+//chunkZ: The Z index of the chunk.
+//synchronous: true to generate the chunk on the calling thread, false to
+//generate it on a worker thread.
+void World_requestChunk(int chunkX, int level, int chunkZ, bool synchronous)
+{
+  Chunk *chunk = World_getChunkSlot(chunkX, level, chunkZ);
+
+  if (chunk->state == ChunkLoaded) BufferedMesh_destroy(&chunk->mesh);
+  chunk->chunkX = chunkX;
+  chunk->level = level;
+  chunk->chunkZ = chunkZ;
+  chunk->state = ChunkGenerating;
+  chunk->isDirty = false;
+  chunk->generation++;
+
+  ChunkJob *job = (ChunkJob *)Common_allocate(sizeof(ChunkJob));
+  job->target = chunk;
+  job->generation = chunk->generation;
+  job->chunkX = chunkX;
+  job->level = level;
+  job->chunkZ = chunkZ;
+  job->generateFields = endlessMode;
+  job->vertexData = NULL;
+  job->next = NULL;
+  World_getValidChunkSize(chunkX, chunkZ, &job->validWidth, &job->validDepth);
+
+  //The map is copied here, so that the worker threads never access it.
+  //Changes of the map made until the job is finished are caught up on by
+  //re-meshing the chunk afterwards (see "World_setField").
+  if (!endlessMode)
+    World_copyFieldsForMeshing(chunkX, level, chunkZ, job->fields,
+      job->fieldsBelow);
+
+  if (synchronous) World_processChunkJob(job);
+  else WorkerPool_submit(&workerPool, World_processChunkJob, job);
+}
+
+//Builds the new mesh of a chunk which is re-meshed (on a worker thread).
+//jobsPointer: A pointer to the RemeshJob array.
+//index: The index of the job.
+void World_buildRemeshJob(void *jobsPointer, int index)
+{
+  RemeshJob *job = &((RemeshJob *)jobsPointer)[index];
+  Field fields[CHUNK_PADDED_SIZE * CHUNK_PADDED_SIZE];
+  Field fieldsBelow[CHUNK_SIZE * CHUNK_SIZE];
+  int validWidth, validDepth;
+
+  World_getValidChunkSize(job->chunk->chunkX, job->chunk->chunkZ, &validWidth,
+    &validDepth);
+  World_copyFieldsForMeshing(job->chunk->chunkX, job->chunk->level,
+    job->chunk->chunkZ, fields, fieldsBelow);
+
+  job->vertexDataLength = World_buildChunkMesh(fields, fieldsBelow,
+    job->chunk->chunkX, job->chunk->level, job->chunk->chunkZ, validWidth,
+    validDepth, NULL);
+  if (job->vertexDataLength > job->vertexDataCapacity)
+  {
+    free(job->vertexData);
+    job->vertexData = (float *)Common_allocate(
+      sizeof(float) * job->vertexDataLength);
+    job->vertexDataCapacity = job->vertexDataLength;
+  }
+  World_buildChunkMesh(fields, fieldsBelow, job->chunk->chunkX,
+    job->chunk->level, job->chunk->chunkZ, validWidth, validDepth,
+    job->vertexData);
+}
+
+//Re-meshes dirty chunks until all chunks are up to date or the time budget
+//for one update (REMESH_BUDGET_MS) is used up. The chunks closest to a
+//position are re-meshed first - one for every thread at once, as the meshes
+//are built on the worker pool (and only uploaded on the calling thread).
+//positionX: The X position world coordinate (usually the player position).
+//level: The level of the position.
+//positionZ: The Z position world coordinate.
+void World_remeshDirtyChunks(float positionX, int level, float positionZ)
+{
+  double startTime = Common_getTimeSeconds();
+  bool anyChunkRemeshed = false;
+
+  while (Common_getTimeSeconds() - startTime < REMESH_BUDGET_MS / 1000.0)
+  {
+    int jobCount = 0;
+    for (; jobCount < remeshJobCount; jobCount++)
+    {
+      Chunk *closestChunk = NULL;
+      float closestDistance = 0;
+
+      for (int i = 0; i < (int)LENGTHOF(chunks); i++)
+      {
+        if (chunks[i].state != ChunkLoaded || !chunks[i].isDirty) continue;
+
+        float distanceX = (chunks[i].chunkX + 0.5f) * CHUNK_SIZE - positionX;
+        float distanceZ = (chunks[i].chunkZ + 0.5f) * CHUNK_SIZE - positionZ;
+        float distance = distanceX * distanceX + distanceZ * distanceZ +
+          (chunks[i].level != level ? CHUNK_SIZE * CHUNK_SIZE : 0);
+        if (closestChunk == NULL || distance < closestDistance)
+        {
+          closestChunk = &chunks[i];
+          closestDistance = distance;
+        }
+      }
+
+      if (closestChunk == NULL) break;
+      closestChunk->isDirty = false;
+      remeshJobs[jobCount].chunk = closestChunk;
+    }
+
+    if (jobCount == 0) break;
+
+    WorkerPool_parallelFor(&workerPool, jobCount, World_buildRemeshJob,
+      remeshJobs);
+
+    for (int i = 0; i < jobCount; i++)
+    {
+      BufferedMesh_update(&remeshJobs[i].chunk->mesh, remeshJobs[i].vertexData,
+        remeshJobs[i].vertexDataLength);
+      remeshUploadedBytes += sizeof(float) * remeshJobs[i].vertexDataLength;
+    }
+    remeshedChunkCount += jobCount;
+    anyChunkRemeshed = true;
+  }
+
+  if (anyChunkRemeshed)
+  {
+    double elapsedSeconds = Common_getTimeSeconds() - startTime;
+    remeshSeconds += elapsedSeconds;
+    maxRemeshSecondsPerUpdate = MAX(maxRemeshSecondsPerUpdate, elapsedSeconds);
+    remeshUpdateCount++;
+  }
+}
+
+//Toggles random fields between Tile and Wall in the loaded chunks around a
+//position (without ever walling in the field at the position itself).
+//positionX: The X position world coordinate (usually the player position).
+//level: The level of the position.
+//positionZ: The Z position world coordinate.
+//count: The amount of fields to toggle.
+void World_toggleRandomWalls(float positionX, int level, float positionZ,
+  int count)
+{
+  const int range = CHUNK_SIZE * (CHUNK_VIEW_RADIUS * 2 + 1);
+  int positionFieldX = (int)roundf(positionX);
+  int positionFieldZ = (int)roundf(positionZ);
+
+  for (int i = 0; i < count; i++)
+  {
+    int x = positionFieldX - range / 2 +
+      (int)(Maze_random(&stressRandomState) % range);
+    int z = positionFieldZ - range / 2 +
+      (int)(Maze_random(&stressRandomState) % range);
+    if (x == positionFieldX && z == positionFieldZ) continue;
+    //The outer walls of a fixed map are never opened up.
+    if (!endlessMode && (x <= 0 || x >= mapWidth - 1 || z <= 0 ||
+      z >= mapDepth - 1)) continue;
+
+    Field field = World_getFieldForMeshing(x, level, z);
+    if (endlessMode && World_getField(x, level, z) != field) continue;
+    if (field == Tile) World_setField(x, level, z, Wall);
+    else if (field == Wall) World_setField(x, level, z, Tile);
+  }
+}
+
+//Prints the streaming and re-meshing statistics and resets the latter.
+void World_printStatistics(void)
+{
+  int loadedChunkCount = 0, dirtyChunkCount = 0;
+  size_t meshBytes = 0;
+  for (int i = 0; i < (int)LENGTHOF(chunks); i++)
+  {
+    if (chunks[i].state != ChunkLoaded) continue;
+    loadedChunkCount++;
+    if (chunks[i].isDirty) dirtyChunkCount++;
+    meshBytes += chunks[i].mesh.vertexCount * FLOATS_PER_VERTEX *
+      sizeof(float);
+  }
+
+  printf("Streaming: %u chunks generated (%.3f ms/chunk on average), "
+    "%d chunks loaded (%.1f KiB of vertex data).\n", streamedChunkCount,
+    streamedChunkCount > 0 ?
+    streamedChunkSeconds * 1000.0 / streamedChunkCount : 0.0,
+    loadedChunkCount, meshBytes / 1024.0);
+
+  printf("Re-meshing: %u chunks in %u updates (%.3f ms/update on average, "
+    "%.3f ms at most, %.1f KiB uploaded/update), %d chunks left dirty.\n",
+    remeshedChunkCount, remeshUpdateCount,
+    remeshUpdateCount > 0 ? remeshSeconds * 1000.0 / remeshUpdateCount : 0.0,
+    maxRemeshSecondsPerUpdate * 1000.0, remeshUpdateCount > 0 ?
+    remeshUploadedBytes / 1024.0 / remeshUpdateCount : 0.0,
+    dirtyChunkCount);
+  WorkerPool_printStatistics(&workerPool);
+  RenderQueue_printStatistics(&renderQueue);
+
+  remeshedChunkCount = 0;
+  remeshUpdateCount = 0;
+  remeshSeconds = 0;
+  maxRemeshSecondsPerUpdate = 0;
+  remeshUploadedBytes = 0;
+}
+
+//Requests all missing chunks around a position (on its level and the levels
+//right above and below, so that lifts never lead into unloaded chunks) and
+//integrates the chunks which were finished since the last update. Chunks with
+//changed fields are re-meshed afterwards (within the time budget).
+//positionX: The X position world coordinate (usually the player position).
+//level: The level of the position.
+//positionZ: The Z position world coordinate.
+//synchronous: true to load all missing chunks before returning.
+void World_update(float positionX, int level, float positionZ,
+  bool synchronous)
+{
+  int centerChunkX = World_floorDivide((int)roundf(positionX), CHUNK_SIZE);
+  int centerChunkZ = World_floorDivide((int)roundf(positionZ), CHUNK_SIZE);
+
+  for (int chunkLevel = MAX(0, level - 1);
+    chunkLevel <= MIN(mapLevels - 1, level + 1); chunkLevel++)
+  {
+    for (int chunkX = centerChunkX - CHUNK_VIEW_RADIUS;
+      chunkX <= centerChunkX + CHUNK_VIEW_RADIUS; chunkX++)
+    {
+      for (int chunkZ = centerChunkZ - CHUNK_VIEW_RADIUS;
+        chunkZ <= centerChunkZ + CHUNK_VIEW_RADIUS; chunkZ++)
+      {
+        if (!endlessMode && (chunkX < 0 || chunkZ < 0 ||
+          chunkX * CHUNK_SIZE >= mapWidth || chunkZ * CHUNK_SIZE >= mapDepth))
+          continue;
+
+        if (World_isChunk(World_getChunkSlot(chunkX, chunkLevel, chunkZ),
+          chunkX, chunkLevel, chunkZ, false)) continue;
+
+        World_requestChunk(chunkX, chunkLevel, chunkZ, synchronous);
+      }
+    }
+  }
+
+  World_integrateFinishedChunks();
+
+  if (stressWallCount > 0)
+    World_toggleRandomWalls(positionX, level, positionZ, stressWallCount);
+  World_remeshDirtyChunks(positionX, level, positionZ);
+
+  double currentTime = Common_getTimeSeconds();
+  if ((endlessMode || stressWallCount > 0) &&
+    currentTime - lastStreamingStatisticsTime > STREAMING_STATISTICS_INTERVAL)
+  {
+    World_printStatistics();
+    lastStreamingStatisticsTime = currentTime;
+  }
+}
+
+//Checks whether a lift connecting two levels is close enough to a position to
+//not be faded out completely - which is the only way to see another level.
+//positionX: The X position world coordinate (usually the player position).
+//level: The level of the position.
+//positionZ: The Z position world coordinate.
+//otherLevel: The level above or below.
+bool World_isLiftVisible(float positionX, int level, float positionZ,
+  int otherLevel)
+{
+  const int range = (int)ceilf(FADE_DISTANCE) + 1;
+  int positionFieldX = (int)roundf(positionX);
+  int positionFieldZ = (int)roundf(positionZ);
+
+  if (otherLevel < 0 || otherLevel >= mapLevels) return false;
+
+  for (int x = positionFieldX - range; x <= positionFieldX + range; x++)
+    for (int z = positionFieldZ - range; z <= positionFieldZ + range; z++)
+      if (World_getFieldForMeshing(x, level, z) == Lift &&
+        World_getFieldForMeshing(x, otherLevel, z) == Lift) return true;
+
+  return false;
+}
+
+//Draws the meshes of all loaded chunks which are close enough to a position
+//to not be faded out completely. Chunks further away are skipped entirely,
+//and so are whole levels which can't be seen from the level of the position
+//(the levels are considered to be separated by ceilings, so only the levels
+//right above or below can be seen - through a nearby lift shaft).
+//positionX: The X position world coordinate (usually the player position).
+//level: The level of the position.
+//positionZ: The Z position world coordinate.
+void World_draw(float positionX, int level, float positionZ)
+{
+  bool isLevelAboveVisible =
+    World_isLiftVisible(positionX, level, positionZ, level + 1);
+  bool isLevelBelowVisible =
+    World_isLiftVisible(positionX, level, positionZ, level - 1);
+
+  for (int i = 0; i < (int)LENGTHOF(chunks); i++)
+  {
+    const Chunk *chunk = &chunks[i];
+    if (chunk->state != ChunkLoaded) continue;
+
+    if (chunk->level != level &&
+      !(chunk->level == level + 1 && isLevelAboveVisible) &&
+      !(chunk->level == level - 1 && isLevelBelowVisible)) continue;
+
+    //The distance to the closest point of the chunk boundaries.
+    float minX = chunk->chunkX * CHUNK_SIZE - 0.5f;
+    float minZ = chunk->chunkZ * CHUNK_SIZE - 0.5f;
+    float distanceX = MAX(MAX(minX - positionX, 0),
+      positionX - (minX + CHUNK_SIZE));
+    float distanceZ = MAX(MAX(minZ - positionZ, 0),
+      positionZ - (minZ + CHUNK_SIZE));
+    if (distanceX * distanceX + distanceZ * distanceZ >
+      (FADE_DISTANCE + 1) * (FADE_DISTANCE + 1)) continue;
+
+    BufferedMesh_draw(&chunk->mesh);
+  }
+}
+
+//Initializes the chunk cache and starts the worker threads.
+void World_initialize(void)
+{
+  for (int i = 0; i < (int)LENGTHOF(chunks); i++)
+  {
+    chunks[i].state = ChunkEmpty;
+    chunks[i].isDirty = false;
+    chunks[i].generation = 0;
+  }
+
+  Mutex_initialize(&finishedChunkJobsMutex);
+  WorkerPool_initialize(&workerPool, Common_getProcessorCount() - 1);
+  remeshJobCount = workerPool.threadCount + 1;
+  remeshJobs = (RemeshJob *)Common_allocate(sizeof(RemeshJob) * remeshJobCount);
+  for (int i = 0; i < remeshJobCount; i++)
+  {
+    remeshJobs[i].vertexData = NULL;
+    remeshJobs[i].vertexDataCapacity = 0;
+  }
+  lastStreamingStatisticsTime = Common_getTimeSeconds();
+}
+
+//Stops the worker threads and releases all chunks and their meshes.
+void World_destroy(void)
+{
+  WorkerPool_destroy(&workerPool);
+
+  for (int i = 0; i < (int)LENGTHOF(chunks); i++)
+  {
+    if (chunks[i].state == ChunkLoaded) BufferedMesh_destroy(&chunks[i].mesh);
+    chunks[i].state = ChunkEmpty;
+  }
+
+  //Jobs which finished after the last update don't have a target anymore, so
+  //integrating them just frees them.
+  World_integrateFinishedChunks();
+
+  for (int i = 0; i < remeshJobCount; i++) free(remeshJobs[i].vertexData);
+  free(remeshJobs);
+  remeshJobs = NULL;
+  remeshJobCount = 0;
+  Mutex_destroy(&finishedChunkJobsMutex);
+}
+
+//=============================================================================
+// Game logic: Map access.
+//=============================================================================
+
+//Translates a world position into field indicies (without checking bounds).
+//positionX: The X position in world coordinates.
+//positionY: The Y position in world coordinates.
+//indexX: The pointer to store the resulting field index (X axis) into.
+//indexY: The pointer to store the resulting field index (Y axis) into.
+void Game_getMapFieldIndiciesByPosition(float positionX, float positionZ,
+  int *indexX, int *indexZ)
+{
+  (*indexX) = (int)roundf(positionX);
+  (*indexZ) = (int)roundf(positionZ);
+}
+
+//Translates field indicies into world coordinates (without checking bounds).
+//indexX: The field index on the X-axis.
+//indexY: The field index on the Y-axis.
+//positionX: The pointer to store the resulting X position world coordinate.
+//positionY: The pointer to store the resulting Y position world coordinate.
+void Game_getMapFieldPositionByIndicies(int indexX, int indexZ,
+  float *positionX, float *positionZ)
+{
+  (*positionX) = (float)indexX;
+  (*positionZ) = (float)indexZ;
+}
+
+//Gets the field type at specific field indicies.
+//To retrieve the field type at a specific world position, use the
+//"Game_getMapFieldByPosition" function instead.
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+//Terminates the application if x, level or z are out of bounds.
+//In the endless mode, the fields are resolved through the chunk cache instead.
+Field Game_getMapFieldByIndicies(int x, int level, int z)
+{
+  if (endlessMode) return World_getField(x, level, z);
+  if (x < 0 || x >= mapWidth || level < 0 || level >= mapLevels ||
+    z < 0 || z >= mapDepth)
+    Common_terminate("INGAME", "An invalid field position was requested.");
+  return map[((size_t)level * mapWidth + x) * mapDepth + z];
+}
+
+//Gets the field type at a specific world position.
+//To retrieve the field type at specific field indicies, use the
+//"Game_getMapFieldByIndicies" function instead.
+//x: The X position world coordinate.
+//level: The level of the field.
+//z: The X position world coordinate.
+//Returns Wall for positions outside of the map (or which aren't finite).
+Field Game_getMapFieldByPosition(float x, int level, float z)
+{
+  int indexX = 0, indexZ = 0;
+  //The comparisons also fail for NaN.
+  if (!(fabsf(x) < 1e9f && fabsf(z) < 1e9f)) return Wall;
+  Game_getMapFieldIndiciesByPosition(x, z, &indexX, &indexZ);
+  if (endlessMode) return World_getField(indexX, level, indexZ);
+  if (indexX < 0 || indexX >= mapWidth || level < 0 || level >= mapLevels ||
+    indexZ < 0 || indexZ >= mapDepth) return Wall;
+  return map[((size_t)level * mapWidth + indexX) * mapDepth + indexZ];
+}
+
+//Checks if a field type is on one of the 3x3 fields around a field. Finite
+//maps use the pickup hash for quest items and goals (see "Pickup_isNearby"),
+//which isn't available for the streamed chunks of the endless mode.
+//x, level, z: The indicies of the field in the center.
+//field: The field type.
+bool Game_isFieldNearby(int x, int level, int z, Field field)
+{
+  if (pickupFields != NULL && Pickup_isPickup(field))
+    return Pickup_isNearby(x, level, z, field);
+
+  for (int probeFieldX = x - 1; probeFieldX <= x + 1; probeFieldX++)
+    for (int probeFieldZ = z - 1; probeFieldZ <= z + 1; probeFieldZ++)
+      if (Game_getMapFieldByIndicies(probeFieldX, level, probeFieldZ) ==
+        field) return true;
+  return false;
+}
+
+//Searches the spawn point on the first level, column by column.
+//searchWidth, searchDepth: The amount of fields to search on both axes
+//(starting at the origin).
+//spawnX, spawnZ: Pointers to store the field indicies of the spawn point
+//into.
+//Returns false if there's no spawn point in the searched fields.
+bool Game_findSpawnPoint(int searchWidth, int searchDepth, int *spawnX,
+  int *spawnZ)
+{
+  for (int x = 0; x < searchWidth; x++)
+    for (int z = 0; z < searchDepth; z++)
+      if (Game_getMapFieldByIndicies(x, 0, z) == Init)
+      {
+        *spawnX = x;
+        *spawnZ = z;
+        return true;
+      }
+  return false;
+}
+
+//Changes the field type at specific field indicies. Only the chunks affected
+//by the change are re-meshed (during the next updates).
+//x: The x index of the field.
+//level: The level of the field.
+//z: The z index of the field.
+//field: The new field type.
+//Terminates the application if x, level or z are out of bounds (except in 
+//the endless mode, where changes to fields which aren't loaded are ignored).
+void Game_setMapFieldByIndicies(int x, int level, int z, Field field)
+{
+  if (!World_setField(x, level, z, field) && !endlessMode)
+    Common_terminate("INGAME", "An invalid field position was changed.");
+}
+
+//=============================================================================
+// Session: Batches of game sessions, which are stepped without a window.
+//=============================================================================
+
+//Defines the bits of the buttons in a SessionInput.
+typedef enum
+{
+  SessionForward = 1,
+  SessionBackwards = 2,
+  SessionLeft = 4,
+  SessionRight = 8,
+  SessionJump = 16,
+  SessionAction = 32
+} SessionButton;
+
+//The input of a game session for one step.
+typedef struct
+{
+  //The pressed buttons (see "SessionButton").
+  uint8_t buttons;
+  //The mouse movement (in pixels) since the last step.
+  float mouseX, mouseY;
+} SessionInput;
+
+//Contains the state of many game sessions as structure of arrays. Every
+//session has its own player and quest item state, but all of them share the
+//current map - so that bots can play thousands of sessions at once. The game
+//itself is a batch with one session (see "Game_updateSimulation").
+typedef struct
+{
+  int count;
+  //The player positions, where Y is relative to the floor of the level.
+  float *positionsX, *positionsY, *positionsZ;
+  int *levels;
+  //The player accerlations (like "playerAccerlationX").
+  float *accerlationsX, *accerlationsY, *accerlationsZ;
+  //The player rotations and rotation accerlations (in degrees).
+  float *rotationsX, *rotationsY;
+  float *rotationAccerlationsX, *rotationAccerlationsY;
+  float *brightnesses;
+  //The ItemState of every session.
+  uint8_t *itemStates;
+  //1 if the action button was pressed during the last step.
+  uint8_t *previousActions;
+  //The time (in seconds) every session was stepped for until it finished.
+  float *times;
+  //1 after the quest item was dropped and the session was faded out.
+  uint8_t *finished;
+} SessionBatch;
+
+//The session of the game itself.
+SessionBatch playerSession;
+
+//Starts a session again, with the quest item at its initial position.
+//self: A pointer to the batch.
+//index: The index of the session.
+//x, level, z: The position of the player (usually the spawn point).
+void SessionBatch_reset(SessionBatch *self, int index, float x, int level,
+  float z)
+{
+  self->positionsX[index] = x;
+  self->positionsY[index] = 0;
+  self->positionsZ[index] = z;
+  self->levels[index] = level;
+  self->accerlationsX[index] = 0;
+  self->accerlationsY[index] = 0;
+  self->accerlationsZ[index] = 0;
+  self->rotationsX[index] = 0;
+  self->rotationsY[index] = 0;
+  self->rotationAccerlationsX[index] = 0;
+  self->rotationAccerlationsY[index] = 0;
+  self->brightnesses[index] = 0;
+  self->itemStates[index] = Initial;
+  self->previousActions[index] = 0;
+  self->times[index] = 0;
+  self->finished[index] = 0;
+}
+
+//Initializes a SessionBatch instance with all players at the origin.
+//self: A pointer to the (uninitialized) batch.
+//count: The amount of sessions.
+void SessionBatch_initialize(SessionBatch *self, int count)
+{
+  const size_t floatsSize = sizeof(float) * MAX(1, count);
+
+  self->count = count;
+  self->positionsX = (float *)Common_allocate(floatsSize);
+  self->positionsY = (float *)Common_allocate(floatsSize);
+  self->positionsZ = (float *)Common_allocate(floatsSize);
+  self->levels = (int *)Common_allocate(sizeof(int) * MAX(1, count));
+  self->accerlationsX = (float *)Common_allocate(floatsSize);
+  self->accerlationsY = (float *)Common_allocate(floatsSize);
+  self->accerlationsZ = (float *)Common_allocate(floatsSize);
+  self->rotationsX = (float *)Common_allocate(floatsSize);
+  self->rotationsY = (float *)Common_allocate(floatsSize);
+  self->rotationAccerlationsX = (float *)Common_allocate(floatsSize);
+  self->rotationAccerlationsY = (float *)Common_allocate(floatsSize);
+  self->brightnesses = (float *)Common_allocate(floatsSize);
+  self->itemStates = (uint8_t *)Common_allocate(MAX(1, count));
+  self->previousActions = (uint8_t *)Common_allocate(MAX(1, count));
+  self->times = (float *)Common_allocate(floatsSize);
+  self->finished = (uint8_t *)Common_allocate(MAX(1, count));
+
+  for (int i = 0; i < count; i++) SessionBatch_reset(self, i, 0, 0, 0);
+}
+
+//Releases the resources of a SessionBatch instance.
+//self: A pointer to the batch.
+void SessionBatch_destroy(SessionBatch *self)
+{
+  free(self->positionsX);
+  free(self->positionsY);
+  free(self->positionsZ);
+  free(self->levels);
+  free(self->accerlationsX);
+  free(self->accerlationsY);
+  free(self->accerlationsZ);
+  free(self->rotationsX);
+  free(self->rotationsY);
+  free(self->rotationAccerlationsX);
+  free(self->rotationAccerlationsY);
+  free(self->brightnesses);
+  free(self->itemStates);
+  free(self->previousActions);
+  free(self->times);
+  free(self->finished);
+  self->count = 0;
+}
+
+//Copies the state of a session into another one.
+//self: A pointer to the target batch.
+//index: The index of the session which is overwritten.
+//source: A pointer to the batch to copy from (which may be the same).
+//sourceIndex: The index of the session to copy.
+void SessionBatch_copy(SessionBatch *self, int index,
+  const SessionBatch *source, int sourceIndex)
+{
+  self->positionsX[index] = source->positionsX[sourceIndex];
+  self->positionsY[index] = source->positionsY[sourceIndex];
+  self->positionsZ[index] = source->positionsZ[sourceIndex];
+  self->levels[index] = source->levels[sourceIndex];
+  self->accerlationsX[index] = source->accerlationsX[sourceIndex];
+  self->accerlationsY[index] = source->accerlationsY[sourceIndex];
+  self->accerlationsZ[index] = source->accerlationsZ[sourceIndex];
+  self->rotationsX[index] = source->rotationsX[sourceIndex];
+  self->rotationsY[index] = source->rotationsY[sourceIndex];
+  self->rotationAccerlationsX[index] =
+    source->rotationAccerlationsX[sourceIndex];
+  self->rotationAccerlationsY[index] =
+    source->rotationAccerlationsY[sourceIndex];
+  self->brightnesses[index] = source->brightnesses[sourceIndex];
+  self->itemStates[index] = source->itemStates[sourceIndex];
+  self->previousActions[index] = source->previousActions[sourceIndex];
+  self->times[index] = source->times[sourceIndex];
+  self->finished[index] = source->finished[sourceIndex];
+}
+
+//Steps a range of sessions: the player movement, the lifts and the quest
+//item. Finished sessions aren't changed anymore. Only the map (and the
+//collision grid and the pickups of finite maps) is read, so that different
+//ranges can be stepped on different threads.
+//self: A pointer to the batch.
+//first: The index of the first session to step.
+//last: The index after the last session to step.
+//inputs: The input of every session (with the same indicies).
+//deltaSeconds: The time since the last step.
+void SessionBatch_stepRange(SessionBatch *self, int first, int last,
+  const SessionInput *inputs, float deltaSeconds)
+{
+  for (int i = first; i < last; i++)
+  {
+    const SessionInput *input = &inputs[i];
+    if (self->finished[i]) continue;
+    self->times[i] += deltaSeconds;
+
+    float brightness = self->brightnesses[i];
+    if (self->itemStates[i] == Initial && brightness < 1.0f)
+      brightness = MIN(1, brightness + FADEOUT_SPEED * deltaSeconds);
+    else if (self->itemStates[i] == Dropped)
+    {
+      if (brightness > 0.0f) brightness -= FADEOUT_SPEED * deltaSeconds;
+      else
+      {
+        self->finished[i] = 1;
+        continue;
+      }
+    }
+    self->brightnesses[i] = brightness;
+
+    //The mouse movement since the last step is used as (absolute) mouse
+    //speed vector.
+    //Prevent the camera rotation to change too much until the game is
+    //actually visible. Also prevents the camera to rotate wildly due to the
+    //initial cursor warp to the screen center (which would otherwise be
+    //interpreted as very rapid mouse movement).
+    float mouseSpeedX = input->mouseX * brightness;
+    float mouseSpeedY = input->mouseY * brightness;
+
+    //This mouse movement is then added to the player rotation accerlation
+    //(which will result into a smoother mouse movement afterwards).
+    //The accerlation is dampened a bit and then applied to the player
+    //rotation, where the vertical mouse movement will eventually rotate the
+    //camera around the players' X axis (which points to the "right") and the
+    //horizontal mouse movement will rotate the camera around the players' Y
+    //axis (which points to the "top").
+    float rotationAccerlationX = self->rotationAccerlationsX[i] +
+      mouseSpeedY * MOUSE_SPEED * deltaSeconds;
+    float rotationAccerlationY = self->rotationAccerlationsY[i] +
+      mouseSpeedX * MOUSE_SPEED * deltaSeconds;
+    rotationAccerlationX -=
+      rotationAccerlationX * MOUSE_FRICTION * deltaSeconds;
+    rotationAccerlationY -=
+      rotationAccerlationY * MOUSE_FRICTION * deltaSeconds;
+    self->rotationAccerlationsX[i] = rotationAccerlationX;
+    self->rotationAccerlationsY[i] = rotationAccerlationY;
+
+    self->rotationsX[i] += rotationAccerlationX;
+    float rotationY = self->rotationsY[i] += rotationAccerlationY;
+
+    //The raw (independent of the current player view) accerlation is
+    //calculated using the current keyboard input values.
+    float newAxisAccerlationX = ((input->buttons & SessionRight) ? 1.0f : 0) -
+      ((input->buttons & SessionLeft) ? 1.0f : 0);
+    float newAxisAccerlationZ =
+      ((input->buttons & SessionForward) ? 1.0f : 0) -
+      ((input->buttons & SessionBackwards) ? 1.0f : 0);
+
+    //That new accerlation must be normalized so that the player doesn't move
+    //faster when going into two different directions simultaneously
+    //(e.g. forward and left).
+    float newAxisAccerlation = sqrtf(newAxisAccerlationX *
+      newAxisAccerlationX + newAxisAccerlationZ * newAxisAccerlationZ);
+    if (newAxisAccerlation > 1.0f)
+    {
+      newAxisAccerlationX /= newAxisAccerlation;
+      newAxisAccerlationZ /= newAxisAccerlation;
+    }
+
+    //Rotate the new "raw" accerlation depending the current player rotation
+    //with some sin/cos magic.
+    float rotationYSin = sinf(Common_degToRad(rotationY));
+    float rotationYCos = cosf(Common_degToRad(rotationY));
+    float newAccerlationX = newAxisAccerlationX * rotationYCos
+      - newAxisAccerlationZ * rotationYSin;
+    float newAccerlationZ = newAxisAccerlationZ * rotationYCos
+      + newAxisAccerlationX * rotationYSin;
+
+    //Add the rotated accerlation to the overall rotation and apply friction.
+    float accerlationX = self->accerlationsX[i] + newAccerlationX *
+      (deltaSeconds * PLAYER_MAX_SPEED);
+    float accerlationY = self->accerlationsY[i];
+    float accerlationZ = self->accerlationsZ[i] + newAccerlationZ *
+      (deltaSeconds * PLAYER_MAX_SPEED);
+
+    //If the player hits jump (and is currently on the floor), the vertical
+    //accerlation is set to the PLAYER_JUMP_SPEED - so that the player bolts
+    //into the air without inertia. While airborne, the accerlation will
+    //slowly decrease through continuosuly applied gravity. When the player
+    //falls back down and finally hits the floor, the player will slightly
+    //bounce off the floor a few times, depending on FLOOR_BOUNCYNESS, and
+    //then be static again. The FLOOR_BOUNCYNESS prevents another jump while
+    //bouncing though - if that is not wanted, FLOOR_BOUNCYNESS needs to be
+    //set to 0.
+    float y = self->positionsY[i];
+    if (y > CALCULATION_TRESHOLD)
+      accerlationY -= (PLAYER_GRAVITY * deltaSeconds);
+    else if (input->buttons & SessionJump)
+      accerlationY = PLAYER_JUMP_SPEED * deltaSeconds;
+    else if (fabsf(accerlationY) > CALCULATION_TRESHOLD)
+      accerlationY = -accerlationY * FLOOR_BOUNCYNESS;
+    else accerlationY = 0;
+
+    //Apply friction to the current player accerlation (on the X and Z axis).
+    accerlationX -= accerlationX * (deltaSeconds * PLAYER_FRICTION);
+    accerlationZ -= accerlationZ * (deltaSeconds * PLAYER_FRICTION);
+
+    //Calculate the new player position and make that the new position if it
+    //doesn't collide with any fields that are not just "floor". If the
+    //player collides with a wall or another object, invert the accerlation
+    //to give us a small bounce effect.
+    //In finite maps, the player is a circle which slides along walls instead
+    //(using the swept circle) - only the part of the accerlation which
+    //points into the wall is removed then.
+    float x = self->positionsX[i], z = self->positionsZ[i];
+    int level = self->levels[i];
+    float newX = x + accerlationX;
+    float newZ = z + accerlationZ;
+
+    float wallNormalX = 0, wallNormalZ = 0;
+    if (isCollisionEnabled)
+    {
+      if (Collision_sweepCircle(&collisionGrid, &x, level, &z,
+        accerlationX, accerlationZ, PLAYER_RADIUS, &wallNormalX,
+        &wallNormalZ))
+      {
+        float accerlationIntoWall = accerlationX * wallNormalX +
+          accerlationZ * wallNormalZ;
+        if (accerlationIntoWall < 0)
+        {
+          accerlationX -= accerlationIntoWall * wallNormalX;
+          accerlationZ -= accerlationIntoWall * wallNormalZ;
+        }
+      }
+    }
+    else if (Game_getMapFieldByPosition(newX, level, newZ) <= 0)
+    {
+      x = newX;
+      z = newZ;
+    }
+    else
+    {
+      accerlationX = -accerlationX;
+      accerlationZ = -accerlationZ;
+      x += accerlationX;
+      z += accerlationZ;
+    }
+
+    self->positionsY[i] = MAX(0, y + accerlationY);
+    self->accerlationsX[i] = accerlationX;
+    self->accerlationsY[i] = accerlationY;
+    self->accerlationsZ[i] = accerlationZ;
+
+    //If the player hits the interaction key while standing on a lift, the
+    //lift takes the player to the level above - or, if the shaft doesn't
+    //continue upwards, to the level below. As the levels above and below are
+    //always loaded (see "World_update"), the player never ends up in an
+    //unloaded chunk.
+    bool isActionPressed = (input->buttons & SessionAction) != 0;
+    if (isActionPressed && !self->previousActions[i] &&
+      Game_getMapFieldByPosition(x, level, z) == Lift)
+    {
+      if (level + 1 < mapLevels && Game_getMapFieldByPosition(x, level + 1,
+        z) == Lift) level++;
+      else if (level > 0 && Game_getMapFieldByPosition(x, level - 1, z) ==
+        Lift) level--;
+    }
+    self->previousActions[i] = isActionPressed;
+
+    //If the player hits the interaction key and is close to the quest item,
+    //the item will be picked up. If he's currently carrying the item and is
+    //close to the goal, the item will be dropped into the goal and the
+    //session is done.
+    if (isActionPressed)
+    {
+      int fieldX, fieldZ;
+      Game_getMapFieldIndiciesByPosition(x, z, &fieldX, &fieldZ);
+
+      if (self->itemStates[i] == Initial && Game_isFieldNearby(fieldX, level,
+        fieldZ, Item)) self->itemStates[i] = Held;
+      if (self->itemStates[i] == Held && Game_isFieldNearby(fieldX, level,
+        fieldZ, Goal)) self->itemStates[i] = Dropped;
+    }
+
+    self->positionsX[i] = x;
+    self->positionsZ[i] = z;
+    self->levels[i] = level;
+  }
+}
+
+//Changes the inputs of sessions like a simple bot: every session presses a
+//random combination of buttons (which is kept most of the time) and turns
+//around a bit.
+//inputs: The inputs of the sessions.
+//count: The amount of sessions.
+//random: A pointer to the state of the random number generator.
+void Session_changeInputsRandomly(SessionInput *inputs, int count,
+  uint32_t *random)
+{
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t value = Maze_random(random);
+    if (value % 4 == 0) inputs[i].buttons = (uint8_t)((value >> 2) & 63);
+    inputs[i].mouseX = (float)((int)((value >> 8) % 41) - 20);
+    inputs[i].mouseY = 0;
+  }
+}
+
+//Describes how the sessions of a batch are split into blocks which are
+//stepped on the worker pool.
+typedef struct
+{
+  SessionBatch *batch;
+  const SessionInput *inputs;
+  int blockSize;
+  float deltaSeconds;
+} SessionStepBlocks;
+
+//Steps one block of sessions (for parallelFor).
+//data: A pointer to a SessionStepBlocks instance.
+//index: The index of the block.
+void SessionBatch_stepBlock(void *data, int index)
+{
+  SessionStepBlocks *blocks = (SessionStepBlocks *)data;
+  int first = index * blocks->blockSize;
+  SessionBatch_stepRange(blocks->batch, first, MIN(blocks->batch->count,
+    first + blocks->blockSize), blocks->inputs, blocks->deltaSeconds);
+}
+
+//Steps all sessions of a batch, in blocks on the worker pool if one is
+//given. The result doesn't depend on the amount of threads.
+//In the endless mode, the fields are read from the chunk cache, which must
+//not be accessed by the worker threads - so the pool isn't used there.
+//self: A pointer to the batch.
+//pool: The worker pool or NULL to step all sessions on the calling thread.
+//inputs, deltaSeconds: See "SessionBatch_stepRange".
+void SessionBatch_step(SessionBatch *self, WorkerPool *pool,
+  const SessionInput *inputs, float deltaSeconds)
+{
+  SessionStepBlocks blocks;
+  if (endlessMode) pool = NULL;
+  int blockCount = pool == NULL ? 1 :
+    MAX(1, MIN((pool->threadCount + 1) * 4, self->count / 256));
+
+  blocks.batch = self;
+  blocks.inputs = inputs;
+  blocks.blockSize = (self->count + blockCount - 1) / blockCount;
+  blocks.deltaSeconds = deltaSeconds;
+  if (blockCount == 1) SessionBatch_stepBlock(&blocks, 0);
+  else WorkerPool_parallelFor(pool, blockCount, SessionBatch_stepBlock,
+    &blocks);
+}
+
+//=============================================================================
+// Lockstep: Sessions in fixed-point numbers, stepped bit-exactly everywhere.
+//=============================================================================
+
+//The fractional bits of a fixed-point number and the number 1.
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+//The square root of 0.5 (as fixed-point number).
+#define FIXED_SQRT_HALF 46341
+//The entries of the sine table per quarter turn.
+#define FIXED_SINE_STEPS 256
+
+//A number with 16 integer and 16 fractional bits. Only integer operations
+//are used on them, so they yield the same results with every compiler and
+//processor - unlike floats, whose results may differ in the last bits (as
+//the math libraries, the instructions and the optimizations differ).
+typedef int32_t Fixed;
+
+//The sines of a quarter turn (see "Fixed_initializeSines").
+Fixed fixedSines[FIXED_SINE_STEPS + 1];
+
+//Converts a float into a fixed-point number (rounded to the nearest one).
+//As the float is only scaled by a power of two, the result is exact for
+//the constants and the integer values (like mouse movements) it's used on.
+//value: The float.
+Fixed Fixed_fromFloat(float value)
+{
+  return (Fixed)floorf(value * FIXED_ONE + 0.5f);
+}
+
+//Converts a fixed-point number into a float (for drawing).
+//value: The fixed-point number.
+float Fixed_toFloat(Fixed value)
+{
+  return (float)value / FIXED_ONE;
+}
+
+//Multiplies two fixed-point numbers (rounding down).
+//a, b: The fixed-point numbers.
+Fixed Fixed_multiply(Fixed a, Fixed b)
+{
+  return (Fixed)(((int64_t)a * b) >> FIXED_SHIFT);
+}
+
+//Fills the sine table with a Taylor series in 64-bit integers with 30
+//fractional bits - so that it doesn't depend on the math library either.
+//Only needs to be called once.
+void Fixed_initializeSines(void)
+{
+  //Pi / 2 with 30 fractional bits.
+  const int64_t halfPi = 1686629713;
+  for (int i = 0; i <= FIXED_SINE_STEPS; i++)
+  {
+    int64_t x = halfPi * i / FIXED_SINE_STEPS, square = (x * x) >> 30;
+    int64_t term = x, sum = x;
+    for (int k = 1; k <= 7; k++)
+    {
+      term = -((term * square) >> 30) / (2 * k * (2 * k + 1));
+      sum += term;
+    }
+    fixedSines[i] = (Fixed)((sum + (1 << 13)) >> 14);
+  }
+}
+
+//Gets the sine of an angle from the sine table (interpolated linearly).
+//degrees: The angle (in degrees).
+Fixed Fixed_sin(Fixed degrees)
+{
+  //The angle in 1/65536 turns, then in the steps of a quarter turn.
+  uint32_t turn = (uint32_t)(degrees / 360) & 0xFFFF;
+  uint32_t quarter = turn >> 14, step = turn & 0x3FFF;
+  if (quarter & 1) step = 0x4000 - step;
+
+  int index = (int)(step >> 6), fraction = (int)(step & 63);
+  Fixed sine = fixedSines[index];
+  if (fraction > 0)
+    sine += ((fixedSines[index + 1] - sine) * fraction) >> 6;
+  return quarter & 2 ? -sine : sine;
+}
+
+//Gets the cosine of an angle (see "Fixed_sin").
+//degrees: The angle (in degrees).
+Fixed Fixed_cos(Fixed degrees)
+{
+  return Fixed_sin(degrees + 90 * FIXED_ONE);
+}
+
+//Contains game sessions like a SessionBatch, but in fixed-point numbers -
+//so that all machines which step them with the same inputs get exactly the
+//same states, as needed for lockstep networking (where only the inputs are
+//sent) and replays. The player is a square which slides along the fields
+//it can't enter (instead of the swept circle, which relies on floats). Only
+//works in finite maps.
+//Use "FixedSessionBatch_initialize" before using an instance.
+typedef struct
+{
+  int count;
+  //The player positions, where Y is relative to the floor of the level.
+  Fixed *positionsX, *positionsY, *positionsZ;
+  int *levels;
+  //The player accerlations (like "playerAccerlationX").
+  Fixed *accerlationsX, *accerlationsY, *accerlationsZ;
+  //The player rotations and rotation accerlations (in degrees) - the
+  //rotation around the Y axis is kept between 0 and 360 degrees.
+  Fixed *rotationsX, *rotationsY;
+  Fixed *rotationAccerlationsX, *rotationAccerlationsY;
+  Fixed *brightnesses;
+  //The ItemState of every session.
+  uint8_t *itemStates;
+  //1 if the action button was pressed during the last step.
+  uint8_t *previousActions;
+  //The time (in seconds, up to 9 hours) every session was stepped for until
+  //it finished.
+  Fixed *times;
+  //1 after the quest item was dropped and the session was faded out.
+  uint8_t *finished;
+} FixedSessionBatch;
+
+//Starts a session again, with the quest item at its initial position.
+//self: A pointer to the batch.
+//index: The index of the session.
+//x, level, z: The position of the player (usually the spawn point).
+void FixedSessionBatch_reset(FixedSessionBatch *self, int index, Fixed x,
+  int level, Fixed z)
+{
+  self->positionsX[index] = x;
+  self->positionsY[index] = 0;
+  self->positionsZ[index] = z;
+  self->levels[index] = level;
+  self->accerlationsX[index] = 0;
+  self->accerlationsY[index] = 0;
+  self->accerlationsZ[index] = 0;
+  self->rotationsX[index] = 0;
+  self->rotationsY[index] = 0;
+  self->rotationAccerlationsX[index] = 0;
+  self->rotationAccerlationsY[index] = 0;
+  self->brightnesses[index] = 0;
+  self->itemStates[index] = Initial;
+  self->previousActions[index] = 0;
+  self->times[index] = 0;
+  self->finished[index] = 0;
+}
+
+//Initializes a FixedSessionBatch instance with all players at the origin
+//(and the sine table, if that didn't happen yet).
+//self: A pointer to the (uninitialized) batch.
+//count: The amount of sessions.
+void FixedSessionBatch_initialize(FixedSessionBatch *self, int count)
+{
+  const size_t fixedsSize = sizeof(Fixed) * MAX(1, count);
+
+  if (fixedSines[FIXED_SINE_STEPS] == 0) Fixed_initializeSines();
+
+  self->count = count;
+  self->positionsX = (Fixed *)Common_allocate(fixedsSize);
+  self->positionsY = (Fixed *)Common_allocate(fixedsSize);
+  self->positionsZ = (Fixed *)Common_allocate(fixedsSize);
+  self->levels = (int *)Common_allocate(sizeof(int) * MAX(1, count));
+  self->accerlationsX = (Fixed *)Common_allocate(fixedsSize);
+  self->accerlationsY = (Fixed *)Common_allocate(fixedsSize);
+  self->accerlationsZ = (Fixed *)Common_allocate(fixedsSize);
+  self->rotationsX = (Fixed *)Common_allocate(fixedsSize);
+  self->rotationsY = (Fixed *)Common_allocate(fixedsSize);
+  self->rotationAccerlationsX = (Fixed *)Common_allocate(fixedsSize);
+  self->rotationAccerlationsY = (Fixed *)Common_allocate(fixedsSize);
+  self->brightnesses = (Fixed *)Common_allocate(fixedsSize);
+  self->itemStates = (uint8_t *)Common_allocate(MAX(1, count));
+  self->previousActions = (uint8_t *)Common_allocate(MAX(1, count));
+  self->times = (Fixed *)Common_allocate(fixedsSize);
+  self->finished = (uint8_t *)Common_allocate(MAX(1, count));
+
+  for (int i = 0; i < count; i++) FixedSessionBatch_reset(self, i, 0, 0, 0);
+}
+
+//Releases the resources of a FixedSessionBatch instance.
+//self: A pointer to the batch.
+void FixedSessionBatch_destroy(FixedSessionBatch *self)
+{
+  free(self->positionsX);
+  free(self->positionsY);
+  free(self->positionsZ);
+  free(self->levels);
+  free(self->accerlationsX);
+  free(self->accerlationsY);
+  free(self->accerlationsZ);
+  free(self->rotationsX);
+  free(self->rotationsY);
+  free(self->rotationAccerlationsX);
+  free(self->rotationAccerlationsY);
+  free(self->brightnesses);
+  free(self->itemStates);
+  free(self->previousActions);
+  free(self->times);
+  free(self->finished);
+  self->count = 0;
+}
+
+//Converts the state of a session of a SessionBatch into a fixed-point one.
+//self: A pointer to the target batch.
+//index: The index of the session which is overwritten.
+//source: A pointer to the batch to convert from.
+//sourceIndex: The index of the session to convert.
+void FixedSessionBatch_load(FixedSessionBatch *self, int index,
+  const SessionBatch *source, int sourceIndex)
+{
+  float rotationY = fmodf(source->rotationsY[sourceIndex], 360.0f);
+
+  self->positionsX[index] = Fixed_fromFloat(source->positionsX[sourceIndex]);
+  self->positionsY[index] = Fixed_fromFloat(source->positionsY[sourceIndex]);
+  self->positionsZ[index] = Fixed_fromFloat(source->positionsZ[sourceIndex]);
+  self->levels[index] = source->levels[sourceIndex];
+  self->accerlationsX[index] =
+    Fixed_fromFloat(source->accerlationsX[sourceIndex]);
+  self->accerlationsY[index] =
+    Fixed_fromFloat(source->accerlationsY[sourceIndex]);
+  self->accerlationsZ[index] =
+    Fixed_fromFloat(source->accerlationsZ[sourceIndex]);
+  self->rotationsX[index] = Fixed_fromFloat(source->rotationsX[sourceIndex]);
+  self->rotationsY[index] = Fixed_fromFloat(rotationY < 0 ?
+    rotationY + 360.0f : rotationY);
+  self->rotationAccerlationsX[index] =
+    Fixed_fromFloat(source->rotationAccerlationsX[sourceIndex]);
+  self->rotationAccerlationsY[index] =
+    Fixed_fromFloat(source->rotationAccerlationsY[sourceIndex]);
+  self->brightnesses[index] =
+    Fixed_fromFloat(source->brightnesses[sourceIndex]);
+  self->itemStates[index] = source->itemStates[sourceIndex];
+  self->previousActions[index] = source->previousActions[sourceIndex];
+  self->times[index] = Fixed_fromFloat(source->times[sourceIndex]);
+  self->finished[index] = source->finished[sourceIndex];
+}
+
+//Converts the state of a session into a session of a SessionBatch (like
+//the one of the game, which is drawn).
+//self: A pointer to the batch.
+//index: The index of the session to convert.
+//target: A pointer to the target batch.
+//targetIndex: The index of the session which is overwritten.
+void FixedSessionBatch_store(const FixedSessionBatch *self, int index,
+  SessionBatch *target, int targetIndex)
+{
+  target->positionsX[targetIndex] = Fixed_toFloat(self->positionsX[index]);
+  target->positionsY[targetIndex] = Fixed_toFloat(self->positionsY[index]);
+  target->positionsZ[targetIndex] = Fixed_toFloat(self->positionsZ[index]);
+  target->levels[targetIndex] = self->levels[index];
+  target->accerlationsX[targetIndex] =
+    Fixed_toFloat(self->accerlationsX[index]);
+  target->accerlationsY[targetIndex] =
+    Fixed_toFloat(self->accerlationsY[index]);
+  target->accerlationsZ[targetIndex] =
+    Fixed_toFloat(self->accerlationsZ[index]);
+  target->rotationsX[targetIndex] = Fixed_toFloat(self->rotationsX[index]);
+  target->rotationsY[targetIndex] = Fixed_toFloat(self->rotationsY[index]);
+  target->rotationAccerlationsX[targetIndex] =
+    Fixed_toFloat(self->rotationAccerlationsX[index]);
+  target->rotationAccerlationsY[targetIndex] =
+    Fixed_toFloat(self->rotationAccerlationsY[index]);
+  target->brightnesses[targetIndex] =
+    Fixed_toFloat(self->brightnesses[index]);
+  target->itemStates[targetIndex] = self->itemStates[index];
+  target->previousActions[targetIndex] = self->previousActions[index];
+  target->times[targetIndex] = Fixed_toFloat(self->times[index]);
+  target->finished[targetIndex] = self->finished[index];
+}
+
+//Checks if the player can't enter a field (or if it's outside of the map).
+//x, level, z: The indicies of the field.
+bool FixedSessionBatch_isFieldBlocked(int x, int level, int z)
+{
+  return x < 0 || z < 0 || x >= mapWidth || z >= mapDepth ||
+    Game_getMapFieldByIndicies(x, level, z) > 0;
+}
+
+//Checks if the player (a square with the size of its diameter) overlaps a
+//field it can't enter.
+//x, level, z: The position of the player.
+bool FixedSessionBatch_isBlocked(Fixed x, int level, Fixed z)
+{
+  //The fields are centered on their indicies (see
+  //"Game_getMapFieldIndiciesByPosition").
+  const Fixed radius = Fixed_fromFloat(PLAYER_RADIUS);
+  int minX = (x - radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int maxX = (x + radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int minZ = (z - radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int maxZ = (z + radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+
+  for (int fieldX = minX; fieldX <= maxX; fieldX++)
+    for (int fieldZ = minZ; fieldZ <= maxZ; fieldZ++)
+      if (FixedSessionBatch_isFieldBlocked(fieldX, level, fieldZ))
+        return true;
+  return false;
+}
+
+//Moves the player along one axis. Only the fields the front edge of the
+//player enters are tested - if it can't enter one of them, the player stops
+//right before it (and the movement along the axis stops). So a player which
+//overlaps a field it can't enter (like after taking a lift, as the fields
+//around a lift shaft differ between the levels) can still move away from
+//it, but its center never enters such a field.
+//This isn't the swept circle of "SessionBatch_stepRange" on purpose: the
+//circle needs square roots and divisions for its contact times, which can't
+//be rounded the same way on every machine without a lot more fixed-point
+//code. The square only compares integers and moves along X and Z one after
+//another, so it's exact everywhere. As a result, a lockstep player is
+//blocked earlier at the corners of walls (where a circle would slide around
+//them), moving diagonally along a wall differs slightly, and the same inputs
+//don't lead to the same positions as in a single-player game (or on a
+//server, which steps floats) - only between the lockstep machines.
+//position: A pointer to the position on the axis.
+//accerlation: A pointer to the accerlation (the movement) on the axis.
+//x, level, z: The position of the player (with the axis still unmoved).
+//isAxisX: true to move along the X axis, false for the Z axis.
+void FixedSessionBatch_moveAxis(Fixed *position, Fixed *accerlation,
+  Fixed x, int level, Fixed z, bool isAxisX)
+{
+  const Fixed radius = Fixed_fromFloat(PLAYER_RADIUS);
+  if (*accerlation == 0) return;
+
+  Fixed newPosition = *position + *accerlation, other = isAxisX ? z : x;
+  int direction = *accerlation > 0 ? 1 : -1;
+  int minOther = (other - radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int maxOther = (other + radius + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int otherField = (other + FIXED_ONE / 2) >> FIXED_SHIFT;
+  int field = (*position + direction * radius + FIXED_ONE / 2) >>
+    FIXED_SHIFT;
+  int newField = (newPosition + direction * radius + FIXED_ONE / 2) >>
+    FIXED_SHIFT;
+  int newCenterField = (newPosition + FIXED_ONE / 2) >> FIXED_SHIFT;
+
+  if (FixedSessionBatch_isFieldBlocked(isAxisX ? newCenterField :
+    otherField, level, isAxisX ? otherField : newCenterField))
+  {
+    *accerlation = 0;
+    return;
+  }
+  while (field != newField)
+  {
+    field += direction;
+    for (int i = minOther; i <= maxOther; i++)
+    {
+      if (!FixedSessionBatch_isFieldBlocked(isAxisX ? field : i, level,
+        isAxisX ? i : field)) continue;
+      *position = direction > 0 ? field * FIXED_ONE - FIXED_ONE / 2 -
+        radius - 1 : (field + 1) * FIXED_ONE - FIXED_ONE / 2 + radius;
+      *accerlation = 0;
+      return;
+    }
+  }
+  *position = newPosition;
+}
+
+//Steps a range of sessions like "SessionBatch_stepRange" - with the same
+//constants, but in fixed-point numbers. Different ranges can be stepped on
+//different threads.
+//self: A pointer to the batch.
+//first: The index of the first session to step.
+//last: The index after the last session to step.
+//inputs: The input of every session (with the same indicies).
+//deltaSeconds: The time since the last step (which needs to be the same on
+//all machines, so it's usually a fixed time step).
+void FixedSessionBatch_stepRange(FixedSessionBatch *self, int first,
+  int last, const SessionInput *inputs, Fixed deltaSeconds)
+{
+  const Fixed fadeoutStep =
+    Fixed_multiply(Fixed_fromFloat(FADEOUT_SPEED), deltaSeconds);
+  const Fixed mouseStep =
+    Fixed_multiply(Fixed_fromFloat(MOUSE_SPEED), deltaSeconds);
+  const Fixed mouseFriction =
+    Fixed_multiply(Fixed_fromFloat(MOUSE_FRICTION), deltaSeconds);
+  const Fixed speedStep =
+    Fixed_multiply(deltaSeconds, Fixed_fromFloat(PLAYER_MAX_SPEED));
+  const Fixed friction =
+    Fixed_multiply(deltaSeconds, Fixed_fromFloat(PLAYER_FRICTION));
+  const Fixed gravityStep =
+    Fixed_multiply(Fixed_fromFloat(PLAYER_GRAVITY), deltaSeconds);
+  const Fixed jumpStep =
+    Fixed_multiply(Fixed_fromFloat(PLAYER_JUMP_SPEED), deltaSeconds);
+  const Fixed bouncyness = Fixed_fromFloat(FLOOR_BOUNCYNESS);
+  const Fixed treshold = Fixed_fromFloat(CALCULATION_TRESHOLD);
+  const Fixed fullTurn = 360 * FIXED_ONE;
+
+  for (int i = first; i < last; i++)
+  {
+    const SessionInput *input = &inputs[i];
+    if (self->finished[i]) continue;
+    self->times[i] += deltaSeconds;
+
+    Fixed brightness = self->brightnesses[i];
+    if (self->itemStates[i] == Initial && brightness < FIXED_ONE)
+      brightness = MIN(FIXED_ONE, brightness + fadeoutStep);
+    else if (self->itemStates[i] == Dropped)
+    {
+      if (brightness > 0) brightness -= fadeoutStep;
+      else
+      {
+        self->finished[i] = 1;
+        continue;
+      }
+    }
+    self->brightnesses[i] = brightness;
+
+    //The mouse movement turns the player like in "SessionBatch_stepRange".
+    Fixed mouseSpeedX =
+      Fixed_multiply(Fixed_fromFloat(input->mouseX), brightness);
+    Fixed mouseSpeedY =
+      Fixed_multiply(Fixed_fromFloat(input->mouseY), brightness);
+    Fixed rotationAccerlationX = self->rotationAccerlationsX[i] +
+      Fixed_multiply(mouseSpeedY, mouseStep);
+    Fixed rotationAccerlationY = self->rotationAccerlationsY[i] +
+      Fixed_multiply(mouseSpeedX, mouseStep);
+    rotationAccerlationX -=
+      Fixed_multiply(rotationAccerlationX, mouseFriction);
+    rotationAccerlationY -=
+      Fixed_multiply(rotationAccerlationY, mouseFriction);
+    self->rotationAccerlationsX[i] = rotationAccerlationX;
+    self->rotationAccerlationsY[i] = rotationAccerlationY;
+
+    self->rotationsX[i] += rotationAccerlationX;
+    Fixed rotationY = (self->rotationsY[i] + rotationAccerlationY) %
+      fullTurn;
+    if (rotationY < 0) rotationY += fullTurn;
+    self->rotationsY[i] = rotationY;
+
+    //The movement along both axes at once is normalized - as both axes are
+    //1 or -1 then, they're just multiplied with the square root of 0.5.
+    Fixed newAxisAccerlationX = ((input->buttons & SessionRight) ?
+      FIXED_ONE : 0) - ((input->buttons & SessionLeft) ? FIXED_ONE : 0);
+    Fixed newAxisAccerlationZ = ((input->buttons & SessionForward) ?
+      FIXED_ONE : 0) - ((input->buttons & SessionBackwards) ? FIXED_ONE : 0);
+    if (newAxisAccerlationX != 0 && newAxisAccerlationZ != 0)
+    {
+      newAxisAccerlationX = Fixed_multiply(newAxisAccerlationX,
+        FIXED_SQRT_HALF);
+      newAxisAccerlationZ = Fixed_multiply(newAxisAccerlationZ,
+        FIXED_SQRT_HALF);
+    }
+
+    Fixed rotationYSin = Fixed_sin(rotationY);
+    Fixed rotationYCos = Fixed_cos(rotationY);
+    Fixed newAccerlationX = Fixed_multiply(newAxisAccerlationX, rotationYCos)
+      - Fixed_multiply(newAxisAccerlationZ, rotationYSin);
+    Fixed newAccerlationZ = Fixed_multiply(newAxisAccerlationZ, rotationYCos)
+      + Fixed_multiply(newAxisAccerlationX, rotationYSin);
+
+    Fixed accerlationX = self->accerlationsX[i] +
+      Fixed_multiply(newAccerlationX, speedStep);
+    Fixed accerlationY = self->accerlationsY[i];
+    Fixed accerlationZ = self->accerlationsZ[i] +
+      Fixed_multiply(newAccerlationZ, speedStep);
+
+    //Jumping, gravity and bouncing off the floor.
+    Fixed y = self->positionsY[i];
+    if (y > treshold) accerlationY -= gravityStep;
+    else if (input->buttons & SessionJump) accerlationY = jumpStep;
+    else if (accerlationY > treshold || accerlationY < -treshold)
+      accerlationY = -Fixed_multiply(accerlationY, bouncyness);
+    else accerlationY = 0;
+
+    accerlationX -= Fixed_multiply(accerlationX, friction);
+    accerlationZ -= Fixed_multiply(accerlationZ, friction);
+
+    Fixed x = self->positionsX[i], z = self->positionsZ[i];
+    int level = self->levels[i];
+    FixedSessionBatch_moveAxis(&x, &accerlationX, x, level, z, true);
+    FixedSessionBatch_moveAxis(&z, &accerlationZ, x, level, z, false);
+
+    self->positionsY[i] = MAX(0, y + accerlationY);
+    self->accerlationsX[i] = accerlationX;
+    self->accerlationsY[i] = accerlationY;
+    self->accerlationsZ[i] = accerlationZ;
+
+    //Lifts and the quest item work like in "SessionBatch_stepRange".
+    int fieldX = (x + FIXED_ONE / 2) >> FIXED_SHIFT;
+    int fieldZ = (z + FIXED_ONE / 2) >> FIXED_SHIFT;
+    bool isActionPressed = (input->buttons & SessionAction) != 0;
+    if (isActionPressed && !self->previousActions[i] &&
+      Game_getMapFieldByIndicies(fieldX, level, fieldZ) == Lift)
+    {
+      if (level + 1 < mapLevels && Game_getMapFieldByIndicies(fieldX,
+        level + 1, fieldZ) == Lift) level++;
+      else if (level > 0 && Game_getMapFieldByIndicies(fieldX, level - 1,
+        fieldZ) == Lift) level--;
+    }
+    self->previousActions[i] = isActionPressed;
+
+    if (isActionPressed)
+    {
+      if (self->itemStates[i] == Initial && Game_isFieldNearby(fieldX, level,
+        fieldZ, Item)) self->itemStates[i] = Held;
+      if (self->itemStates[i] == Held && Game_isFieldNearby(fieldX, level,
+        fieldZ, Goal)) self->itemStates[i] = Dropped;
+    }
+
+    self->positionsX[i] = x;
+    self->positionsZ[i] = z;
+    self->levels[i] = level;
+  }
+}
+
+//Adds a 32-bit value to a 64-bit FNV-1a hash (byte by byte, starting with
+//the lowest one - so that it's the same on every platform).
+//hash: The hash so far.
+//value: The value.
+//Returns the new hash.
+uint64_t FixedSessionBatch_hashValue(uint64_t hash, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    hash ^= (value >> (i * 8)) & 0xFF;
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+//Hashes the states of all sessions - machines which stepped the sessions
+//the same way get the same hash.
+//self: A pointer to the batch.
+//Returns the hash.
+uint64_t FixedSessionBatch_hash(const FixedSessionBatch *self)
+{
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (int i = 0; i < self->count; i++)
+  {
+    const Fixed values[] = { self->positionsX[i], self->positionsY[i],
+      self->positionsZ[i], self->levels[i], self->accerlationsX[i],
+      self->accerlationsY[i], self->accerlationsZ[i], self->rotationsX[i],
+      self->rotationsY[i], self->rotationAccerlationsX[i],
+      self->rotationAccerlationsY[i], self->brightnesses[i],
+      self->itemStates[i], self->previousActions[i], self->times[i],
+      self->finished[i] };
+    for (int j = 0; j < (int)LENGTHOF(values); j++)
+      hash = FixedSessionBatch_hashValue(hash, (uint32_t)values[j]);
+  }
+  return hash;
+}
+
+//=============================================================================
+// Lidar: Rays cast from the players of a session batch through the map.
+//=============================================================================
+
+//Describes the rays every player of a session batch casts around itself -
+//a cheap observation for bots instead of rendering their views. The rays
+//stay on the level of the player and are spread evenly over the field of
+//view, centered on the direction the player looks into.
+//Use "Lidar_initialize" before using an instance.
+typedef struct
+{
+  //The amount of rays per player and their maximum length (in fields).
+  int rayCount;
+  float range;
+  //The sine and cosine of the angle of every ray relative to the player.
+  float *offsetSins, *offsetCoss;
+} Lidar;
+
+//The state of a ray traversing the fields, like in the DDA of Amanatides and
+//Woo: the current field and the distances along the ray where it leaves the
+//current column (on the X axis) and the current row (on the Z axis).
+typedef struct
+{
+  int fieldX, fieldZ, stepX, stepZ;
+  float distanceX, distanceZ, distanceStepX, distanceStepZ;
+} LidarRay;
+
+//Initializes a Lidar instance.
+//self: A pointer to the (uninitialized) lidar.
+//rayCount: The amount of rays per player.
+//fieldOfView: The angle (in degrees) the rays are spread over - 360 for
+//rays all around the player.
+//range: The maximum length of the rays (in fields).
+void Lidar_initialize(Lidar *self, int rayCount, float fieldOfView,
+  float range)
+{
+  self->rayCount = MAX(1, rayCount);
+  self->range = range;
+  self->offsetSins = (float *)Common_allocate(sizeof(float) *
+    self->rayCount);
+  self->offsetCoss = (float *)Common_allocate(sizeof(float) *
+    self->rayCount);
+
+  for (int i = 0; i < self->rayCount; i++)
+  {
+    float angle = fieldOfView * ((i + 0.5f) / self->rayCount - 0.5f);
+    self->offsetSins[i] = sinf(Common_degToRad(angle));
+    self->offsetCoss[i] = cosf(Common_degToRad(angle));
+  }
+}
+
+//Releases the resources of a Lidar instance.
+//self: A pointer to the lidar.
+void Lidar_destroy(Lidar *self)
+{
+  free(self->offsetSins);
+  free(self->offsetCoss);
+  self->offsetSins = NULL;
+  self->offsetCoss = NULL;
+}
+
+//Starts a ray at the position of a player. The fields are the ones of
+//"Game_getMapFieldIndiciesByPosition" - every field reaches half a field
+//around its position.
+//self: A pointer to the lidar.
+//x, z: The position of the player.
+//rotationSin, rotationCos: The sine and cosine of the rotation of the
+//player (around the Y axis), which are the same for all of its rays.
+//offset: The index of the ray of the player.
+//state: A pointer to the state to initialize.
+void Lidar_startRay(const Lidar *self, float x, float z, float rotationSin,
+  float rotationCos, int offset, LidarRay *state)
+{
+  //The player looks along (-sin, cos) of its rotation (like the forward
+  //movement in "SessionBatch_stepRange"), which is rotated by the offset.
+  float directionX = -(rotationSin * self->offsetCoss[offset] +
+    rotationCos * self->offsetSins[offset]);
+  float directionZ = rotationCos * self->offsetCoss[offset] -
+    rotationSin * self->offsetSins[offset];
+
+  Game_getMapFieldIndiciesByPosition(x, z, &state->fieldX, &state->fieldZ);
+  state->stepX = directionX > 0 ? 1 : -1;
+  state->stepZ = directionZ > 0 ? 1 : -1;
+
+  //Rays parallel to an axis never leave their column or row (the huge
+  //distance is only compared, never multiplied).
+  if (fabsf(directionX) > 1e-6f)
+  {
+    state->distanceStepX = 1.0f / fabsf(directionX);
+    state->distanceX = (state->fieldX + 0.5f * state->stepX - x) /
+      directionX;
+  }
+  else state->distanceStepX = state->distanceX = 1e30f;
+  if (fabsf(directionZ) > 1e-6f)
+  {
+    state->distanceStepZ = 1.0f / fabsf(directionZ);
+    state->distanceZ = (state->fieldZ + 0.5f * state->stepZ - z) /
+      directionZ;
+  }
+  else state->distanceStepZ = state->distanceZ = 1e30f;
+}
+
+//Casts a single ray with "Game_getMapFieldByIndicies", which also works in
+//the endless mode - a simple reference for "Lidar_castRange". A ray stops
+//at the first field which isn't walkable (fields outside of a finite map
+//count as walls) or at the range of the lidar.
+//self: A pointer to the lidar.
+//sessions: A pointer to the session batch.
+//ray: The index of the ray (the session times the rays per player plus the
+//ray of the player).
+//distance: A pointer to store the distance to the hit field into (or the
+//range if nothing was hit).
+//field: A pointer to store the hit field into (or Tile if nothing was hit).
+void Lidar_castRay(const Lidar *self, const SessionBatch *sessions, int ray,
+  float *distance, int8_t *field)
+{
+  const int session = ray / self->rayCount;
+  const int level = sessions->levels[session];
+  const float rotation = Common_degToRad(sessions->rotationsY[session]);
+  LidarRay state;
+  float entryDistance = 0;
+
+  Lidar_startRay(self, sessions->positionsX[session],
+    sessions->positionsZ[session], sinf(rotation), cosf(rotation),
+    ray % self->rayCount, &state);
+  while (entryDistance < self->range)
+  {
+    Field current = Wall;
+    if (endlessMode || (state.fieldX >= 0 && state.fieldX < mapWidth &&
+      state.fieldZ >= 0 && state.fieldZ < mapDepth))
+      current = Game_getMapFieldByIndicies(state.fieldX, level, state.fieldZ);
+    if (!Analysis_isWalkable(current))
+    {
+      *distance = entryDistance;
+      *field = (int8_t)current;
+      return;
+    }
+
+    if (state.distanceX < state.distanceZ)
+    {
+      entryDistance = state.distanceX;
+      state.distanceX += state.distanceStepX;
+      state.fieldX += state.stepX;
+    }
+    else
+    {
+      entryDistance = state.distanceZ;
+      state.distanceZ += state.distanceStepZ;
+      state.fieldZ += state.stepZ;
+    }
+  }
+
+  *distance = self->range;
+  *field = Tile;
+}
+
+//The amount of rays which are started at once (see "Lidar_startRays").
+#define LIDAR_BATCH_SIZE 256
+
+//The start states (see "LidarRay") of a batch of rays.
+typedef struct
+{
+  //The index of the first field of the level of every ray in the map.
+  int levelIndicies[LIDAR_BATCH_SIZE];
+  int fieldsX[LIDAR_BATCH_SIZE], fieldsZ[LIDAR_BATCH_SIZE];
+  int stepsX[LIDAR_BATCH_SIZE], stepsZ[LIDAR_BATCH_SIZE];
+  float distancesX[LIDAR_BATCH_SIZE], distancesZ[LIDAR_BATCH_SIZE];
+  float distanceStepsX[LIDAR_BATCH_SIZE], distanceStepsZ[LIDAR_BATCH_SIZE];
+} LidarStarts;
+
+//Starts a batch of rays like "Lidar_startRay". The rays of a player only
+//differ in their offset, so they're started in one loop without branches,
+//which the compiler can vectorize (as long as comparing floats isn't
+//treated as trapping, like with -fno-trapping-math) - the sines, cosines
+//and divisions are the expensive part of short rays.
+//self: A pointer to the lidar.
+//sessions: A pointer to the session batch.
+//first: The index of the first ray.
+//last: The index after the last ray (at most LIDAR_BATCH_SIZE after the
+//first one).
+//starts: A pointer to the target for the start states.
+void Lidar_startRays(const Lidar *self, const SessionBatch *sessions,
+  int first, int last, LidarStarts *starts)
+{
+  for (int ray = first; ray < last;)
+  {
+    const int session = ray / self->rayCount;
+    const int firstOffset = ray % self->rayCount;
+    const int lastOffset = MIN(self->rayCount, firstOffset + last - ray);
+    const int shift = ray - first - firstOffset;
+    const float x = sessions->positionsX[session];
+    const float z = sessions->positionsZ[session];
+    const float rotation = Common_degToRad(sessions->rotationsY[session]);
+    const float rotationSin = sinf(rotation), rotationCos = cosf(rotation);
+    const int levelIndex = sessions->levels[session] * mapWidth * mapDepth;
+    int fieldX, fieldZ;
+    Game_getMapFieldIndiciesByPosition(x, z, &fieldX, &fieldZ);
+
+    for (int offset = firstOffset; offset < lastOffset; offset++)
+    {
+      const int i = shift + offset;
+      float directionX = -(rotationSin * self->offsetCoss[offset] +
+        rotationCos * self->offsetSins[offset]);
+      float directionZ = rotationCos * self->offsetCoss[offset] -
+        rotationSin * self->offsetSins[offset];
+      int stepX = directionX > 0 ? 1 : -1, stepZ = directionZ > 0 ? 1 : -1;
+      int isParallelX = fabsf(directionX) <= 1e-6f;
+      int isParallelZ = fabsf(directionZ) <= 1e-6f;
+
+      //The divisions are done for parallel rays too (and their results
+      //replaced), so that there are no branches.
+      float distanceStepX = 1.0f / fabsf(directionX);
+      float distanceStepZ = 1.0f / fabsf(directionZ);
+      float distanceX = (fieldX + 0.5f * stepX - x) / directionX;
+      float distanceZ = (fieldZ + 0.5f * stepZ - z) / directionZ;
+
+      starts->levelIndicies[i] = levelIndex;
+      starts->fieldsX[i] = fieldX;
+      starts->fieldsZ[i] = fieldZ;
+      starts->stepsX[i] = stepX;
+      starts->stepsZ[i] = stepZ;
+      starts->distanceStepsX[i] = isParallelX ? 1e30f : distanceStepX;
+      starts->distanceStepsZ[i] = isParallelZ ? 1e30f : distanceStepZ;
+      starts->distancesX[i] = isParallelX ? 1e30f : distanceX;
+      starts->distancesZ[i] = isParallelZ ? 1e30f : distanceZ;
+    }
+    ray += lastOffset - firstOffset;
+  }
+}
+
+//Casts a range of rays (see "Lidar_castRay") through the fields of a finite
+//map. The rays are started in batches (see "Lidar_startRays") and then
+//traversed one after another - they are short in the corridors of a maze.
+//self: A pointer to the lidar.
+//sessions: A pointer to the session batch.
+//first: The index of the first ray.
+//last: The index after the last ray.
+//distances, fields: The targets for the results of the rays (see
+//"Lidar_castRay").
+void Lidar_castRange(const Lidar *self, const SessionBatch *sessions,
+  int first, int last, float *distances, int8_t *fields)
+{
+  const unsigned int width = (unsigned int)mapWidth;
+  const unsigned int depth = (unsigned int)mapDepth;
+  const float range = self->range;
+  LidarStarts starts;
+
+  for (int batch = first; batch < last; batch += LIDAR_BATCH_SIZE)
+  {
+    const int count = MIN(LIDAR_BATCH_SIZE, last - batch);
+    Lidar_startRays(self, sessions, batch, batch + count, &starts);
+
+    for (int i = 0; i < count; i++)
+    {
+      const int levelIndex = starts.levelIndicies[i];
+      int fieldX = starts.fieldsX[i], fieldZ = starts.fieldsZ[i];
+      float distanceX = starts.distancesX[i];
+      float distanceZ = starts.distancesZ[i];
+      float entryDistance = 0;
+      int field = Tile;
+
+      while (entryDistance < range)
+      {
+        //Fields outside of the map count as walls.
+        field = (unsigned int)fieldX < width &&
+          (unsigned int)fieldZ < depth ?
+          map[levelIndex + fieldX * (int)depth + fieldZ] : Wall;
+        if (field > 0) break;
+
+        if (distanceX < distanceZ)
+        {
+          entryDistance = distanceX;
+          distanceX += starts.distanceStepsX[i];
+          fieldX += starts.stepsX[i];
+        }
+        else
+        {
+          entryDistance = distanceZ;
+          distanceZ += starts.distanceStepsZ[i];
+          fieldZ += starts.stepsZ[i];
+        }
+      }
+
+      distances[batch + i] = field > 0 ? entryDistance : range;
+      fields[batch + i] = (int8_t)(field > 0 ? field : Tile);
+    }
+  }
+}
+
+//Describes how rays are split into blocks which are cast on the worker
+//pool.
+typedef struct
+{
+  const Lidar *lidar;
+  const SessionBatch *sessions;
+  float *distances;
+  int8_t *fields;
+  int count, blockSize;
+} LidarBlocks;
+
+//Casts one block of rays (for parallelFor).
+//data: A pointer to a LidarBlocks instance.
+//index: The index of the block.
+void Lidar_castBlock(void *data, int index)
+{
+  LidarBlocks *blocks = (LidarBlocks *)data;
+  int first = index * blocks->blockSize;
+  Lidar_castRange(blocks->lidar, blocks->sessions, first,
+    MIN(blocks->count, first + blocks->blockSize), blocks->distances,
+    blocks->fields);
+}
+
+//Casts the rays of all players of a session batch, in blocks on the worker
+//pool if one is given. The results of the rays of a player are stored
+//next to each other (at the index of the session times the rays per
+//player). In the endless mode, the fields are read from the chunk cache,
+//so every ray is cast on its own with "Lidar_castRay" (and the pool isn't
+//used, see "SessionBatch_step").
+//self: A pointer to the lidar.
+//sessions: A pointer to the session batch.
+//pool: The worker pool or NULL to cast all rays on the calling thread.
+//distances, fields: The targets for the results (with one entry per ray,
+//see "Lidar_castRay").
+void Lidar_cast(const Lidar *self, const SessionBatch *sessions,
+  WorkerPool *pool, float *distances, int8_t *fields)
+{
+  const int count = sessions->count * self->rayCount;
+
+  if (endlessMode)
+  {
+    for (int i = 0; i < count; i++)
+      Lidar_castRay(self, sessions, i, &distances[i], &fields[i]);
+  }
+  else if (pool == NULL)
+    Lidar_castRange(self, sessions, 0, count, distances, fields);
+  else
+  {
+    LidarBlocks blocks;
+    int blockCount = MAX(1, MIN((pool->threadCount + 1) * 4, count / 1024));
+
+    blocks.lidar = self;
+    blocks.sessions = sessions;
+    blocks.distances = distances;
+    blocks.fields = fields;
+    blocks.count = count;
+    blocks.blockSize = (count + blockCount - 1) / blockCount;
+    WorkerPool_parallelFor(pool, blockCount, Lidar_castBlock, &blocks);
+  }
+}
+
+//=============================================================================
+// Autopilot: A bot which plays a game session like a player would.
+//=============================================================================
+
+//The time (in seconds) after which the autopilot is considered stuck if it
+//didn't get any closer to its current target.
+#define AUTOPILOT_STUCK_SECONDS 30.0f
+//The share of the remaining turn towards the movement direction which the
+//autopilot tries to take in every update.
+#define AUTOPILOT_TURN_RATE 0.25f
+//The sine of 22.5 degrees - a button is pressed if the direction towards the
+//next field is less than 67.5 degrees away from its direction, which gives
+//eight directions of movement.
+#define AUTOPILOT_BUTTON_TRESHOLD 0.38f
+
+//The state of the autopilot of one session. The autopilot follows the
+//distance fields of the current map (see "Navigation_initialize") - to the
+//closest quest item first and then to the closest goal, where it presses the
+//action button - so it's only available for finite maps.
+typedef struct
+{
+  //The item state the progress was measured for, the smallest distance to
+  //the target so far and the time since it was reached.
+  ItemState target;
+  uint32_t closestDistance;
+  float secondsWithoutProgress;
+  //true if the action button was pressed in the last update.
+  bool wasActionPressed;
+} Autopilot;
+
+//Resets an autopilot at the start of a session.
+//self: A pointer to the autopilot.
+void Autopilot_reset(Autopilot *self)
+{
+  self->target = Initial;
+  self->closestDistance = NAVIGATION_UNREACHABLE;
+  self->secondsWithoutProgress = 0;
+  self->wasActionPressed = false;
+}
+
+//Checks if the autopilot can't reach its target: if it didn't get closer to
+//it for AUTOPILOT_STUCK_SECONDS.
+//self: A pointer to the autopilot.
+bool Autopilot_isStuck(const Autopilot *self)
+{
+  return self->secondsWithoutProgress > AUTOPILOT_STUCK_SECONDS;
+}
+
+//Calculates the mouse movement which turns a session towards a rotation
+//(see "SessionBatch_stepRange") - by taking a share of the remaining turn as
+//the rotation accerlation after the next step.
+//rotation: The current rotation (in degrees).
+//targetRotation: The rotation to turn to (in degrees).
+//accerlation: The current rotation accerlation.
+//brightness: The brightness of the session, which scales the mouse movement.
+//deltaSeconds: The duration of the next step.
+//Returns the mouse movement (in pixels).
+float Autopilot_getMouseMovement(float rotation, float targetRotation,
+  float accerlation, float brightness, float deltaSeconds)
+{
+  //The damping of the next step is inverted, so that it doesn't slow down
+  //the turn (it's limited for very long steps, which dampen everything).
+  float damping = MAX(0.1f, 1.0f - MOUSE_FRICTION * deltaSeconds);
+  float turn = remainderf(targetRotation - rotation, 360.0f);
+  float targetAccerlation = turn * AUTOPILOT_TURN_RATE / damping;
+  return (targetAccerlation - accerlation) /
+    (brightness * MOUSE_SPEED * deltaSeconds);
+}
+
+//Calculates the input of a session for its next step: the buttons move the
+//player towards the center of the next field on the way to the target (and
+//use lifts), while the mouse turns the player into that direction.
+//self: A pointer to the autopilot of the session.
+//sessions: A pointer to the session batch.
+//index: The index of the session.
+//deltaSeconds: The duration of the next step.
+//input: A pointer to the target for the input.
+void Autopilot_steer(Autopilot *self, const SessionBatch *sessions,
+  int index, float deltaSeconds, SessionInput *input)
+{
+  const float x = sessions->positionsX[index];
+  const float z = sessions->positionsZ[index];
+  const int level = sessions->levels[index];
+  const ItemState itemState = (ItemState)sessions->itemStates[index];
+  const float brightness = sessions->brightnesses[index];
+  int fieldX, fieldZ;
+
+  input->buttons = 0;
+  input->mouseX = 0;
+  input->mouseY = 0;
+
+  //There's nothing left to do while the session is faded out.
+  if (itemState == Dropped)
+  {
+    self->secondsWithoutProgress = 0;
+    return;
+  }
+
+  const DistanceField *distances = itemState == Initial ?
+    &itemDistanceField : &goalDistanceField;
+  Game_getMapFieldIndiciesByPosition(x, z, &fieldX, &fieldZ);
+
+  uint32_t distance = DistanceField_getDistance(distances, fieldX, level,
+    fieldZ);
+  if (itemState != self->target || distance < self->closestDistance)
+  {
+    self->target = itemState;
+    self->closestDistance = distance;
+    self->secondsWithoutProgress = 0;
+  }
+  else self->secondsWithoutProgress += deltaSeconds;
+
+  //Right next to the target, holding the action button picks up the quest
+  //item or drops it into the goal.
+  if (Game_isFieldNearby(fieldX, level, fieldZ,
+    itemState == Initial ? Item : Goal))
+  {
+    input->buttons = SessionAction;
+    self->wasActionPressed = true;
+    return;
+  }
+
+  //Lifts only react when the action button is pressed again, so it's
+  //released in every other update while the next step is on another level.
+  //Until then, the player stays in the center of the lift.
+  float targetX = 0, targetZ = 0;
+  int nextX = fieldX, nextLevel = level, nextZ = fieldZ;
+  DistanceField_getNextStep(distances, fieldX, level, fieldZ, &nextX,
+    &nextLevel, &nextZ);
+  bool isActionPressed = nextLevel != level && !self->wasActionPressed;
+  if (nextLevel != level) Game_getMapFieldPositionByIndicies(fieldX, fieldZ,
+    &targetX, &targetZ);
+  else Game_getMapFieldPositionByIndicies(nextX, nextZ, &targetX, &targetZ);
+  self->wasActionPressed = isActionPressed;
+  if (isActionPressed) input->buttons |= SessionAction;
+
+  float deltaX = targetX - x, deltaZ = targetZ - z;
+  float length = sqrtf(deltaX * deltaX + deltaZ * deltaZ);
+  if (length < CALCULATION_TRESHOLD) return;
+
+  //The direction is transformed into the view of the player (see the
+  //movement in "SessionBatch_stepRange"), where it's "forward" along
+  //(-sin, cos) of the rotation and "right" along (cos, sin).
+  const float rotationY = sessions->rotationsY[index];
+  float rotationYSin = sinf(Common_degToRad(rotationY));
+  float rotationYCos = cosf(Common_degToRad(rotationY));
+  float forward = (deltaZ * rotationYCos - deltaX * rotationYSin) / length;
+  float right = (deltaX * rotationYCos + deltaZ * rotationYSin) / length;
+
+  if (forward > AUTOPILOT_BUTTON_TRESHOLD) input->buttons |= SessionForward;
+  else if (forward < -AUTOPILOT_BUTTON_TRESHOLD)
+    input->buttons |= SessionBackwards;
+  if (right > AUTOPILOT_BUTTON_TRESHOLD) input->buttons |= SessionRight;
+  else if (right < -AUTOPILOT_BUTTON_TRESHOLD) input->buttons |= SessionLeft;
+
+  //The mouse has no effect until the session is faded in.
+  if (brightness > CALCULATION_TRESHOLD)
+  {
+    input->mouseX = Autopilot_getMouseMovement(rotationY,
+      Common_radToDeg(atan2f(-deltaX, deltaZ)),
+      sessions->rotationAccerlationsY[index], brightness, deltaSeconds);
+    input->mouseY = Autopilot_getMouseMovement(sessions->rotationsX[index],
+      0, sessions->rotationAccerlationsX[index], brightness, deltaSeconds);
+  }
+}
+
+//=============================================================================
+// Laps: Restarting finished games and statistics of every lap.
+//=============================================================================
+
+//true to let the autopilot play the game (see "Autopilot").
+bool autopilotMode = false;
+//The autopilot of the player session.
+Autopilot playerAutopilot;
+//true to restart the game when it's finished instead of exiting - every
+//game is a lap then.
+bool restartMode = false;
+//The position every lap starts at (the spawn point).
+float lapStartX = 0, lapStartZ = 0;
+//The amount of laps which ended so far (finished or aborted because the
+//autopilot got stuck), how long the last one took and whether it was
+//finished. Written by the simulation while "simulationMutex" is locked.
+int lapCount = 0;
+double lastLapSeconds = 0;
+bool wasLastLapFinished = false;
+//The amount of laps which were already printed and the times between the
+//frames drawn since then (in seconds) - only used by the GLUT thread.
+int printedLapCount = 0;
+double *lapFrameSeconds = NULL;
+int lapFrameCount = 0, lapFrameCapacity = 0;
+double lastFrameTime = 0;
+
+//Records the time since the last drawn frame (if laps are printed).
+void Lap_recordFrame(void)
+{
+  double currentTime = Common_getTimeSeconds();
+  if (!restartMode) return;
+
+  if (lastFrameTime > 0)
+  {
+    if (lapFrameCount == lapFrameCapacity)
+    {
+      int newCapacity = MAX(1024, lapFrameCapacity * 2);
+      double *newFrameSeconds = (double *)Common_allocate(sizeof(double) *
+        newCapacity);
+      if (lapFrameCount > 0) memcpy(newFrameSeconds, lapFrameSeconds,
+        sizeof(double) * lapFrameCount);
+      free(lapFrameSeconds);
+      lapFrameSeconds = newFrameSeconds;
+      lapFrameCapacity = newCapacity;
+    }
+    lapFrameSeconds[lapFrameCount++] = currentTime - lastFrameTime;
+  }
+  lastFrameTime = currentTime;
+}
+
+//Compares two durations (for qsort).
+//a, b: Pointers to the durations.
+int Lap_compareSeconds(const void *a, const void *b)
+{
+  double secondsA = *(const double *)a, secondsB = *(const double *)b;
+  return (secondsA > secondsB) - (secondsA < secondsB);
+}
+
+//Prints the statistics of a lap: its duration, the frame times (average,
+//median, 99th percentile and maximum) and the resident memory - so that
+//soak tests show whether the game gets slower or grows over time. Starts
+//the frame statistics of the next lap.
+//lap: The number of the lap.
+//seconds: The duration of the lap.
+//isFinished: false if the lap was aborted because the autopilot got stuck.
+void Lap_print(int lap, double seconds, bool isFinished)
+{
+  double sum = 0, median = 0, percentile = 0, maximum = 0;
+  if (lapFrameCount > 0)
+  {
+    qsort(lapFrameSeconds, lapFrameCount, sizeof(double),
+      Lap_compareSeconds);
+    for (int i = 0; i < lapFrameCount; i++) sum += lapFrameSeconds[i];
+    median = lapFrameSeconds[lapFrameCount / 2];
+    percentile = lapFrameSeconds[(int)(lapFrameCount * 0.99)];
+    maximum = lapFrameSeconds[lapFrameCount - 1];
+  }
+
+  printf("Lap %d: %s after %.2f s, %d frames - frame time %.2f ms on "
+    "average, %.2f ms median, %.2f ms 99th percentile, %.2f ms at most, "
+    "%.1f MiB resident memory.\n", lap, isFinished ? "finished" :
+    "aborted (the autopilot got stuck)", seconds, lapFrameCount,
+    lapFrameCount > 0 ? sum * 1000.0 / lapFrameCount : 0.0, median * 1000.0,
+    percentile * 1000.0, maximum * 1000.0,
+    Common_getResidentMemory() / (1024.0 * 1024.0));
+  fflush(stdout);
+
+  lapFrameCount = 0;
+}
+
+//Releases the frame statistics.
+void Lap_destroy(void)
+{
+  free(lapFrameSeconds);
+  lapFrameSeconds = NULL;
+  lapFrameCount = 0;
+  lapFrameCapacity = 0;
+}
+
+//=============================================================================
+// Network: UDP sockets and the messages between the server and its clients.
+//=============================================================================
+
+//The port the server listens on by default (see "--port").
+#define NET_DEFAULT_PORT 27960
+//The biggest message which is sent - small enough to never be fragmented.
+#define NET_MAX_MESSAGE_SIZE 1200
+//Identifies the messages of the game (the first two bytes of every message).
+#define NET_PROTOCOL_ID 0x4751
+//The amount of recent inputs every input message repeats, so that a lost
+//message doesn't lose the input of a step.
+#define NET_INPUT_REDUNDANCY 4
+//The largest mouse movement (in pixels per step) an input may contain.
+#define NET_MAX_MOUSE_MOVEMENT 1000.0f
+//The IPv4 addresses of all interfaces and of the local machine only.
+#define NET_ANY_HOST 0u
+#define NET_LOOPBACK_HOST 0x7F000001u
+
+//An IPv4 address and port (both in host byte order).
+typedef struct
+{
+  uint32_t host;
+  uint16_t port;
+} NetAddress;
+
+//Provides a non-blocking UDP socket.
+//Use "UdpSocket_open" before using an instance.
+typedef struct
+{
+#if defined(_WIN32)
+  SOCKET handle;
+#else
+  int handle;
+#endif
+} UdpSocket;
+
+//Defines the types of the messages.
+typedef enum
+{
+  NetInvalid = 0,
+  //Sent by a client (repeatedly) until it's accepted by the server.
+  NetConnect = 1,
+  //The answer of the server to NetConnect: the index of the client, the tick
+  //rate, the maximum amount of clients and the size of the map.
+  NetAccept = 2,
+  //The answer of the server to NetConnect if all slots are taken.
+  NetReject = 3,
+  //The newest complete snapshot a client received and its recent inputs
+  //(see "NET_INPUT_REDUNDANCY").
+  NetInput = 4,
+  //The state of the session of a client after a tick of the server.
+  NetState = 5,
+  //Sent by a client when it leaves.
+  NetDisconnect = 6,
+  //A part of the snapshot of all players after a tick (see "Snapshot").
+  NetSnapshot = 7
+} NetMessageType;
+
+//Contains a message which is written before it's sent or read after it was
+//received. All values are stored in little endian byte order.
+typedef struct
+{
+  uint8_t data[NET_MAX_MESSAGE_SIZE];
+  //The amount of bytes written (or received) and the position of the next
+  //byte to read.
+  int size, position;
+  //false after a value was written or read beyond the end of the message.
+  bool isValid;
+} NetMessage;
+
+//Creates a NetAddress instance.
+//host: The IPv4 address (like NET_LOOPBACK_HOST).
+//port: The port.
+NetAddress NetAddress_create(uint32_t host, uint16_t port)
+{
+  NetAddress address;
+  address.host = host;
+  address.port = port;
+  return address;
+}
+
+//Checks whether two addresses are the same.
+bool NetAddress_equals(NetAddress a, NetAddress b)
+{
+  return a.host == b.host && a.port == b.port;
+}
+
+//Opens a UDP socket, which never blocks when receiving.
+//self: A pointer to the (uninitialized) socket.
+//host: The address of the interface to listen on (like NET_ANY_HOST).
+//port: The port to listen on or 0 to use any free port.
+//Terminates the application if the socket couldn't be opened.
+void UdpSocket_open(UdpSocket *self, uint32_t host, uint16_t port)
+{
+  struct sockaddr_in address;
+  //Many clients may send their messages between two ticks of the server.
+  int bufferSize = 1 << 22;
+
+#if defined(_WIN32)
+  static bool isInitialized = false;
+  WSADATA data;
+  if (!isInitialized && WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    Common_terminate("NETWORK", "The network couldn't be initialized.");
+  isInitialized = true;
+#endif
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(host);
+  address.sin_port = htons(port);
+
+  self->handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if defined(_WIN32)
+  u_long isNonBlocking = 1;
+  if (self->handle == INVALID_SOCKET) Common_terminate("NETWORK",
+    "A socket couldn't be created.");
+  if (ioctlsocket(self->handle, FIONBIO, &isNonBlocking) != 0)
+#else
+  if (self->handle < 0) Common_terminate("NETWORK",
+    "A socket couldn't be created.");
+  if (fcntl(self->handle, F_SETFL, fcntl(self->handle, F_GETFL) |
+    O_NONBLOCK) != 0)
+#endif
+    Common_terminate("NETWORK", "A socket couldn't be made non-blocking.");
+
+  //The buffers are only a hint - the system may use smaller ones.
+  setsockopt(self->handle, SOL_SOCKET, SO_RCVBUF, (const char *)&bufferSize,
+    sizeof(bufferSize));
+  setsockopt(self->handle, SOL_SOCKET, SO_SNDBUF, (const char *)&bufferSize,
+    sizeof(bufferSize));
+
+  if (bind(self->handle, (struct sockaddr *)&address, sizeof(address)) != 0)
+    Common_terminate("NETWORK", "A socket couldn't be bound to its port "
+      "(is the port already used by another application?).");
+}
+
+//Closes a UDP socket.
+//self: A pointer to the socket.
+void UdpSocket_close(UdpSocket *self)
+{
+#if defined(_WIN32)
+  closesocket(self->handle);
+#else
+  close(self->handle);
+#endif
+}
+
+//Gets the port a socket is bound to (useful if it was opened with port 0).
+//self: A pointer to the socket.
+uint16_t UdpSocket_getPort(UdpSocket *self)
+{
+  struct sockaddr_in address;
+#if defined(_WIN32)
+  int addressSize = sizeof(address);
+#else
+  socklen_t addressSize = sizeof(address);
+#endif
+  if (getsockname(self->handle, (struct sockaddr *)&address, &addressSize))
+    return 0;
+  return ntohs(address.sin_port);
+}
+
+//Sends a datagram.
+//self: A pointer to the socket.
+//to: The address of the receiver.
+//data: The datagram.
+//size: The size of the datagram in bytes.
+//Returns true if the datagram was sent (which doesn't mean it arrives).
+bool UdpSocket_send(UdpSocket *self, NetAddress to, const uint8_t *data,
+  int size)
+{
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(to.host);
+  address.sin_port = htons(to.port);
+  return sendto(self->handle, (const char *)data, size, 0,
+    (struct sockaddr *)&address, sizeof(address)) == size;
+}
+
+//Receives the next pending datagram (without blocking).
+//self: A pointer to the socket.
+//from: A pointer to store the address of the sender into.
+//buffer: The buffer for the datagram.
+//capacity: The size of the buffer in bytes.
+//Returns the size of the datagram, 0 if no datagram is pending or -1 if the
+//next datagram couldn't be received (which may succeed on the next call).
+int UdpSocket_receive(UdpSocket *self, NetAddress *from, uint8_t *buffer,
+  int capacity)
+{
+  struct sockaddr_in address;
+#if defined(_WIN32)
+  int addressSize = sizeof(address);
+  int size = recvfrom(self->handle, (char *)buffer, capacity, 0,
+    (struct sockaddr *)&address, &addressSize);
+  if (size < 0) return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+  socklen_t addressSize = sizeof(address);
+  int size = (int)recvfrom(self->handle, buffer, (size_t)capacity, 0,
+    (struct sockaddr *)&address, &addressSize);
+  if (size < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+#endif
+  from->host = ntohl(address.sin_addr.s_addr);
+  from->port = ntohs(address.sin_port);
+  //Empty datagrams are never sent by the game.
+  return size == 0 ? -1 : size;
+}
+
+//Starts writing a new message.
+//self: A pointer to the message.
+//type: The type of the message.
+void NetMessage_begin(NetMessage *self, NetMessageType type)
+{
+  self->size = 0;
+  self->position = 0;
+  self->isValid = true;
+  self->data[self->size++] = NET_PROTOCOL_ID & 0xFF;
+  self->data[self->size++] = NET_PROTOCOL_ID >> 8;
+  self->data[self->size++] = (uint8_t)type;
+}
+
+//Starts reading a received message.
+//self: A pointer to the message, whose data was received.
+//size: The size of the received data.
+//Returns the type of the message or NetInvalid if it isn't a message of the
+//game.
+NetMessageType NetMessage_open(NetMessage *self, int size)
+{
+  self->size = size;
+  self->position = 3;
+  self->isValid = size >= 3 && self->data[0] == (NET_PROTOCOL_ID & 0xFF) &&
+    self->data[1] == NET_PROTOCOL_ID >> 8;
+  return self->isValid ? (NetMessageType)self->data[2] : NetInvalid;
+}
+
+//Appends an unsigned integer to a message.
+//self: A pointer to the message.
+//value: The value.
+//byteCount: The amount of (lower) bytes of the value to write.
+void NetMessage_writeBytes(NetMessage *self, uint32_t value, int byteCount)
+{
+  if (self->size + byteCount > NET_MAX_MESSAGE_SIZE)
+  {
+    self->isValid = false;
+    return;
+  }
+  for (int i = 0; i < byteCount; i++)
+    self->data[self->size++] = (uint8_t)(value >> (i * 8));
+}
+
+//Reads an unsigned integer from a message.
+//self: A pointer to the message.
+//byteCount: The amount of bytes of the value.
+//Returns the value or 0 if the message is too short (see "isValid").
+uint32_t NetMessage_readBytes(NetMessage *self, int byteCount)
+{
+  uint32_t value = 0;
+  if (self->position + byteCount > self->size)
+  {
+    self->isValid = false;
+    return 0;
+  }
+  for (int i = 0; i < byteCount; i++)
+    value |= (uint32_t)self->data[self->position++] << (i * 8);
+  return value;
+}
+
+//Appends a float (with all of its bits) to a message.
+void NetMessage_writeFloat(NetMessage *self, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  NetMessage_writeBytes(self, bits, 4);
+}
+
+//Reads a float written with "NetMessage_writeFloat" from a message.
+float NetMessage_readFloat(NetMessage *self)
+{
+  uint32_t bits = NetMessage_readBytes(self, 4);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+//Appends the complete state of a session to a message, so that the session
+//can be continued exactly where it is on the other side.
+//self: A pointer to the message.
+//batch: A pointer to the batch of the session.
+//index: The index of the session.
+void NetMessage_writeSession(NetMessage *self, const SessionBatch *batch,
+  int index)
+{
+  NetMessage_writeFloat(self, batch->positionsX[index]);
+  NetMessage_writeFloat(self, batch->positionsY[index]);
+  NetMessage_writeFloat(self, batch->positionsZ[index]);
+  NetMessage_writeBytes(self, (uint32_t)batch->levels[index], 2);
+  NetMessage_writeFloat(self, batch->accerlationsX[index]);
+  NetMessage_writeFloat(self, batch->accerlationsY[index]);
+  NetMessage_writeFloat(self, batch->accerlationsZ[index]);
+  NetMessage_writeFloat(self, batch->rotationsX[index]);
+  NetMessage_writeFloat(self, batch->rotationsY[index]);
+  NetMessage_writeFloat(self, batch->rotationAccerlationsX[index]);
+  NetMessage_writeFloat(self, batch->rotationAccerlationsY[index]);
+  NetMessage_writeFloat(self, batch->brightnesses[index]);
+  NetMessage_writeBytes(self, batch->itemStates[index], 1);
+  NetMessage_writeBytes(self, batch->previousActions[index], 1);
+  NetMessage_writeFloat(self, batch->times[index]);
+  NetMessage_writeBytes(self, batch->finished[index], 1);
+}
+
+//Reads the state of a session written with "NetMessage_writeSession".
+//self: A pointer to the message.
+//batch: A pointer to the batch of the session.
+//index: The index of the session, which is overwritten.
+void NetMessage_readSession(NetMessage *self, SessionBatch *batch, int index)
+{
+  batch->positionsX[index] = NetMessage_readFloat(self);
+  batch->positionsY[index] = NetMessage_readFloat(self);
+  batch->positionsZ[index] = NetMessage_readFloat(self);
+  batch->levels[index] = (int)NetMessage_readBytes(self, 2);
+  batch->accerlationsX[index] = NetMessage_readFloat(self);
+  batch->accerlationsY[index] = NetMessage_readFloat(self);
+  batch->accerlationsZ[index] = NetMessage_readFloat(self);
+  batch->rotationsX[index] = NetMessage_readFloat(self);
+  batch->rotationsY[index] = NetMessage_readFloat(self);
+  batch->rotationAccerlationsX[index] = NetMessage_readFloat(self);
+  batch->rotationAccerlationsY[index] = NetMessage_readFloat(self);
+  batch->brightnesses[index] = NetMessage_readFloat(self);
+  batch->itemStates[index] = (uint8_t)NetMessage_readBytes(self, 1);
+  batch->previousActions[index] = (uint8_t)NetMessage_readBytes(self, 1);
+  batch->times[index] = NetMessage_readFloat(self);
+  batch->finished[index] = (uint8_t)NetMessage_readBytes(self, 1);
+}
+
+//Appends the input of a step to a message.
+void NetMessage_writeInput(NetMessage *self, const SessionInput *input)
+{
+  NetMessage_writeBytes(self, input->buttons, 1);
+  NetMessage_writeFloat(self, input->mouseX);
+  NetMessage_writeFloat(self, input->mouseY);
+}
+
+//Reads the input of a step written with "NetMessage_writeInput". As the
+//input comes from another machine, unknown buttons are ignored and the mouse
+//movement is clamped to NET_MAX_MOUSE_MOVEMENT - and a mouse movement which
+//isn't a finite number makes the message invalid.
+void NetMessage_readInput(NetMessage *self, SessionInput *input)
+{
+  input->buttons = (uint8_t)(NetMessage_readBytes(self, 1) &
+    (SessionForward | SessionBackwards | SessionLeft | SessionRight |
+    SessionJump | SessionAction));
+  input->mouseX = NetMessage_readFloat(self);
+  input->mouseY = NetMessage_readFloat(self);
+  if (!isfinite(input->mouseX) || !isfinite(input->mouseY))
+  {
+    self->isValid = false;
+    input->mouseX = 0;
+    input->mouseY = 0;
+  }
+  input->mouseX = MAX(-NET_MAX_MOUSE_MOVEMENT, MIN(NET_MAX_MOUSE_MOVEMENT,
+    input->mouseX));
+  input->mouseY = MAX(-NET_MAX_MOUSE_MOVEMENT, MIN(NET_MAX_MOUSE_MOVEMENT,
+    input->mouseY));
+}
+
+//Sends a message.
+//self: A pointer to the message.
+//socket: A pointer to the socket to send it with.
+//to: The address of the receiver.
+//Returns the amount of bytes sent (0 if the message was invalid or couldn't
+//be sent).
+int NetMessage_send(const NetMessage *self, UdpSocket *socket, NetAddress to)
+{
+  if (!self->isValid || !UdpSocket_send(socket, to, self->data, self->size))
+    return 0;
+  return self->size;
+}
+
+//Receives the next pending message of the game.
+//self: A pointer to the message to receive into.
+//socket: A pointer to the socket.
+//from: A pointer to store the address of the sender into.
+//Returns the type of the message (other datagrams are skipped) or NetInvalid
+//if no message is pending.
+NetMessageType NetMessage_receive(NetMessage *self, UdpSocket *socket,
+  NetAddress *from)
+{
+  int size;
+  while ((size = UdpSocket_receive(socket, from, self->data,
+    NET_MAX_MESSAGE_SIZE)) != 0)
+  {
+    NetMessageType type = size < 0 ? NetInvalid : NetMessage_open(self, size);
+    if (type != NetInvalid) return type;
+  }
+  return NetInvalid;
+}
+
+//Delays messages to simulate a slow connection - every message is
+//delivered after the latency plus a random part of the jitter, so messages
+//can also arrive out of order (like they do on the internet). Used for
+//tests on the loopback interface.
+//Use "NetDelayQueue_initialize" before using an instance.
+typedef struct
+{
+  NetMessage *messages;
+  double *deliveryTimes;
+  int count, capacity;
+  //The delay of the messages (in seconds).
+  double latency, jitter;
+  uint32_t random;
+} NetDelayQueue;
+
+//Initializes a NetDelayQueue instance.
+//self: A pointer to the (uninitialized) queue.
+//latency: The minimum delay of every message (in seconds).
+//jitter: The maximum additional delay of every message (in seconds).
+//seed: The seed of the random additional delays.
+void NetDelayQueue_initialize(NetDelayQueue *self, double latency,
+  double jitter, uint32_t seed)
+{
+  self->messages = NULL;
+  self->deliveryTimes = NULL;
+  self->count = 0;
+  self->capacity = 0;
+  self->latency = latency;
+  self->jitter = jitter;
+  self->random = seed;
+}
+
+//Releases the resources of a NetDelayQueue instance (and drops the queued
+//messages).
+//self: A pointer to the queue.
+void NetDelayQueue_destroy(NetDelayQueue *self)
+{
+  free(self->messages);
+  free(self->deliveryTimes);
+  self->messages = NULL;
+  self->deliveryTimes = NULL;
+  self->count = 0;
+  self->capacity = 0;
+}
+
+//Adds a message to the queue.
+//self: A pointer to the queue.
+//message: A pointer to the message.
+//currentTime: The current time (see "Common_getTimeSeconds").
+void NetDelayQueue_push(NetDelayQueue *self, const NetMessage *message,
+  double currentTime)
+{
+  if (self->count == self->capacity)
+  {
+    int newCapacity = MAX(16, self->capacity * 2);
+    NetMessage *newMessages = (NetMessage *)Common_allocate(
+      sizeof(NetMessage) * newCapacity);
+    double *newTimes = (double *)Common_allocate(sizeof(double) *
+      newCapacity);
+    if (self->count > 0)
+    {
+      memcpy(newMessages, self->messages, sizeof(NetMessage) * self->count);
+      memcpy(newTimes, self->deliveryTimes, sizeof(double) * self->count);
+    }
+    free(self->messages);
+    free(self->deliveryTimes);
+    self->messages = newMessages;
+    self->deliveryTimes = newTimes;
+    self->capacity = newCapacity;
+  }
+
+  self->messages[self->count] = *message;
+  self->deliveryTimes[self->count++] = currentTime + self->latency +
+    self->jitter * (Maze_random(&self->random) % 1001) / 1000.0;
+}
+
+//Takes the message which is due first out of the queue.
+//self: A pointer to the queue.
+//message: A pointer to store the message into.
+//currentTime: The current time (see "Common_getTimeSeconds").
+//Returns false if no message is due yet.
+bool NetDelayQueue_pop(NetDelayQueue *self, NetMessage *message,
+  double currentTime)
+{
+  int first = -1;
+  for (int i = 0; i < self->count; i++)
+  {
+    if (self->deliveryTimes[i] <= currentTime && (first < 0 ||
+      self->deliveryTimes[i] < self->deliveryTimes[first])) first = i;
+  }
+  if (first < 0) return false;
+
+  *message = self->messages[first];
+  self->count--;
+  self->messages[first] = self->messages[self->count];
+  self->deliveryTimes[first] = self->deliveryTimes[self->count];
+  return true;
+}
+
+//=============================================================================
+// Snapshot: Quantized, delta-encoded and bit-packed states of all players.
+//=============================================================================
+
+//The amount of snapshots the server and the clients keep - a snapshot which
+//was acknowledged longer ago than this can't be used as baseline anymore.
+#define SNAPSHOT_HISTORY 16
+//The resolution of the quantized values: positions in 1/64 units, the
+//height above the floor in 1/128 units (up to 2 units) and the rotations in
+//1/1024 (around the Y axis) and 1/256 (around the X axis) of a turn.
+#define SNAPSHOT_POSITION_SCALE 64.0f
+#define SNAPSHOT_HEIGHT_SCALE 128.0f
+#define SNAPSHOT_YAW_BITS 10
+#define SNAPSHOT_PITCH_BITS 8
+//The bits of a position or rotation change which is encoded as delta (as
+//signed value).
+#define SNAPSHOT_DELTA_BITS 6
+//The bytes a snapshot part may use after its header.
+#define SNAPSHOT_PART_CAPACITY (NET_MAX_MESSAGE_SIZE - 16)
+//The most bits a single player can use in a snapshot.
+#define SNAPSHOT_MAX_ENTITY_BITS 128
+
+//The quantized state of a player in a snapshot.
+typedef struct
+{
+  uint32_t x, z;
+  uint16_t level, yaw;
+  uint8_t y, pitch, itemState;
+  //0 if there's no player with this index.
+  uint8_t isPresent;
+} SnapshotEntity;
+
+//Writes and reads values with any amount of bits into a buffer.
+//Use "BitPacker_initialize" before using an instance.
+typedef struct
+{
+  uint8_t *data;
+  //The size of the buffer and the amount of bytes written or read.
+  int capacity, position;
+  //The bits which weren't written into (or were read from) the buffer yet.
+  uint64_t scratch;
+  int scratchBitCount;
+  //false after a value was written or read beyond the end of the buffer.
+  bool isValid;
+} BitPacker;
+
+//Initializes a BitPacker instance.
+//self: A pointer to the (uninitialized) instance.
+//data: The buffer to write into or read from.
+//capacity: The size of the buffer in bytes (or of the data to read).
+void BitPacker_initialize(BitPacker *self, uint8_t *data, int capacity)
+{
+  self->data = data;
+  self->capacity = capacity;
+  self->position = 0;
+  self->scratch = 0;
+  self->scratchBitCount = 0;
+  self->isValid = true;
+}
+
+//Writes the lower bits of a value.
+//self: A pointer to the packer.
+//value: The value.
+//bitCount: The amount of bits to write (up to 32).
+void BitPacker_write(BitPacker *self, uint32_t value, int bitCount)
+{
+  if (bitCount < 32) value &= (1u << bitCount) - 1;
+  self->scratch |= (uint64_t)value << self->scratchBitCount;
+  self->scratchBitCount += bitCount;
+
+  //The bits are written in blocks of 4 bytes, which is much faster than
+  //writing every byte on its own.
+  if (self->scratchBitCount < 32) return;
+  if (self->position + 4 > self->capacity) self->isValid = false;
+  else
+  {
+    uint8_t *bytes = &self->data[self->position];
+    bytes[0] = (uint8_t)self->scratch;
+    bytes[1] = (uint8_t)(self->scratch >> 8);
+    bytes[2] = (uint8_t)(self->scratch >> 16);
+    bytes[3] = (uint8_t)(self->scratch >> 24);
+    self->position += 4;
+  }
+  self->scratch >>= 32;
+  self->scratchBitCount -= 32;
+}
+
+//Writes the remaining bits (padded to a full byte).
+//self: A pointer to the packer.
+//Returns the amount of bytes written.
+int BitPacker_flush(BitPacker *self)
+{
+  while (self->scratchBitCount > 0)
+  {
+    if (self->position >= self->capacity) self->isValid = false;
+    else self->data[self->position++] = (uint8_t)self->scratch;
+    self->scratch >>= 8;
+    self->scratchBitCount = MAX(0, self->scratchBitCount - 8);
+  }
+  return self->position;
+}
+
+//Reads a value written with "BitPacker_write".
+//self: A pointer to the packer.
+//bitCount: The amount of bits of the value (up to 32).
+//Returns the value or 0 if the data is too short (see "isValid").
+uint32_t BitPacker_read(BitPacker *self, int bitCount)
+{
+  while (self->scratchBitCount < bitCount)
+  {
+    if (self->position >= self->capacity)
+    {
+      self->isValid = false;
+      return 0;
+    }
+    self->scratch |= (uint64_t)self->data[self->position++] <<
+      self->scratchBitCount;
+    self->scratchBitCount += 8;
+  }
+  uint32_t value = (uint32_t)(self->scratch & ((1ull << bitCount) - 1));
+  self->scratch >>= bitCount;
+  self->scratchBitCount -= bitCount;
+  return value;
+}
+
+//Writes an unsigned value in groups of 4 bits (each with a bit telling
+//whether another group follows), so that small values need few bits.
+void BitPacker_writeVariable(BitPacker *self, uint32_t value)
+{
+  do
+  {
+    BitPacker_write(self, value & 15, 4);
+    value >>= 4;
+    BitPacker_write(self, value != 0, 1);
+  } while (value != 0);
+}
+
+//Reads a value written with "BitPacker_writeVariable".
+uint32_t BitPacker_readVariable(BitPacker *self)
+{
+  uint32_t value = 0;
+  for (int shift = 0; shift < 32 && self->isValid; shift += 4)
+  {
+    value |= BitPacker_read(self, 4) << shift;
+    if (!BitPacker_read(self, 1)) break;
+  }
+  return value;
+}
+
+//Gets the amount of bits needed for the values from 0 to a maximum.
+int Snapshot_getBitCount(uint32_t maximum)
+{
+  int bitCount = 0;
+  while (bitCount < 32 && (maximum >> bitCount) != 0) bitCount++;
+  return bitCount;
+}
+
+//Quantizes an angle (in degrees, in any range) into a fraction of a turn.
+//degrees: The angle.
+//bitCount: The bits of the quantized angle.
+uint16_t Snapshot_quantizeAngle(float degrees, int bitCount)
+{
+  float turns = fmodf(degrees, 360.0f) / 360.0f;
+  if (turns < 0) turns += 1.0f;
+  return (uint16_t)((uint32_t)lroundf(turns * (float)(1 << bitCount)) &
+    ((1u << bitCount) - 1));
+}
+
+//Quantizes the state of a session for a snapshot.
+//entity: A pointer to store the quantized state into.
+//batch: A pointer to the batch of the session.
+//index: The index of the session.
+void SnapshotEntity_quantize(SnapshotEntity *entity, const SessionBatch *batch,
+  int index)
+{
+  //The positions of the fields are their centers, so the map starts half a
+  //field before the origin.
+  float maximumX = mapWidth * SNAPSHOT_POSITION_SCALE;
+  float maximumZ = mapDepth * SNAPSHOT_POSITION_SCALE;
+  float x = (batch->positionsX[index] + 0.5f) * SNAPSHOT_POSITION_SCALE;
+  float z = (batch->positionsZ[index] + 0.5f) * SNAPSHOT_POSITION_SCALE;
+  float y = batch->positionsY[index] * SNAPSHOT_HEIGHT_SCALE;
+
+  entity->x = (uint32_t)lroundf(MAX(0, MIN(x, maximumX)));
+  entity->z = (uint32_t)lroundf(MAX(0, MIN(z, maximumZ)));
+  entity->y = (uint8_t)lroundf(MAX(0, MIN(y, 255.0f)));
+  entity->level = (uint16_t)batch->levels[index];
+  entity->yaw = Snapshot_quantizeAngle(batch->rotationsY[index],
+    SNAPSHOT_YAW_BITS);
+  entity->pitch = (uint8_t)Snapshot_quantizeAngle(batch->rotationsX[index],
+    SNAPSHOT_PITCH_BITS);
+  entity->itemState = batch->itemStates[index];
+  entity->isPresent = 1;
+}
+
+//Gets the position of a quantized player (in world coordinates).
+//entity: A pointer to the quantized state.
+//x, y, z: Pointers to store the position into (where Y is relative to the
+//floor of the level of the player).
+void SnapshotEntity_getPosition(const SnapshotEntity *entity, float *x,
+  float *y, float *z)
+{
+  *x = entity->x / SNAPSHOT_POSITION_SCALE - 0.5f;
+  *y = entity->y / SNAPSHOT_HEIGHT_SCALE;
+  *z = entity->z / SNAPSHOT_POSITION_SCALE - 0.5f;
+}
+
+//Describes the amount of bits of the quantized values, which depend on the
+//size of the map.
+typedef struct
+{
+  int xBits, zBits, levelBits;
+} SnapshotLayout;
+
+//Gets the amount of bits of the quantized values for the current map.
+SnapshotLayout SnapshotLayout_create(void)
+{
+  SnapshotLayout layout;
+  layout.xBits = Snapshot_getBitCount((uint32_t)(mapWidth *
+    SNAPSHOT_POSITION_SCALE));
+  layout.zBits = Snapshot_getBitCount((uint32_t)(mapDepth *
+    SNAPSHOT_POSITION_SCALE));
+  layout.levelBits = Snapshot_getBitCount((uint32_t)(mapLevels - 1));
+  return layout;
+}
+
+//Writes a changed value as delta if it's small enough (or the new value
+//otherwise).
+//packer: A pointer to the packer.
+//value, baseline: The new and the previous value.
+//bitCount: The bits of the complete value.
+//isWrapping: true if the value wraps around at 2^bitCount (like angles).
+void Snapshot_writeChange(BitPacker *packer, uint32_t value,
+  uint32_t baseline, int bitCount, bool isWrapping)
+{
+  int64_t delta = (int64_t)value - (int64_t)baseline;
+  const int64_t limit = 1 << (SNAPSHOT_DELTA_BITS - 1);
+  if (isWrapping && delta >= (1 << (bitCount - 1))) delta -= 1 << bitCount;
+  else if (isWrapping && delta < -(1 << (bitCount - 1)))
+    delta += 1 << bitCount;
+  bool isSmall = delta >= -limit && delta < limit;
+
+  BitPacker_write(packer, isSmall, 1);
+  if (isSmall) BitPacker_write(packer, (uint32_t)(delta + limit),
+    SNAPSHOT_DELTA_BITS);
+  else BitPacker_write(packer, value, bitCount);
+}
+
+//Reads a value written with "Snapshot_writeChange".
+uint32_t Snapshot_readChange(BitPacker *packer, uint32_t baseline,
+  int bitCount, bool isWrapping)
+{
+  const int64_t limit = 1 << (SNAPSHOT_DELTA_BITS - 1);
+  if (!BitPacker_read(packer, 1)) return BitPacker_read(packer, bitCount);
+  uint32_t value = (uint32_t)((int64_t)baseline +
+    (int64_t)BitPacker_read(packer, SNAPSHOT_DELTA_BITS) - limit);
+  return isWrapping ? value & ((1u << bitCount) - 1) : value;
+}
+
+//Writes the change of a player since the baseline: whether the player was
+//removed, or a bit for every changed value followed by the value (or its
+//delta) - or all values if the player is new. Nothing may be written for
+//players which didn't change. Small changes of the position and the
+//rotation are written as delta.
+//packer: A pointer to the packer.
+//layout: A pointer to the bits of the values.
+//entity: A pointer to the current (present or removed) state.
+//baseline: A pointer to the state in the baseline.
+void SnapshotEntity_writeDelta(BitPacker *packer,
+  const SnapshotLayout *layout, const SnapshotEntity *entity,
+  const SnapshotEntity *baseline)
+{
+  if (baseline->isPresent)
+  {
+    BitPacker_write(packer, !entity->isPresent, 1);
+    if (!entity->isPresent) return;
+  }
+
+  bool isNew = !baseline->isPresent;
+  bool isMoved = isNew || entity->x != baseline->x ||
+    entity->z != baseline->z;
+  bool isHeightChanged = isNew || entity->y != baseline->y;
+  bool isLevelChanged = isNew || entity->level != baseline->level;
+  bool isRotated = isNew || entity->yaw != baseline->yaw ||
+    entity->pitch != baseline->pitch;
+  bool isItemChanged = isNew || entity->itemState != baseline->itemState;
+  if (!isNew)
+  {
+    BitPacker_write(packer, isMoved, 1);
+    BitPacker_write(packer, isHeightChanged, 1);
+    BitPacker_write(packer, isLevelChanged, 1);
+    BitPacker_write(packer, isRotated, 1);
+    BitPacker_write(packer, isItemChanged, 1);
+  }
+
+  if (isNew)
+  {
+    BitPacker_write(packer, entity->x, layout->xBits);
+    BitPacker_write(packer, entity->z, layout->zBits);
+  }
+  else if (isMoved)
+  {
+    Snapshot_writeChange(packer, entity->x, baseline->x, layout->xBits,
+      false);
+    Snapshot_writeChange(packer, entity->z, baseline->z, layout->zBits,
+      false);
+  }
+  if (isHeightChanged) BitPacker_write(packer, entity->y, 8);
+  if (isLevelChanged) BitPacker_write(packer, entity->level,
+    layout->levelBits);
+  if (isNew)
+  {
+    BitPacker_write(packer, entity->yaw, SNAPSHOT_YAW_BITS);
+    BitPacker_write(packer, entity->pitch, SNAPSHOT_PITCH_BITS);
+  }
+  else if (isRotated)
+  {
+    Snapshot_writeChange(packer, entity->yaw, baseline->yaw,
+      SNAPSHOT_YAW_BITS, true);
+    Snapshot_writeChange(packer, entity->pitch, baseline->pitch,
+      SNAPSHOT_PITCH_BITS, true);
+  }
+  if (isItemChanged) BitPacker_write(packer, entity->itemState, 2);
+}
+
+//Reads a change written with "SnapshotEntity_writeDelta".
+//packer: A pointer to the packer.
+//layout: A pointer to the bits of the values.
+//entity: A pointer to the state in the baseline, which is changed.
+void SnapshotEntity_readDelta(BitPacker *packer, const SnapshotLayout *layout,
+  SnapshotEntity *entity)
+{
+  bool isNew = !entity->isPresent;
+  if (!isNew && BitPacker_read(packer, 1))
+  {
+    memset(entity, 0, sizeof(SnapshotEntity));
+    return;
+  }
+
+  bool isMoved = true, isHeightChanged = true, isLevelChanged = true;
+  bool isRotated = true, isItemChanged = true;
+  if (!isNew)
+  {
+    isMoved = BitPacker_read(packer, 1) != 0;
+    isHeightChanged = BitPacker_read(packer, 1) != 0;
+    isLevelChanged = BitPacker_read(packer, 1) != 0;
+    isRotated = BitPacker_read(packer, 1) != 0;
+    isItemChanged = BitPacker_read(packer, 1) != 0;
+  }
+
+  if (isNew)
+  {
+    entity->x = BitPacker_read(packer, layout->xBits);
+    entity->z = BitPacker_read(packer, layout->zBits);
+  }
+  else if (isMoved)
+  {
+    entity->x = Snapshot_readChange(packer, entity->x, layout->xBits, false);
+    entity->z = Snapshot_readChange(packer, entity->z, layout->zBits, false);
+  }
+  if (isHeightChanged) entity->y = (uint8_t)BitPacker_read(packer, 8);
+  if (isLevelChanged)
+    entity->level = (uint16_t)BitPacker_read(packer, layout->levelBits);
+  if (isNew)
+  {
+    entity->yaw = (uint16_t)BitPacker_read(packer, SNAPSHOT_YAW_BITS);
+    entity->pitch = (uint8_t)BitPacker_read(packer, SNAPSHOT_PITCH_BITS);
+  }
+  else if (isRotated)
+  {
+    entity->yaw = (uint16_t)Snapshot_readChange(packer, entity->yaw,
+      SNAPSHOT_YAW_BITS, true);
+    entity->pitch = (uint8_t)Snapshot_readChange(packer, entity->pitch,
+      SNAPSHOT_PITCH_BITS, true);
+  }
+  if (isItemChanged) entity->itemState = (uint8_t)BitPacker_read(packer, 2);
+  entity->isPresent = 1;
+}
+
+//Describes a snapshot which is split into parts that fit into a message.
+//Every part contains the amount of changed players and their changes with
+//increasing indicies (see "Snapshot_writeIndex") - and can be applied on
+//its own once the baseline is known.
+typedef struct
+{
+  NetMessage message;
+  BitPacker packer;
+  uint32_t tick, baselineTick;
+  //The position of the part index and of the amount of players in the
+  //message.
+  int partIndex, partIndexPosition, entityCount, previousIndex;
+} SnapshotWriter;
+
+//Writes the index of a changed player as difference to the previous one -
+//a single bit if it follows right after the previous one, as most players
+//change in every tick.
+//packer: A pointer to the packer.
+//index, previousIndex: The index and the previous index (or -1).
+void Snapshot_writeIndex(BitPacker *packer, int index, int previousIndex)
+{
+  BitPacker_write(packer, index == previousIndex + 1, 1);
+  if (index != previousIndex + 1)
+    BitPacker_writeVariable(packer, (uint32_t)(index - previousIndex - 2));
+}
+
+//Reads an index written with "Snapshot_writeIndex".
+int Snapshot_readIndex(BitPacker *packer, int previousIndex)
+{
+  if (BitPacker_read(packer, 1)) return previousIndex + 1;
+  return previousIndex + 2 + (int)BitPacker_readVariable(packer);
+}
+
+//Starts the next part of a snapshot.
+//self: A pointer to the writer (with tick and baseline set).
+void SnapshotWriter_beginPart(SnapshotWriter *self)
+{
+  NetMessage_begin(&self->message, NetSnapshot);
+  NetMessage_writeBytes(&self->message, self->tick, 4);
+  NetMessage_writeBytes(&self->message, self->baselineTick, 4);
+  //The part index (its highest bit marks the last part) and the amount of
+  //players, which are known when the part is finished.
+  self->partIndexPosition = self->message.size;
+  NetMessage_writeBytes(&self->message, 0, 3);
+  BitPacker_initialize(&self->packer, self->message.data + self->message.size,
+    MIN(SNAPSHOT_PART_CAPACITY, NET_MAX_MESSAGE_SIZE - self->message.size));
+  self->entityCount = 0;
+  self->previousIndex = -1;
+}
+
+//Finishes the current part of a snapshot.
+//self: A pointer to the writer.
+//isLast: true if it's the last part.
+void SnapshotWriter_endPart(SnapshotWriter *self, bool isLast)
+{
+  uint8_t *header = &self->message.data[self->partIndexPosition];
+  self->message.size += BitPacker_flush(&self->packer);
+  header[0] = (uint8_t)(self->partIndex | (isLast ? 128 : 0));
+  header[1] = (uint8_t)self->entityCount;
+  header[2] = (uint8_t)(self->entityCount >> 8);
+  self->partIndex++;
+}
+
+//Encodes the snapshot of a tick for one client and passes every finished
+//part to a function, which sends it. Only the players which changed since
+//the baseline are written - and players which aren't relevant to the
+//client are treated as if they weren't present, so only the words of the
+//relevant players (in the snapshot or in the baseline) are visited.
+//layout: A pointer to the bits of the values.
+//entities: The quantized states of all players.
+//relevantBits: One bit for every player which is relevant to the client
+//(see "InterestGrid"), or NULL if all players are relevant.
+//baseline: The states of the players in the baseline, or NULL to send all
+//present players.
+//baselineRelevantBits: The relevant players in the baseline (or NULL).
+//count: The amount of players (present or not).
+//tick, baselineTick: The tick of the snapshot and of the baseline (or 0).
+//send: The function which sends a finished part.
+//data: The argument which is passed to the function.
+//Returns the amount of parts.
+int Snapshot_encode(const SnapshotLayout *layout,
+  const SnapshotEntity *entities, const uint32_t *relevantBits,
+  const SnapshotEntity *baseline, const uint32_t *baselineRelevantBits,
+  int count, uint32_t tick, uint32_t baselineTick,
+  void (*send)(const NetMessage *, void *), void *data)
+{
+  SnapshotWriter writer;
+  SnapshotEntity empty;
+  memset(&empty, 0, sizeof(empty));
+
+  writer.tick = tick;
+  writer.baselineTick = baseline != NULL ? baselineTick : 0;
+  writer.partIndex = 0;
+  SnapshotWriter_beginPart(&writer);
+
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t relevant = relevantBits != NULL ? relevantBits[i / 32] : ~0u;
+    uint32_t baselineRelevant = baseline == NULL ? 0 :
+      baselineRelevantBits != NULL ? baselineRelevantBits[i / 32] : ~0u;
+    if (i % 32 == 0 && (relevant | baselineRelevant) == 0)
+    {
+      i += 31;
+      continue;
+    }
+
+    const SnapshotEntity *current = (relevant >> (i % 32)) & 1 ?
+      &entities[i] : &empty;
+    const SnapshotEntity *previous = (baselineRelevant >> (i % 32)) & 1 ?
+      &baseline[i] : &empty;
+    if (!current->isPresent && !previous->isPresent) continue;
+    if (memcmp(current, previous, sizeof(SnapshotEntity)) == 0) continue;
+
+    if ((writer.packer.position + 4) * 8 + SNAPSHOT_MAX_ENTITY_BITS >
+      writer.packer.capacity * 8)
+    {
+      SnapshotWriter_endPart(&writer, false);
+      send(&writer.message, data);
+      SnapshotWriter_beginPart(&writer);
+    }
+    Snapshot_writeIndex(&writer.packer, i, writer.previousIndex);
+    SnapshotEntity_writeDelta(&writer.packer, layout, current, previous);
+    writer.previousIndex = i;
+    writer.entityCount++;
+  }
+
+  SnapshotWriter_endPart(&writer, true);
+  send(&writer.message, data);
+  return writer.partIndex;
+}
+
+//Contains the snapshots a client received - the newest ones, which can
+//still be used as baseline, and the ones which are still incomplete.
+//Use "SnapshotHistory_initialize" before using an instance.
+typedef struct
+{
+  //SNAPSHOT_HISTORY snapshots of "count" players each (indexed by their
+  //tick), with the tick and the received parts of every snapshot.
+  SnapshotEntity *entities;
+  int count;
+  uint32_t ticks[SNAPSHOT_HISTORY], receivedParts[SNAPSHOT_HISTORY];
+  int lastParts[SNAPSHOT_HISTORY];
+  //The tick of the newest complete snapshot (or 0).
+  uint32_t newestTick;
+  SnapshotLayout layout;
+} SnapshotHistory;
+
+//Initializes a SnapshotHistory instance.
+//self: A pointer to the (uninitialized) history.
+//count: The amount of players in every snapshot - or 0 to only keep track
+//of the complete snapshots without decoding them (for bots in load tests).
+void SnapshotHistory_initialize(SnapshotHistory *self, int count)
+{
+  self->entities = (SnapshotEntity *)Common_allocate(sizeof(SnapshotEntity)
+    * SNAPSHOT_HISTORY * count);
+  self->count = count;
+  memset(self->ticks, 0, sizeof(self->ticks));
+  for (int i = 0; i < SNAPSHOT_HISTORY; i++) self->lastParts[i] = -1;
+  self->newestTick = 0;
+  self->layout = SnapshotLayout_create();
+}
+
+//Releases the resources of a SnapshotHistory instance.
+void SnapshotHistory_destroy(SnapshotHistory *self)
+{
+  free(self->entities);
+  self->entities = NULL;
+  self->count = 0;
+}
+
+//Gets a complete snapshot.
+//self: A pointer to the history.
+//tick: The tick of the snapshot.
+//Returns the players of the snapshot or NULL if it isn't in the history (or
+//incomplete).
+const SnapshotEntity *SnapshotHistory_get(const SnapshotHistory *self,
+  uint32_t tick)
+{
+  int slot = tick % SNAPSHOT_HISTORY;
+  if (tick == 0 || self->ticks[slot] != tick || self->lastParts[slot] < 0 ||
+    self->receivedParts[slot] != (2u << self->lastParts[slot]) - 1)
+    return NULL;
+  return &self->entities[slot * self->count];
+}
+
+//Decodes a received part of a snapshot. Parts of snapshots which are older
+//than the newest complete one, or whose baseline isn't known, are dropped.
+//self: A pointer to the history.
+//message: A pointer to the message, positioned after its type.
+//Returns true if the snapshot of the part is complete now.
+bool SnapshotHistory_receive(SnapshotHistory *self, NetMessage *message)
+{
+  uint32_t tick = NetMessage_readBytes(message, 4);
+  uint32_t baselineTick = NetMessage_readBytes(message, 4);
+  int part = (int)NetMessage_readBytes(message, 1);
+  int entityCount = (int)NetMessage_readBytes(message, 2);
+  int partIndex = part & 127, slot = tick % SNAPSHOT_HISTORY;
+  if (!message->isValid || tick <= self->newestTick || partIndex >= 32)
+    return false;
+
+  SnapshotEntity *entities = &self->entities[slot * self->count];
+  if (self->ticks[slot] != tick)
+  {
+    const SnapshotEntity *baseline = NULL;
+    if (baselineTick != 0 && (baseline = SnapshotHistory_get(self,
+      baselineTick)) == NULL) return false;
+    if (baseline != NULL) memcpy(entities, baseline, sizeof(SnapshotEntity) *
+      self->count);
+    else memset(entities, 0, sizeof(SnapshotEntity) * self->count);
+    self->ticks[slot] = tick;
+    self->receivedParts[slot] = 0;
+    self->lastParts[slot] = -1;
+  }
+  if (self->receivedParts[slot] & (1u << partIndex)) return false;
+
+  if (self->count > 0)
+  {
+    BitPacker packer;
+    BitPacker_initialize(&packer, message->data + message->position,
+      message->size - message->position);
+    int index = -1;
+    for (int i = 0; i < entityCount && packer.isValid; i++)
+    {
+      index = Snapshot_readIndex(&packer, index);
+      if (index >= self->count) break;
+      SnapshotEntity_readDelta(&packer, &self->layout, &entities[index]);
+    }
+    //A broken part leaves the snapshot incomplete forever.
+    if (!packer.isValid || index >= self->count) return false;
+  }
+
+  self->receivedParts[slot] |= 1u << partIndex;
+  if (part & 128) self->lastParts[slot] = partIndex;
+  if (SnapshotHistory_get(self, tick) == NULL) return false;
+  self->newestTick = tick;
+  return true;
+}
+
+//=============================================================================
+// Interest: The players which are replicated to every client of a server.
+//=============================================================================
+
+//The size of the cells of the interest grid (in fields) and the amount of
+//cells around the cell of a player (in every direction) whose players are
+//relevant to it - so every player closer than 6 fields on the same level is
+//replicated, which is further than the view reaches (see "FADE_DISTANCE").
+#define INTEREST_CELL_SIZE 3
+#define INTEREST_RADIUS 2
+#define INTEREST_SPAN (2 * INTEREST_RADIUS + 1)
+//Marks the visible cells of a cell as computed (see "InterestGrid").
+#define INTEREST_VISIBILITY_COMPUTED (1u << 31)
+
+//Defines an enum of the ways a server selects the players which are
+//replicated to a client (see "--interest").
+typedef enum
+{
+  //Every client gets all players.
+  InterestAll,
+  //Every client gets the players in the cells around its own cell.
+  InterestDistance,
+  //Like InterestDistance, but without the cells which can't be seen from
+  //the cell of the client (its potentially visible set).
+  InterestVisibility
+} InterestMode;
+
+//Sorts the players into the cells of a grid over the map and keeps the set
+//of relevant players of every player (one bit per player) up to date. Two
+//players are relevant to each other if their cells are on the same level
+//and at most INTEREST_RADIUS cells apart - and with InterestVisibility, if
+//the center of any field of one cell can be seen from the center of any
+//field of the other one. That's symmetric, so a player which crosses a
+//cell border only changes its own bit in the sets of the players in the
+//cells around its old and its new cell (and their bits in its own set).
+//Use "InterestGrid_initialize" before using an instance.
+typedef struct
+{
+  InterestMode mode;
+  int cellCountX, cellCountZ, cellCount;
+  //The first player in every cell, the next and previous player in the
+  //same cell (or -1) and the cell of every player (or -1).
+  int *cellHeads, *nextPlayers, *previousPlayers, *playerCells;
+  //The cells around every cell which can be seen from it - one bit for
+  //each of the INTEREST_SPAN * INTEREST_SPAN cells around it (row by row),
+  //computed when a player comes close to the cell for the first time.
+  uint32_t *visibleCells;
+  SightGrid sight;
+  //The relevant players of every player ("wordCount" words per player).
+  uint32_t *relevantBits;
+  int capacity, wordCount;
+  //The amount of crossed cell borders and of changed bits so far.
+  uint64_t crossingCount, changeCount;
+} InterestGrid;
+
+//Initializes an InterestGrid instance for the current map, without any
+//players.
+//self: A pointer to the (uninitialized) grid.
+//mode: The way the relevant players are selected (the grid isn't used with
+//InterestAll).
+//capacity: The maximum amount of players.
+void InterestGrid_initialize(InterestGrid *self, InterestMode mode,
+  int capacity)
+{
+  self->mode = mode;
+  self->capacity = capacity;
+  self->wordCount = (capacity + 31) / 32;
+  self->cellCountX = (mapWidth + INTEREST_CELL_SIZE - 1) / INTEREST_CELL_SIZE;
+  self->cellCountZ = (mapDepth + INTEREST_CELL_SIZE - 1) / INTEREST_CELL_SIZE;
+  self->cellCount = self->cellCountX * self->cellCountZ * mapLevels;
+  self->cellHeads = (int *)Common_allocate(sizeof(int) * self->cellCount);
+  self->nextPlayers = (int *)Common_allocate(sizeof(int) * capacity);
+  self->previousPlayers = (int *)Common_allocate(sizeof(int) * capacity);
+  self->playerCells = (int *)Common_allocate(sizeof(int) * capacity);
+  self->visibleCells = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    self->cellCount);
+  self->relevantBits = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    self->wordCount * capacity);
+  self->crossingCount = 0;
+  self->changeCount = 0;
+
+  memset(self->cellHeads, -1, sizeof(int) * self->cellCount);
+  memset(self->playerCells, -1, sizeof(int) * capacity);
+  memset(self->visibleCells, 0, sizeof(uint32_t) * self->cellCount);
+  memset(self->relevantBits, 0, sizeof(uint32_t) * self->wordCount *
+    capacity);
+  if (mode == InterestVisibility)
+    SightGrid_initialize(&self->sight, map, mapWidth, mapDepth, mapLevels);
+  else self->sight.opaqueBits = NULL;
+}
+
+//Releases the resources of an InterestGrid instance.
+//self: A pointer to the grid.
+void InterestGrid_destroy(InterestGrid *self)
+{
+  free(self->cellHeads);
+  free(self->nextPlayers);
+  free(self->previousPlayers);
+  free(self->playerCells);
+  free(self->visibleCells);
+  free(self->relevantBits);
+  if (self->sight.opaqueBits != NULL) SightGrid_destroy(&self->sight);
+  self->capacity = 0;
+}
+
+//Gets the cell of a position.
+//self: A pointer to the grid.
+//x, level, z: The position (positions outside of the map are clamped).
+int InterestGrid_getCell(const InterestGrid *self, float x, int level,
+  float z)
+{
+  int fieldX, fieldZ;
+  Game_getMapFieldIndiciesByPosition(x, z, &fieldX, &fieldZ);
+  fieldX = MAX(0, MIN(fieldX, mapWidth - 1));
+  fieldZ = MAX(0, MIN(fieldZ, mapDepth - 1));
+  level = MAX(0, MIN(level, mapLevels - 1));
+  return (level * self->cellCountX + fieldX / INTEREST_CELL_SIZE) *
+    self->cellCountZ + fieldZ / INTEREST_CELL_SIZE;
+}
+
+//Checks if the center of any walkable field of one cell can be seen from
+//the center of any walkable field of another cell on the same level.
+//self: A pointer to the grid (with the sight grid).
+//cellX, cellZ, otherCellX, otherCellZ, level: The indicies of the cells.
+bool InterestGrid_testCells(const InterestGrid *self, int cellX, int cellZ,
+  int otherCellX, int otherCellZ, int level)
+{
+  SightRay ray;
+  ray.level = level;
+  int endX = MIN((cellX + 1) * INTEREST_CELL_SIZE, mapWidth);
+  int endZ = MIN((cellZ + 1) * INTEREST_CELL_SIZE, mapDepth);
+  int otherEndX = MIN((otherCellX + 1) * INTEREST_CELL_SIZE, mapWidth);
+  int otherEndZ = MIN((otherCellZ + 1) * INTEREST_CELL_SIZE, mapDepth);
+
+  for (ray.fromX = cellX * INTEREST_CELL_SIZE; ray.fromX < endX; ray.fromX++)
+  {
+    for (ray.fromZ = cellZ * INTEREST_CELL_SIZE; ray.fromZ < endZ;
+      ray.fromZ++)
+    {
+      if (SightGrid_isOpaque(&self->sight, (level * mapWidth + ray.fromX) *
+        mapDepth + ray.fromZ)) continue;
+      for (ray.toX = otherCellX * INTEREST_CELL_SIZE; ray.toX < otherEndX;
+        ray.toX++)
+      {
+        for (ray.toZ = otherCellZ * INTEREST_CELL_SIZE; ray.toZ < otherEndZ;
+          ray.toZ++)
+        {
+          if (!SightGrid_isOpaque(&self->sight, (level * mapWidth +
+            ray.toX) * mapDepth + ray.toZ) &&
+            SightGrid_testRay(&self->sight, &ray)) return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+//Checks if the players of two cells are relevant to each other (see
+//"InterestGrid"). Computes the visible cells of the first cell if needed.
+//self: A pointer to the grid.
+//cell, otherCell: The cells (or -1, which isn't relevant to any cell).
+bool InterestGrid_isCellRelevant(InterestGrid *self, int cell, int otherCell)
+{
+  if (cell < 0 || otherCell < 0) return false;
+
+  int levelSize = self->cellCountX * self->cellCountZ;
+  int level = cell / levelSize, otherLevel = otherCell / levelSize;
+  int cellX = cell % levelSize / self->cellCountZ;
+  int cellZ = cell % self->cellCountZ;
+  int offsetX = otherCell % levelSize / self->cellCountZ - cellX;
+  int offsetZ = otherCell % self->cellCountZ - cellZ;
+  if (level != otherLevel || abs(offsetX) > INTEREST_RADIUS ||
+    abs(offsetZ) > INTEREST_RADIUS) return false;
+  if (self->mode != InterestVisibility) return true;
+
+  uint32_t visibleCells = self->visibleCells[cell];
+  if (!(visibleCells & INTEREST_VISIBILITY_COMPUTED))
+  {
+    visibleCells = INTEREST_VISIBILITY_COMPUTED;
+    for (int x = -INTEREST_RADIUS; x <= INTEREST_RADIUS; x++)
+    {
+      for (int z = -INTEREST_RADIUS; z <= INTEREST_RADIUS; z++)
+      {
+        if (cellX + x < 0 || cellX + x >= self->cellCountX ||
+          cellZ + z < 0 || cellZ + z >= self->cellCountZ) continue;
+        if ((x == 0 && z == 0) || InterestGrid_testCells(self, cellX, cellZ,
+          cellX + x, cellZ + z, level)) visibleCells |= 1u <<
+          ((x + INTEREST_RADIUS) * INTEREST_SPAN + z + INTEREST_RADIUS);
+      }
+    }
+    self->visibleCells[cell] = visibleCells;
+  }
+  return (visibleCells >> ((offsetX + INTEREST_RADIUS) * INTEREST_SPAN +
+    offsetZ + INTEREST_RADIUS)) & 1;
+}
+
+//Sets whether two players are relevant to each other.
+//self: A pointer to the grid.
+//player, otherPlayer: The indicies of the players.
+//isRelevant: true if they're relevant to each other.
+void InterestGrid_setRelevant(InterestGrid *self, int player,
+  int otherPlayer, bool isRelevant)
+{
+  uint32_t *bits = &self->relevantBits[player * self->wordCount];
+  uint32_t *otherBits = &self->relevantBits[otherPlayer * self->wordCount];
+  if (isRelevant)
+  {
+    bits[otherPlayer / 32] |= 1u << (otherPlayer % 32);
+    otherBits[player / 32] |= 1u << (player % 32);
+  }
+  else
+  {
+    bits[otherPlayer / 32] &= ~(1u << (otherPlayer % 32));
+    otherBits[player / 32] &= ~(1u << (player % 32));
+  }
+  self->changeCount += 2;
+}
+
+//Updates the relevance between a player which changes its cell and the
+//players in the cells around one of its cells.
+//self: A pointer to the grid.
+//player: The index of the player (which isn't in any cell at the moment).
+//oldCell, newCell: The cell the player leaves and enters (or -1).
+//centerCell: The cell whose surrounding cells are updated.
+//skippedCell: A cell whose surrounding cells were updated already (or -1).
+void InterestGrid_updateCells(InterestGrid *self, int player, int oldCell,
+  int newCell, int centerCell, int skippedCell)
+{
+  int levelSize = self->cellCountX * self->cellCountZ;
+  int level = centerCell / levelSize;
+  int centerX = centerCell % levelSize / self->cellCountZ;
+  int centerZ = centerCell % self->cellCountZ;
+  int skippedX = skippedCell % levelSize / self->cellCountZ;
+  int skippedZ = skippedCell % self->cellCountZ;
+  bool isSkipping = skippedCell >= 0 && skippedCell / levelSize == level;
+
+  for (int x = MAX(0, centerX - INTEREST_RADIUS);
+    x <= MIN(self->cellCountX - 1, centerX + INTEREST_RADIUS); x++)
+  {
+    for (int z = MAX(0, centerZ - INTEREST_RADIUS);
+      z <= MIN(self->cellCountZ - 1, centerZ + INTEREST_RADIUS); z++)
+    {
+      if (isSkipping && abs(x - skippedX) <= INTEREST_RADIUS &&
+        abs(z - skippedZ) <= INTEREST_RADIUS) continue;
+
+      int cell = (level * self->cellCountX + x) * self->cellCountZ + z;
+      bool isRelevant = InterestGrid_isCellRelevant(self, newCell, cell);
+      if (InterestGrid_isCellRelevant(self, oldCell, cell) == isRelevant)
+        continue;
+      for (int other = self->cellHeads[cell]; other >= 0;
+        other = self->nextPlayers[other])
+        InterestGrid_setRelevant(self, player, other, isRelevant);
+    }
+  }
+}
+
+//Moves a player into another cell (or adds or removes it) and updates the
+//relevant players - does nothing if the cell didn't change.
+//self: A pointer to the grid.
+//player: The index of the player.
+//cell: The new cell of the player (see "InterestGrid_getCell") or -1 to
+//remove the player.
+void InterestGrid_move(InterestGrid *self, int player, int cell)
+{
+  int oldCell = self->playerCells[player];
+  if (cell == oldCell || self->mode == InterestAll) return;
+  self->crossingCount++;
+
+  if (oldCell >= 0)
+  {
+    int next = self->nextPlayers[player];
+    int previous = self->previousPlayers[player];
+    if (previous >= 0) self->nextPlayers[previous] = next;
+    else self->cellHeads[oldCell] = next;
+    if (next >= 0) self->previousPlayers[next] = previous;
+    InterestGrid_updateCells(self, player, oldCell, cell, oldCell, -1);
+  }
+  if (cell >= 0)
+  {
+    InterestGrid_updateCells(self, player, oldCell, cell, cell, oldCell);
+    int next = self->cellHeads[cell];
+    self->nextPlayers[player] = next;
+    self->previousPlayers[player] = -1;
+    if (next >= 0) self->previousPlayers[next] = player;
+    self->cellHeads[cell] = player;
+  }
+
+  //Every player is relevant to itself.
+  uint32_t *bits = &self->relevantBits[player * self->wordCount];
+  if (cell >= 0) bits[player / 32] |= 1u << (player % 32);
+  else bits[player / 32] &= ~(1u << (player % 32));
+  self->playerCells[player] = cell;
+}
+
+//Gets the relevant players of a player.
+//self: A pointer to the grid.
+//player: The index of the player.
+//Returns one bit per player (set for the relevant ones) - or NULL with
+//InterestAll, where all players are relevant.
+const uint32_t *InterestGrid_getRelevantBits(const InterestGrid *self,
+  int player)
+{
+  if (self->mode == InterestAll) return NULL;
+  return &self->relevantBits[player * self->wordCount];
+}
+
+//Counts the set bits of a row of words.
+//bits: The words.
+//wordCount: The amount of words.
+int Interest_countBits(const uint32_t *bits, int wordCount)
+{
+  int count = 0;
+  for (int i = 0; i < wordCount; i++)
+    for (uint32_t word = bits[i]; word != 0; word &= word - 1) count++;
+  return count;
+}
+
+//Compares the relevant players of every player with the ones computed from
+//scratch (from the cells of the players).
+//self: A pointer to the grid.
+//Returns true if they're equal.
+bool InterestGrid_check(InterestGrid *self)
+{
+  if (self->mode == InterestAll) return true;
+  for (int i = 0; i < self->capacity; i++)
+  {
+    const uint32_t *bits = &self->relevantBits[i * self->wordCount];
+    for (int j = 0; j < self->capacity; j++)
+    {
+      bool isRelevant = i == j ? self->playerCells[i] >= 0 :
+        InterestGrid_isCellRelevant(self, self->playerCells[i],
+        self->playerCells[j]);
+      if (isRelevant != (bool)((bits[j / 32] >> (j % 32)) & 1)) return false;
+    }
+  }
+  return true;
+}
+
+//=============================================================================
+// Server: Game sessions of many clients, simulated without a window.
+//=============================================================================
+
+//The amount of clients a server accepts.
+#define SERVER_MAX_CLIENTS 1024
+//The amount of inputs of a client which are buffered until they're applied
+//(one per tick). Must be a power of two.
+#define SERVER_INPUT_BUFFER 16
+//The amount of inputs of a client which may still wait after a tick: if
+//more of them arrived (as the messages are delayed differently), a tick
+//applies two of them - so that a small delay absorbs the jitter, but
+//doesn't grow.
+#define SERVER_INPUT_DELAY 2
+//Clients which didn't send anything for this time (in seconds) are removed.
+#define SERVER_CLIENT_TIMEOUT 5.0
+//The interval (in seconds) in which the server prints its statistics.
+#define SERVER_STATISTICS_INTERVAL 10.0
+
+//The tick rate of the server (see "--tick-rate") - by default, it's stepped
+//as often as the game is updated.
+int serverTickRate = 1000 / UPDATE_TIMEOUT_MS;
+//The port of the server (see "--port").
+int serverPort = NET_DEFAULT_PORT;
+//The way the server selects the players replicated to a client (see
+//"--interest").
+InterestMode serverInterestMode = InterestDistance;
+
+//Contains the statistics of a server over a period of time (see
+//"Server_getStatistics").
+typedef struct
+{
+  double seconds;
+  int tickCount, clientCount;
+  //The tick times (in seconds): average, median, 99th percentile, maximum.
+  double averageTickSeconds, medianTickSeconds, percentileTickSeconds;
+  double maximumTickSeconds;
+  //The received and sent bytes per second, the snapshot bytes per client
+  //and second and their share of all players as floats (in percent).
+  double receivedRate, sentRate, snapshotRate, snapshotRatio;
+  //The average amount of players replicated per client.
+  double replicatedCount;
+  //The time per tick needed to encode, to send the snapshots and to update
+  //the relevant players (in seconds).
+  double encodeSeconds, sendSeconds, interestSeconds;
+  int lapCount, missedInputCount, timeoutCount;
+} ServerStatistics;
+
+//Contains the sessions of the clients connected to a server. Every client
+//has a fixed slot (its index), which is sent with every message of the
+//client - so that the server doesn't need to look up the client by its
+//address. The sessions of free slots are marked as finished, so that they
+//aren't stepped.
+//Use "Server_initialize" before using an instance.
+typedef struct
+{
+  UdpSocket socket;
+  SessionBatch sessions;
+  //The input applied to every session in the current tick.
+  SessionInput *inputs;
+  //The sessions of the clients whose next input didn't arrive in time, which
+  //are kept out of the current tick (with the same indicies).
+  SessionBatch waitingSessions;
+  uint8_t *isWaiting;
+  //The address and the time of the last message of every client.
+  NetAddress *addresses;
+  double *receiveTimes;
+  uint8_t *isConnected;
+  //The buffered inputs of every client (SERVER_INPUT_BUFFER per client,
+  //indexed by their sequence number), the sequence number of the newest
+  //received input and of the last applied one.
+  SessionInput *bufferedInputs;
+  uint32_t *receivedSequences, *appliedSequences;
+  //The point every session starts at (and restarts at after finishing).
+  float *spawnsX, *spawnsZ;
+  int *spawnLevels;
+  //The quantized players of the last SNAPSHOT_HISTORY ticks (indexed by
+  //their tick), the relevant players of every client in these ticks (one
+  //row of "interest.wordCount" words per client, unless all players are
+  //relevant) and the newest snapshot every client acknowledged.
+  SnapshotEntity *snapshots;
+  uint32_t *relevantHistory;
+  uint32_t snapshotTicks[SNAPSHOT_HISTORY];
+  uint32_t *acknowledgedTicks;
+  InterestGrid interest;
+  SnapshotLayout snapshotLayout;
+  //false to always send complete snapshots (for comparisons).
+  bool isDeltaEncoding;
+  int capacity, clientCount;
+  //0 to spawn every client at the spawn point of the map - or the size of
+  //the square part of the map (at its origin) in which every client spawns
+  //on a random field from which the quest item can be reached (for load
+  //tests).
+  int spawnAreaSize;
+  float spawnX, spawnZ;
+  uint32_t random;
+  int tickRate;
+  float tickSeconds;
+  uint32_t tick;
+  //The statistics since they were printed the last time: the duration of
+  //every tick (in seconds), the transferred bytes and the events.
+  double *tickDurations;
+  int tickCount, tickCapacity;
+  uint64_t receivedBytes, sentBytes;
+  int lapCount, missedInputCount, timeoutCount;
+  //The bytes of the sent snapshots and of the same players as floats, the
+  //sum of the connected clients of every tick and the time needed to
+  //encode and send the snapshots.
+  uint64_t snapshotBytes, uncompressedSnapshotBytes, clientTickCount;
+  double snapshotSeconds, snapshotSendSeconds;
+  //The sum of the players replicated to every client in every tick and the
+  //time needed to update the relevant players.
+  uint64_t replicatedCount;
+  double interestSeconds;
+  //The statistics printed the last time and the interval in which they're
+  //printed (in seconds, or 0 to print them only when the server stops).
+  ServerStatistics statistics;
+  double statisticsInterval;
+} Server;
+
+//Initializes a Server instance and opens its socket. The map (and the
+//collision grid and the pickups of finite maps) must be initialized.
+//self: A pointer to the (uninitialized) server.
+//host: The address of the interface to listen on (like NET_ANY_HOST).
+//port: The port to listen on (or 0 to use any free port).
+//capacity: The maximum amount of clients.
+//tickRate: The amount of ticks per second.
+//interestMode: The way the players replicated to a client are selected.
+//Terminates the application if the map doesn't contain a spawn point or if
+//the socket couldn't be opened.
+void Server_initialize(Server *self, uint32_t host, uint16_t port,
+  int capacity, int tickRate, InterestMode interestMode)
+{
+  int spawnFieldX, spawnFieldZ;
+  if (!Game_findSpawnPoint(mapWidth, mapDepth, &spawnFieldX, &spawnFieldZ))
+    Common_terminate("SERVER", "The map doesn't contain a spawn point.");
+  Game_getMapFieldPositionByIndicies(spawnFieldX, spawnFieldZ, &self->spawnX,
+    &self->spawnZ);
+
+  UdpSocket_open(&self->socket, host, port);
+  SessionBatch_initialize(&self->sessions, capacity);
+  self->inputs = (SessionInput *)Common_allocate(sizeof(SessionInput) *
+    capacity);
+  SessionBatch_initialize(&self->waitingSessions, capacity);
+  self->isWaiting = (uint8_t *)Common_allocate(capacity);
+  self->addresses = (NetAddress *)Common_allocate(sizeof(NetAddress) *
+    capacity);
+  self->receiveTimes = (double *)Common_allocate(sizeof(double) * capacity);
+  self->isConnected = (uint8_t *)Common_allocate(capacity);
+  self->bufferedInputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * SERVER_INPUT_BUFFER * capacity);
+  self->receivedSequences = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    capacity);
+  self->appliedSequences = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    capacity);
+  self->spawnsX = (float *)Common_allocate(sizeof(float) * capacity);
+  self->spawnsZ = (float *)Common_allocate(sizeof(float) * capacity);
+  self->spawnLevels = (int *)Common_allocate(sizeof(int) * capacity);
+  self->snapshots = (SnapshotEntity *)Common_allocate(sizeof(SnapshotEntity)
+    * SNAPSHOT_HISTORY * capacity);
+  InterestGrid_initialize(&self->interest, interestMode, capacity);
+  self->relevantHistory = interestMode == InterestAll ? NULL :
+    (uint32_t *)Common_allocate(sizeof(uint32_t) * SNAPSHOT_HISTORY *
+    capacity * self->interest.wordCount);
+  memset(self->snapshotTicks, 0, sizeof(self->snapshotTicks));
+  self->acknowledgedTicks = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    capacity);
+  self->snapshotLayout = SnapshotLayout_create();
+  self->isDeltaEncoding = true;
+  self->capacity = capacity;
+  self->clientCount = 0;
+  self->spawnAreaSize = 0;
+  self->random = mapSeed;
+  self->tickRate = tickRate;
+  self->tickSeconds = 1.0f / tickRate;
+  self->tick = 0;
+  self->tickDurations = NULL;
+  self->tickCount = 0;
+  self->tickCapacity = 0;
+  self->receivedBytes = 0;
+  self->sentBytes = 0;
+  self->lapCount = 0;
+  self->missedInputCount = 0;
+  self->timeoutCount = 0;
+  self->snapshotBytes = 0;
+  self->uncompressedSnapshotBytes = 0;
+  self->clientTickCount = 0;
+  self->snapshotSeconds = 0;
+  self->snapshotSendSeconds = 0;
+  self->replicatedCount = 0;
+  self->interestSeconds = 0;
+  memset(&self->statistics, 0, sizeof(ServerStatistics));
+  self->statisticsInterval = SERVER_STATISTICS_INTERVAL;
+
+  memset(self->isConnected, 0, capacity);
+  memset(self->isWaiting, 0, capacity);
+  for (int i = 0; i < capacity; i++) self->sessions.finished[i] = 1;
+}
+
+//Closes the socket of a Server instance and releases its resources.
+//self: A pointer to the server.
+void Server_destroy(Server *self)
+{
+  UdpSocket_close(&self->socket);
+  SessionBatch_destroy(&self->sessions);
+  free(self->inputs);
+  SessionBatch_destroy(&self->waitingSessions);
+  free(self->isWaiting);
+  free(self->addresses);
+  free(self->receiveTimes);
+  free(self->isConnected);
+  free(self->bufferedInputs);
+  free(self->receivedSequences);
+  free(self->appliedSequences);
+  free(self->spawnsX);
+  free(self->spawnsZ);
+  free(self->spawnLevels);
+  free(self->snapshots);
+  free(self->relevantHistory);
+  free(self->acknowledgedTicks);
+  InterestGrid_destroy(&self->interest);
+  free(self->tickDurations);
+  self->capacity = 0;
+  self->clientCount = 0;
+}
+
+//Sends a message to a client and counts the sent bytes.
+//self: A pointer to the server.
+//message: A pointer to the message.
+//to: The address of the client.
+void Server_send(Server *self, const NetMessage *message, NetAddress to)
+{
+  self->sentBytes += NetMessage_send(message, &self->socket, to);
+}
+
+//Accepts a client which wants to connect (again, if the answer got lost)
+//and starts its session - or rejects it if all slots are taken.
+//self: A pointer to the server.
+//from: The address of the client.
+//currentTime: The current time (see "Common_getTimeSeconds").
+void Server_accept(Server *self, NetAddress from, double currentTime)
+{
+  NetMessage message;
+  int index = -1, freeIndex = -1;
+  for (int i = 0; i < self->capacity && index < 0; i++)
+  {
+    if (!self->isConnected[i]) freeIndex = freeIndex < 0 ? i : freeIndex;
+    else if (NetAddress_equals(self->addresses[i], from)) index = i;
+  }
+
+  if (index < 0 && freeIndex < 0)
+  {
+    NetMessage_begin(&message, NetReject);
+    Server_send(self, &message, from);
+    return;
+  }
+  else if (index < 0)
+  {
+    index = freeIndex;
+    self->spawnsX[index] = self->spawnX;
+    self->spawnsZ[index] = self->spawnZ;
+    self->spawnLevels[index] = 0;
+    if (self->spawnAreaSize > 0)
+    {
+      int width = MIN(self->spawnAreaSize, mapWidth);
+      int depth = MIN(self->spawnAreaSize, mapDepth);
+      int field = 0, attempt = 0;
+      do
+      {
+        uint32_t area = Maze_random(&self->random) %
+          (uint32_t)(width * depth * mapLevels);
+        field = ((int)(area / (width * depth)) * mapWidth +
+          (int)(area % (width * depth)) / depth) * mapDepth +
+          (int)(area % depth);
+      }
+      while ((!Analysis_isWalkable(map[field]) ||
+        (itemDistanceField.distances != NULL &&
+        itemDistanceField.distances[field] == NAVIGATION_UNREACHABLE)) &&
+        ++attempt < 1000000);
+      if (attempt < 1000000)
+      {
+        self->spawnsX[index] = (float)((field % (mapWidth * mapDepth)) /
+          mapDepth);
+        self->spawnsZ[index] = (float)(field % mapDepth);
+        self->spawnLevels[index] = field / (mapWidth * mapDepth);
+      }
+    }
+
+    self->addresses[index] = from;
+    self->isConnected[index] = 1;
+    self->receivedSequences[index] = 0;
+    self->appliedSequences[index] = 0;
+    self->acknowledgedTicks[index] = 0;
+    memset(&self->inputs[index], 0, sizeof(SessionInput));
+    SessionBatch_reset(&self->sessions, index, self->spawnsX[index],
+      self->spawnLevels[index], self->spawnsZ[index]);
+    self->clientCount++;
+  }
+  self->receiveTimes[index] = currentTime;
+
+  NetMessage_begin(&message, NetAccept);
+  NetMessage_writeBytes(&message, (uint32_t)index, 2);
+  NetMessage_writeBytes(&message, (uint32_t)self->tickRate, 2);
+  NetMessage_writeBytes(&message, (uint32_t)self->capacity, 2);
+  NetMessage_writeBytes(&message, (uint32_t)mapWidth, 4);
+  NetMessage_writeBytes(&message, (uint32_t)mapDepth, 4);
+  NetMessage_writeBytes(&message, (uint32_t)mapLevels, 2);
+  Server_send(self, &message, from);
+}
+
+//Frees the slot of a client.
+//self: A pointer to the server.
+//index: The index of the client.
+void Server_disconnect(Server *self, int index)
+{
+  InterestGrid_move(&self->interest, index, -1);
+  self->isConnected[index] = 0;
+  self->sessions.finished[index] = 1;
+  self->clientCount--;
+}
+
+//Buffers the inputs of an input message. Inputs which were already applied
+//(or received) are ignored - and if a client is too far ahead, its oldest
+//buffered inputs are skipped. The acknowledged snapshot becomes the
+//baseline of the next snapshots.
+//self: A pointer to the server.
+//index: The index of the client.
+//message: A pointer to the message, positioned after the client index.
+void Server_bufferInputs(Server *self, int index, NetMessage *message)
+{
+  uint32_t acknowledgedTick = NetMessage_readBytes(message, 4);
+  if (acknowledgedTick > self->acknowledgedTicks[index] &&
+    acknowledgedTick <= self->tick)
+    self->acknowledgedTicks[index] = acknowledgedTick;
+
+  uint32_t newestSequence = NetMessage_readBytes(message, 4);
+  int count = (int)NetMessage_readBytes(message, 1);
+  if (count > NET_INPUT_REDUNDANCY || (uint32_t)count > newestSequence)
+    return;
+
+  for (int i = 0; i < count; i++)
+  {
+    SessionInput input;
+    uint32_t sequence = newestSequence - (uint32_t)(count - 1 - i);
+    NetMessage_readInput(message, &input);
+    if (!message->isValid) return;
+    if (sequence <= self->receivedSequences[index]) continue;
+
+    self->bufferedInputs[index * SERVER_INPUT_BUFFER + (sequence &
+      (SERVER_INPUT_BUFFER - 1))] = input;
+    self->receivedSequences[index] = sequence;
+  }
+
+  if (self->receivedSequences[index] - self->appliedSequences[index] >
+    SERVER_INPUT_BUFFER)
+    self->appliedSequences[index] = self->receivedSequences[index] -
+      SERVER_INPUT_BUFFER;
+}
+
+//Handles all pending messages.
+//self: A pointer to the server.
+//currentTime: The current time (see "Common_getTimeSeconds").
+void Server_receive(Server *self, double currentTime)
+{
+  NetMessage message;
+  NetAddress from;
+  NetMessageType type;
+
+  while ((type = NetMessage_receive(&message, &self->socket, &from)) !=
+    NetInvalid)
+  {
+    self->receivedBytes += message.size;
+    if (type == NetConnect)
+    {
+      Server_accept(self, from, currentTime);
+      continue;
+    }
+
+    //Every other message contains the index of the client, which must
+    //belong to the sender.
+    int index = (int)NetMessage_readBytes(&message, 2);
+    if (!message.isValid || index >= self->capacity ||
+      !self->isConnected[index] ||
+      !NetAddress_equals(self->addresses[index], from)) continue;
+    self->receiveTimes[index] = currentTime;
+
+    if (type == NetInput) Server_bufferInputs(self, index, &message);
+    else if (type == NetDisconnect) Server_disconnect(self, index);
+  }
+}
+
+//Describes the client a snapshot is sent to by "Server_sendSnapshotPart".
+typedef struct
+{
+  Server *server;
+  NetAddress address;
+} ServerSnapshotTarget;
+
+//Sends a finished part of a snapshot (for "Snapshot_encode").
+//message: A pointer to the part.
+//data: A pointer to a ServerSnapshotTarget instance.
+void Server_sendSnapshotPart(const NetMessage *message, void *data)
+{
+  ServerSnapshotTarget *target = (ServerSnapshotTarget *)data;
+  double startTime = Common_getTimeSeconds();
+  int size = NetMessage_send(message, &target->server->socket,
+    target->address);
+  target->server->sentBytes += size;
+  target->server->snapshotBytes += size;
+  target->server->snapshotSendSeconds += Common_getTimeSeconds() - startTime;
+}
+
+//Quantizes the players after a tick, updates the relevant players of every
+//client and sends every client a snapshot of them - with the changes since
+//the newest snapshot the client acknowledged, if it's still known.
+//self: A pointer to the server.
+void Server_sendSnapshots(Server *self)
+{
+  double startTime = Common_getTimeSeconds();
+  int slot = self->tick % SNAPSHOT_HISTORY, presentCount = 0;
+  int wordCount = self->interest.wordCount;
+  SnapshotEntity *entities = &self->snapshots[slot * self->capacity];
+  uint32_t *relevantBits = NULL;
+  ServerSnapshotTarget target;
+
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (!self->isConnected[i]) continue;
+    InterestGrid_move(&self->interest, i, InterestGrid_getCell(
+      &self->interest, self->sessions.positionsX[i], self->sessions.levels[i],
+      self->sessions.positionsZ[i]));
+  }
+  if (self->relevantHistory != NULL)
+  {
+    relevantBits = &self->relevantHistory[slot * self->capacity * wordCount];
+    memcpy(relevantBits, self->interest.relevantBits, sizeof(uint32_t) *
+      self->capacity * wordCount);
+  }
+  self->interestSeconds += Common_getTimeSeconds() - startTime;
+
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (self->isConnected[i])
+    {
+      SnapshotEntity_quantize(&entities[i], &self->sessions, i);
+      presentCount++;
+    }
+    else memset(&entities[i], 0, sizeof(SnapshotEntity));
+  }
+  self->snapshotTicks[slot] = self->tick;
+
+  target.server = self;
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (!self->isConnected[i]) continue;
+    uint32_t baselineTick = self->acknowledgedTicks[i];
+    int baselineSlot = baselineTick % SNAPSHOT_HISTORY;
+    const SnapshotEntity *baseline = NULL;
+    const uint32_t *baselineRelevantBits = NULL;
+    if (self->isDeltaEncoding && baselineTick != 0 &&
+      self->tick - baselineTick < SNAPSHOT_HISTORY &&
+      self->snapshotTicks[baselineSlot] == baselineTick)
+    {
+      baseline = &self->snapshots[baselineSlot * self->capacity];
+      if (relevantBits != NULL) baselineRelevantBits = &self->relevantHistory[
+        (baselineSlot * self->capacity + i) * wordCount];
+    }
+
+    const uint32_t *clientBits = NULL;
+    if (relevantBits != NULL)
+    {
+      clientBits = &relevantBits[i * wordCount];
+      self->replicatedCount += Interest_countBits(clientBits, wordCount);
+    }
+    else self->replicatedCount += presentCount;
+
+    target.address = self->addresses[i];
+    Snapshot_encode(&self->snapshotLayout, entities, clientBits, baseline,
+      baselineRelevantBits, self->capacity, self->tick, baselineTick,
+      Server_sendSnapshotPart, &target);
+    //All players as floats: an index, the position, the level, the rotation
+    //and the item state.
+    self->uncompressedSnapshotBytes += (uint64_t)presentCount * 25;
+  }
+
+  self->clientTickCount += presentCount;
+  self->snapshotSeconds += Common_getTimeSeconds() - startTime;
+}
+
+//Runs one tick of the server: handles the received messages, applies the
+//next buffered input of every client (two if too many of them are waiting),
+//steps the sessions and sends every client the state of its session and a
+//snapshot of all players. The session of a client whose next input didn't
+//arrive isn't stepped, so that it only ever depends on the acknowledged
+//inputs (which is what the prediction of the client replays). Finished
+//sessions start again at their spawn point.
+//self: A pointer to the server.
+//pool: The worker pool used to step the sessions (or NULL).
+//currentTime: The current time (see "Common_getTimeSeconds").
+void Server_tick(Server *self, WorkerPool *pool, double currentTime)
+{
+  NetMessage message;
+
+  Server_receive(self, currentTime);
+
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (!self->isConnected[i]) continue;
+    if (currentTime - self->receiveTimes[i] > SERVER_CLIENT_TIMEOUT)
+    {
+      Server_disconnect(self, i);
+      self->timeoutCount++;
+    }
+    else if (self->appliedSequences[i] < self->receivedSequences[i])
+    {
+      self->inputs[i] = self->bufferedInputs[i * SERVER_INPUT_BUFFER +
+        (++self->appliedSequences[i] & (SERVER_INPUT_BUFFER - 1))];
+    }
+    else
+    {
+      //The session waits for the input, it's put back after the step.
+      SessionBatch_copy(&self->waitingSessions, i, &self->sessions, i);
+      self->isWaiting[i] = 1;
+      self->missedInputCount += self->appliedSequences[i] > 0;
+    }
+  }
+
+  SessionBatch_step(&self->sessions, pool, self->inputs, self->tickSeconds);
+  self->tick++;
+
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (self->isWaiting[i])
+    {
+      SessionBatch_copy(&self->sessions, i, &self->waitingSessions, i);
+      self->isWaiting[i] = 0;
+    }
+    else if (self->isConnected[i] && self->receivedSequences[i] -
+      self->appliedSequences[i] > SERVER_INPUT_DELAY)
+    {
+      self->inputs[i] = self->bufferedInputs[i * SERVER_INPUT_BUFFER +
+        (++self->appliedSequences[i] & (SERVER_INPUT_BUFFER - 1))];
+      SessionBatch_stepRange(&self->sessions, i, i + 1, self->inputs,
+        self->tickSeconds);
+    }
+  }
+
+  for (int i = 0; i < self->capacity; i++)
+  {
+    if (!self->isConnected[i]) continue;
+    if (self->sessions.finished[i])
+    {
+      SessionBatch_reset(&self->sessions, i, self->spawnsX[i],
+        self->spawnLevels[i], self->spawnsZ[i]);
+      self->lapCount++;
+    }
+
+    NetMessage_begin(&message, NetState);
+    NetMessage_writeBytes(&message, self->tick, 4);
+    NetMessage_writeBytes(&message, self->appliedSequences[i], 4);
+    NetMessage_writeSession(&message, &self->sessions, i);
+    Server_send(self, &message, self->addresses[i]);
+  }
+
+  Server_sendSnapshots(self);
+}
+
+//Computes the statistics of the server since they were printed the last
+//time (and sorts the tick durations).
+//self: A pointer to the server.
+//seconds: The time since the statistics were printed the last time.
+//statistics: A pointer to the statistics to fill.
+void Server_getStatistics(Server *self, double seconds,
+  ServerStatistics *statistics)
+{
+  double sum = 0;
+  memset(statistics, 0, sizeof(ServerStatistics));
+  if (self->tickCount > 0)
+  {
+    qsort(self->tickDurations, self->tickCount, sizeof(double),
+      Lap_compareSeconds);
+    for (int i = 0; i < self->tickCount; i++) sum += self->tickDurations[i];
+    statistics->averageTickSeconds = sum / self->tickCount;
+    statistics->medianTickSeconds = self->tickDurations[self->tickCount / 2];
+    statistics->percentileTickSeconds =
+      self->tickDurations[(int)(self->tickCount * 0.99)];
+    statistics->maximumTickSeconds = self->tickDurations[self->tickCount - 1];
+  }
+
+  double clientSeconds = MAX(1, self->clientTickCount) * self->tickSeconds;
+  int tickCount = MAX(1, self->tickCount);
+  statistics->seconds = seconds;
+  statistics->tickCount = self->tickCount;
+  statistics->clientCount = self->clientCount;
+  statistics->receivedRate = self->receivedBytes / seconds;
+  statistics->sentRate = self->sentBytes / seconds;
+  statistics->snapshotRate = self->snapshotBytes / clientSeconds;
+  statistics->snapshotRatio = self->snapshotBytes * 100.0 /
+    MAX(1, self->uncompressedSnapshotBytes);
+  statistics->replicatedCount = (double)self->replicatedCount /
+    MAX(1, self->clientTickCount);
+  statistics->encodeSeconds = (self->snapshotSeconds -
+    self->snapshotSendSeconds - self->interestSeconds) / tickCount;
+  statistics->sendSeconds = self->snapshotSendSeconds / tickCount;
+  statistics->interestSeconds = self->interestSeconds / tickCount;
+  statistics->lapCount = self->lapCount;
+  statistics->missedInputCount = self->missedInputCount;
+  statistics->timeoutCount = self->timeoutCount;
+}
+
+//Prints the statistics of the server since they were printed the last time
+//- the tick times (average, median, 99th percentile and maximum), the
+//traffic and the size of the snapshots - and starts the next statistics.
+//self: A pointer to the server.
+//seconds: The time since the statistics were printed the last time.
+void Server_printStatistics(Server *self, double seconds)
+{
+  ServerStatistics *statistics = &self->statistics;
+  Server_getStatistics(self, seconds, statistics);
+
+  printf("Server: tick %u, %d clients - %d ticks, tick time %.3f ms on "
+    "average, %.3f ms median, %.3f ms 99th percentile, %.3f ms at most - "
+    "%.1f KiB/s received, %.1f KiB/s sent - %d laps, %d missed inputs, %d "
+    "timeouts.\n", self->tick, statistics->clientCount,
+    statistics->tickCount, statistics->averageTickSeconds * 1000.0,
+    statistics->medianTickSeconds * 1000.0,
+    statistics->percentileTickSeconds * 1000.0,
+    statistics->maximumTickSeconds * 1000.0,
+    statistics->receivedRate / 1024.0, statistics->sentRate / 1024.0,
+    statistics->lapCount, statistics->missedInputCount,
+    statistics->timeoutCount);
+  printf("Server: snapshots %.2f KiB/s per client (%.1f%% of all players as "
+    "floats, %.1f players replicated per client), %.3f ms per tick to "
+    "encode them (and %.3f ms to send them, %.3f ms to update the relevant "
+    "players).\n", statistics->snapshotRate / 1024.0,
+    statistics->snapshotRatio, statistics->replicatedCount,
+    statistics->encodeSeconds * 1000.0, statistics->sendSeconds * 1000.0,
+    statistics->interestSeconds * 1000.0);
+  fflush(stdout);
+
+  self->tickCount = 0;
+  self->receivedBytes = 0;
+  self->sentBytes = 0;
+  self->lapCount = 0;
+  self->missedInputCount = 0;
+  self->timeoutCount = 0;
+  self->snapshotBytes = 0;
+  self->uncompressedSnapshotBytes = 0;
+  self->clientTickCount = 0;
+  self->snapshotSeconds = 0;
+  self->snapshotSendSeconds = 0;
+  self->replicatedCount = 0;
+  self->interestSeconds = 0;
+}
+
+//Runs the server with its tick rate, measures the time of every tick and
+//prints the statistics regularly (see "Server") and at the end.
+//self: A pointer to the server.
+//pool: The worker pool used to step the sessions (or NULL).
+//seconds: The time to run (or 0 to run until the application is closed).
+void Server_run(Server *self, WorkerPool *pool, double seconds)
+{
+  double startTime = Common_getTimeSeconds();
+  double nextTickTime = startTime, printTime = startTime;
+
+  while (true)
+  {
+    double currentTime = Common_getTimeSeconds();
+    if (seconds > 0 && currentTime - startTime >= seconds) break;
+    if (currentTime < nextTickTime)
+    {
+      Thread_sleep(nextTickTime - currentTime);
+      continue;
+    }
+
+    Server_tick(self, pool, currentTime);
+    double tickEndTime = Common_getTimeSeconds();
+    if (self->tickCount == self->tickCapacity)
+    {
+      int newCapacity = MAX(1024, self->tickCapacity * 2);
+      double *newDurations = (double *)Common_allocate(sizeof(double) *
+        newCapacity);
+      if (self->tickCount > 0) memcpy(newDurations, self->tickDurations,
+        sizeof(double) * self->tickCount);
+      free(self->tickDurations);
+      self->tickDurations = newDurations;
+      self->tickCapacity = newCapacity;
+    }
+    self->tickDurations[self->tickCount++] = tickEndTime - currentTime;
+
+    //A server which can't keep up skips ticks instead of catching up.
+    nextTickTime += self->tickSeconds;
+    if (nextTickTime < tickEndTime) nextTickTime = tickEndTime;
+
+    if (self->statisticsInterval > 0 &&
+      tickEndTime - printTime >= self->statisticsInterval)
+    {
+      Server_printStatistics(self, tickEndTime - printTime);
+      printTime = tickEndTime;
+    }
+  }
+
+  Server_printStatistics(self, MAX(Common_getTimeSeconds() - printTime,
+    0.001));
+}
+
+//=============================================================================
+// Client: The connection of a player (or a bot) to a server.
+//=============================================================================
+
+//Contains the connection to a server, which sends the input of every step
+//and receives the state of the session on the server.
+//Use "NetClient_initialize" before using an instance.
+typedef struct
+{
+  UdpSocket socket;
+  NetAddress serverAddress;
+  //The index of the client on the server (-1 until it was accepted) and
+  //the tick rate of the server.
+  int index, tickRate;
+  bool isRejected;
+  //The sequence number of the last sent input (starting with 1) and the
+  //last NET_INPUT_REDUNDANCY inputs (indexed by their sequence number).
+  uint32_t inputSequence;
+  SessionInput sentInputs[NET_INPUT_REDUNDANCY];
+  //The tick of the newest state received and the sequence number of the
+  //last input the server applied until then.
+  uint32_t tick, acknowledgedSequence;
+  int stateCount;
+  //The received snapshots of all players (allocated once the client was
+  //accepted) and the amount of complete ones - false to only acknowledge
+  //them without decoding the players (for bots in load tests).
+  SnapshotHistory snapshots;
+  int snapshotCount;
+  bool isDecodingSnapshots;
+  //The messages which are delayed on their way to the server and back (see
+  //"NetClient_setDelay").
+  NetDelayQueue sendQueue, receiveQueue;
+  bool isDelaying;
+} NetClient;
+
+//Initializes a NetClient instance and opens its socket.
+//self: A pointer to the (uninitialized) client.
+//serverAddress: The address of the server.
+void NetClient_initialize(NetClient *self, NetAddress serverAddress)
+{
+  UdpSocket_open(&self->socket, NET_ANY_HOST, 0);
+  self->serverAddress = serverAddress;
+  self->index = -1;
+  self->tickRate = 0;
+  self->isRejected = false;
+  self->inputSequence = 0;
+  self->tick = 0;
+  self->acknowledgedSequence = 0;
+  self->stateCount = 0;
+  self->snapshots.entities = NULL;
+  self->snapshotCount = 0;
+  self->isDecodingSnapshots = true;
+  self->isDelaying = false;
+}
+
+//Delays all messages between the client and the server, as if the
+//connection was slow (for tests on the loopback interface).
+//self: A pointer to the client.
+//latency: The round trip time (in seconds).
+//jitter: The maximum additional delay of every message (in seconds).
+//seed: The seed of the random additional delays.
+void NetClient_setDelay(NetClient *self, double latency, double jitter,
+  uint32_t seed)
+{
+  NetDelayQueue_initialize(&self->sendQueue, latency / 2, jitter, seed);
+  NetDelayQueue_initialize(&self->receiveQueue, latency / 2, jitter,
+    seed * 2 + 1);
+  self->isDelaying = true;
+}
+
+//Sends a message to the server (or delays it, see "NetClient_setDelay").
+//self: A pointer to the client.
+//message: A pointer to the message.
+void NetClient_send(NetClient *self, const NetMessage *message)
+{
+  if (self->isDelaying)
+    NetDelayQueue_push(&self->sendQueue, message, Common_getTimeSeconds());
+  else NetMessage_send(message, &self->socket, self->serverAddress);
+}
+
+//Tells the server that the client leaves (if it was accepted) and closes
+//the socket of a NetClient instance.
+//self: A pointer to the client.
+void NetClient_destroy(NetClient *self)
+{
+  NetMessage message;
+  if (self->index >= 0)
+  {
+    NetMessage_begin(&message, NetDisconnect);
+    NetMessage_writeBytes(&message, (uint32_t)self->index, 2);
+    NetMessage_send(&message, &self->socket, self->serverAddress);
+  }
+  UdpSocket_close(&self->socket);
+  if (self->snapshots.entities != NULL)
+    SnapshotHistory_destroy(&self->snapshots);
+  if (self->isDelaying)
+  {
+    NetDelayQueue_destroy(&self->sendQueue);
+    NetDelayQueue_destroy(&self->receiveQueue);
+  }
+  self->index = -1;
+}
+
+//Asks the server to accept the client. Needs to be repeated until the
+//client was accepted, as the messages might get lost.
+//self: A pointer to the client.
+void NetClient_connect(NetClient *self)
+{
+  NetMessage message;
+  NetMessage_begin(&message, NetConnect);
+  NetClient_send(self, &message);
+}
+
+//Handles a message of the server.
+//self: A pointer to the client.
+//message: A pointer to the message, positioned after its type.
+//type: The type of the message.
+//state: A pointer to the batch which receives the state of the session.
+//index: The index of the session in the batch.
+//Returns true if a newer state was received.
+bool NetClient_handle(NetClient *self, NetMessage *message,
+  NetMessageType type, SessionBatch *state, int index)
+{
+  if (type == NetAccept && self->index < 0)
+  {
+    int clientIndex = (int)NetMessage_readBytes(message, 2);
+    int tickRate = (int)NetMessage_readBytes(message, 2);
+    int capacity = (int)NetMessage_readBytes(message, 2);
+    int width = (int)NetMessage_readBytes(message, 4);
+    int depth = (int)NetMessage_readBytes(message, 4);
+    int levels = (int)NetMessage_readBytes(message, 2);
+    if (!message->isValid) return false;
+    if (width != mapWidth || depth != mapDepth || levels != mapLevels)
+      Common_terminate("NETWORK", "The server uses a different map.");
+    self->index = clientIndex;
+    self->tickRate = tickRate;
+    SnapshotHistory_initialize(&self->snapshots,
+      self->isDecodingSnapshots ? capacity : 0);
+  }
+  else if (type == NetReject) self->isRejected = true;
+  else if (type == NetState && self->index >= 0)
+  {
+    uint32_t tick = NetMessage_readBytes(message, 4);
+    uint32_t acknowledgedSequence = NetMessage_readBytes(message, 4);
+    //Older states (which arrived out of order) are dropped.
+    if (!message->isValid || tick <= self->tick) return false;
+    NetMessage_readSession(message, state, index);
+    if (!message->isValid) return false;
+    self->tick = tick;
+    self->acknowledgedSequence = acknowledgedSequence;
+    self->stateCount++;
+    return true;
+  }
+  else if (type == NetSnapshot && self->index >= 0 &&
+    SnapshotHistory_receive(&self->snapshots, message))
+    self->snapshotCount++;
+  return false;
+}
+
+//Handles all pending messages of the server (and sends the delayed
+//messages which are due, see "NetClient_setDelay").
+//self: A pointer to the client.
+//state: A pointer to the batch which receives the state of the session.
+//index: The index of the session in the batch.
+//Returns true if a newer state was received.
+bool NetClient_receive(NetClient *self, SessionBatch *state, int index)
+{
+  NetMessage message;
+  NetAddress from;
+  NetMessageType type;
+  bool isUpdated = false;
+  double currentTime = self->isDelaying ? Common_getTimeSeconds() : 0;
+
+  if (self->isDelaying)
+  {
+    while (NetDelayQueue_pop(&self->sendQueue, &message, currentTime))
+      NetMessage_send(&message, &self->socket, self->serverAddress);
+  }
+
+  while ((type = NetMessage_receive(&message, &self->socket, &from)) !=
+    NetInvalid)
+  {
+    if (!NetAddress_equals(from, self->serverAddress)) continue;
+    if (self->isDelaying)
+      NetDelayQueue_push(&self->receiveQueue, &message, currentTime);
+    else isUpdated |= NetClient_handle(self, &message, type, state, index);
+  }
+
+  if (self->isDelaying)
+  {
+    while (NetDelayQueue_pop(&self->receiveQueue, &message, currentTime))
+    {
+      type = NetMessage_open(&message, message.size);
+      isUpdated |= NetClient_handle(self, &message, type, state, index);
+    }
+  }
+  return isUpdated;
+}
+
+//Sends the input of the next step to the server (together with the recent
+//inputs, see "NET_INPUT_REDUNDANCY") and acknowledges the newest complete
+//snapshot. Does nothing until the client was accepted.
+//self: A pointer to the client.
+//input: A pointer to the input.
+void NetClient_sendInput(NetClient *self, const SessionInput *input)
+{
+  NetMessage message;
+  if (self->index < 0) return;
+
+  self->inputSequence++;
+  self->sentInputs[self->inputSequence % NET_INPUT_REDUNDANCY] = *input;
+  uint32_t count = MIN(self->inputSequence, NET_INPUT_REDUNDANCY);
+
+  NetMessage_begin(&message, NetInput);
+  NetMessage_writeBytes(&message, (uint32_t)self->index, 2);
+  NetMessage_writeBytes(&message, self->snapshots.newestTick, 4);
+  NetMessage_writeBytes(&message, self->inputSequence, 4);
+  NetMessage_writeBytes(&message, count, 1);
+  for (uint32_t sequence = self->inputSequence - count + 1;
+    sequence <= self->inputSequence; sequence++)
+    NetMessage_writeInput(&message,
+      &self->sentInputs[sequence % NET_INPUT_REDUNDANCY]);
+  NetClient_send(self, &message);
+}
+
+//=============================================================================
+// Prediction: The session of a client, stepped ahead of the server.
+//=============================================================================
+
+//The amount of inputs a client keeps until the server applied them (about
+//two seconds with the default tick rate). Must be a power of two.
+#define PREDICTION_INPUTS 64
+//Position errors bigger than this (in units) are corrected at once instead
+//of smoothly.
+#define PREDICTION_SNAP_DISTANCE 1.0f
+//The rate (per second) at which the remaining position error of a
+//correction decays.
+#define PREDICTION_CORRECTION_RATE 10.0f
+
+//Contains the session of a client as predicted by the client: every input
+//is applied right away, with the same step function the server (and the
+//game) uses - instead of waiting a round trip for the state of the server.
+//The inputs are kept until the server applied them: when a state of the
+//server arrives, the session is set to it and the inputs the server didn't
+//apply yet are applied again (reconciliation). If the player ends up
+//somewhere else than predicted before, the difference becomes an offset of
+//the shown position, which decays smoothly.
+//Use "Prediction_initialize" before using an instance.
+typedef struct
+{
+  //A batch with the predicted session.
+  SessionBatch session;
+  //The recent inputs (indexed by their sequence number), the sequence
+  //number of the newest one and the duration of a step on the server.
+  SessionInput inputs[PREDICTION_INPUTS];
+  uint32_t sequence;
+  float deltaSeconds;
+  //false until the first state of the server was received.
+  bool isStarted;
+  //The offset of the shown position of the player to the predicted one.
+  float offsetX, offsetY, offsetZ;
+  //The amount of states, of corrected predictions and of predictions which
+  //were corrected at once.
+  int reconcileCount, correctionCount, snapCount;
+} Prediction;
+
+//Initializes a Prediction instance.
+//self: A pointer to the (uninitialized) prediction.
+//tickRate: The tick rate of the server.
+void Prediction_initialize(Prediction *self, int tickRate)
+{
+  SessionBatch_initialize(&self->session, 1);
+  self->sequence = 0;
+  self->deltaSeconds = 1.0f / tickRate;
+  self->isStarted = false;
+  self->offsetX = 0;
+  self->offsetY = 0;
+  self->offsetZ = 0;
+  self->reconcileCount = 0;
+  self->correctionCount = 0;
+  self->snapCount = 0;
+}
+
+//Releases the resources of a Prediction instance.
+//self: A pointer to the prediction.
+void Prediction_destroy(Prediction *self)
+{
+  SessionBatch_destroy(&self->session);
+}
+
+//Applies the input of the next step to the predicted session right away
+//(once the first state of the server was received) and lets the offset of
+//the last correction decay. The mouse movement is clamped like the server
+//does (see "NetMessage_readInput"), so that both apply the same input.
+//self: A pointer to the prediction.
+//sequence: The sequence number of the input (see "NetClient_sendInput").
+//input: A pointer to the input.
+void Prediction_step(Prediction *self, uint32_t sequence,
+  const SessionInput *input)
+{
+  SessionInput *appliedInput =
+    &self->inputs[sequence & (PREDICTION_INPUTS - 1)];
+  *appliedInput = *input;
+  appliedInput->mouseX = MAX(-NET_MAX_MOUSE_MOVEMENT,
+    MIN(NET_MAX_MOUSE_MOVEMENT, input->mouseX));
+  appliedInput->mouseY = MAX(-NET_MAX_MOUSE_MOVEMENT,
+    MIN(NET_MAX_MOUSE_MOVEMENT, input->mouseY));
+  self->sequence = sequence;
+  if (self->isStarted) SessionBatch_stepRange(&self->session, 0, 1,
+    appliedInput, self->deltaSeconds);
+
+  float decay = expf(-PREDICTION_CORRECTION_RATE * self->deltaSeconds);
+  self->offsetX *= decay;
+  self->offsetY *= decay;
+  self->offsetZ *= decay;
+}
+
+//Sets the predicted session to a state of the server and applies the
+//inputs the server didn't apply until then again. A different result than
+//predicted before is shown smoothly - unless it's too far away (or on
+//another level).
+//self: A pointer to the prediction.
+//state: A pointer to the batch with the state of the server.
+//index: The index of the session in the batch.
+//acknowledgedSequence: The sequence number of the last input the server
+//applied to the state.
+//Returns the distance between the position predicted before and after the
+//state arrived (the prediction error).
+float Prediction_reconcile(Prediction *self, const SessionBatch *state,
+  int index, uint32_t acknowledgedSequence)
+{
+  float x = self->session.positionsX[0], y = self->session.positionsY[0];
+  float z = self->session.positionsZ[0];
+  int level = self->session.levels[0];
+  bool wasStarted = self->isStarted;
+
+  SessionBatch_copy(&self->session, 0, state, index);
+  self->isStarted = true;
+  //Inputs which are too old aren't known anymore, so the prediction starts
+  //at the state again.
+  if (self->sequence - acknowledgedSequence < PREDICTION_INPUTS)
+  {
+    for (uint32_t sequence = acknowledgedSequence + 1;
+      sequence <= self->sequence; sequence++)
+      SessionBatch_stepRange(&self->session, 0, 1,
+        &self->inputs[sequence & (PREDICTION_INPUTS - 1)],
+        self->deltaSeconds);
+  }
+  if (!wasStarted) return 0;
+
+  float errorX = x - self->session.positionsX[0];
+  float errorY = y - self->session.positionsY[0];
+  float errorZ = z - self->session.positionsZ[0];
+  float error = sqrtf(errorX * errorX + errorY * errorY + errorZ * errorZ);
+  self->reconcileCount++;
+  if (error == 0 && level == self->session.levels[0]) return 0;
+
+  //The shown position stays where it was, and moves to the corrected one
+  //while the offset decays.
+  self->correctionCount++;
+  self->offsetX += errorX;
+  self->offsetY += errorY;
+  self->offsetZ += errorZ;
+  if (level != self->session.levels[0] || self->offsetX * self->offsetX +
+    self->offsetY * self->offsetY + self->offsetZ * self->offsetZ >
+    PREDICTION_SNAP_DISTANCE * PREDICTION_SNAP_DISTANCE)
+  {
+    self->offsetX = 0;
+    self->offsetY = 0;
+    self->offsetZ = 0;
+    self->snapCount++;
+  }
+  return error;
+}
+
+//Gets the position the player is shown at: the predicted one plus the
+//offset of the last corrections.
+//self: A pointer to the prediction.
+//x, y, z: Pointers to store the position into (where Y is relative to the
+//floor of the level of the player).
+void Prediction_getPosition(const Prediction *self, float *x, float *y,
+  float *z)
+{
+  *x = self->session.positionsX[0] + self->offsetX;
+  *y = self->session.positionsY[0] + self->offsetY;
+  *z = self->session.positionsZ[0] + self->offsetZ;
+}
+
+//The address of the server the game is played on (see "--connect") - a
+//port of 0 plays the game without a server.
+NetAddress connectAddress = { 0, 0 };
+//The connection of the player to the server, the predicted session and the
+//newest state of the session on the server.
+NetClient playerClient;
+Prediction playerPrediction;
+SessionBatch playerServerState;
+
+//Connects the game to the server given with "--connect" and waits until
+//the player was accepted.
+//Terminates the application if the server is full or doesn't answer.
+void Game_connect(void)
+{
+  printf("Connecting to the server...\n");
+  NetClient_initialize(&playerClient, connectAddress);
+  SessionBatch_initialize(&playerServerState, 1);
+
+  double startTime = Common_getTimeSeconds();
+  while (playerClient.index < 0)
+  {
+    if (playerClient.isRejected) Common_terminate("NETWORK",
+      "The server doesn't accept any more players.");
+    if (Common_getTimeSeconds() - startTime > SERVER_CLIENT_TIMEOUT)
+      Common_terminate("NETWORK", "The server doesn't answer.");
+    NetClient_connect(&playerClient);
+    Thread_sleep(0.1);
+    NetClient_receive(&playerClient, &playerServerState, 0);
+  }
+
+  Prediction_initialize(&playerPrediction, playerClient.tickRate);
+  printf("Connected as player %d, the server runs with %d ticks per "
+    "second.\n", playerClient.index, playerClient.tickRate);
+}
+
+//=============================================================================
+// Game logic: Event handlers.
+//=============================================================================
+
+//Ocurrs when the game is loaded, after the window was opened the first time.
+//Terminates the application when the function is called more than once or when
+//the map definition is invalid.
+void Game_onLoad(void)
+{
+  printf("\n");
+
+  if (isLoaded) Common_terminate("LOADING",
+    "The load function was called more than once.");
+
+  Mutex_initialize(&simulationMutex);
+  Mutex_initialize(&inputMutex);
+  SessionBatch_initialize(&playerSession, 1);
+  RenderQueue_initialize(&renderQueue, renderMode, endlessMode ? 0 : npcCount);
+
+  printf("Initializing OpenGL context and shaders...\n");
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_CULL_FACE);
+  shaderProgram = ShaderProgram_createDefault(true);
+
+  printf("Loading game assets...\n");
+
+  //Unless a maze was generated, the built-in (single level) map is used.
+  if (map == NULL)
+  {
+    if (LENGTHOF(defaultMap) != (defaultMapWidth * defaultMapDepth))
+      Common_terminate("LOADING",
+        "The map size doesn't match with the actual data size.");
+    map = defaultMap;
+    mapWidth = defaultMapWidth;
+    mapDepth = defaultMapDepth;
+    mapLevels = 1;
+  }
+
+  World_initialize();
+
+  //Finite maps are analyzed completely before the game starts, so that maps
+  //which can't be completed are rejected right away.
+  if (!endlessMode)
+  {
+    MapAnalysis analysis = Analysis_analyzeMap(map, mapWidth, mapDepth,
+      mapLevels, &workerPool);
+    Analysis_print(&analysis);
+    if (!Analysis_isValid(&analysis)) Common_terminate("LOADING",
+      "The map can't be completed - see the map analysis above.");
+
+    Navigation_initialize();
+    Collision_initialize();
+    Npc_initialize(mapSeed);
+    Pickup_initialize();
+  }
+
+  //In the endless mode, the spawn point is always in the chunk at the origin,
+  //which needs to be loaded before it can be searched.
+  int spawnSearchWidth = mapWidth, spawnSearchDepth = mapDepth;
+  if (endlessMode)
+  {
+    printf("Generating endless maze with seed %u...\n", mapSeed);
+    World_update(0, 0, 0, true);
+    spawnSearchWidth = CHUNK_SIZE;
+    spawnSearchDepth = CHUNK_SIZE;
+  }
+
+  int spawnX = 0, spawnZ = 0;
+  bool spawnPointFound = Game_findSpawnPoint(spawnSearchWidth,
+    spawnSearchDepth, &spawnX, &spawnZ);
+
+  Game_getMapFieldPositionByIndicies(spawnX, spawnZ, &playerX, &playerZ);
+  lapStartX = playerX;
+  lapStartZ = playerZ;
+  Autopilot_reset(&playerAutopilot);
+
+  if (!spawnPointFound) Common_terminate("LOADING",
+    "The map doesn't contain a player spawn point.");
+
+  skyboxMesh = BufferedMesh_create(
+    skyboxMeshData, LENGTHOF(skyboxMeshData), shaderProgram);
+  wallMesh = BufferedMesh_create(
+    wallMeshData, LENGTHOF(wallMeshData), shaderProgram);
+  floorMesh = BufferedMesh_create(
+    floorMeshData, LENGTHOF(floorMeshData), shaderProgram);
+  archMesh = BufferedMesh_create(
+    archMeshData, LENGTHOF(archMeshData), shaderProgram);
+  crystalMesh = BufferedMesh_create(
+    crystalMeshData, LENGTHOF(crystalMeshData), shaderProgram);
+  tubeMesh = BufferedMesh_create(
+    tubeMeshData, LENGTHOF(tubeMeshData), shaderProgram);
+
+  World_update(playerX, playerLevel, playerZ, true);
+  if (connectAddress.port != 0) Game_connect();
+
+  gameStartTime = Common_getTimeSeconds();
+  lastUpdateTime = gameStartTime;
+  isLoaded = true;
+
+  printf("Application initialized successfully!\n");
+}
+
+//Ocurrs when the game is destroyed.
+void Game_onDestroy()
+{
+  if (isLoaded)
+  {
+    printf("Unloading game resources and closing application...\n");
+
+    //The simulation thread accesses most of the resources released below.
+    Mutex_lock(&simulationMutex);
+    isSimulationStopping = true;
+    Mutex_unlock(&simulationMutex);
+    RenderQueue_shutdown(&renderQueue);
+    if (useSimulationThread) Thread_join(&simulationThread);
+    RenderQueue_printStatistics(&renderQueue);
+
+    BufferedMesh_destroy(&skyboxMesh);
+    BufferedMesh_destroy(&wallMesh);
+    BufferedMesh_destroy(&floorMesh);
+    BufferedMesh_destroy(&archMesh);
+    BufferedMesh_destroy(&crystalMesh);
+    BufferedMesh_destroy(&tubeMesh);
+    World_destroy();
+    Navigation_destroy();
+    Collision_destroy();
+    Npc_destroy();
+    Pickup_destroy();
+    if (map != defaultMap) free(map);
+    map = NULL;
+
+    ShaderProgram_destroy(&shaderProgram);
+    RenderQueue_destroy(&renderQueue);
+    Mutex_destroy(&simulationMutex);
+    Mutex_destroy(&inputMutex);
+    SessionBatch_destroy(&playerSession);
+    Lap_destroy();
+    if (connectAddress.port != 0)
+    {
+      NetClient_destroy(&playerClient);
+      Prediction_destroy(&playerPrediction);
+      SessionBatch_destroy(&playerServerState);
+    }
+
+    isLoaded = false;
+    glutLeaveMainLoop();
+    printf("Application terminated successfully!\n\n");
+  }
+}
+
+//Sets the projection of the shader programs.
+//aspect: The aspect ratio (width / height) of the viewport.
+//screenHeight: The height of the viewport (in pixels).
+void Game_setProjection(float aspect, float screenHeight)
+{
+  const Matrix4x4 projection =
+    Matrix4x4_createPerspective(aspect, 0.001f, 200, 70);
+
+  ShaderProgram_setUniformValue_Matrix4x4(
+    shaderProgram.uniformLocation_projection, &projection);
+  ShaderProgram_setUniformValue_float(
+    shaderProgram.uniformLocation_screenHeight, screenHeight);
+  if (instancedShaderProgram.handle != 0)
+  {
+    glUseProgram(instancedShaderProgram.handle);
+    ShaderProgram_setUniformValue_Matrix4x4(
+      instancedShaderProgram.uniformLocation_projection, &projection);
+    ShaderProgram_setUniformValue_float(
+      instancedShaderProgram.uniformLocation_screenHeight, screenHeight);
+    glUseProgram(shaderProgram.handle);
+  }
+}
+
+//Ocurrs when the game window is resized.
+void Game_onResize(int newWidth, int newHeight)
+{
+  glViewport(0, 0, newWidth, newHeight);
+  Game_setProjection((float)newWidth / newHeight, (float)newHeight);
+  currentWindowWidth = newWidth;
+  currentWindowHeight = newHeight;
+}
+
+//Ocurrs after the player has pressed a key on the keyboard.
+void Game_onKeyboardDown(unsigned char key, int mouseX, int mouseY)
+{
+  mouseX; mouseY;
+
+  //The input can't be accessed anymore after the game was destroyed.
+  if (!isLoaded) return;
+  else if (key == 27)
+  {
+    Game_onDestroy();
+    return;
+  }
+
+  Mutex_lock(&inputMutex);
+  switch (key)
+  {
+    case 'w': inputForward = true; break;
+    case 's': inputBackwards = true; break;
+    case 'a': inputLeft = true; break;
+    case 'd': inputRight = true; break;
+    case ' ': inputJump = true; break;
+    case 'e': inputAction = true; break;
+  }
+  Mutex_unlock(&inputMutex);
+}
+
+//Ocurrs after the player has released a key on the keyboard.
+void Game_onKeyboardUp(unsigned char key, int mouseX, int mouseY)
+{
+  mouseX; mouseY;
+
+  if (!isLoaded) return;
+
+  Mutex_lock(&inputMutex);
+  switch (key)
+  {
+    case 'w': inputForward = false; break;
+    case 's': inputBackwards = false; break;
+    case 'a': inputLeft = false; break;
+    case 'd': inputRight = false; break;
+    case ' ': inputJump = false; break;
+    case 'e': inputAction = false; break;
+  }
+  Mutex_unlock(&inputMutex);
+}
+
+//Ocurrs after the player has moved the mouse.
+void Game_onMouseMove(int mouseX, int mouseY)
+{
+  currentMouseX = (float)mouseX;
+  currentMouseY = (float)mouseY;
+}
+
+//Records everything which is needed to draw the current state of the game
+//into a render packet. The map is only accessed here, so that drawing the
+//packet doesn't depend on the simulation anymore.
+//packet: A pointer to the (empty) packet.
+void Game_recordFrame(RenderPacket *packet)
+{
+  //The player position relative to the floor of the first level.
+  const float playerWorldY = playerLevel * LEVEL_HEIGHT + playerY;
+
+  packet->view = Matrix4x4_createCamera(playerX, playerWorldY + 0.5f, playerZ,
+    playerRotationY, playerRotationX);
+  packet->viewerX = playerX;
+  packet->viewerY = playerWorldY;
+  packet->viewerZ = playerZ;
+  packet->viewerLevel = playerLevel;
+  packet->currentTimeMs = currentTimeMs;
+  packet->brightness = gameBrightness;
+
+  //First, draw the skybox (the gradient around the game field).
+  RenderPacket_addCommand(packet, RenderDrawMesh, &skyboxMesh, NULL, 0);
+
+  //Calculate the rotation transformation of the quest item, which is used
+  //in different parts of the drawing function.
+  const Matrix4x4 meshRotationTransformation =
+    Matrix4x4_createRotationY(itemRotationY);
+
+  //Everything else is faded out when it's too far away from the player (by
+  //the shader). This both looks nice and makes things a bit more efficient,
+  //as chunks which are faded out completely aren't drawn at all.
+  //If the quest item is currently "held" (it was picked up by the player),
+  //it will be drawn right at the player position - with backface culling and
+  //a little translation downwards, only the rotation rings are visible to the
+  //player, giving us a "blessed by the gem" kind of look.
+  if (itemState == Held)
+  {
+    const Matrix4x4 meshHoverTranslationTransformation =
+      Matrix4x4_createTranslation(playerX, playerWorldY - 0.2f, playerZ);
+    const Matrix4x4 meshTransformation = Matrix4x4_multiply(
+      &meshHoverTranslationTransformation, &meshRotationTransformation);
+    RenderPacket_addCommand(packet, RenderDrawMesh, &crystalMesh,
+      &meshTransformation, FADE_DISTANCE);
+  }
+
+  //The static geometry (floors, walls, arches and the goal) is baked into the
+  //chunk meshes, which are already in world coordinates. Only the level of
+  //the player (and the levels visible through nearby lift shafts) is drawn.
+  RenderPacket_addCommand(packet, RenderDrawWorld, NULL, NULL, FADE_DISTANCE);
+  if (npcPopulation.count > 0)
+  {
+    packet->instanceCount = NpcPopulation_getInstances(&npcPopulation,
+      playerX, playerLevel, playerZ, FADE_DISTANCE + 1.0f, packet->instances,
+      packet->instanceCapacity);
+    RenderPacket_addCommand(packet, RenderDrawNpcs, NULL, NULL,
+      FADE_DISTANCE);
+  }
+
+  //Only the animated quest items remain, which can only be visible when they
+  //are close to the player (and on the same level).
+  int playerFieldX, playerFieldZ;
+  Game_getMapFieldIndiciesByPosition(playerX, playerZ,
+    &playerFieldX, &playerFieldZ);
+  const int visibleRange = (int)ceilf(FADE_DISTANCE) + 1;
+
+  for (int x = playerFieldX - visibleRange;
+    x <= playerFieldX + visibleRange; x++)
+  {
+    for (int z = playerFieldZ - visibleRange;
+      z <= playerFieldZ + visibleRange; z++)
+    {
+      if (!endlessMode && (x < 0 || x >= mapWidth || z < 0 || z >= mapDepth))
+        continue;
+
+      //The quest item is either drawn at its initial position or - if the
+      //player dropped the quest item at the target - right above the goal...
+      //levitating and rotating in its glory.
+      Field currentField = Game_getMapFieldByIndicies(x, playerLevel, z);
+      if ((currentField == Item && itemState == Initial) ||
+        (currentField == Goal && itemState == Dropped))
+      {
+        float fieldX, fieldZ;
+        Game_getMapFieldPositionByIndicies(x, z, &fieldX, &fieldZ);
+
+        //As the item rotates, the transformation matrix is a combination of
+        //the translation based on the field position and the rotation
+        //calculated above already.
+        const Matrix4x4 meshTranslationTransformation =
+          Matrix4x4_createTranslation(fieldX, playerLevel * LEVEL_HEIGHT,
+            fieldZ);
+        const Matrix4x4 meshTransformation = Matrix4x4_multiply(
+          &meshTranslationTransformation, &meshRotationTransformation);
+        RenderPacket_addCommand(packet, RenderDrawMesh, &crystalMesh,
+          &meshTransformation, FADE_DISTANCE);
+      }
+    }
+  }
+}
+
+//Draws a render packet with the default shader program.
+//packet: A pointer to the packet.
+void Game_drawPacket(const RenderPacket *packet)
+{
+  //Initialize the shader uniforms for this drawing call.
+  ShaderProgram_setUniformValue_float(
+    shaderProgram.uniformLocation_currentTimeMs, packet->currentTimeMs);
+  ShaderProgram_setUniformValue_float(
+    shaderProgram.uniformLocation_brightness, packet->brightness);
+  ShaderProgram_setUniformValue_vec3(
+    shaderProgram.uniformLocation_viewerPosition, packet->viewerX,
+    packet->viewerY, packet->viewerZ);
+  ShaderProgram_setUniformValue_Matrix4x4(shaderProgram.uniformLocation_view,
+    &packet->view);
+  ShaderProgram_setUniformValue_float(
+    shaderProgram.uniformLocation_opacity, 1);
+
+  for (int i = 0; i < packet->commandCount; i++)
+  {
+    const RenderCommand *command = &packet->commands[i];
+    ShaderProgram_setUniformValue_float(
+      shaderProgram.uniformLocation_fadeDistance, command->fadeDistance);
+    ShaderProgram_setUniformValue_Matrix4x4(
+      shaderProgram.uniformLocation_model, &command->model);
+
+    switch (command->type)
+    {
+      case RenderDrawMesh: BufferedMesh_draw(command->mesh); break;
+      case RenderDrawWorld:
+        World_draw(packet->viewerX, packet->viewerLevel, packet->viewerZ);
+        break;
+      case RenderDrawNpcs: Npc_draw(packet); break;
+    }
+  }
+}
+
+//Ocurrs after a "Game_onUpdate" or when GLUT thinks that a redraw is required.
+//Draws the most recent render packet (see "RenderQueue_acquire").
+void Game_onRedraw(void)
+{
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  const RenderPacket *packet = NULL;
+  if (isLoaded) packet = RenderQueue_acquire(&renderQueue);
+  if (packet != NULL) Game_drawPacket(packet);
+
+  glutSwapBuffers();
+  if (packet != NULL) Lap_recordFrame();
+
+  if (packet != NULL) RenderQueue_present(&renderQueue, packet);
+}
+
+//Copies the player variables into a session.
+//session: A pointer to the batch of the session.
+//index: The index of the session.
+void Game_storePlayer(SessionBatch *session, int index)
+{
+  session->positionsX[index] = playerX;
+  session->positionsY[index] = playerY;
+  session->positionsZ[index] = playerZ;
+  session->levels[index] = playerLevel;
+  session->accerlationsX[index] = playerAccerlationX;
+  session->accerlationsY[index] = playerAccerlationY;
+  session->accerlationsZ[index] = playerAccerlationZ;
+  session->rotationsX[index] = playerRotationX;
+  session->rotationsY[index] = playerRotationY;
+  session->rotationAccerlationsX[index] = playerRotationAccerlationX;
+  session->rotationAccerlationsY[index] = playerRotationAccerlationY;
+  session->brightnesses[index] = gameBrightness;
+  session->itemStates[index] = (uint8_t)itemState;
+  session->previousActions[index] = previousInputAction;
+}
+
+//Copies a session into the player variables (which are drawn).
+//session: A pointer to the batch of the session.
+//index: The index of the session.
+void Game_loadPlayer(const SessionBatch *session, int index)
+{
+  playerX = session->positionsX[index];
+  playerY = session->positionsY[index];
+  playerZ = session->positionsZ[index];
+  playerLevel = session->levels[index];
+  playerAccerlationX = session->accerlationsX[index];
+  playerAccerlationY = session->accerlationsY[index];
+  playerAccerlationZ = session->accerlationsZ[index];
+  playerRotationX = session->rotationsX[index];
+  playerRotationY = session->rotationsY[index];
+  playerRotationAccerlationX = session->rotationAccerlationsX[index];
+  playerRotationAccerlationY = session->rotationAccerlationsY[index];
+  gameBrightness = session->brightnesses[index];
+  itemState = (ItemState)session->itemStates[index];
+  previousInputAction = session->previousActions[index] != 0;
+}
+
+//Starts the next lap (see "--restart"): the player starts at the spawn point
+//again, with the quest item at its initial position.
+//Must only be called while "simulationMutex" is locked.
+//isFinished: false if the last lap was aborted.
+//currentTime: The current time (see "Common_getTimeSeconds").
+void Game_restartLap(bool isFinished, double currentTime)
+{
+  lastLapSeconds = currentTime - gameStartTime;
+  wasLastLapFinished = isFinished;
+  lapCount++;
+
+  SessionBatch_reset(&playerSession, 0, lapStartX, 0, lapStartZ);
+  Game_loadPlayer(&playerSession, 0);
+  Autopilot_reset(&playerAutopilot);
+  gameStartTime = currentTime;
+}
+
+//Lets the autopilot press the buttons and move the mouse for the next
+//update, like a player would (which overrides the actual input).
+//deltaSeconds: The duration of the next update.
+void Game_steerAutopilot(float deltaSeconds)
+{
+  SessionInput input;
+  Game_storePlayer(&playerSession, 0);
+  Autopilot_steer(&playerAutopilot, &playerSession, 0, deltaSeconds, &input);
+
+  Mutex_lock(&inputMutex);
+  inputForward = (input.buttons & SessionForward) != 0;
+  inputBackwards = (input.buttons & SessionBackwards) != 0;
+  inputLeft = (input.buttons & SessionLeft) != 0;
+  inputRight = (input.buttons & SessionRight) != 0;
+  inputJump = (input.buttons & SessionJump) != 0;
+  inputAction = (input.buttons & SessionAction) != 0;
+  inputMouseX = input.mouseX;
+  inputMouseY = input.mouseY;
+  Mutex_unlock(&inputMutex);
+}
+
+//Plays the session of the player on the server (see "--connect"): sends
+//the input of the update, predicts the session with it and reconciles the
+//prediction with the newest state of the server. The player is shown at the
+//predicted position (see "Prediction") - every update is a step of the
+//server.
+//Must only be called while "simulationMutex" is locked.
+//input: A pointer to the input of the update.
+void Game_stepOnServer(const SessionInput *input)
+{
+  if (NetClient_receive(&playerClient, &playerServerState, 0))
+    Prediction_reconcile(&playerPrediction, &playerServerState, 0,
+      playerClient.acknowledgedSequence);
+  NetClient_sendInput(&playerClient, input);
+  Prediction_step(&playerPrediction, playerClient.inputSequence, input);
+
+  Game_loadPlayer(&playerPrediction.session, 0);
+  Prediction_getPosition(&playerPrediction, &playerX, &playerY, &playerZ);
+}
+
+//Updates the player, the maze dwellers and the quest item by the time since
+//the last update. Doesn't call any GL or GLUT functions, so that it can run
+//on the simulation thread. The player is stepped like every other game
+//session (see "SessionBatch_stepRange").
+//Must only be called while "simulationMutex" is locked.
+void Game_updateSimulation(void)
+{
+  double currentUpdateTime = Common_getTimeSeconds();
+  float deltaSeconds = (float)(currentUpdateTime - lastUpdateTime);
+  currentTimeMs = (float)fmod((currentUpdateTime - gameStartTime) * 1000.0,
+    1000.0);
+  lastUpdateTime = currentUpdateTime;
+  if (autopilotMode) Game_steerAutopilot(deltaSeconds);
+
+  //The input is copied, so that it doesn't change during the update.
+  SessionInput input;
+  Mutex_lock(&inputMutex);
+  input.buttons = (uint8_t)((inputForward ? SessionForward : 0) |
+    (inputBackwards ? SessionBackwards : 0) | (inputLeft ? SessionLeft : 0) |
+    (inputRight ? SessionRight : 0) | (inputJump ? SessionJump : 0) |
+    (inputAction ? SessionAction : 0));
+  input.mouseX = inputMouseX;
+  input.mouseY = inputMouseY;
+  inputMouseX = 0;
+  inputMouseY = 0;
+  Mutex_unlock(&inputMutex);
+
+  itemRotationY += deltaSeconds * ITEM_ROTATION_SPEED;
+
+  //On a server, finished sessions are started again by the server.
+  if (connectAddress.port != 0)
+  {
+    Game_stepOnServer(&input);
+    return;
+  }
+
+  Game_storePlayer(&playerSession, 0);
+  SessionBatch_stepRange(&playerSession, 0, 1, &input, deltaSeconds);
+  Game_loadPlayer(&playerSession, 0);
+
+  if (playerSession.finished[0])
+  {
+    printf("You finished the game in %.2f seconds. Well done!\n",
+      currentUpdateTime - gameStartTime);
+    if (!restartMode)
+    {
+      isGameFinished = true;
+      return;
+    }
+    Game_restartLap(true, currentUpdateTime);
+  }
+  else if (autopilotMode && Autopilot_isStuck(&playerAutopilot))
+  {
+    printf("The autopilot got stuck at %.1f/%.1f on level %d.\n", playerX,
+      playerZ, playerLevel);
+    Game_restartLap(false, currentUpdateTime);
+  }
+
+  //The maze dwellers are updated after the player, so that they chase the
+  //current position of the player.
+  if (npcPopulation.count > 0)
+    NpcPopulation_updateAll(&npcPopulation, &workerPool, deltaSeconds,
+      playerX, playerLevel, playerZ);
+}
+
+//The width and height of the views rendered with "--render-views".
+#define VIEW_SIZE 84
+//The amount of frames rendered with "--render-views".
+#define VIEW_FRAME_COUNT 200
+
+//Sums up the brightness (the average of the color channels) of all pixels of
+//the views in a view atlas.
+//atlas: A pointer to the atlas.
+//pixels: The pixels of the atlas (see "ViewAtlas_map").
+int64_t Game_sumViewBrightness(const ViewAtlas *atlas, const uint8_t *pixels)
+{
+  int64_t sum = 0;
+  for (int view = 0; view < atlas->viewCount; view++)
+  {
+    int originX = (view % atlas->columnCount) * atlas->viewSize;
+    int originY = (view / atlas->columnCount) * atlas->viewSize;
+    for (int y = originY; y < originY + atlas->viewSize; y++)
+    {
+      const uint8_t *row = pixels + ((size_t)y * atlas->width + originX) * 4;
+      for (int x = 0; x < atlas->viewSize; x++)
+        sum += (row[x * 4] + row[x * 4 + 1] + row[x * 4 + 2]) / 3;
+    }
+  }
+  return sum;
+}
+
+//Renders the first-person views of bots instead of playing (see
+//"--render-views"). In every frame, the sessions of the bots are stepped and
+//all of their views are drawn into one view atlas - with the same chunk
+//meshes, only the uniforms change between the views. The atlas is read back
+//asynchronously and only mapped when its copy is finished. Prints how many
+//views were rendered per second.
+//viewCount: The amount of bots (and views).
+void Game_renderViews(int viewCount)
+{
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+  SessionBatch bots;
+  ViewAtlas atlas;
+  RenderPacket packet;
+  uint32_t random = mapSeed != 0 ? mapSeed : 1;
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * viewCount);
+  double drawSeconds = 0, mapSeconds = 0;
+  int64_t brightnessSum = 0;
+  int mappedCount = 0;
+
+  //The bots start at the spawn point of the player, but look into different
+  //directions (and the views aren't faded in).
+  SessionBatch_initialize(&bots, viewCount);
+  for (int i = 0; i < viewCount; i++)
+  {
+    SessionBatch_reset(&bots, i, playerX, playerLevel, playerZ);
+    bots.rotationsY[i] = i * 360.0f / viewCount;
+    bots.brightnesses[i] = 1;
+  }
+  memset(inputs, 0, sizeof(SessionInput) * viewCount);
+  packet.instanceCapacity = npcPopulation.count;
+  packet.instances = (float *)Common_allocate(sizeof(float) * 4 *
+    MAX(1, npcPopulation.count));
+
+  ViewAtlas_initialize(&atlas, viewCount, VIEW_SIZE);
+  Game_setProjection(1.0f, VIEW_SIZE);
+  Game_storePlayer(&playerSession, 0);
+
+  double startTime = Common_getTimeSeconds();
+  for (int frame = 0; frame < VIEW_FRAME_COUNT; frame++)
+  {
+    Session_changeInputsRandomly(inputs, viewCount, &random);
+    SessionBatch_step(&bots, &workerPool, inputs, deltaSeconds);
+
+    double drawStartTime = Common_getTimeSeconds();
+    ViewAtlas_begin(&atlas);
+    for (int i = 0; i < viewCount; i++)
+    {
+      Game_loadPlayer(&bots, i);
+      packet.commandCount = 0;
+      Game_recordFrame(&packet);
+      ViewAtlas_selectView(&atlas, i);
+      Game_drawPacket(&packet);
+    }
+    ViewAtlas_end(&atlas);
+    double mapStartTime = Common_getTimeSeconds();
+    drawSeconds += mapStartTime - drawStartTime;
+
+    //Only the last frames are waited for - otherwise, the finished copies
+    //are used while the next frames are drawn.
+    const uint8_t *pixels;
+    while ((pixels = ViewAtlas_map(&atlas, frame == VIEW_FRAME_COUNT - 1))
+      != NULL)
+    {
+      brightnessSum += Game_sumViewBrightness(&atlas, pixels);
+      mappedCount++;
+      ViewAtlas_unmap(&atlas);
+    }
+    mapSeconds += Common_getTimeSeconds() - mapStartTime;
+  }
+  double seconds = Common_getTimeSeconds() - startTime;
+
+  printf("Views: %d views of %dx%d pixels in a %dx%d atlas, %d frames in "
+    "%.3f s - %.0f views per second.\n", viewCount, VIEW_SIZE, VIEW_SIZE,
+    atlas.width, atlas.height, VIEW_FRAME_COUNT, seconds,
+    (double)viewCount * VIEW_FRAME_COUNT / seconds);
+  printf("Drawing: %.3f ms per frame, readback: %.3f ms per frame (%d frames "
+    "mapped, %u dropped), average brightness %.1f%%.\n",
+    drawSeconds * 1000.0 / VIEW_FRAME_COUNT,
+    mapSeconds * 1000.0 / VIEW_FRAME_COUNT, mappedCount, atlas.droppedCount,
+    mappedCount > 0 ? brightnessSum * 100.0 / (255.0 * mappedCount *
+    viewCount * VIEW_SIZE * VIEW_SIZE) : 0.0);
+
+  Game_loadPlayer(&playerSession, 0);
+  ViewAtlas_destroy(&atlas);
+  SessionBatch_destroy(&bots);
+  free(packet.instances);
+  free(inputs);
+}
+
+//Runs one update of the simulation and publishes a render packet of the new
+//state (see "Game_recordFrame").
+void Game_runSimulationStep(void)
+{
+  RenderPacket *packet = RenderQueue_beginRecording(&renderQueue);
+  if (packet == NULL) return;
+
+  Mutex_lock(&simulationMutex);
+  if (!isGameFinished) Game_updateSimulation();
+  Game_recordFrame(packet);
+  simulationUpdateCount++;
+  Mutex_unlock(&simulationMutex);
+
+  RenderQueue_publish(&renderQueue, packet);
+}
+
+//The main loop of the simulation thread, which updates the simulation every
+//UPDATE_TIMEOUT_MS until the game is finished or destroyed.
+//unused: Unused.
+void Game_runSimulation(void *unused)
+{
+  unused;
+  double nextUpdateTime = Common_getTimeSeconds();
+
+  while (true)
+  {
+    Mutex_lock(&simulationMutex);
+    bool isStopping = isGameFinished || isSimulationStopping;
+    Mutex_unlock(&simulationMutex);
+    if (isStopping) break;
+
+    Game_runSimulationStep();
+
+    //Late updates aren't caught up on, as every update uses the actual time
+    //since the last update anyway.
+    nextUpdateTime += UPDATE_TIMEOUT_MS / 1000.0;
+    double currentTime = Common_getTimeSeconds();
+    if (nextUpdateTime > currentTime)
+      Thread_sleep(nextUpdateTime - currentTime);
+    else nextUpdateTime = currentTime;
+  }
+}
+
+//Adds the mouse movement since the last call to the input of the simulation
+//and moves the mouse back to the center of the window.
+void Game_captureMouse(void)
+{
+  //The autopilot moves the mouse on its own (and leaves the cursor alone).
+  if (autopilotMode) return;
+
+  float capturedMouseX = currentWindowWidth / 2.0f;
+  float capturedMouseY = currentWindowHeight / 2.0f;
+
+  Mutex_lock(&inputMutex);
+  inputMouseX += capturedMouseX - currentMouseX;
+  inputMouseY += capturedMouseY - currentMouseY;
+  Mutex_unlock(&inputMutex);
+
+  glutSetCursor(GLUT_CURSOR_NONE);
+  glutWarpPointer((int)capturedMouseX, (int)capturedMouseY);
+  //The motion event of the warp might arrive after the next call, which
+  //would count the same movement twice otherwise.
+  currentMouseX = capturedMouseX;
+  currentMouseY = capturedMouseY;
+}
+
+//Ocurrs after the configured update timer event fires.
+//Also re-registers the update event timer after invocation.
+//The simulation either runs right here or on its own thread - either way, the
+//world (which calls GL functions for its chunk meshes) is updated here after
+//every update of the simulation, and a redraw is requested whenever a new 
+//render packet was published.
+void Game_onUpdate(int uselessValue)
+{
+  uselessValue;
+
+  //The game might have been destroyed while this update was already queued.
+  if (!isLoaded) return;
+
+  if (!useSimulationThread)
+  {
+    Game_captureMouse();
+    Game_runSimulationStep();
+  }
+
+  //The simulation reads the world, so it's paused while the world changes.
+  Mutex_lock(&simulationMutex);
+  bool isFinished = isGameFinished;
+  bool wasSimulationUpdated = simulationUpdateCount != worldUpdateCount;
+  bool isLapEnded = lapCount != printedLapCount;
+  int lap = lapCount;
+  double lapSeconds = lastLapSeconds;
+  bool isLapFinished = wasLastLapFinished;
+  if (!isFinished && wasSimulationUpdated)
+  {
+    World_update(playerX, playerLevel, playerZ, false);
+    worldUpdateCount = simulationUpdateCount;
+  }
+  Mutex_unlock(&simulationMutex);
+
+  //Only the last lap is printed if several laps ended since the last update
+  //(which only happens if the laps are very short).
+  if (isLapEnded)
+  {
+    Lap_print(lap, lapSeconds, isLapFinished);
+    printedLapCount = lap;
+  }
+
+  if (isFinished)
+  {
+    Game_onDestroy();
+    return;
+  }
+
+  if (useSimulationThread && wasSimulationUpdated) Game_captureMouse();
+  if (RenderQueue_hasPacket(&renderQueue)) glutPostRedisplay();
+
+  //I wonder what that mandatory value should really be used for...
+  glutTimerFunc(useSimulationThread ? RENDER_POLL_TIMEOUT_MS :
+    UPDATE_TIMEOUT_MS, Game_onUpdate, 42);
+}
+
+//=============================================================================
+// Benchmarks: Headless performance measurements (see the "--benchmark" option).
+//=============================================================================
+
+//The size of the maze generated for benchmarks (unless "--maze" is used).
+#define BENCHMARK_MAZE_SIZE 1024
+//The minimum time (in seconds) a measured loop is repeated for.
+#define BENCHMARK_MIN_SECONDS 0.25
+
+//The hash of the fixed-point sessions after the reference run of the
+//lockstep benchmark (see "Benchmark_lockstep"), which depends on the
+//built-in map.
+#if defined(BORING_MODE)
+#define BENCHMARK_LOCKSTEP_HASH 0x6BAFF9E8BDACFA70ull
+#else
+#define BENCHMARK_LOCKSTEP_HASH 0xBCFBDD8274EF3E9Full
+#endif
+
+//The most bots of the load benchmark (see "--bots").
+int loadTestBotCount = SERVER_MAX_CLIENTS;
+//The path of the file the load benchmark writes its results into as CSV
+//(see "--csv", or NULL).
+const char *loadTestCsvPath = NULL;
+
+//Measures the compression ratio of the chunks of the map and the encode and
+//decode throughput (in fields, stored in one byte each, per second).
+//pool: The worker pool (unused).
+void Benchmark_chunkCodec(WorkerPool *pool)
+{
+  pool;
+
+  int chunkCountX = (mapWidth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  int chunkCountZ = (mapDepth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  int chunkCount = chunkCountX * chunkCountZ * mapLevels;
+  uint8_t *encoded = (uint8_t *)Common_allocate(
+    (size_t)chunkCount * CHUNK_ENCODED_MAX_SIZE);
+  int *encodedSizes = (int *)Common_allocate(sizeof(int) * chunkCount);
+  Field *chunkFields = (Field *)Common_allocate(
+    sizeof(Field) * CHUNK_FIELD_COUNT * (size_t)chunkCount);
+  size_t compressedBytes = 0;
+  int compressedChunkCount = 0;
+
+  for (int i = 0; i < chunkCount; i++)
+    MapFile_getChunkFields(map, mapWidth, mapDepth,
+      (i % (chunkCountX * chunkCountZ)) / chunkCountZ,
+      i / (chunkCountX * chunkCountZ), i % chunkCountZ,
+      chunkFields + (size_t)i * CHUNK_FIELD_COUNT);
+
+  double startTime = Common_getTimeSeconds();
+  for (int i = 0; i < chunkCount; i++)
+  {
+    encodedSizes[i] = MapFile_encodeChunk(
+      chunkFields + (size_t)i * CHUNK_FIELD_COUNT, true,
+      encoded + (size_t)i * CHUNK_ENCODED_MAX_SIZE);
+    compressedBytes += encodedSizes[i] + 1;
+    if (encoded[(size_t)i * CHUNK_ENCODED_MAX_SIZE] ==
+      ChunkEncodingCompressed) compressedChunkCount++;
+  }
+  double encodeSeconds = Common_getTimeSeconds() - startTime;
+
+  //Decode all chunks repeatedly (and check them once).
+  Field decodedFields[CHUNK_FIELD_COUNT];
+  int decodedChunkCount = 0;
+  startTime = Common_getTimeSeconds();
+  do
+  {
+    for (int i = 0; i < chunkCount; i++)
+    {
+      if (!MapFile_decodeChunk(encoded + (size_t)i * CHUNK_ENCODED_MAX_SIZE,
+        encodedSizes[i], decodedFields) || (decodedChunkCount < chunkCount &&
+        memcmp(decodedFields, chunkFields + (size_t)i * CHUNK_FIELD_COUNT,
+          sizeof(decodedFields)) != 0))
+        Common_terminate("BENCHMARK", "A chunk wasn't decoded correctly.");
+      decodedChunkCount++;
+    }
+  } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+  double decodeSeconds = Common_getTimeSeconds() - startTime;
+
+  size_t rawBytes = (size_t)chunkCount * (CHUNK_ENCODED_MAX_SIZE + 1);
+  double fieldMegabytes = (double)chunkCount * CHUNK_FIELD_COUNT / 1000000.0;
+  printf("Chunk codec: %d chunks, %d of them compressed.\n", chunkCount,
+    compressedChunkCount);
+  printf("Size: %.1f KiB with 4-bit fields, %.1f KiB compressed "
+    "(ratio %.2f:1, %.2f:1 compared to one byte per field).\n",
+    rawBytes / 1024.0, compressedBytes / 1024.0,
+    (double)rawBytes / compressedBytes,
+    (double)chunkCount * CHUNK_FIELD_COUNT / compressedBytes);
+  printf("Encoding: %.1f MB/s (%.3f us per chunk).\n",
+    fieldMegabytes / encodeSeconds, encodeSeconds * 1000000.0 / chunkCount);
+  printf("Decoding: %.1f MB/s (%.3f us per chunk).\n",
+    fieldMegabytes * decodedChunkCount / chunkCount / decodeSeconds,
+    decodeSeconds * 1000000.0 / decodedChunkCount);
+
+  free(encoded);
+  free(encodedSizes);
+  free(chunkFields);
+}
+
+//The path of the map file written by the lift shaft test.
+#define BENCHMARK_LIFT_SHAFT_FILE "lift-shafts.map"
+
+//Checks that the validation of map files follows the lifts like the game
+//does: a map with three levels (one row of fields each), where the quest
+//item and the goal are on the lowest level and the player starts on the
+//middle one, is saved into a map file and loaded again. With a lift shaft
+//over the two lower levels, the map must be valid - with the shaft
+//continuing to the top level, the lift on the middle level only goes up
+//and the map must be rejected. The map of the options isn't used.
+//pool: The worker pool which decodes and analyzes the map files.
+void Benchmark_liftShafts(WorkerPool *pool)
+{
+  Field fields[] =
+  {
+    Wall, Wall, Wall, Wall, Wall,
+    Wall, Goal, Lift, Item, Wall,
+    Wall, Wall, Wall, Wall, Wall,
+
+    Wall, Wall, Wall, Wall, Wall,
+    Wall, Init, Lift, Tile, Wall,
+    Wall, Wall, Wall, Wall, Wall,
+
+    Wall, Wall, Wall, Wall, Wall,
+    Wall, Tile, Tile, Tile, Wall,
+    Wall, Wall, Wall, Wall, Wall
+  };
+  const int width = 3, depth = 5, levels = 3;
+  const char *shaftNames[] = { "two levels", "three levels" };
+
+  for (int shaft = 0; shaft < (int)LENGTHOF(shaftNames); shaft++)
+  {
+    int fileWidth, fileDepth, fileLevels;
+    fields[(2 * width + 1) * depth + 2] = shaft == 0 ? Tile : Lift;
+    MapFile_save(BENCHMARK_LIFT_SHAFT_FILE, fields, width, depth, levels,
+      true);
+    Field *fileFields = MapFile_load(BENCHMARK_LIFT_SHAFT_FILE, &fileWidth,
+      &fileDepth, &fileLevels, pool);
+    remove(BENCHMARK_LIFT_SHAFT_FILE);
+
+    MapAnalysis analysis = Analysis_analyzeMap(fileFields, fileWidth,
+      fileDepth, fileLevels, pool);
+    printf("Lift shaft over %s: ", shaftNames[shaft]);
+    Analysis_print(&analysis);
+    free(fileFields);
+    if (Analysis_isValid(&analysis) != (shaft == 0))
+      Common_terminate("BENCHMARK", shaft == 0 ?
+        "A map with a lift shaft over two levels was rejected." :
+        "A map with a lift which only goes up was accepted.");
+  }
+}
+
+//Measures how long calculating a distance field takes, how fast next step
+//queries are and how much cheaper incremental updates are than calculating
+//the distance field again. Also checks the results against each other.
+//pool: The worker pool (unused).
+void Benchmark_distanceField(WorkerPool *pool)
+{
+  pool;
+
+  const int fieldCount = mapWidth * mapDepth * mapLevels;
+  const int sampleCount = 4096, changeCount = 1000;
+  DistanceField itemField, checkField;
+  uint32_t random = 1;
+
+  double startTime = Common_getTimeSeconds();
+  DistanceField_initialize(&itemField, Item, map, mapWidth, mapDepth,
+    mapLevels);
+  double buildSeconds = Common_getTimeSeconds() - startTime;
+
+  //Follow the paths of random fields to the next quest item and check their
+  //length, which also collects the fields for measuring single queries.
+  int *samples = (int *)Common_allocate(sizeof(int) * sampleCount);
+  int sampleFound = 0;
+  for (int attempt = 0; sampleFound < sampleCount &&
+    attempt < sampleCount * 100; attempt++)
+  {
+    int index = (int)(Maze_random(&random) % fieldCount);
+    uint32_t distance = itemField.distances[index];
+    if (distance == 0 || distance == NAVIGATION_UNREACHABLE) continue;
+    samples[sampleFound++] = index;
+
+    int levelSize = mapWidth * mapDepth;
+    int x = (index % levelSize) / mapDepth, level = index / levelSize;
+    int z = index % mapDepth;
+    uint32_t steps = 0;
+    while (DistanceField_getNextStep(&itemField, x, level, z, &x, &level, &z))
+      steps++;
+    if (steps != distance || map[(level * mapWidth + x) * mapDepth + z] != Item)
+      Common_terminate("BENCHMARK", "A path doesn't lead to a quest item.");
+  }
+  if (sampleFound == 0)
+    Common_terminate("BENCHMARK", "The map doesn't contain quest items.");
+
+  long long queryCount = 0;
+  int nextX, nextLevel, nextZ;
+  unsigned int checksum = 0;
+  startTime = Common_getTimeSeconds();
+  do
+  {
+    for (int i = 0; i < sampleFound; i++)
+    {
+      int index = samples[i], levelSize = mapWidth * mapDepth;
+      if (DistanceField_getNextStep(&itemField,
+        (index % levelSize) / mapDepth, index / levelSize, index % mapDepth,
+        &nextX, &nextLevel, &nextZ)) checksum += nextX;
+    }
+    queryCount += sampleFound;
+  } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+  double querySeconds = Common_getTimeSeconds() - startTime;
+
+  //Toggle random fields between walls and floor tiles (never at the border).
+  startTime = Common_getTimeSeconds();
+  for (int i = 0; i < changeCount; i++)
+  {
+    int x = 1 + (int)(Maze_random(&random) % (mapWidth - 2));
+    int z = 1 + (int)(Maze_random(&random) % (mapDepth - 2));
+    int level = (int)(Maze_random(&random) % mapLevels);
+    Field *field = &map[((size_t)level * mapWidth + x) * mapDepth + z];
+    if (*field != Tile && *field != Wall) continue;
+    *field = *field == Tile ? Wall : Tile;
+    DistanceField_onFieldChanged(&itemField, x, level, z);
+  }
+  double updateSeconds = Common_getTimeSeconds() - startTime;
+
+  DistanceField_initialize(&checkField, Item, map, mapWidth, mapDepth,
+    mapLevels);
+  if (memcmp(itemField.distances, checkField.distances,
+    sizeof(uint32_t) * fieldCount) != 0) Common_terminate("BENCHMARK",
+      "The updated distance field doesn't match a new distance field.");
+
+  printf("Distance field: %d fields, calculated in %.3f ms, using %.1f KiB "
+    "(%d bytes per field).\n", fieldCount, buildSeconds * 1000.0,
+    sizeof(uint32_t) * fieldCount / 1024.0, (int)sizeof(uint32_t));
+  printf("Queries: %.1f million next steps per second (checksum %u).\n",
+    queryCount / querySeconds / 1000000.0, checksum);
+  printf("Updates: %.3f us per changed field on average (%d changes), "
+    "%.0f times cheaper than calculating the distance field again.\n",
+    updateSeconds * 1000000.0 / changeCount, changeCount,
+    buildSeconds / (updateSeconds / changeCount));
+
+  free(samples);
+  DistanceField_destroy(&itemField);
+  DistanceField_destroy(&checkField);
+}
+
+//The data of the queries of a thread in the pathfinding benchmark.
+typedef struct
+{
+  const HierarchicalPathfinder *pathfinder;
+  const int *queries;
+  int queryCount, workerCount;
+  //The sum of all path lengths of every worker.
+  uint32_t *lengthSums;
+} BenchmarkPathQueries;
+
+//Runs the queries of a worker in the pathfinding benchmark.
+//data: A pointer to the BenchmarkPathQueries.
+//index: The index of the worker.
+void Benchmark_findPaths(void *data, int index)
+{
+  BenchmarkPathQueries *queries = (BenchmarkPathQueries *)data;
+  HierarchicalPathSearch search;
+  uint32_t lengthSum = 0;
+
+  HierarchicalPathSearch_initialize(&search, queries->pathfinder);
+  for (int i = index; i < queries->queryCount; i += queries->workerCount)
+    lengthSum += HierarchicalPathfinder_findPath(queries->pathfinder, &search,
+      queries->queries[i * 2], queries->queries[i * 2 + 1], NULL);
+  queries->lengthSums[index] = lengthSum;
+  HierarchicalPathSearch_destroy(&search);
+}
+
+//Checks if a path is a valid walk between two fields.
+//grid: A pointer to the map view.
+//path: The fields of the path.
+//start, goal: The indicies of the first and the last field.
+//length: The expected length of the path.
+bool Benchmark_isValidPath(const MapGrid *grid, const NavigationList *path,
+  int start, int goal, uint32_t length)
+{
+  int neighbours[6];
+
+  if (path->count != (int)length + 1 || path->entries[0].index != start ||
+    path->entries[path->count - 1].index != goal) return false;
+  for (int i = 1; i < path->count; i++)
+  {
+    int neighbourCount = MapGrid_getNeighbours(grid,
+      path->entries[i - 1].index, neighbours);
+    bool isNeighbour = false;
+    for (int j = 0; j < neighbourCount; j++)
+      isNeighbour |= neighbours[j] == path->entries[i].index;
+    if (!isNeighbour ||
+      !Analysis_isWalkable(grid->fields[path->entries[i].index])) return false;
+  }
+
+  return true;
+}
+
+//Compares the throughput and the path lengths of A* and the hierarchical
+//pathfinder (on its own, with refined paths and with several threads) on
+//random queries between walkable fields.
+//pool: The worker pool used for the multi-threaded queries.
+void Benchmark_pathfinding(WorkerPool *pool)
+{
+  const int fieldCount = mapWidth * mapDepth * mapLevels;
+  const int queryCount = 1000;
+  GridPathfinder gridPathfinder;
+  HierarchicalPathfinder pathfinder;
+  HierarchicalPathSearch search;
+  NavigationList path;
+  uint32_t random = 1;
+
+  double startTime = Common_getTimeSeconds();
+  HierarchicalPathfinder_initialize(&pathfinder, map, mapWidth, mapDepth,
+    mapLevels);
+  double buildSeconds = Common_getTimeSeconds() - startTime;
+  GridPathfinder_initialize(&gridPathfinder, map, mapWidth, mapDepth,
+    mapLevels);
+  HierarchicalPathSearch_initialize(&search, &pathfinder);
+  memset(&path, 0, sizeof(NavigationList));
+
+  //Pick random pairs of walkable fields (which might not be connected).
+  int *queries = (int *)Common_allocate(sizeof(int) * queryCount * 2);
+  for (int i = 0; i < queryCount * 2; i++)
+  {
+    int attempt = 0;
+    do queries[i] = (int)(Maze_random(&random) % fieldCount);
+    while (!Analysis_isWalkable(map[queries[i]]) && ++attempt < 1000000);
+    if (attempt == 1000000)
+      Common_terminate("BENCHMARK", "The map doesn't contain walkable fields.");
+  }
+
+  //Run the reference queries and compare the paths of both pathfinders.
+  uint32_t *lengths = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    queryCount);
+  double optimalitySum = 0.0, worstOptimality = 1.0;
+  int foundCount = 0;
+  startTime = Common_getTimeSeconds();
+  for (int i = 0; i < queryCount; i++)
+    lengths[i] = GridPathfinder_findPath(&gridPathfinder, queries[i * 2],
+      queries[i * 2 + 1], NULL);
+  double gridSeconds = Common_getTimeSeconds() - startTime;
+
+  for (int i = 0; i < queryCount; i++)
+  {
+    uint32_t length = HierarchicalPathfinder_findPath(&pathfinder, &search,
+      queries[i * 2], queries[i * 2 + 1], &path);
+    if ((length == NAVIGATION_UNREACHABLE) !=
+      (lengths[i] == NAVIGATION_UNREACHABLE) || length < lengths[i])
+      Common_terminate("BENCHMARK", "The pathfinders found different paths.");
+    if (length == NAVIGATION_UNREACHABLE) continue;
+    if (!Benchmark_isValidPath(&pathfinder.grid, &path, queries[i * 2],
+      queries[i * 2 + 1], length))
+      Common_terminate("BENCHMARK", "A refined path isn't valid.");
+
+    double optimality = lengths[i] > 0 ? (double)length / lengths[i] : 1.0;
+    optimalitySum += optimality;
+    worstOptimality = MAX(worstOptimality, optimality);
+    foundCount++;
+  }
+
+  //Measure the hierarchical queries with and without refining the paths.
+  long long abstractQueryCount = 0, refinedQueryCount = 0;
+  startTime = Common_getTimeSeconds();
+  do
+  {
+    for (int i = 0; i < queryCount; i++)
+      HierarchicalPathfinder_findPath(&pathfinder, &search, queries[i * 2],
+        queries[i * 2 + 1], NULL);
+    abstractQueryCount += queryCount;
+  } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+  double abstractSeconds = Common_getTimeSeconds() - startTime;
+
+  startTime = Common_getTimeSeconds();
+  do
+  {
+    for (int i = 0; i < queryCount; i++)
+      HierarchicalPathfinder_findPath(&pathfinder, &search, queries[i * 2],
+        queries[i * 2 + 1], &path);
+    refinedQueryCount += queryCount;
+  } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+  double refinedSeconds = Common_getTimeSeconds() - startTime;
+
+  BenchmarkPathQueries threadQueries;
+  threadQueries.pathfinder = &pathfinder;
+  threadQueries.queries = queries;
+  threadQueries.queryCount = queryCount;
+  threadQueries.workerCount = pool->threadCount + 1;
+  threadQueries.lengthSums = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+    threadQueries.workerCount);
+  long long threadQueryCount = 0;
+  startTime = Common_getTimeSeconds();
+  do
+  {
+    WorkerPool_parallelFor(pool, threadQueries.workerCount,
+      Benchmark_findPaths, &threadQueries);
+    threadQueryCount += queryCount;
+  } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+  double threadSeconds = Common_getTimeSeconds() - startTime;
+
+  printf("Pathfinding: %d fields, %d queries (%d of them reachable).\n",
+    fieldCount, queryCount, foundCount);
+  printf("Hierarchy: %d clusters, %d nodes, %d edges, built in %.3f ms, "
+    "using %.1f KiB.\n", pathfinder.clusterCount, pathfinder.nodeCount,
+    pathfinder.edgeCount, buildSeconds * 1000.0,
+    HierarchicalPathfinder_getMemorySize(&pathfinder) / 1024.0);
+  printf("A*: %.0f queries per second (%.0f fields expanded per query).\n",
+    queryCount / gridSeconds,
+    (double)gridPathfinder.expandedFieldCount / queryCount);
+  printf("HPA*: %.0f queries per second, %.0f with refined paths, "
+    "%.0f with %d threads.\n", abstractQueryCount / abstractSeconds,
+    refinedQueryCount / refinedSeconds, threadQueryCount / threadSeconds,
+    threadQueries.workerCount);
+  printf("Path length compared to A*: %.3f on average, %.3f at most.\n",
+    foundCount > 0 ? optimalitySum / foundCount : 1.0, worstOptimality);
+
+  free(queries);
+  free(lengths);
+  free(path.entries);
+  free(threadQueries.lengthSums);
+  HierarchicalPathSearch_destroy(&search);
+  HierarchicalPathfinder_destroy(&pathfinder);
+  GridPathfinder_destroy(&gridPathfinder);
+}
+
+//Gets the exact distance from a position to the closest blocking field
+//within two fields (or the border of the map) by checking all fields around
+//it - the reference for checking that circles don't overlap walls.
+//x, level, z: The position (in field coordinates).
+float Benchmark_getWallDistance(float x, int level, float z)
+{
+  const int radius = 3;
+  int centerX = (int)roundf(x), centerZ = (int)roundf(z);
+  float closest = 2.0f;
+
+  for (int fieldX = centerX - radius; fieldX <= centerX + radius; fieldX++)
+  {
+    for (int fieldZ = centerZ - radius; fieldZ <= centerZ + radius; fieldZ++)
+    {
+      if (fieldX >= 0 && fieldX < mapWidth && fieldZ >= 0 &&
+        fieldZ < mapDepth && Analysis_isWalkable(map[((size_t)level *
+          mapWidth + fieldX) * mapDepth + fieldZ])) continue;
+      float offsetX = MAX(0, fabsf(x - fieldX) - 0.5f);
+      float offsetZ = MAX(0, fabsf(z - fieldZ) - 0.5f);
+      closest = MIN(closest, sqrtf(offsetX * offsetX + offsetZ * offsetZ));
+    }
+  }
+
+  return closest;
+}
+
+//Checks if a circle with the PLAYER_RADIUS crossed the side of a wall.
+//x, z: The position of the center of the circle.
+//wallX, wallZ: The indicies of the wall field.
+//directionX, directionZ: The direction the circle was moved into the wall.
+//tolerance: The distance the circle may overlap the side of the wall.
+bool Benchmark_isBehindWall(float x, float z, int wallX, int wallZ,
+  int directionX, int directionZ, float tolerance)
+{
+  float advance = directionX != 0 ? (x - wallX) * directionX + 0.5f :
+    (z - wallZ) * directionZ + 0.5f;
+  float sideways = directionX != 0 ? fabsf(z - wallZ) : fabsf(x - wallX);
+  return advance > tolerance - PLAYER_RADIUS &&
+    sideways < 0.5f + PLAYER_RADIUS - tolerance;
+}
+
+//Fires a movement through every side of every wall of the map, which must
+//never end inside or behind the wall. Compares the swept collision with the
+//point test of the original movement code, so this is both a test and a
+//benchmark of the swept collision.
+//pool: The worker pool (unused).
+void Benchmark_sweptCollision(WorkerPool *pool)
+{
+  pool;
+
+  //The movement length (far enough to reach the field behind the wall) and
+  //the sideways offsets of the movements (too small to get around a wall).
+  const float length = 3.0f, offsets[] = { -0.45f, -0.15f, 0.15f, 0.45f };
+  const int directionX[] = { 1, -1, 0, 0 }, directionZ[] = { 0, 0, 1, -1 };
+  MapGrid grid;
+  NavigationList movements;
+  long long traversedFieldCount = 0;
+  int sweepPenetrationCount = 0, pointPenetrationCount = 0;
+
+  MapGrid_initialize(&grid, map, mapWidth, mapDepth, mapLevels);
+
+  //Collect the movements as wall field index and direction.
+  memset(&movements, 0, sizeof(NavigationList));
+  for (int wall = 0; wall < mapWidth * mapDepth * mapLevels; wall++)
+  {
+    int level = wall / (mapWidth * mapDepth);
+    int wallX = (wall % (mapWidth * mapDepth)) / mapDepth;
+    int wallZ = wall % mapDepth;
+    if (!Collision_isBlocking(&grid, wallX, level, wallZ)) continue;
+    for (int direction = 0; direction < 4; direction++)
+      if (!Collision_isBlocking(&grid, wallX - directionX[direction],
+        level, wallZ - directionZ[direction]))
+        NavigationList_push(&movements, wall, direction);
+  }
+
+  float *results = (float *)Common_allocate(sizeof(float) * 2 *
+    MAX(1, movements.count));
+  double seconds[2];
+  for (int method = 0; method < 2; method++)
+  {
+    double startTime = Common_getTimeSeconds();
+    for (int i = 0; i < movements.count; i++)
+    {
+      int wall = movements.entries[i].index;
+      int direction = (int)movements.entries[i].distance;
+      int level = wall / (mapWidth * mapDepth);
+      int wallX = (wall % (mapWidth * mapDepth)) / mapDepth;
+      int wallZ = wall % mapDepth;
+      float x = (float)(wallX - directionX[direction]);
+      float z = (float)(wallZ - directionZ[direction]);
+      float offset = offsets[i % LENGTHOF(offsets)];
+      float moveX = directionX[direction] * length +
+        directionZ[direction] * offset;
+      float moveZ = directionZ[direction] * length +
+        directionX[direction] * offset;
+
+      //The swept collision and the point test of the original movement code
+      //(which moves if the target field isn't blocking).
+      if (method == 0) Collision_sweepCircle(&grid, &x, level, &z,
+        moveX, moveZ, PLAYER_RADIUS, NULL, NULL);
+      else if (!Collision_isBlocking(&grid, (int)roundf(x + moveX), level,
+        (int)roundf(z + moveZ)))
+      {
+        x += moveX;
+        z += moveZ;
+      }
+      results[i * 2] = x;
+      results[i * 2 + 1] = z;
+    }
+    seconds[method] = Common_getTimeSeconds() - startTime;
+
+    //A movement penetrates the wall if the circle ends up overlapping any
+    //blocking field or beyond the side of the wall.
+    for (int i = 0; i < movements.count; i++)
+    {
+      int wall = movements.entries[i].index;
+      int direction = (int)movements.entries[i].distance;
+      int level = wall / (mapWidth * mapDepth);
+      int wallX = (wall % (mapWidth * mapDepth)) / mapDepth;
+      int wallZ = wall % mapDepth;
+      float x = results[i * 2], z = results[i * 2 + 1];
+
+      if (method == 0 && (Benchmark_isBehindWall(x, z, wallX, wallZ,
+        directionX[direction], directionZ[direction], COLLISION_SKIN) ||
+        Benchmark_getWallDistance(x, level, z) <
+        PLAYER_RADIUS - COLLISION_SKIN)) sweepPenetrationCount++;
+      else if (method == 1 && Benchmark_isBehindWall(x, z, wallX, wallZ,
+        directionX[direction], directionZ[direction], 0.0f))
+        pointPenetrationCount++;
+
+      if (method == 0)
+      {
+        float time, normalX, normalZ;
+        float offset = offsets[i % LENGTHOF(offsets)];
+        traversedFieldCount += Collision_castCircle(&grid,
+          (float)(wallX - directionX[direction]), level,
+          (float)(wallZ - directionZ[direction]),
+          directionX[direction] * length + directionZ[direction] * offset,
+          directionZ[direction] * length + directionX[direction] * offset,
+          PLAYER_RADIUS, &time, &normalX, &normalZ);
+      }
+    }
+  }
+
+  printf("Swept collision: %d movements of %.1f fields through the sides of "
+    "all walls.\n", movements.count, length);
+  printf("Swept circle: %.2f million movements per second (%.1f fields "
+    "traversed until the contact on average), %d penetrations.\n",
+    movements.count / seconds[0] / 1000000.0,
+    (double)traversedFieldCount / MAX(1, movements.count),
+    sweepPenetrationCount);
+  printf("Point test: %.2f million movements per second, %d movements ended "
+    "behind a wall.\n", movements.count / seconds[1] / 1000000.0,
+    pointPenetrationCount);
+
+  free(results);
+  free(movements.entries);
+  if (sweepPenetrationCount > 0)
+    Common_terminate("BENCHMARK", "A swept movement penetrated a wall.");
+}
+
+//Measures the line-of-sight tests on random rays from walkable fields to
+//fields up to 16 fields away (on the same level): rays per second of the
+//reference (see "Sight_testRayReference"), single rays on the sight grid
+//and packets of rays (on one thread and on the worker pool). Fails
+//if any of them gets a different result than the reference, or if a ray
+//gets a different result in the opposite direction.
+//pool: The worker pool for the multi-threaded tests.
+void Benchmark_lineOfSight(WorkerPool *pool)
+{
+  const int rayCount = 1000000, range = 16;
+  SightRay *rays = (SightRay *)Common_allocate(sizeof(SightRay) * rayCount);
+  uint8_t *expected = (uint8_t *)Common_allocate(rayCount);
+  uint8_t *results = (uint8_t *)Common_allocate(rayCount);
+  const int fieldCount = mapWidth * mapDepth * mapLevels;
+  uint32_t random = 1;
+  SightGrid grid;
+  int64_t lengthSum = 0;
+
+  for (int i = 0; i < rayCount; i++)
+  {
+    int field = 0;
+    do field = (int)(Maze_random(&random) % fieldCount);
+    while (!Analysis_isWalkable(map[field]));
+
+    SightRay *ray = &rays[i];
+    ray->level = field / (mapWidth * mapDepth);
+    ray->fromX = (field % (mapWidth * mapDepth)) / mapDepth;
+    ray->fromZ = field % mapDepth;
+    int offsetX = (int)(Maze_random(&random) % (2 * range + 1)) - range;
+    int offsetZ = (int)(Maze_random(&random) % (2 * range + 1)) - range;
+    ray->toX = MAX(0, MIN(mapWidth - 1, ray->fromX + offsetX));
+    ray->toZ = MAX(0, MIN(mapDepth - 1, ray->fromZ + offsetZ));
+    lengthSum += abs(ray->toX - ray->fromX) + abs(ray->toZ - ray->fromZ);
+  }
+
+  double startTime = Common_getTimeSeconds();
+  SightGrid_initialize(&grid, map, mapWidth, mapDepth, mapLevels);
+  double gridSeconds = Common_getTimeSeconds() - startTime;
+
+  startTime = Common_getTimeSeconds();
+  for (int i = 0; i < rayCount; i++)
+    expected[i] = Sight_testRayReference(map, mapWidth, mapDepth, &rays[i]);
+  double referenceSeconds = Common_getTimeSeconds() - startTime;
+
+  double seconds[3];
+  const char *methodNames[3] = { "single rays", "packets, one thread",
+    "packets, worker pool" };
+  for (int method = 0; method < 3; method++)
+  {
+    //A single pass is too short for stable timings.
+    int passCount = 0;
+    memset(results, 2, rayCount);
+    startTime = Common_getTimeSeconds();
+    do
+    {
+      if (method == 0)
+        for (int i = 0; i < rayCount; i++)
+          results[i] = SightGrid_testRay(&grid, &rays[i]);
+      else SightGrid_testRays(&grid, method == 2 ? pool : NULL, rays,
+        rayCount, results);
+      passCount++;
+    } while (Common_getTimeSeconds() - startTime < BENCHMARK_MIN_SECONDS);
+    seconds[method] = (Common_getTimeSeconds() - startTime) / passCount;
+
+    if (memcmp(results, expected, rayCount)) Common_terminate("BENCHMARK",
+      "A line of sight differs from the reference.");
+  }
+
+  //Every ray needs to get the same result in the opposite direction.
+  int visibleCount = 0;
+  for (int i = 0; i < rayCount; i++)
+  {
+    SightRay *ray = &rays[i];
+    int fromX = ray->fromX, fromZ = ray->fromZ;
+    ray->fromX = ray->toX;
+    ray->fromZ = ray->toZ;
+    ray->toX = fromX;
+    ray->toZ = fromZ;
+    visibleCount += expected[i];
+  }
+  SightGrid_testRays(&grid, pool, rays, rayCount, results);
+  if (memcmp(results, expected, rayCount)) Common_terminate("BENCHMARK",
+    "A line of sight differs in the opposite direction.");
+
+  printf("Line of sight: %d rays up to %d fields away (%.1f fields on "
+    "average), %.1f%% visible.\n", rayCount, range,
+    (double)lengthSum / rayCount, visibleCount * 100.0 / rayCount);
+  printf("Sight grid: %.3f ms to create, using %.1f KiB.\n",
+    gridSeconds * 1000.0,
+    sizeof(uint32_t) * ((double)fieldCount / 32 + 1) / 1024.0);
+  printf("Reference: %.2f million rays per second.\n",
+    rayCount / referenceSeconds / 1000000.0);
+  for (int method = 0; method < 3; method++)
+  {
+    printf("Sight grid (%s): %.2f million rays per second, %.2fx faster "
+      "than the reference.\n", methodNames[method],
+      rayCount / seconds[method] / 1000000.0,
+      referenceSeconds / seconds[method]);
+  }
+
+  SightGrid_destroy(&grid);
+  free(rays);
+  free(expected);
+  free(results);
+}
+
+//Spawns the players of the sessions in a benchmark on random walkable
+//fields in a square part of the map (at its origin, on all levels).
+//batch: A pointer to the batch.
+//random: A pointer to the state of the random number generator.
+//areaSize: The size of the part of the map.
+void Benchmark_spawnSessionsInArea(SessionBatch *batch, uint32_t *random,
+  int areaSize)
+{
+  int width = MIN(areaSize, mapWidth), depth = MIN(areaSize, mapDepth);
+  for (int i = 0; i < batch->count; i++)
+  {
+    int x = 0, level = 0, z = 0, attempt = 0;
+    do
+    {
+      uint32_t index = Maze_random(random) % (width * depth * mapLevels);
+      level = (int)(index / (width * depth));
+      x = (int)(index % (width * depth)) / depth;
+      z = (int)(index % depth);
+    }
+    while (!Analysis_isWalkable(map[(level * mapWidth + x) * mapDepth + z]) &&
+      ++attempt < 1000000);
+    if (attempt == 1000000)
+      Common_terminate("BENCHMARK", "The map doesn't contain walkable fields.");
+
+    SessionBatch_reset(batch, i, (float)x, level, (float)z);
+  }
+}
+
+//Spawns the players of the sessions in a benchmark on random walkable
+//fields of the whole map.
+//batch: A pointer to the batch.
+//random: A pointer to the state of the random number generator.
+void Benchmark_spawnSessions(SessionBatch *batch, uint32_t *random)
+{
+  Benchmark_spawnSessionsInArea(batch, random, MAX(mapWidth, mapDepth));
+}
+
+//Steps batches of 1, 64 and 4096 game sessions played by simple bots (on
+//one thread and on the worker pool) and prints the steps per second. Fails
+//if a player ends up closer to a wall than its radius or if the results of
+//both runs differ.
+//pool: The worker pool.
+void Benchmark_sessions(WorkerPool *pool)
+{
+  const int sessionCounts[] = { 1, 64, 4096 };
+  const int sessionStepCount = 1 << 21;
+  //The bots keep their input for this amount of steps.
+  const int inputStepCount = 16;
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+
+  //The sessions collide and find the quest items like the game does.
+  Collision_initialize();
+  Pickup_initialize();
+
+  for (int run = 0; run < (int)LENGTHOF(sessionCounts); run++)
+  {
+    const int count = sessionCounts[run];
+    const int stepCount = sessionStepCount / count;
+    SessionInput *inputs = (SessionInput *)Common_allocate(
+      sizeof(SessionInput) * count);
+    SessionBatch batches[2];
+    double seconds[2];
+
+    for (int method = 0; method < 2; method++)
+    {
+      SessionBatch *batch = &batches[method];
+      uint32_t random = 1;
+      SessionBatch_initialize(batch, count);
+      Benchmark_spawnSessions(batch, &random);
+      memset(inputs, 0, sizeof(SessionInput) * count);
+
+      seconds[method] = 0;
+      for (int step = 0; step < stepCount; step += inputStepCount)
+      {
+        Session_changeInputsRandomly(inputs, count, &random);
+        double startTime = Common_getTimeSeconds();
+        for (int i = step; i < MIN(stepCount, step + inputStepCount); i++)
+          SessionBatch_step(batch, method == 0 ? NULL : pool, inputs,
+            deltaSeconds);
+        seconds[method] += Common_getTimeSeconds() - startTime;
+      }
+    }
+
+    //Players who just took a lift may be closer to the walls of the other
+    //level, as the fields around the lift shaft differ between levels.
+    int itemCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+      float x = batches[0].positionsX[i], z = batches[0].positionsZ[i];
+      int level = batches[0].levels[i];
+      itemCount += batches[0].itemStates[i] != Initial;
+      if (Game_getMapFieldByPosition(x, level, z) != Lift &&
+        Benchmark_getWallDistance(x, level, z) <
+        PLAYER_RADIUS - COLLISION_SKIN)
+        Common_terminate("BENCHMARK", "A player moved into a wall.");
+    }
+    if (memcmp(batches[0].positionsX, batches[1].positionsX,
+      sizeof(float) * count) || memcmp(batches[0].positionsZ,
+      batches[1].positionsZ, sizeof(float) * count) ||
+      memcmp(batches[0].levels, batches[1].levels, sizeof(int) * count) ||
+      memcmp(batches[0].itemStates, batches[1].itemStates, count))
+      Common_terminate("BENCHMARK", "The sessions differ between threads.");
+
+    printf("Sessions: %d, %d steps (%d with a quest item at the end).\n",
+      count, stepCount, itemCount);
+    for (int method = 0; method < 2; method++)
+      printf("Step (%s): %.0f steps per second, %.2f million session steps "
+        "per second (%.0fx faster than real time).\n", method == 0 ?
+        "one thread" : "worker pool", stepCount / seconds[method],
+        (double)stepCount * count / seconds[method] / 1000000.0,
+        stepCount * deltaSeconds / seconds[method]);
+
+    SessionBatch_destroy(&batches[0]);
+    SessionBatch_destroy(&batches[1]);
+    free(inputs);
+  }
+
+  Pickup_destroy();
+  Collision_destroy();
+}
+
+//Steps the sessions of the reference run of the lockstep benchmark: bots
+//which start at the spawn point of the built-in map and press random
+//buttons.
+//batch: A pointer to the fixed-point batch, which is reset.
+//stepCount: The amount of steps.
+//Returns the hash of the sessions after the last step.
+uint64_t Benchmark_runLockstepReference(FixedSessionBatch *batch,
+  int stepCount)
+{
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * batch->count);
+  uint32_t random = 1;
+  int spawnX = 0, spawnZ = 0;
+
+  Game_findSpawnPoint(mapWidth, mapDepth, &spawnX, &spawnZ);
+  for (int i = 0; i < batch->count; i++) FixedSessionBatch_reset(batch, i,
+    spawnX * FIXED_ONE, 0, spawnZ * FIXED_ONE);
+  memset(inputs, 0, sizeof(SessionInput) * batch->count);
+
+  for (int step = 0; step < stepCount; step++)
+  {
+    if (step % 16 == 0)
+      Session_changeInputsRandomly(inputs, batch->count, &random);
+    FixedSessionBatch_stepRange(batch, 0, batch->count, inputs,
+      FIXED_ONE * UPDATE_TIMEOUT_MS / 1000);
+  }
+
+  free(inputs);
+  return FixedSessionBatch_hash(batch);
+}
+
+//Checks that the fixed-point sessions are stepped bit-exactly: the
+//reference run on the built-in map must end with BENCHMARK_LOCKSTEP_HASH in
+//every build (with every compiler, optimization and processor). Then steps
+//4096 sessions on the map of the options with the float code (with and
+//without the swept circle) and with the fixed-point code (on one thread)
+//and prints the steps per second and the hash of the fixed-point sessions
+//(which can be compared between machines when the maze is generated with
+//the same "--seed"). Fails if the reference hash differs or if a player
+//ends up in a field it can't enter.
+//pool: The worker pool (unused).
+void Benchmark_lockstep(WorkerPool *pool)
+{
+  pool;
+
+  const int count = 4096, stepCount = 512, inputStepCount = 16;
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+  const Fixed fixedDeltaSeconds = FIXED_ONE * UPDATE_TIMEOUT_MS / 1000;
+  FixedSessionBatch fixedBatch;
+  SessionBatch batch;
+  const char *methodNames[] = { "float, swept circle",
+    "float, field test", "fixed-point" };
+  double seconds[3] = { 0, 0, 0 };
+
+  //The reference run needs the built-in map (without the pickup hash).
+  Field *benchmarkMap = map;
+  int benchmarkMapWidth = mapWidth, benchmarkMapDepth = mapDepth;
+  int benchmarkMapLevels = mapLevels;
+  map = defaultMap;
+  mapWidth = defaultMapWidth;
+  mapDepth = defaultMapDepth;
+  mapLevels = 1;
+  FixedSessionBatch_initialize(&fixedBatch, 64);
+  uint64_t hash = Benchmark_runLockstepReference(&fixedBatch, 10000);
+  FixedSessionBatch_destroy(&fixedBatch);
+  map = benchmarkMap;
+  mapWidth = benchmarkMapWidth;
+  mapDepth = benchmarkMapDepth;
+  mapLevels = benchmarkMapLevels;
+
+  printf("Reference: 64 sessions, 10000 steps on the built-in map - hash "
+    "%016llx (expected %016llx).\n", (unsigned long long)hash,
+    (unsigned long long)BENCHMARK_LOCKSTEP_HASH);
+  if (hash != BENCHMARK_LOCKSTEP_HASH) Common_terminate("BENCHMARK",
+    "The fixed-point sessions differ from the reference run.");
+
+  //The float sessions collide like the game does - and like the game in
+  //endless mazes, which only tests the field of the new position (the
+  //collision which is the closest to the one of the fixed-point sessions).
+  Collision_initialize();
+  Pickup_initialize();
+
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * count);
+  for (int method = 0; method < (int)LENGTHOF(seconds); method++)
+  {
+    uint32_t random = 1;
+    SessionBatch_initialize(&batch, count);
+    Benchmark_spawnSessions(&batch, &random);
+    memset(inputs, 0, sizeof(SessionInput) * count);
+    isCollisionEnabled = method != 1;
+    if (method == 2)
+    {
+      FixedSessionBatch_initialize(&fixedBatch, count);
+      for (int i = 0; i < count; i++)
+        FixedSessionBatch_load(&fixedBatch, i, &batch, i);
+    }
+
+    for (int step = 0; step < stepCount; step += inputStepCount)
+    {
+      Session_changeInputsRandomly(inputs, count, &random);
+      double startTime = Common_getTimeSeconds();
+      for (int i = step; i < MIN(stepCount, step + inputStepCount); i++)
+      {
+        if (method < 2)
+          SessionBatch_stepRange(&batch, 0, count, inputs, deltaSeconds);
+        else FixedSessionBatch_stepRange(&fixedBatch, 0, count, inputs,
+          fixedDeltaSeconds);
+      }
+      seconds[method] += Common_getTimeSeconds() - startTime;
+    }
+
+    SessionBatch_destroy(&batch);
+  }
+
+  //Players who took a lift may overlap the walls of the other level, but
+  //their center must never enter them.
+  for (int i = 0; i < count; i++)
+  {
+    Fixed x = fixedBatch.positionsX[i], z = fixedBatch.positionsZ[i];
+    int level = fixedBatch.levels[i];
+    if (FixedSessionBatch_isFieldBlocked((x + FIXED_ONE / 2) >> FIXED_SHIFT,
+      level, (z + FIXED_ONE / 2) >> FIXED_SHIFT) || (mapLevels == 1 &&
+      FixedSessionBatch_isBlocked(x, level, z)))
+      Common_terminate("BENCHMARK", "A player moved into a wall.");
+  }
+
+  printf("Sessions: %d, %d steps - fixed-point hash %016llx.\n", count,
+    stepCount, (unsigned long long)FixedSessionBatch_hash(&fixedBatch));
+  for (int method = 0; method < (int)LENGTHOF(seconds); method++)
+    printf("Step (%s): %.2f million session steps per second (%.2fx the "
+      "time of the float steps with the swept circle).\n",
+      methodNames[method], (double)stepCount * count / seconds[method] /
+      1000000.0, seconds[method] / seconds[0]);
+
+  FixedSessionBatch_destroy(&fixedBatch);
+  free(inputs);
+  Pickup_destroy();
+  Collision_destroy();
+}
+
+//Casts the rays of 4096 players on random fields (with random rotations and
+//positions inside of the fields) a few times: every ray on its own (the
+//reference) and in batches (on one thread and on the worker pool), and
+//prints the rays per second. Fails if the batches get a different result
+//than the reference.
+//pool: The worker pool for the multi-threaded casts.
+void Benchmark_lidar(WorkerPool *pool)
+{
+  const int playerCount = 4096, rayCount = 32, castCount = 16;
+  const float range = 16;
+  const int count = playerCount * rayCount;
+  float *expectedDistances = (float *)Common_allocate(sizeof(float) * count);
+  int8_t *expectedFields = (int8_t *)Common_allocate(count);
+  float *distances = (float *)Common_allocate(sizeof(float) * count);
+  int8_t *fields = (int8_t *)Common_allocate(count);
+  uint32_t random = 1;
+  SessionBatch players;
+  Lidar lidar;
+  double seconds[3] = { 0, 0, 0 };
+  double distanceSum = 0;
+  int64_t hitCount = 0;
+  const char *methodNames[3] = { "single rays", "batches, one thread",
+    "batches, worker pool" };
+
+  SessionBatch_initialize(&players, playerCount);
+  Lidar_initialize(&lidar, rayCount, 360, range);
+
+  for (int cast = 0; cast < castCount; cast++)
+  {
+    Benchmark_spawnSessions(&players, &random);
+    for (int i = 0; i < playerCount; i++)
+    {
+      players.positionsX[i] +=
+        (float)((int)(Maze_random(&random) % 61) - 30) / 100.0f;
+      players.positionsZ[i] +=
+        (float)((int)(Maze_random(&random) % 61) - 30) / 100.0f;
+      players.rotationsY[i] = (float)(Maze_random(&random) % 3600) / 10.0f;
+    }
+
+    for (int method = 0; method < 3; method++)
+    {
+      float *targetDistances = method == 0 ? expectedDistances : distances;
+      int8_t *targetFields = method == 0 ? expectedFields : fields;
+      memset(targetFields, -1, count);
+
+      double startTime = Common_getTimeSeconds();
+      if (method == 0)
+        for (int i = 0; i < count; i++)
+          Lidar_castRay(&lidar, &players, i, &targetDistances[i],
+            &targetFields[i]);
+      else Lidar_cast(&lidar, &players, method == 2 ? pool : NULL,
+        targetDistances, targetFields);
+      seconds[method] += Common_getTimeSeconds() - startTime;
+
+      if (method > 0 && (memcmp(distances, expectedDistances,
+        sizeof(float) * count) || memcmp(fields, expectedFields, count)))
+        Common_terminate("BENCHMARK", "A lidar ray differs from the "
+          "reference.");
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+      if (expectedDistances[i] < 0 || expectedDistances[i] > range)
+        Common_terminate("BENCHMARK", "A lidar ray is out of range.");
+      distanceSum += expectedDistances[i];
+      hitCount += expectedFields[i] != Tile;
+    }
+  }
+
+  printf("Lidar: %d players with %d rays up to %.0f fields, %d casts - "
+    "%.2f fields on average, %.1f%% of the rays hit a wall.\n",
+    playerCount, rayCount, range, castCount,
+    distanceSum / ((double)count * castCount),
+    hitCount * 100.0 / ((double)count * castCount));
+  for (int method = 0; method < 3; method++)
+  {
+    //The single rays are the reference of the batched ones.
+    printf("Lidar (%s): %.2f million rays per second", methodNames[method],
+      (double)count * castCount / seconds[method] / 1000000.0);
+    if (method > 0)
+      printf(", %.2fx faster than single rays", seconds[0] / seconds[method]);
+    printf(".\n");
+  }
+
+  Lidar_destroy(&lidar);
+  SessionBatch_destroy(&players);
+  free(expectedDistances);
+  free(expectedFields);
+  free(distances);
+  free(fields);
+}
+
+//Lets bots with the autopilot play 256 sessions from random fields for 30
+//minutes of game time - every finished (or stuck) session starts again
+//where it started first - and prints how many laps were finished, how long
+//a lap took and how long steering and stepping took. Fails if an autopilot
+//gets stuck.
+//pool: The worker pool used to step the sessions.
+void Benchmark_autopilot(WorkerPool *pool)
+{
+  const int count = 256;
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+  const int stepCount = (int)(30 * 60 / deltaSeconds);
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * count);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(
+    sizeof(Autopilot) * count);
+  float *startsX = (float *)Common_allocate(sizeof(float) * count);
+  float *startsZ = (float *)Common_allocate(sizeof(float) * count);
+  int *startLevels = (int *)Common_allocate(sizeof(int) * count);
+  int *lapCounts = (int *)Common_allocate(sizeof(int) * count);
+  double steerSeconds = 0, stepSeconds = 0, lapSecondsSum = 0;
+  int lapCount = 0, stuckCount = 0, idleCount = 0;
+  uint32_t random = 1;
+  SessionBatch sessions;
+
+  //The autopilot follows the distance fields, collides and finds the quest
+  //items like the game does.
+  Navigation_initialize();
+  Collision_initialize();
+  Pickup_initialize();
+
+  //The bots only start on fields from which a quest item can be reached.
+  SessionBatch_initialize(&sessions, count);
+  for (int i = 0; i < count; i++)
+  {
+    do Benchmark_spawnSessions(&sessions, &random);
+    while (itemDistanceField.distances[(sessions.levels[0] * mapWidth +
+      (int)sessions.positionsX[0]) * mapDepth + (int)sessions.positionsZ[0]]
+      == NAVIGATION_UNREACHABLE);
+    startsX[i] = sessions.positionsX[0];
+    startsZ[i] = sessions.positionsZ[0];
+    startLevels[i] = sessions.levels[0];
+  }
+  for (int i = 0; i < count; i++)
+  {
+    SessionBatch_reset(&sessions, i, startsX[i], startLevels[i], startsZ[i]);
+    Autopilot_reset(&autopilots[i]);
+    lapCounts[i] = 0;
+  }
+
+  for (int step = 0; step < stepCount; step++)
+  {
+    double startTime = Common_getTimeSeconds();
+    for (int i = 0; i < count; i++)
+      Autopilot_steer(&autopilots[i], &sessions, i, deltaSeconds,
+        &inputs[i]);
+    double steerEndTime = Common_getTimeSeconds();
+    SessionBatch_step(&sessions, pool, inputs, deltaSeconds);
+    steerSeconds += steerEndTime - startTime;
+    stepSeconds += Common_getTimeSeconds() - steerEndTime;
+
+    for (int i = 0; i < count; i++)
+    {
+      if (!sessions.finished[i] && !Autopilot_isStuck(&autopilots[i]))
+        continue;
+      if (sessions.finished[i])
+      {
+        lapCounts[i]++;
+        lapCount++;
+        lapSecondsSum += sessions.times[i];
+      }
+      else stuckCount++;
+      SessionBatch_reset(&sessions, i, startsX[i], startLevels[i],
+        startsZ[i]);
+      Autopilot_reset(&autopilots[i]);
+    }
+  }
+
+  for (int i = 0; i < count; i++) idleCount += lapCounts[i] == 0;
+  printf("Autopilot: %d bots, %.0f minutes of game time - %d laps finished "
+    "(%.1f seconds per lap on average), %d bots without a lap, %d times "
+    "stuck.\n", count, stepCount * deltaSeconds / 60.0, lapCount,
+    lapCount > 0 ? lapSecondsSum / lapCount : 0.0, idleCount, stuckCount);
+  printf("Steering: %.3f us per bot and step, stepping: %.3f us per bot and "
+    "step (%.0fx faster than real time).\n",
+    steerSeconds * 1000000.0 / ((double)stepCount * count),
+    stepSeconds * 1000000.0 / ((double)stepCount * count),
+    stepCount * deltaSeconds * count / (steerSeconds + stepSeconds));
+
+  if (stuckCount > 0) Common_terminate("BENCHMARK",
+    "An autopilot got stuck.");
+
+  SessionBatch_destroy(&sessions);
+  Pickup_destroy();
+  Collision_destroy();
+  Navigation_destroy();
+  free(inputs);
+  free(autopilots);
+  free(startsX);
+  free(startsZ);
+  free(startLevels);
+  free(lapCounts);
+}
+
+//Describes the server run by "Benchmark_runServer".
+typedef struct
+{
+  Server *server;
+  WorkerPool *pool;
+  double seconds;
+} BenchmarkServerRun;
+
+//Runs a server for a given time (on its own thread).
+//data: A pointer to a BenchmarkServerRun instance.
+void Benchmark_runServer(void *data)
+{
+  BenchmarkServerRun *run = (BenchmarkServerRun *)data;
+  Server_run(run->server, run->pool, run->seconds);
+}
+
+//Runs a server on the loopback interface (on its own thread) with bots,
+//which connect, send random input every tick and leave again - the server
+//prints its tick times, traffic and snapshot sizes. Every bot compares the
+//snapshots it decodes with the states the other bots received for the same
+//tick. Fails if a bot isn't accepted, receives too few states or
+//snapshots, if the server doesn't apply the inputs of a bot, if a snapshot
+//differs from the states or if it misses a player which is close enough
+//to be always relevant (see "InterestGrid").
+//server: A pointer to the (initialized) server.
+//pool: The worker pool used by the server.
+//clientCount: The amount of bots.
+//seconds: The time the bots play.
+//isUsingAutopilot: true to let the bots play like players (with the
+//autopilot on the states they receive), which needs the distance fields.
+void Benchmark_playOnServer(Server *server, WorkerPool *pool,
+  int clientCount, double seconds, bool isUsingAutopilot)
+{
+  NetClient *clients = (NetClient *)Common_allocate(sizeof(NetClient) *
+    clientCount);
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * clientCount);
+  SnapshotEntity *quantizedStates = (SnapshotEntity *)Common_allocate(
+    sizeof(SnapshotEntity) * clientCount);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(sizeof(Autopilot) *
+    clientCount);
+  uint32_t random = 1;
+  int connectedCount = 0, stateCount = 0, snapshotCount = 0;
+  uint32_t inputCount = 0, acknowledgedCount = 0;
+  int64_t comparedCount = 0, missingCount = 0;
+  SessionBatch states;
+  BenchmarkServerRun run;
+
+  //Players on the same level which are closer than this on both axes (in
+  //quantized units) are in the surrounding cells of each other - unless all
+  //players are relevant anyway (or only the visible ones).
+  int64_t relevantDistance = (int64_t)((INTEREST_CELL_SIZE *
+    INTEREST_RADIUS - 1) * SNAPSHOT_POSITION_SCALE);
+  if (server->interest.mode == InterestAll) relevantDistance = INT64_MAX;
+  else if (server->interest.mode == InterestVisibility) relevantDistance = 0;
+
+  run.server = server;
+  run.pool = pool;
+  run.seconds = seconds + 1;
+  Thread serverThread = Thread_create(Benchmark_runServer, &run);
+
+  NetAddress serverAddress = NetAddress_create(NET_LOOPBACK_HOST,
+    UdpSocket_getPort(&server->socket));
+  SessionBatch_initialize(&states, clientCount);
+  memset(inputs, 0, sizeof(SessionInput) * clientCount);
+  for (int i = 0; i < clientCount; i++)
+  {
+    NetClient_initialize(&clients[i], serverAddress);
+    Autopilot_reset(&autopilots[i]);
+  }
+
+  //The bots step with the tick rate of the server (and skip steps if they
+  //can't keep up).
+  double startTime = Common_getTimeSeconds(), stepTime = startTime;
+  while (Common_getTimeSeconds() - startTime < seconds)
+  {
+    if (!isUsingAutopilot)
+      Session_changeInputsRandomly(inputs, clientCount, &random);
+    for (int i = 0; i < clientCount; i++)
+    {
+      NetClient_receive(&clients[i], &states, i);
+      if (isUsingAutopilot && clients[i].stateCount > 0)
+        Autopilot_steer(&autopilots[i], &states, i, 1.0f / server->tickRate,
+          &inputs[i]);
+      if (clients[i].index < 0) NetClient_connect(&clients[i]);
+      else NetClient_sendInput(&clients[i], &inputs[i]);
+      SnapshotEntity_quantize(&quantizedStates[i], &states, i);
+    }
+
+    for (int i = 0; i < clientCount; i++)
+    {
+      const SnapshotEntity *entities = SnapshotHistory_get(
+        &clients[i].snapshots, clients[i].snapshots.newestTick);
+      if (entities == NULL) continue;
+      for (int j = 0; j < clientCount; j++)
+      {
+        if (clients[j].tick != clients[i].snapshots.newestTick ||
+          clients[j].index < 0) continue;
+        const SnapshotEntity *entity = &entities[clients[j].index];
+        const SnapshotEntity *own = &quantizedStates[i], *other =
+          &quantizedStates[j];
+        if (!entity->isPresent)
+        {
+          if (clients[i].tick == clients[j].tick &&
+            own->level == other->level &&
+            llabs((int64_t)own->x - other->x) < relevantDistance &&
+            llabs((int64_t)own->z - other->z) < relevantDistance)
+            Common_terminate("BENCHMARK", "A snapshot misses a player "
+              "which is close enough to be relevant.");
+          missingCount++;
+          continue;
+        }
+        if (memcmp(entity, other, sizeof(SnapshotEntity)) != 0)
+          Common_terminate("BENCHMARK", "A snapshot differs from the state "
+          "sent for the same tick.");
+        comparedCount++;
+      }
+    }
+
+    stepTime += 1.0 / server->tickRate;
+    double currentTime = Common_getTimeSeconds();
+    if (stepTime > currentTime) Thread_sleep(stepTime - currentTime);
+    else stepTime = currentTime;
+  }
+
+  for (int i = 0; i < clientCount; i++)
+  {
+    NetClient_receive(&clients[i], &states, i);
+    if (clients[i].index >= 0) connectedCount++;
+    stateCount += clients[i].stateCount;
+    snapshotCount += clients[i].snapshotCount;
+    inputCount += clients[i].inputSequence;
+    acknowledgedCount += clients[i].acknowledgedSequence;
+    if (clients[i].index < 0 || clients[i].stateCount < seconds *
+      server->tickRate / 2 || clients[i].snapshotCount < seconds *
+      server->tickRate / 2 || clients[i].acknowledgedSequence +
+      (uint32_t)server->tickRate < clients[i].inputSequence)
+    {
+      Common_terminate("BENCHMARK", "A bot wasn't accepted, received too "
+        "few states or snapshots or the server didn't apply its inputs.");
+    }
+    NetClient_destroy(&clients[i]);
+  }
+  Thread_join(&serverThread);
+
+  printf("Bots: %d for %.0f seconds at %d ticks per second - %d "
+    "connected, %.1f states and %.1f snapshots received per bot and second "
+    "(%lld players compared with their states, %lld not relevant), %.1f%% "
+    "of the inputs applied until the end, %d left without a timeout.\n",
+    clientCount, seconds, server->tickRate, connectedCount,
+    stateCount / seconds / clientCount, snapshotCount / seconds /
+    clientCount, (long long)comparedCount, (long long)missingCount,
+    acknowledgedCount * 100.0 / MAX(1, inputCount),
+    clientCount - server->clientCount);
+
+  SessionBatch_destroy(&states);
+  free(clients);
+  free(inputs);
+  free(quantizedStates);
+  free(autopilots);
+}
+
+//Runs a server on the loopback interface for 256 bots, which play for 8
+//seconds (see "Benchmark_playOnServer").
+//pool: The worker pool used by the server.
+void Benchmark_server(WorkerPool *pool)
+{
+  Server server;
+
+  //The sessions collide and find the quest items like the game does.
+  Collision_initialize();
+  Pickup_initialize();
+
+  Server_initialize(&server, NET_LOOPBACK_HOST, 0, 256, serverTickRate,
+    serverInterestMode);
+  Benchmark_playOnServer(&server, pool, 256, 8, false);
+  Server_destroy(&server);
+
+  Pickup_destroy();
+  Collision_destroy();
+}
+
+//Counts the bytes of a snapshot part instead of sending it (for
+//"Snapshot_encode").
+//message: A pointer to the part.
+//data: A pointer to the byte counter (an uint64_t).
+void Benchmark_countSnapshotPart(const NetMessage *message, void *data)
+{
+  *(uint64_t *)data += message->size;
+}
+
+//Measures the size of the snapshots for 500 bots which play with the
+//autopilot (and how long encoding them takes) - once with complete
+//snapshots and once with the changes since the snapshot of two ticks
+//before (as if every client acknowledged it). Then runs a server on the
+//loopback interface for 500 bots spread over the map (see
+//"Benchmark_playOnServer"), which prints the snapshot sizes and encoding
+//times of the actual traffic.
+//pool: The worker pool used to step the sessions and by the server.
+void Benchmark_snapshots(WorkerPool *pool)
+{
+  const int clientCount = 500, tickCount = 200, baselineAge = 2;
+  const float deltaSeconds = 1.0f / serverTickRate;
+  SnapshotEntity *snapshots = (SnapshotEntity *)Common_allocate(
+    sizeof(SnapshotEntity) * SNAPSHOT_HISTORY * clientCount);
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * clientCount);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(sizeof(Autopilot) *
+    clientCount);
+  double encodeSeconds[2] = { 0, 0 };
+  uint64_t byteCounts[2] = { 0, 0 };
+  int partCounts[2] = { 0, 0 };
+  uint32_t random = 1;
+  SessionBatch sessions;
+  Server server;
+
+  //The bots follow the distance fields and collide like the game does.
+  Navigation_initialize();
+  Collision_initialize();
+  Pickup_initialize();
+
+  SnapshotLayout layout = SnapshotLayout_create();
+  SessionBatch_initialize(&sessions, clientCount);
+  Benchmark_spawnSessions(&sessions, &random);
+  for (int i = 0; i < clientCount; i++) Autopilot_reset(&autopilots[i]);
+
+  for (int tick = 1; tick <= tickCount; tick++)
+  {
+    SnapshotEntity *entities =
+      &snapshots[(tick % SNAPSHOT_HISTORY) * clientCount];
+    const SnapshotEntity *baseline = &snapshots[((tick - baselineAge) %
+      SNAPSHOT_HISTORY) * clientCount];
+
+    for (int i = 0; i < clientCount; i++)
+      Autopilot_steer(&autopilots[i], &sessions, i, deltaSeconds,
+        &inputs[i]);
+    SessionBatch_step(&sessions, pool, inputs, deltaSeconds);
+    for (int i = 0; i < clientCount; i++)
+      SnapshotEntity_quantize(&entities[i], &sessions, i);
+    if (tick <= baselineAge) continue;
+
+    for (int method = 0; method < 2; method++)
+    {
+      double startTime = Common_getTimeSeconds();
+      for (int i = 0; i < clientCount; i++)
+        partCounts[method] += Snapshot_encode(&layout, entities, NULL,
+          method == 0 ? NULL : baseline, NULL, clientCount, (uint32_t)tick,
+          (uint32_t)(tick - baselineAge), Benchmark_countSnapshotPart,
+          &byteCounts[method]);
+      encodeSeconds[method] += Common_getTimeSeconds() - startTime;
+    }
+  }
+
+  for (int method = 0; method < 2; method++)
+  {
+    int encodedTickCount = tickCount - baselineAge;
+    printf("Snapshots (%s): %.2f KiB/s per client at %d ticks per second "
+      "(%.1f%% of the players as floats, %.1f parts per snapshot), %.3f ms "
+      "per tick to encode them for %d clients.\n", method == 0 ?
+      "complete" : "delta-encoded", byteCounts[method] / 1024.0 /
+      ((double)encodedTickCount * clientCount) * serverTickRate,
+      serverTickRate, byteCounts[method] * 100.0 /
+      ((double)encodedTickCount * clientCount * clientCount * 25),
+      partCounts[method] / ((double)encodedTickCount * clientCount),
+      encodeSeconds[method] * 1000.0 / encodedTickCount, clientCount);
+  }
+
+  Server_initialize(&server, NET_LOOPBACK_HOST, 0, clientCount,
+    serverTickRate, InterestAll);
+  server.spawnAreaSize = MAX(mapWidth, mapDepth);
+  Benchmark_playOnServer(&server, pool, clientCount, 8, true);
+  Server_destroy(&server);
+
+  SessionBatch_destroy(&sessions);
+  Pickup_destroy();
+  Collision_destroy();
+  Navigation_destroy();
+  free(snapshots);
+  free(inputs);
+  free(autopilots);
+}
+
+//Measures the players replicated to 1000 bots which play with the
+//autopilot in a 128x128 part of the map - with all players, with the ones
+//in the cells around every bot and with the visible ones among them (see
+//"InterestMode"): the replicated players and the snapshot size per client
+//(delta-encoded against the snapshot of two ticks before), the time per
+//tick needed to update the relevant players and to encode the snapshots.
+//Fails if the incrementally updated relevant players differ from the ones
+//computed from scratch. Then runs a server on the loopback interface for
+//1000 bots in the same part of the map (see "Benchmark_playOnServer").
+//pool: The worker pool used to step the sessions and by the server.
+void Benchmark_interest(WorkerPool *pool)
+{
+  const char *modeNames[] = { "all", "distance", "visibility" };
+  const int clientCount = 1000, tickCount = 200, baselineAge = 2;
+  const int areaSize = 128;
+  const float deltaSeconds = 1.0f / serverTickRate;
+  SnapshotEntity *snapshots = (SnapshotEntity *)Common_allocate(
+    sizeof(SnapshotEntity) * SNAPSHOT_HISTORY * clientCount);
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * clientCount);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(sizeof(Autopilot) *
+    clientCount);
+  InterestGrid grids[3];
+  uint32_t *relevantHistories[3];
+  double interestSeconds[3] = { 0, 0, 0 }, encodeSeconds[3] = { 0, 0, 0 };
+  uint64_t byteCounts[3] = { 0, 0, 0 }, replicatedCounts[3] = { 0, 0, 0 };
+  uint32_t random = 1;
+  SessionBatch sessions;
+  Server server;
+
+  //The bots follow the distance fields and collide like the game does.
+  Navigation_initialize();
+  Collision_initialize();
+  Pickup_initialize();
+
+  SnapshotLayout layout = SnapshotLayout_create();
+  SessionBatch_initialize(&sessions, clientCount);
+  Benchmark_spawnSessionsInArea(&sessions, &random, areaSize);
+  for (int i = 0; i < clientCount; i++) Autopilot_reset(&autopilots[i]);
+  for (int mode = 0; mode < 3; mode++)
+  {
+    InterestGrid_initialize(&grids[mode], (InterestMode)mode, clientCount);
+    relevantHistories[mode] = (uint32_t *)Common_allocate(sizeof(uint32_t) *
+      SNAPSHOT_HISTORY * clientCount * grids[mode].wordCount);
+  }
+
+  for (int tick = 1; tick <= tickCount; tick++)
+  {
+    int slot = tick % SNAPSHOT_HISTORY;
+    int baselineSlot = (tick - baselineAge) % SNAPSHOT_HISTORY;
+    SnapshotEntity *entities = &snapshots[slot * clientCount];
+
+    for (int i = 0; i < clientCount; i++)
+      Autopilot_steer(&autopilots[i], &sessions, i, deltaSeconds,
+        &inputs[i]);
+    SessionBatch_step(&sessions, pool, inputs, deltaSeconds);
+    for (int i = 0; i < clientCount; i++)
+      SnapshotEntity_quantize(&entities[i], &sessions, i);
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+      InterestGrid *grid = &grids[mode];
+      int wordCount = grid->wordCount;
+      uint32_t *relevantBits = &relevantHistories[mode][slot * clientCount *
+        wordCount];
+      const uint32_t *baselineRelevantBits =
+        &relevantHistories[mode][baselineSlot * clientCount * wordCount];
+
+      double startTime = Common_getTimeSeconds();
+      for (int i = 0; i < clientCount; i++)
+        InterestGrid_move(grid, i, InterestGrid_getCell(grid,
+          sessions.positionsX[i], sessions.levels[i], sessions.positionsZ[i]));
+      memcpy(relevantBits, grid->relevantBits, sizeof(uint32_t) *
+        clientCount * wordCount);
+      if (tick <= baselineAge) continue;
+      interestSeconds[mode] += Common_getTimeSeconds() - startTime;
+
+      startTime = Common_getTimeSeconds();
+      for (int i = 0; i < clientCount; i++)
+      {
+        const uint32_t *bits = NULL, *baselineBits = NULL;
+        if (mode != InterestAll)
+        {
+          bits = &relevantBits[i * wordCount];
+          baselineBits = &baselineRelevantBits[i * wordCount];
+          replicatedCounts[mode] += Interest_countBits(bits, wordCount);
+        }
+        else replicatedCounts[mode] += clientCount;
+        Snapshot_encode(&layout, entities, bits, &snapshots[baselineSlot *
+          clientCount], baselineBits, clientCount, (uint32_t)tick,
+          (uint32_t)(tick - baselineAge), Benchmark_countSnapshotPart,
+          &byteCounts[mode]);
+      }
+      encodeSeconds[mode] += Common_getTimeSeconds() - startTime;
+    }
+  }
+
+  for (int mode = 0; mode < 3; mode++)
+  {
+    int encodedTickCount = tickCount - baselineAge;
+    printf("Interest (%s): %.1f of %d players replicated per client, %.2f "
+      "KiB/s per client at %d ticks per second, %.3f ms per tick to update "
+      "the relevant players (%llu cell borders crossed), %.3f ms per tick "
+      "to encode the snapshots.\n", modeNames[mode],
+      (double)replicatedCounts[mode] / ((double)encodedTickCount *
+      clientCount), clientCount, byteCounts[mode] / 1024.0 /
+      ((double)encodedTickCount * clientCount) * serverTickRate,
+      serverTickRate, interestSeconds[mode] * 1000.0 / encodedTickCount,
+      (unsigned long long)grids[mode].crossingCount,
+      encodeSeconds[mode] * 1000.0 / encodedTickCount);
+    if (!InterestGrid_check(&grids[mode])) Common_terminate("BENCHMARK",
+      "The relevant players differ from the ones computed from scratch.");
+    InterestGrid_destroy(&grids[mode]);
+    free(relevantHistories[mode]);
+  }
+  fflush(stdout);
+
+  Server_initialize(&server, NET_LOOPBACK_HOST, 0, clientCount,
+    serverTickRate, serverInterestMode);
+  server.spawnAreaSize = areaSize;
+  Benchmark_playOnServer(&server, pool, clientCount, 8, true);
+  Server_destroy(&server);
+
+  SessionBatch_destroy(&sessions);
+  Pickup_destroy();
+  Collision_destroy();
+  Navigation_destroy();
+  free(snapshots);
+  free(inputs);
+  free(autopilots);
+}
+
+//Runs a server on the loopback interface for 64 bots which play with the
+//autopilot on their predicted sessions (see "Prediction") - once without
+//delay, once with 100 ms and once with 200 ms round trip time (and up to 20
+//or 50 ms jitter per message, so that messages also arrive out of order).
+//Prints the prediction errors, the corrections, the offset of the shown
+//positions and how far behind the players would be shown without
+//prediction. Fails if a bot isn't accepted or receives too few states, if
+//more than 10% of the predictions had to be corrected or if the shown
+//positions are off by more than 0.05 units on average.
+//pool: The worker pool used to step the sessions and by the server.
+void Benchmark_prediction(WorkerPool *pool)
+{
+  const double latencies[] = { 0, 0.1, 0.2 }, jitters[] = { 0, 0.02, 0.05 };
+  const int clientCount = 64;
+  const double seconds = 6;
+  const float deltaSeconds = 1.0f / serverTickRate;
+  NetClient *clients = (NetClient *)Common_allocate(sizeof(NetClient) *
+    clientCount);
+  Prediction *predictions = (Prediction *)Common_allocate(
+    sizeof(Prediction) * clientCount);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(sizeof(Autopilot) *
+    clientCount);
+  SessionBatch states;
+  Server server;
+  BenchmarkServerRun run;
+
+  //The bots follow the distance fields and collide like the game does.
+  Navigation_initialize();
+  Collision_initialize();
+  Pickup_initialize();
+  SessionBatch_initialize(&states, clientCount);
+
+  for (int scenario = 0; scenario < (int)LENGTHOF(latencies); scenario++)
+  {
+    double *errors = NULL, offsetSum = 0, lagSum = 0;
+    int errorCount = 0, errorCapacity = 0, correctionCount = 0;
+    int snapCount = 0;
+    int64_t replayedCount = 0, shownCount = 0;
+
+    Server_initialize(&server, NET_LOOPBACK_HOST, 0, clientCount,
+      serverTickRate, InterestDistance);
+    server.spawnAreaSize = 128;
+    run.server = &server;
+    run.pool = pool;
+    run.seconds = seconds + 1;
+    Thread serverThread = Thread_create(Benchmark_runServer, &run);
+
+    NetAddress serverAddress = NetAddress_create(NET_LOOPBACK_HOST,
+      UdpSocket_getPort(&server.socket));
+    for (int i = 0; i < clientCount; i++)
+    {
+      NetClient_initialize(&clients[i], serverAddress);
+      if (latencies[scenario] > 0) NetClient_setDelay(&clients[i],
+        latencies[scenario], jitters[scenario], (uint32_t)i + 1);
+      Prediction_initialize(&predictions[i], serverTickRate);
+      Autopilot_reset(&autopilots[i]);
+    }
+
+    double startTime = Common_getTimeSeconds(), stepTime = startTime;
+    while (Common_getTimeSeconds() - startTime < seconds)
+    {
+      for (int i = 0; i < clientCount; i++)
+      {
+        Prediction *prediction = &predictions[i];
+        if (NetClient_receive(&clients[i], &states, i))
+        {
+          int reconcileCount = prediction->reconcileCount;
+          replayedCount += prediction->sequence -
+            clients[i].acknowledgedSequence;
+          double error = Prediction_reconcile(prediction, &states, i,
+            clients[i].acknowledgedSequence);
+          if (prediction->reconcileCount > reconcileCount)
+          {
+            if (errorCount == errorCapacity)
+            {
+              errorCapacity = MAX(1024, errorCapacity * 2);
+              double *newErrors = (double *)Common_allocate(sizeof(double) *
+                errorCapacity);
+              if (errorCount > 0) memcpy(newErrors, errors, sizeof(double) *
+                errorCount);
+              free(errors);
+              errors = newErrors;
+            }
+            errors[errorCount++] = error;
+          }
+        }
+        if (clients[i].index < 0)
+        {
+          NetClient_connect(&clients[i]);
+          continue;
+        }
+
+        SessionInput input;
+        memset(&input, 0, sizeof(input));
+        if (prediction->isStarted) Autopilot_steer(&autopilots[i],
+          &prediction->session, 0, deltaSeconds, &input);
+        NetClient_sendInput(&clients[i], &input);
+        Prediction_step(prediction, clients[i].inputSequence, &input);
+        if (!prediction->isStarted ||
+          states.levels[i] != prediction->session.levels[0]) continue;
+
+        //Without prediction, the player would be shown at the newest state.
+        float x, y, z;
+        Prediction_getPosition(prediction, &x, &y, &z);
+        float lagX = states.positionsX[i] - prediction->session.positionsX[0];
+        float lagZ = states.positionsZ[i] - prediction->session.positionsZ[0];
+        offsetSum += sqrtf((x - prediction->session.positionsX[0]) *
+          (x - prediction->session.positionsX[0]) +
+          (z - prediction->session.positionsZ[0]) *
+          (z - prediction->session.positionsZ[0]));
+        lagSum += sqrtf(lagX * lagX + lagZ * lagZ);
+        shownCount++;
+      }
+
+      stepTime += deltaSeconds;
+      double currentTime = Common_getTimeSeconds();
+      if (stepTime > currentTime) Thread_sleep(stepTime - currentTime);
+      else stepTime = currentTime;
+    }
+
+    for (int i = 0; i < clientCount; i++)
+    {
+      if (clients[i].index < 0 || clients[i].stateCount < seconds *
+        serverTickRate / 2) Common_terminate("BENCHMARK", "A bot wasn't "
+        "accepted or received too few states.");
+      correctionCount += predictions[i].correctionCount;
+      snapCount += predictions[i].snapCount;
+      NetClient_destroy(&clients[i]);
+      Prediction_destroy(&predictions[i]);
+    }
+    Thread_join(&serverThread);
+    Server_destroy(&server);
+
+    double errorSum = 0;
+    qsort(errors, errorCount, sizeof(double), Lap_compareSeconds);
+    for (int i = 0; i < errorCount; i++) errorSum += errors[i];
+    printf("Prediction (%.0f ms round trip, %.0f ms jitter): %d bots, %d "
+      "states reconciled (with %.1f inputs replayed on average) - "
+      "prediction error %.4f units on average, %.4f at the 99th "
+      "percentile, %.3f at most, %.2f%% of the predictions corrected (%d "
+      "at once) - the shown positions are %.4f units off on average, "
+      "without prediction they would be %.3f units behind.\n",
+      latencies[scenario] * 1000.0, jitters[scenario] * 1000.0, clientCount,
+      errorCount, (double)replayedCount / MAX(1, errorCount),
+      errorSum / MAX(1, errorCount), errorCount > 0 ?
+      errors[(int)(errorCount * 0.99)] : 0.0, errorCount > 0 ?
+      errors[errorCount - 1] : 0.0, correctionCount * 100.0 /
+      MAX(1, errorCount), snapCount, offsetSum / MAX(1, shownCount),
+      lagSum / MAX(1, shownCount));
+    fflush(stdout);
+    free(errors);
+
+    if (correctionCount > errorCount / 10 || offsetSum > 0.05 * shownCount)
+      Common_terminate("BENCHMARK", "The predictions are wrong too often.");
+  }
+
+  SessionBatch_destroy(&states);
+  Pickup_destroy();
+  Collision_destroy();
+  Navigation_destroy();
+  free(clients);
+  free(predictions);
+  free(autopilots);
+}
+
+//The inputs of every bot in the load benchmark whose send times are kept
+//until the server acknowledges them.
+#define BENCHMARK_LOAD_INPUTS 64
+
+//Runs a server on the loopback interface (on its own thread) for lightweight
+//bots, which play with the autopilot on the states they receive and only
+//acknowledge the snapshots instead of decoding them. Measures the tick
+//times and the traffic of the server and the input latency of the bots -
+//the time from sending an input until receiving the first state it was
+//applied to (the bots check for messages four times per tick).
+//pool: The worker pool used by the server.
+//clientCount: The amount of bots.
+//seconds: The time the server runs.
+//file: The CSV file to append the results to (or NULL).
+void Benchmark_measureLoad(WorkerPool *pool, int clientCount, double seconds,
+  FILE *file)
+{
+  const float deltaSeconds = 1.0f / serverTickRate;
+  NetClient *clients = (NetClient *)Common_allocate(sizeof(NetClient) *
+    clientCount);
+  SessionInput *inputs = (SessionInput *)Common_allocate(
+    sizeof(SessionInput) * clientCount);
+  Autopilot *autopilots = (Autopilot *)Common_allocate(sizeof(Autopilot) *
+    clientCount);
+  double *sendTimes = (double *)Common_allocate(sizeof(double) *
+    BENCHMARK_LOAD_INPUTS * clientCount);
+  double *latencies = NULL, latencySum = 0;
+  int latencyCount = 0, latencyCapacity = 0, stepCount = 0;
+  SessionBatch states;
+  Server server;
+  BenchmarkServerRun run;
+
+  //The bots are spread over a part of the map, so that they don't all see
+  //each other (like players on a big map).
+  Server_initialize(&server, NET_LOOPBACK_HOST, 0, clientCount,
+    serverTickRate, serverInterestMode);
+  server.spawnAreaSize = 256;
+  server.statisticsInterval = 0;
+  run.server = &server;
+  run.pool = pool;
+  run.seconds = seconds;
+  Thread serverThread = Thread_create(Benchmark_runServer, &run);
+
+  NetAddress serverAddress = NetAddress_create(NET_LOOPBACK_HOST,
+    UdpSocket_getPort(&server.socket));
+  SessionBatch_initialize(&states, clientCount);
+  memset(inputs, 0, sizeof(SessionInput) * clientCount);
+  for (int i = 0; i < clientCount; i++)
+  {
+    NetClient_initialize(&clients[i], serverAddress);
+    clients[i].isDecodingSnapshots = false;
+    Autopilot_reset(&autopilots[i]);
+  }
+
+  //The bots play a bit longer than the server runs, so that every tick of
+  //the server gets their inputs.
+  double startTime = Common_getTimeSeconds(), stepTime = startTime;
+  double currentTime = startTime;
+  while (currentTime - startTime < seconds + 0.5)
+  {
+    bool isStepping = currentTime >= stepTime;
+    for (int i = 0; i < clientCount; i++)
+    {
+      NetClient *client = &clients[i];
+      uint32_t acknowledgedSequence = client->acknowledgedSequence;
+      if (NetClient_receive(client, &states, i))
+      {
+        double receiveTime = Common_getTimeSeconds();
+        for (uint32_t sequence = acknowledgedSequence + 1;
+          sequence <= client->acknowledgedSequence; sequence++)
+        {
+          if (client->inputSequence - sequence >= BENCHMARK_LOAD_INPUTS)
+            continue;
+          if (latencyCount == latencyCapacity)
+          {
+            latencyCapacity = MAX(1024, latencyCapacity * 2);
+            double *newLatencies = (double *)Common_allocate(sizeof(double)
+              * latencyCapacity);
+            if (latencyCount > 0) memcpy(newLatencies, latencies,
+              sizeof(double) * latencyCount);
+            free(latencies);
+            latencies = newLatencies;
+          }
+          latencies[latencyCount] = receiveTime - sendTimes[i *
+            BENCHMARK_LOAD_INPUTS + sequence % BENCHMARK_LOAD_INPUTS];
+          latencySum += latencies[latencyCount++];
+        }
+      }
+      if (!isStepping) continue;
+
+      if (client->index < 0)
+      {
+        NetClient_connect(client);
+        continue;
+      }
+      if (client->stateCount > 0) Autopilot_steer(&autopilots[i], &states,
+        i, deltaSeconds, &inputs[i]);
+      NetClient_sendInput(client, &inputs[i]);
+      sendTimes[i * BENCHMARK_LOAD_INPUTS + client->inputSequence %
+        BENCHMARK_LOAD_INPUTS] = Common_getTimeSeconds();
+    }
+
+    //The bots step with the tick rate of the server (and skip steps if they
+    //can't keep up).
+    currentTime = Common_getTimeSeconds();
+    if (isStepping)
+    {
+      stepCount++;
+      stepTime += deltaSeconds;
+      if (stepTime < currentTime) stepTime = currentTime;
+    }
+    double nextTime = MIN(stepTime, currentTime + deltaSeconds / 4);
+    if (nextTime > currentTime) Thread_sleep(nextTime - currentTime);
+    currentTime = Common_getTimeSeconds();
+  }
+  double botSeconds = currentTime - startTime;
+  Thread_join(&serverThread);
+
+  int connectedCount = 0;
+  for (int i = 0; i < clientCount; i++)
+  {
+    connectedCount += clients[i].index >= 0;
+    NetClient_destroy(&clients[i]);
+  }
+  if (connectedCount < clientCount)
+    Common_terminate("BENCHMARK", "A bot wasn't accepted.");
+
+  const ServerStatistics *statistics = &server.statistics;
+  double median = 0, percentile = 0, maximum = 0;
+  qsort(latencies, latencyCount, sizeof(double), Lap_compareSeconds);
+  if (latencyCount > 0)
+  {
+    median = latencies[latencyCount / 2];
+    percentile = latencies[(int)(latencyCount * 0.99)];
+    maximum = latencies[latencyCount - 1];
+  }
+  double tickRate = statistics->tickCount / statistics->seconds;
+  printf("Load (%d bots): %.1f ticks per second (of %d), tick time %.3f ms "
+    "on average, %.3f ms at the 99th percentile - %.1f KiB/s sent (%.2f "
+    "KiB/s per bot, %.2f KiB/s of it snapshots), %.1f KiB/s received - "
+    "input latency %.1f ms on average, %.1f ms median, %.1f ms 99th "
+    "percentile, %.1f ms at most - %.1f bot steps per second.\n",
+    clientCount, tickRate, serverTickRate,
+    statistics->averageTickSeconds * 1000.0,
+    statistics->percentileTickSeconds * 1000.0,
+    statistics->sentRate / 1024.0,
+    statistics->sentRate / 1024.0 / clientCount,
+    statistics->snapshotRate / 1024.0, statistics->receivedRate / 1024.0,
+    latencySum * 1000.0 / MAX(1, latencyCount), median * 1000.0,
+    percentile * 1000.0, maximum * 1000.0, stepCount / botSeconds);
+  fflush(stdout);
+
+  if (file != NULL)
+  {
+    fprintf(file, "%d,%d,%.2f,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f,%.3f,%.1f,%d,"
+      "%.3f,%.3f,%.3f,%.3f,%.2f\n", clientCount, serverTickRate, tickRate,
+      statistics->averageTickSeconds * 1000.0,
+      statistics->medianTickSeconds * 1000.0,
+      statistics->percentileTickSeconds * 1000.0,
+      statistics->maximumTickSeconds * 1000.0,
+      statistics->sentRate / 1024.0, statistics->receivedRate / 1024.0,
+      statistics->snapshotRate / 1024.0, statistics->replicatedCount,
+      statistics->missedInputCount,
+      latencySum * 1000.0 / MAX(1, latencyCount), median * 1000.0,
+      percentile * 1000.0, maximum * 1000.0, stepCount / botSeconds);
+    fflush(file);
+  }
+
+  Server_destroy(&server);
+  SessionBatch_destroy(&states);
+  free(clients);
+  free(inputs);
+  free(autopilots);
+  free(sendTimes);
+  free(latencies);
+}
+
+//Measures how many clients a server can handle: runs a server for 8
+//seconds with 32 bots, then with twice as many and so on, up to the amount
+//given with "--bots" (see "Benchmark_measureLoad") - and writes the results
+//into the file given with "--csv" (if any).
+//pool: The worker pool used by the server.
+void Benchmark_load(WorkerPool *pool)
+{
+  FILE *file = NULL;
+  if (loadTestCsvPath != NULL)
+  {
+    if ((file = fopen(loadTestCsvPath, "w")) == NULL)
+      Common_terminate("BENCHMARK", "The CSV file couldn't be opened.");
+    fprintf(file, "bots,tick_rate,ticks_per_second,tick_ms_average,"
+      "tick_ms_median,tick_ms_99th_percentile,tick_ms_maximum,sent_kib_s,"
+      "received_kib_s,snapshot_kib_s_per_bot,replicated_per_bot,"
+      "missed_inputs,latency_ms_average,latency_ms_median,"
+      "latency_ms_99th_percentile,latency_ms_maximum,bot_steps_per_second"
+      "\n");
+  }
+
+  //The bots follow the distance fields and the sessions collide and find
+  //the quest items like the game does.
+  Navigation_initialize();
+  Collision_initialize();
+  Pickup_initialize();
+
+  for (int clientCount = MIN(32, loadTestBotCount); ;
+    clientCount = MIN(clientCount * 2, loadTestBotCount))
+  {
+    Benchmark_measureLoad(pool, clientCount, 8, file);
+    if (clientCount == loadTestBotCount) break;
+  }
+
+  Pickup_destroy();
+  Collision_destroy();
+  Navigation_destroy();
+  if (file != NULL && fclose(file) != 0)
+    Common_terminate("BENCHMARK", "The CSV file couldn't be written.");
+}
+
+//Measures how long updating many maze dwellers takes (single-threaded and
+//on the worker pool) and how long collecting the visible ones for drawing
+//takes. Also checks that no maze dweller ends up in a blocking field.
+//pool: The worker pool for the multi-threaded updates.
+void Benchmark_npcs(WorkerPool *pool)
+{
+  const int populationCount = 100000, tickCount = 200;
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+  NpcPopulation population;
+  int playerField = 0;
+
+  NpcPopulation_initialize(&population, map, mapWidth, mapDepth, mapLevels,
+    populationCount, 1);
+  //The avoidance is measured separately (see "Benchmark_crowd").
+  population.isAvoiding = false;
+  //The player stands on the first walkable field, so that some maze 
+  //dwellers are chasing.
+  while (!Analysis_isWalkable(map[playerField])) playerField++;
+  float targetX = (float)(playerField / mapDepth);
+  float targetZ = (float)(playerField % mapDepth);
+
+  double slowestTick = 0.0, startTime = Common_getTimeSeconds();
+  for (int tick = 0; tick < tickCount; tick++)
+  {
+    double tickStartTime = Common_getTimeSeconds();
+    NpcPopulation_updateAll(&population, NULL, deltaSeconds, targetX, 0,
+      targetZ);
+    slowestTick = MAX(slowestTick, Common_getTimeSeconds() - tickStartTime);
+  }
+  double singleSeconds = Common_getTimeSeconds() - startTime;
+
+  startTime = Common_getTimeSeconds();
+  for (int tick = 0; tick < tickCount; tick++)
+    NpcPopulation_updateAll(&population, pool, deltaSeconds, targetX, 0,
+      targetZ);
+  double parallelSeconds = Common_getTimeSeconds() - startTime;
+
+  float *instances = (float *)Common_allocate(sizeof(float) * 4 *
+    population.count);
+  int instanceCount = 0;
+  startTime = Common_getTimeSeconds();
+  for (int tick = 0; tick < tickCount; tick++)
+    instanceCount = NpcPopulation_getInstances(&population, targetX, 0,
+      targetZ, FADE_DISTANCE + 1.0f, instances, population.count);
+  double instanceSeconds = Common_getTimeSeconds() - startTime;
+
+  int chasingCount = 0;
+  for (int i = 0; i < population.count; i++)
+  {
+    chasingCount += population.states[i] == NpcChasing;
+    if (NpcPopulation_isBlocking(&population,
+      (int)floorf(population.positionsX[i] + 0.5f), population.levels[i],
+      (int)floorf(population.positionsZ[i] + 0.5f)))
+      Common_terminate("BENCHMARK", "A maze dweller entered a wall.");
+  }
+
+  printf("Maze dwellers: %d on %d fields, %d ticks (%d chasing at the "
+    "end).\n", population.count, mapWidth * mapDepth * mapLevels, tickCount,
+    chasingCount);
+  printf("Update: %.3f ms per tick on one thread (%.3f ms at most, %.1f ns "
+    "per maze dweller), %.3f ms with %d threads.\n",
+    singleSeconds * 1000.0 / tickCount, slowestTick * 1000.0,
+    singleSeconds * 1000000000.0 / tickCount / population.count,
+    parallelSeconds * 1000.0 / tickCount, pool->threadCount + 1);
+  printf("Instances: %.3f ms per frame to collect the %d maze dwellers close "
+    "to the player.\n", instanceSeconds * 1000.0 / tickCount, instanceCount);
+
+  free(instances);
+  NpcPopulation_destroy(&population);
+}
+
+//Spawns the maze dwellers of the "crowd" benchmark: two on every walkable
+//field of the first level (in the order of the fields), so that they fill
+//the corridors of a part of the map.
+//population: A pointer to the (uninitialized) population.
+//count: The amount of maze dwellers.
+void Benchmark_spawnCrowd(NpcPopulation *population, int count)
+{
+  int field = 0;
+
+  NpcPopulation_initialize(population, map, mapWidth, mapDepth, mapLevels,
+    count, 1);
+  for (int i = 0; i < count; i++)
+  {
+    while (field < mapWidth * mapDepth && !Analysis_isWalkable(map[field]))
+      field++;
+    if (field == mapWidth * mapDepth)
+      Common_terminate("BENCHMARK", "The map is too small for the crowd.");
+
+    population->positionsX[i] =
+      (float)(field / mapDepth) + (i % 2 == 0 ? -0.25f : 0.25f);
+    population->positionsZ[i] = (float)(field % mapDepth);
+    population->levels[i] = 0;
+    if (i % 2 == 1) field++;
+  }
+}
+
+//Counts the pairs of maze dwellers which overlap.
+//population: A pointer to the population (with an up-to-date spatial hash).
+int Benchmark_countOverlaps(const NpcPopulation *population)
+{
+  int neighbours[NPC_MAX_NEIGHBOURS + 1], overlapCount = 0;
+
+  for (int i = 0; i < population->count; i++)
+  {
+    int neighbourCount = SpatialHash_queryRadius(&population->hash,
+      population->positionsX[i], population->levels[i],
+      population->positionsZ[i], 2.0f * NPC_RADIUS, neighbours,
+      LENGTHOF(neighbours));
+    for (int n = 0; n < neighbourCount; n++) overlapCount += neighbours[n] > i;
+  }
+
+  return overlapCount;
+}
+
+//Measures the local avoidance of maze dwellers packed into the corridors of
+//a part of the map: the time per update without the avoidance and with it
+//(on one thread and on the worker pool), how many neighbour queries per 
+//second the spatial hash answers and how many maze dwellers overlap at the
+//end. Fails if a maze dweller ends up in a blocking field or if the 
+//multi-threaded avoidance gets a different result.
+//pool: The worker pool for the multi-threaded updates.
+void Benchmark_crowd(WorkerPool *pool)
+{
+  const int populationCount = 16384, tickCount = 200, queryRounds = 20;
+  const float deltaSeconds = UPDATE_TIMEOUT_MS / 1000.0f;
+  NpcPopulation populations[3];
+  double seconds[3], slowestTicks[3];
+  int overlapCounts[3];
+  const char *runNames[3] = { "without avoidance", "one thread",
+    "worker pool" };
+
+  //Nobody chases the target (which is on no level), so that the maze 
+  //dwellers wander into each other in the corridors.
+  for (int run = 0; run < 3; run++)
+  {
+    NpcPopulation *population = &populations[run];
+    Benchmark_spawnCrowd(population, populationCount);
+    population->isAvoiding = run > 0;
+
+    slowestTicks[run] = 0.0;
+    double startTime = Common_getTimeSeconds();
+    for (int tick = 0; tick < tickCount; tick++)
+    {
+      double tickStartTime = Common_getTimeSeconds();
+      NpcPopulation_updateAll(population, run == 2 ? pool : NULL,
+        deltaSeconds, 0.0f, -1, 0.0f);
+      slowestTicks[run] = MAX(slowestTicks[run],
+        Common_getTimeSeconds() - tickStartTime);
+    }
+    seconds[run] = Common_getTimeSeconds() - startTime;
+
+    SpatialHash_rebuild(&population->hash, population->count,
+      population->positionsX, population->levels, population->positionsZ);
+    overlapCounts[run] = Benchmark_countOverlaps(population);
+    for (int i = 0; i < population->count; i++)
+    {
+      if (NpcPopulation_isBlocking(population,
+        (int)floorf(population->positionsX[i] + 0.5f), population->levels[i],
+        (int)floorf(population->positionsZ[i] + 0.5f)))
+        Common_terminate("BENCHMARK", "A maze dweller entered a wall.");
+    }
+  }
+
+  if (memcmp(populations[1].positionsX, populations[2].positionsX,
+    sizeof(float) * populationCount) ||
+    memcmp(populations[1].positionsZ, populations[2].positionsZ,
+    sizeof(float) * populationCount)) Common_terminate("BENCHMARK",
+    "The avoidance on the worker pool got a different result.");
+
+  //The queries of the avoidance, which find the maze dwellers within the
+  //avoidance distance (including the one at the position).
+  int neighbours[NPC_MAX_NEIGHBOURS + 1];
+  int64_t neighbourCount = 0;
+  const SpatialHash *hash = &populations[1].hash;
+  double startTime = Common_getTimeSeconds();
+  for (int round = 0; round < queryRounds; round++)
+  {
+    for (int i = 0; i < populationCount; i++)
+      neighbourCount += SpatialHash_queryRadius(hash,
+        populations[1].positionsX[i], populations[1].levels[i],
+        populations[1].positionsZ[i], NPC_AVOIDANCE_DISTANCE, neighbours,
+        LENGTHOF(neighbours));
+  }
+  double querySeconds = Common_getTimeSeconds() - startTime;
+
+  startTime = Common_getTimeSeconds();
+  for (int round = 0; round < queryRounds; round++)
+    SpatialHash_rebuild(&populations[1].hash, populationCount,
+      populations[1].positionsX, populations[1].levels,
+      populations[1].positionsZ);
+  double rebuildSeconds = Common_getTimeSeconds() - startTime;
+
+  printf("Crowd: %d maze dwellers on %d fields, %d ticks.\n",
+    populationCount, (populationCount + 1) / 2, tickCount);
+  for (int run = 0; run < 3; run++)
+  {
+    printf("Update (%s): %.3f ms per tick (%.3f ms at most), %d "
+      "overlapping pairs at the end.\n", runNames[run],
+      seconds[run] * 1000.0 / tickCount, slowestTicks[run] * 1000.0,
+      overlapCounts[run]);
+  }
+  printf("Worker pool: %d threads, %.2fx faster than one thread.\n",
+    pool->threadCount + 1, seconds[1] / seconds[2]);
+  printf("Neighbour queries: %.2f million per second on one thread (%.1f "
+    "maze dwellers found on average), %.3f ms to rebuild the spatial "
+    "hash.\n", queryRounds * populationCount / querySeconds / 1000000.0,
+    (double)neighbourCount / queryRounds / populationCount,
+    rebuildSeconds * 1000.0 / queryRounds);
+
+  for (int run = 0; run < 3; run++) NpcPopulation_destroy(&populations[run]);
+}
+
+//Moves entities of the "spatial-hash" benchmark by their velocities, where
+//they bounce off the borders of the map.
+//positionsX, positionsZ, velocitiesX, velocitiesZ: The entities.
+//count: The amount of entities to move (from the first one).
+void Benchmark_moveEntities(float *positionsX, float *positionsZ,
+  float *velocitiesX, float *velocitiesZ, int count)
+{
+  const float maxX = (float)(mapWidth - 1), maxZ = (float)(mapDepth - 1);
+
+  for (int i = 0; i < count; i++)
+  {
+    positionsX[i] += velocitiesX[i];
+    positionsZ[i] += velocitiesZ[i];
+    if (positionsX[i] < 0.0f || positionsX[i] > maxX)
+    {
+      velocitiesX[i] = -velocitiesX[i];
+      positionsX[i] = MAX(0.0f, MIN(maxX, positionsX[i]));
+    }
+    if (positionsZ[i] < 0.0f || positionsZ[i] > maxZ)
+    {
+      velocitiesZ[i] = -velocitiesZ[i];
+      positionsZ[i] = MAX(0.0f, MIN(maxZ, positionsZ[i]));
+    }
+  }
+}
+
+//Compares the results of a radius query with all entities within the
+//radius (found without the hash) and fails if they differ.
+//results, count: The found entities.
+//x, level, z, radius: The query.
+//positionsX, levels, positionsZ: The positions of the entities.
+//entityCount: The amount of entities.
+//isRemoved: The removed entities (which must not be found) or NULL.
+void Benchmark_checkQuery(const int *results, int count, float x, int level,
+  float z, float radius, const float *positionsX, const int *levels,
+  const float *positionsZ, int entityCount, const bool *isRemoved)
+{
+  int expectedCount = 0;
+  int64_t expectedSum = 0, sum = 0;
+
+  for (int i = 0; i < entityCount; i++)
+  {
+    float offsetX = positionsX[i] - x, offsetZ = positionsZ[i] - z;
+    if (levels[i] != level || (isRemoved != NULL && isRemoved[i]) ||
+      offsetX * offsetX + offsetZ * offsetZ > radius * radius) continue;
+    expectedCount++;
+    expectedSum += i;
+  }
+  for (int i = 0; i < count; i++) sum += results[i];
+
+  if (count != expectedCount || sum != expectedSum)
+    Common_terminate("BENCHMARK", "A spatial hash query failed.");
+}
+
+//Measures the spatial hash with 100000 entities moving across the map: the
+//time per update when the hash is rebuilt (with a counting sort) compared to
+//moving the changed entities (when all, 10% or 1% of them move) and the 
+//queries per second with both. Fails if a query gets a different result than
+//testing all entities, also after removing half of them.
+//pool: Unused.
+void Benchmark_spatialHash(WorkerPool *pool)
+{
+  pool;
+  const int entityCount = 100000, tickCount = 50, queryCount = 100000;
+  const int checkedQueryCount = 100, resultCapacity = entityCount;
+  const int movingPercentages[3] = { 100, 10, 1 };
+  const float queryRadius = 2.0f, cellSize = 1.0f;
+  float *positionsX = (float *)Common_allocate(sizeof(float) * entityCount);
+  float *positionsZ = (float *)Common_allocate(sizeof(float) * entityCount);
+  float *velocitiesX = (float *)Common_allocate(sizeof(float) * entityCount);
+  float *velocitiesZ = (float *)Common_allocate(sizeof(float) * entityCount);
+  int *levels = (int *)Common_allocate(sizeof(int) * entityCount);
+  bool *isRemoved = (bool *)Common_allocate(sizeof(bool) * entityCount);
+  int *results = (int *)Common_allocate(sizeof(int) * resultCapacity);
+  uint32_t random = 1;
+  SpatialHash rebuilt, incremental;
+
+  for (int i = 0; i < entityCount; i++)
+  {
+    positionsX[i] = (float)(Maze_random(&random) % (mapWidth * 64)) / 64.0f;
+    positionsZ[i] = (float)(Maze_random(&random) % (mapDepth * 64)) / 64.0f;
+    velocitiesX[i] = (float)((int)(Maze_random(&random) % 201) - 100) / 500.0f;
+    velocitiesZ[i] = (float)((int)(Maze_random(&random) % 201) - 100) / 500.0f;
+    levels[i] = (int)(Maze_random(&random) % mapLevels);
+    isRemoved[i] = false;
+  }
+
+  SpatialHash_initialize(&rebuilt, cellSize, entityCount);
+  SpatialHash_initialize(&incremental, cellSize, entityCount);
+  double startTime = Common_getTimeSeconds();
+  for (int i = 0; i < entityCount; i++)
+    SpatialHash_insert(&incremental, i, positionsX[i], levels[i],
+      positionsZ[i]);
+  double insertSeconds = Common_getTimeSeconds() - startTime;
+
+  printf("Spatial hash: %d entities on %d fields, %.1f units per cell, "
+    "%.3f ms to insert all of them.\n", entityCount,
+    mapWidth * mapDepth * mapLevels, cellSize, insertSeconds * 1000.0);
+
+  for (int run = 0; run < 3; run++)
+  {
+    int movingCount = entityCount * movingPercentages[run] / 100;
+    double rebuildSeconds = 0.0, incrementalSeconds = 0.0;
+
+    for (int tick = 0; tick < tickCount; tick++)
+    {
+      Benchmark_moveEntities(positionsX, positionsZ, velocitiesX,
+        velocitiesZ, movingCount);
+
+      startTime = Common_getTimeSeconds();
+      SpatialHash_rebuild(&rebuilt, entityCount, positionsX, levels,
+        positionsZ);
+      rebuildSeconds += Common_getTimeSeconds() - startTime;
+
+      startTime = Common_getTimeSeconds();
+      for (int i = 0; i < movingCount; i++)
+        SpatialHash_move(&incremental, i, positionsX[i], levels[i],
+          positionsZ[i]);
+      incrementalSeconds += Common_getTimeSeconds() - startTime;
+    }
+
+    printf("Update with %d%% moving: %.3f ms per tick to rebuild, %.3f ms "
+      "to move the entities.\n", movingPercentages[run],
+      rebuildSeconds * 1000.0 / tickCount,
+      incrementalSeconds * 1000.0 / tickCount);
+  }
+
+  //The queries are placed on random entities, so that they find some.
+  double querySeconds[2];
+  int64_t foundCount = 0;
+  for (int method = 0; method < 2; method++)
+  {
+    const SpatialHash *hash = method == 0 ? &rebuilt : &incremental;
+    startTime = Common_getTimeSeconds();
+    for (int query = 0; query < queryCount; query++)
+    {
+      int i = (int)(((int64_t)query * 7919) % entityCount);
+      int count = SpatialHash_queryRadius(hash, positionsX[i], levels[i],
+        positionsZ[i], queryRadius, results, resultCapacity);
+      if (method == 0) foundCount += count;
+      if (query < checkedQueryCount) Benchmark_checkQuery(results, count,
+        positionsX[i], levels[i], positionsZ[i], queryRadius, positionsX,
+        levels, positionsZ, entityCount, NULL);
+    }
+    querySeconds[method] = Common_getTimeSeconds() - startTime;
+  }
+
+  startTime = Common_getTimeSeconds();
+  int64_t boxFoundCount = 0;
+  for (int query = 0; query < queryCount; query++)
+  {
+    int i = (int)(((int64_t)query * 7919) % entityCount);
+    boxFoundCount += SpatialHash_queryBox(&rebuilt, positionsX[i] - 
+      queryRadius, levels[i], positionsZ[i] - queryRadius,
+      positionsX[i] + queryRadius, positionsZ[i] + queryRadius, results,
+      resultCapacity);
+  }
+  double boxSeconds = Common_getTimeSeconds() - startTime;
+
+  printf("Radius queries: %.2f million per second after rebuilding, %.2f "
+    "million per second with moved entities (%.1f entities found on "
+    "average).\n", queryCount / querySeconds[0] / 1000000.0,
+    queryCount / querySeconds[1] / 1000000.0,
+    (double)foundCount / queryCount);
+  printf("Box queries: %.2f million per second after rebuilding (%.1f "
+    "entities found on average).\n", queryCount / boxSeconds / 1000000.0,
+    (double)boxFoundCount / queryCount);
+
+  startTime = Common_getTimeSeconds();
+  for (int i = 0; i < entityCount; i += 2)
+  {
+    SpatialHash_remove(&incremental, i);
+    isRemoved[i] = true;
+  }
+  double removeSeconds = Common_getTimeSeconds() - startTime;
+  for (int query = 0; query < checkedQueryCount; query++)
+  {
+    int i = (int)(((int64_t)query * 7919) % entityCount);
+    int count = SpatialHash_queryRadius(&incremental, positionsX[i],
+      levels[i], positionsZ[i], queryRadius, results, resultCapacity);
+    Benchmark_checkQuery(results, count, positionsX[i], levels[i],
+      positionsZ[i], queryRadius, positionsX, levels, positionsZ,
+      entityCount, isRemoved);
+  }
+  if (incremental.count != entityCount / 2)
+    Common_terminate("BENCHMARK", "The spatial hash lost an entity.");
+  printf("Remove: %.3f ms to remove half of the entities.\n",
+    removeSeconds * 1000.0);
+
+  SpatialHash_destroy(&rebuilt);
+  SpatialHash_destroy(&incremental);
+  free(positionsX);
+  free(positionsZ);
+  free(velocitiesX);
+  free(velocitiesZ);
+  free(levels);
+  free(isRemoved);
+  free(results);
+}
+
+//Contains the chunks of the map which are meshed in the "job-system"
+//benchmark and the amount of vertex data of every chunk.
+typedef struct
+{
+  WorkerPool *pool;
+  int chunkCountX, chunkCountZ;
+  int *lengths;
+  //The amount of vertex data of all chunks of a row of chunks along the Z
+  //axis (for every row, on every level).
+  int64_t *rowLengths;
+  //One counter for the chunks of every row.
+  WorkerPoolCounter *rowCounters;
+} BenchmarkMeshingJobs;
+
+//Contains a chunk or a row of chunks for a task of the "job-system"
+//benchmark.
+typedef struct
+{
+  BenchmarkMeshingJobs *jobs;
+  int index;
+} BenchmarkMeshingTask;
+
+//Builds the mesh of a chunk of the map and stores the amount of vertex data.
+//jobsPointer: A pointer to the BenchmarkMeshingJobs.
+//index: The index of the chunk (in rows of chunks along the Z axis).
+void Benchmark_meshChunk(void *jobsPointer, int index)
+{
+  BenchmarkMeshingJobs *jobs = (BenchmarkMeshingJobs *)jobsPointer;
+  Field fields[CHUNK_PADDED_SIZE * CHUNK_PADDED_SIZE];
+  Field fieldsBelow[CHUNK_SIZE * CHUNK_SIZE];
+  int chunkZ = index % jobs->chunkCountZ;
+  int chunkX = (index / jobs->chunkCountZ) % jobs->chunkCountX;
+  int level = index / jobs->chunkCountZ / jobs->chunkCountX;
+  int validWidth, validDepth;
+
+  World_getValidChunkSize(chunkX, chunkZ, &validWidth, &validDepth);
+  World_copyFieldsForMeshing(chunkX, level, chunkZ, fields, fieldsBelow);
+  int length = World_buildChunkMesh(fields, fieldsBelow, chunkX, level,
+    chunkZ, validWidth, validDepth, NULL);
+  float *vertexData = (float *)Common_allocate(sizeof(float) * length);
+  jobs->lengths[index] = World_buildChunkMesh(fields, fieldsBelow, chunkX,
+    level, chunkZ, validWidth, validDepth, vertexData);
+  free(vertexData);
+}
+
+//Builds the mesh of one chunk of a row (see "Benchmark_meshChunkRow").
+//taskPointer: A pointer to the BenchmarkMeshingTask of the row.
+//chunkZ: The Z index of the chunk.
+void Benchmark_meshChunkOfRow(void *taskPointer, int chunkZ)
+{
+  BenchmarkMeshingTask *task = (BenchmarkMeshingTask *)taskPointer;
+  Benchmark_meshChunk(task->jobs, task->index * task->jobs->chunkCountZ +
+    chunkZ);
+}
+
+//Builds the meshes of a row of chunks with a nested parallel for.
+//jobsPointer: A pointer to the BenchmarkMeshingJobs.
+//row: The index of the row.
+void Benchmark_meshChunkRow(void *jobsPointer, int row)
+{
+  BenchmarkMeshingTask task;
+  task.jobs = (BenchmarkMeshingJobs *)jobsPointer;
+  task.index = row;
+  WorkerPool_parallelFor(task.jobs->pool, task.jobs->chunkCountZ,
+    Benchmark_meshChunkOfRow, &task);
+}
+
+//Builds the mesh of a chunk as a task of the dependency graph.
+//taskPointer: A pointer to the BenchmarkMeshingTask of the chunk.
+void Benchmark_runMeshChunkTask(void *taskPointer)
+{
+  BenchmarkMeshingTask *task = (BenchmarkMeshingTask *)taskPointer;
+  Benchmark_meshChunk(task->jobs, task->index);
+}
+
+//Sums up the vertex data of a row of chunks after all of them were meshed.
+//taskPointer: A pointer to the BenchmarkMeshingTask of the row.
+void Benchmark_runSumRowTask(void *taskPointer)
+{
+  BenchmarkMeshingTask *task = (BenchmarkMeshingTask *)taskPointer;
+  int64_t length = 0;
+  for (int i = 0; i < task->jobs->chunkCountZ; i++)
+    length += task->jobs->lengths[task->index * task->jobs->chunkCountZ + i];
+  task->jobs->rowLengths[task->index] = length;
+}
+
+//An empty task for measuring the overhead of the job system.
+//data: Unused.
+void Benchmark_runEmptyTask(void *data)
+{
+  data;
+}
+
+//Measures the job system of the worker pool by meshing all chunks of the map
+//in different ways: on one thread, with a parallel for, with nested parallel
+//fors (rows of chunks, which mesh their chunks in parallel again) and as a
+//dependency graph (every row is summed up after all of its chunks were
+//meshed). Fails if any of them gets a different result than the first one.
+//Afterwards, the overhead per task is measured with empty tasks.
+//pool: The worker pool.
+void Benchmark_jobSystem(WorkerPool *pool)
+{
+  const int emptyTaskCount = 100000;
+  BenchmarkMeshingJobs jobs;
+  jobs.pool = pool;
+  jobs.chunkCountX = (mapWidth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  jobs.chunkCountZ = (mapDepth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  int rowCount = jobs.chunkCountX * mapLevels;
+  int chunkCount = rowCount * jobs.chunkCountZ;
+  jobs.lengths = (int *)Common_allocate(sizeof(int) * chunkCount);
+  jobs.rowLengths = (int64_t *)Common_allocate(sizeof(int64_t) * rowCount);
+  jobs.rowCounters = (WorkerPoolCounter *)Common_allocate(
+    sizeof(WorkerPoolCounter) * rowCount);
+  int *expectedLengths = (int *)Common_allocate(sizeof(int) * chunkCount);
+  BenchmarkMeshingTask *tasks = (BenchmarkMeshingTask *)Common_allocate(
+    sizeof(BenchmarkMeshingTask) * (chunkCount + rowCount));
+  double seconds[4];
+  const char *methodNames[4] = { "one thread", "parallel for",
+    "nested parallel for", "dependency graph" };
+
+  for (int method = 0; method < 4; method++)
+  {
+    memset(jobs.lengths, 0, sizeof(int) * chunkCount);
+    WorkerPool_getStatistics(pool, NULL, true);
+    double startTime = Common_getTimeSeconds();
+
+    if (method == 0)
+      for (int i = 0; i < chunkCount; i++) Benchmark_meshChunk(&jobs, i);
+    else if (method == 1)
+      WorkerPool_parallelFor(pool, chunkCount, Benchmark_meshChunk, &jobs);
+    else if (method == 2)
+      WorkerPool_parallelFor(pool, rowCount, Benchmark_meshChunkRow, &jobs);
+    else
+    {
+      WorkerPoolCounter rowsSummed;
+      WorkerPoolCounter_initialize(&rowsSummed);
+      for (int row = 0; row < rowCount; row++)
+      {
+        WorkerPoolCounter_initialize(&jobs.rowCounters[row]);
+        for (int i = 0; i < jobs.chunkCountZ; i++)
+        {
+          BenchmarkMeshingTask *task = &tasks[row * jobs.chunkCountZ + i];
+          task->jobs = &jobs;
+          task->index = row * jobs.chunkCountZ + i;
+          WorkerPool_submitCounted(pool, Benchmark_runMeshChunkTask, task,
+            &jobs.rowCounters[row]);
+        }
+
+        BenchmarkMeshingTask *rowTask = &tasks[chunkCount + row];
+        rowTask->jobs = &jobs;
+        rowTask->index = row;
+        WorkerPool_submitAfter(pool, &jobs.rowCounters[row],
+          Benchmark_runSumRowTask, rowTask, &rowsSummed);
+      }
+      WorkerPool_wait(pool, &rowsSummed);
+    }
+
+    seconds[method] = Common_getTimeSeconds() - startTime;
+
+    if (method == 0)
+      memcpy(expectedLengths, jobs.lengths, sizeof(int) * chunkCount);
+    else if (memcmp(expectedLengths, jobs.lengths, sizeof(int) * chunkCount))
+      Common_terminate("BENCHMARK", "A chunk wasn't meshed correctly.");
+    if (method == 3)
+    {
+      for (int row = 0; row < rowCount; row++)
+      {
+        int64_t expectedLength = 0;
+        for (int i = 0; i < jobs.chunkCountZ; i++)
+          expectedLength += expectedLengths[row * jobs.chunkCountZ + i];
+        if (jobs.rowLengths[row] != expectedLength)
+          Common_terminate("BENCHMARK", "A row wasn't summed up correctly.");
+      }
+    }
+
+    printf("Meshing %d chunks (%s): %.3f ms.\n", chunkCount,
+      methodNames[method], seconds[method] * 1000.0);
+    if (method > 0) WorkerPool_printStatistics(pool);
+  }
+
+  WorkerPoolCounter emptyTasksFinished;
+  WorkerPoolCounter_initialize(&emptyTasksFinished);
+  double startTime = Common_getTimeSeconds();
+  for (int i = 0; i < emptyTaskCount; i++)
+    WorkerPool_submitCounted(pool, Benchmark_runEmptyTask, NULL,
+      &emptyTasksFinished);
+  WorkerPool_wait(pool, &emptyTasksFinished);
+  double emptySeconds = Common_getTimeSeconds() - startTime;
+  printf("Overhead: %.3f us per task (%d empty tasks with %d threads).\n",
+    emptySeconds * 1000000.0 / emptyTaskCount, emptyTaskCount,
+    pool->threadCount + 1);
+
+  free(jobs.lengths);
+  free(jobs.rowLengths);
+  free(jobs.rowCounters);
+  free(expectedLengths);
+  free(tasks);
+}
+
+//Contains the state of the thread which records the render packets in the 
+//"render-pipeline" benchmark.
+typedef struct
+{
+  RenderQueue *queue;
+  int frameCount;
+  uint32_t randomState;
+} BenchmarkRenderProducer;
+
+//Records and publishes render packets like the simulation, but spends a
+//random time between 1 and 7 ms on every packet instead of updating a game.
+//producerPointer: A pointer to the BenchmarkRenderProducer.
+void Benchmark_produceRenderPackets(void *producerPointer)
+{
+  BenchmarkRenderProducer *producer =
+    (BenchmarkRenderProducer *)producerPointer;
+
+  for (int i = 0; i < producer->frameCount; i++)
+  {
+    RenderPacket *packet = RenderQueue_beginRecording(producer->queue);
+    if (packet == NULL) break;
+
+    producer->randomState ^= producer->randomState << 13;
+    producer->randomState ^= producer->randomState >> 17;
+    producer->randomState ^= producer->randomState << 5;
+    Thread_sleep((1 + producer->randomState % 7) / 1000.0);
+    RenderPacket_addCommand(packet, RenderDrawWorld, NULL, NULL, 0);
+
+    RenderQueue_publish(producer->queue, packet);
+  }
+}
+
+//Measures the latency added by the render queue in both modes: a thread
+//records packets in 4 ms on average (see "Benchmark_produceRenderPackets"),
+//while the calling thread "draws" every packet in 5 ms. Fails if a packet is
+//drawn out of order, if a packet is neither drawn nor dropped or if the 
+//throughput mode drops a packet.
+//pool: The worker pool (unused).
+void Benchmark_renderPipeline(WorkerPool *pool)
+{
+  pool;
+
+  const int frameCount = 200;
+  const double drawSeconds = 0.005;
+
+  for (int mode = RenderLatencyMode; mode <= RenderThroughputMode; mode++)
+  {
+    RenderQueue queue;
+    RenderQueue_initialize(&queue, (RenderMode)mode, 0);
+
+    BenchmarkRenderProducer producer;
+    producer.queue = &queue;
+    producer.frameCount = frameCount;
+    producer.randomState = 1;
+
+    double startTime = Common_getTimeSeconds();
+    Thread producerThread = Thread_create(Benchmark_produceRenderPackets,
+      &producer);
+
+    //The last packet is never dropped, so every run ends with drawing it.
+    int lastFrameNumber = -1;
+    while (lastFrameNumber < frameCount - 1)
+    {
+      if (!RenderQueue_hasPacket(&queue))
+      {
+        Thread_sleep(0.0005);
+        continue;
+      }
+
+      const RenderPacket *packet = RenderQueue_acquire(&queue);
+      if ((int)packet->frameNumber <= lastFrameNumber ||
+        (mode == RenderThroughputMode &&
+          (int)packet->frameNumber != lastFrameNumber + 1) ||
+        packet->commandCount != 1)
+        Common_terminate("BENCHMARK", "A render packet was drawn out of "
+          "order.");
+      lastFrameNumber = (int)packet->frameNumber;
+
+      Thread_sleep(drawSeconds);
+      RenderQueue_present(&queue, packet);
+    }
+
+    Thread_join(&producerThread);
+    double seconds = Common_getTimeSeconds() - startTime;
+
+    if (queue.presentedCount + queue.droppedCount != queue.publishedCount ||
+      (mode == RenderThroughputMode && queue.droppedCount > 0))
+      Common_terminate("BENCHMARK", "A render packet was lost.");
+
+    printf("%d frames in %.3f s (%.1f frames per second presented).\n",
+      frameCount, seconds, queue.presentedCount / seconds);
+    RenderQueue_printStatistics(&queue);
+    RenderQueue_destroy(&queue);
+  }
+}
+
+//Provides a benchmark which can be run with the "--benchmark" option.
+typedef struct
+{
+  const char *name;
+  const char *description;
+  void (*function)(WorkerPool *pool);
+} Benchmark;
+
+//All available benchmarks. They run on the map specified with the options
+//(or on a generated maze of BENCHMARK_MAZE_SIZE).
+Benchmark benchmarks[] =
+{
+  { "chunk-codec", "compression ratio and throughput of the chunk encoding",
+    Benchmark_chunkCodec },
+  { "lift-shafts", "validation of map files with lift shafts (a test)",
+    Benchmark_liftShafts },
+  { "distance-field", "distance field calculation, queries and updates",
+    Benchmark_distanceField },
+  { "pathfinding", "A* and hierarchical pathfinding on random queries",
+    Benchmark_pathfinding },
+  { "swept-collision", "high-speed movements through all walls (a test)",
+    Benchmark_sweptCollision },
+  { "line-of-sight", "batched line-of-sight tests (a test)",
+    Benchmark_lineOfSight },
+  { "sessions", "stepping batches of game sessions without a window",
+    Benchmark_sessions },
+  { "lockstep", "fixed-point sessions compared to float sessions (a test)",
+    Benchmark_lockstep },
+  { "lidar", "rays cast around the players of many sessions (a test)",
+    Benchmark_lidar },
+  { "autopilot", "bots playing laps with the autopilot (a test)",
+    Benchmark_autopilot },
+  { "server", "bots playing on a server over the loopback interface (a "
+    "test)", Benchmark_server },
+  { "snapshots", "complete and delta-encoded snapshots for 500 bots (a "
+    "test)", Benchmark_snapshots },
+  { "interest", "players replicated to 1000 bots with and without interest "
+    "management (a test)", Benchmark_interest },
+  { "prediction", "bots predicting their sessions on a server with latency "
+    "(a test)", Benchmark_prediction },
+  { "load", "tick times, traffic and input latency of a server with more "
+    "and more bots", Benchmark_load },
+  { "npcs", "updates of 100000 maze dwellers", Benchmark_npcs },
+  { "crowd", "local avoidance of 16384 maze dwellers in corridors",
+    Benchmark_crowd },
+  { "spatial-hash", "rebuilding the spatial hash compared to moving entities",
+    Benchmark_spatialHash },
+  { "job-system", "meshing all chunks with the job system of the worker pool",
+    Benchmark_jobSystem },
+  { "render-pipeline", "latency of the render queue in both modes (a test)",
+    Benchmark_renderPipeline }
+};
+
+//=============================================================================
+// Main function.
+//=============================================================================
+
+//The size of the maze to generate (or 0 to use the built-in map).
+int mazeWidth = 0, mazeDepth = 0;
+//The path of the map file to load instead (or NULL).
+const char *mapFilePath = NULL;
+//true to only validate maps (without opening a window) and exit.
+bool validationMode = false;
+//The amount of mazes (with consecutive seeds) to generate and validate.
+int validationCount = 1;
+//The path of the file to save the map into before exiting (or NULL).
+const char *saveMapFilePath = NULL;
+//false to store the fields of saved maps in 4 bits without compression.
+bool compressMapFile = true;
+//The name of the benchmark to run before exiting (or NULL).
+const char *benchmarkName = NULL;
+//The amount of bots whose views are rendered before exiting (or 0).
+int renderViewCount = 0;
+//true to run a dedicated server instead of the game (see "Server").
+bool serverMode = false;
+//The time (in seconds) the server runs before exiting (or 0 to run until
+//the application is closed).
+double serverDuration = 0;
+
+//Parses the command line options of the application. Unknown options are 
+//ignored, as they might be meant for GLUT.
+//Terminates the application if the value of an option is missing or invalid.
+void Main_parseOptions(int argc, char **argv)
+{
+  //Unless a seed is specified, every generated maze is different.
+  mapSeed = (uint32_t)time(NULL);
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--endless") == 0) endlessMode = true;
+    else if (strcmp(argv[i], "--stress-walls") == 0)
+    {
+      if (i + 1 >= argc || (stressWallCount = atoi(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--stress-walls\" requires "
+          "a positive number as value.");
+    }
+    else if (strcmp(argv[i], "--seed") == 0)
+    {
+      char *end = NULL;
+      if (i + 1 >= argc) Common_terminate("STARTUP",
+        "The option \"--seed\" requires a number as value.");
+      mapSeed = (uint32_t)strtoul(argv[++i], &end, 10);
+      if (end == argv[i] || *end != '\0') Common_terminate("STARTUP",
+        "The option \"--seed\" requires a number as value.");
+    }
+    else if (strcmp(argv[i], "--maze") == 0)
+    {
+      if (i + 1 >= argc || sscanf(argv[++i], "%dx%d", &mazeWidth,
+        &mazeDepth) != 2 || mazeWidth <= 0 || mazeDepth <= 0)
+        Common_terminate("STARTUP", "The option \"--maze\" requires a size "
+          "(like \"64x64\") as value.");
+    }
+    else if (strcmp(argv[i], "--validate") == 0) validationMode = true;
+    else if (strcmp(argv[i], "--count") == 0)
+    {
+      if (i + 1 >= argc || (validationCount = atoi(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--count\" requires a "
+          "positive number as value.");
+    }
+    else if (strcmp(argv[i], "--load-map") == 0 ||
+      strcmp(argv[i], "--save-map") == 0 ||
+      strcmp(argv[i], "--benchmark") == 0)
+    {
+      if (i + 1 >= argc) Common_terminate("STARTUP", "The options "
+        "\"--load-map\", \"--save-map\" and \"--benchmark\" require a "
+        "value.");
+      if (strcmp(argv[i], "--load-map") == 0) mapFilePath = argv[++i];
+      else if (strcmp(argv[i], "--save-map") == 0) saveMapFilePath = argv[++i];
+      else benchmarkName = argv[++i];
+    }
+    else if (strcmp(argv[i], "--raw") == 0) compressMapFile = false;
+    else if (strcmp(argv[i], "--npcs") == 0)
+    {
+      if (i + 1 >= argc || (npcCount = atoi(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--npcs\" requires a "
+          "positive number as value.");
+    }
+    else if (strcmp(argv[i], "--render-views") == 0)
+    {
+      if (i + 1 >= argc || (renderViewCount = atoi(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--render-views\" requires "
+          "a positive number as value.");
+    }
+    else if (strcmp(argv[i], "--render-mode") == 0)
+    {
+      const char *modeName = i + 1 < argc ? argv[++i] : "";
+      useSimulationThread = strcmp(modeName, "synchronous") != 0;
+      if (strcmp(modeName, "latency") == 0 ||
+        strcmp(modeName, "synchronous") == 0) renderMode = RenderLatencyMode;
+      else if (strcmp(modeName, "throughput") == 0)
+        renderMode = RenderThroughputMode;
+      else Common_terminate("STARTUP", "The option \"--render-mode\" "
+        "requires \"latency\", \"throughput\" or \"synchronous\" as "
+        "value.");
+    }
+    else if (strcmp(argv[i], "--server") == 0) serverMode = true;
+    else if (strcmp(argv[i], "--port") == 0)
+    {
+      if (i + 1 >= argc || (serverPort = atoi(argv[++i])) <= 0 ||
+        serverPort > 65535) Common_terminate("STARTUP", "The option "
+        "\"--port\" requires a number between 1 and 65535 as value.");
+    }
+    else if (strcmp(argv[i], "--tick-rate") == 0)
+    {
+      if (i + 1 >= argc || (serverTickRate = atoi(argv[++i])) <= 0 ||
+        serverTickRate > 1000) Common_terminate("STARTUP", "The option "
+        "\"--tick-rate\" requires a number between 1 and 1000 as value.");
+    }
+    else if (strcmp(argv[i], "--connect") == 0)
+    {
+      unsigned int a = 0, b = 0, c = 0, d = 0, port = NET_DEFAULT_PORT;
+      if (i + 1 >= argc || sscanf(argv[++i], "%u.%u.%u.%u:%u", &a, &b, &c,
+        &d, &port) < 4 || a > 255 || b > 255 || c > 255 || d > 255 ||
+        port == 0 || port > 65535) Common_terminate("STARTUP", "The option "
+        "\"--connect\" requires an IPv4 address (optionally followed by a "
+        "colon and the port) as value.");
+      connectAddress = NetAddress_create((a << 24) | (b << 16) | (c << 8) | d,
+        (uint16_t)port);
+    }
+    else if (strcmp(argv[i], "--interest") == 0)
+    {
+      const char *modeName = i + 1 < argc ? argv[++i] : "";
+      if (strcmp(modeName, "all") == 0) serverInterestMode = InterestAll;
+      else if (strcmp(modeName, "distance") == 0)
+        serverInterestMode = InterestDistance;
+      else if (strcmp(modeName, "visibility") == 0)
+        serverInterestMode = InterestVisibility;
+      else Common_terminate("STARTUP", "The option \"--interest\" requires "
+        "\"all\", \"distance\" or \"visibility\" as value.");
+    }
+    else if (strcmp(argv[i], "--bots") == 0)
+    {
+      if (i + 1 >= argc || (loadTestBotCount = atoi(argv[++i])) <= 0 ||
+        loadTestBotCount > 65535) Common_terminate("STARTUP", "The option "
+        "\"--bots\" requires a number between 1 and 65535 as value.");
+    }
+    else if (strcmp(argv[i], "--csv") == 0)
+    {
+      if (i + 1 >= argc) Common_terminate("STARTUP", "The option \"--csv\" "
+        "requires a file path as value.");
+      loadTestCsvPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--duration") == 0)
+    {
+      if (i + 1 >= argc || (serverDuration = atof(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--duration\" requires a "
+          "positive number of seconds as value.");
+    }
+    else if (strcmp(argv[i], "--autopilot") == 0) autopilotMode = true;
+    else if (strcmp(argv[i], "--restart") == 0) restartMode = true;
+    else if (strcmp(argv[i], "--levels") == 0)
+    {
+      if (i + 1 >= argc || (mapLevels = atoi(argv[++i])) <= 0)
+        Common_terminate("STARTUP", "The option \"--levels\" requires a "
+          "positive number as value.");
+    }
+  }
+}
+
+//Loads the map file or generates the maze requested with the options (if 
+//any), so that the map is complete before the game is loaded - in the endless
+//mode, the maze is generated while playing instead. Otherwise, the map stays
+//NULL and the built-in map is used.
+//pool: The worker pool used to decode map files.
+void Main_prepareMap(WorkerPool *pool)
+{
+  double startTime = Common_getTimeSeconds();
+
+  if (endlessMode) return;
+  else if (mapFilePath != NULL)
+  {
+    map = MapFile_load(mapFilePath, &mapWidth, &mapDepth, &mapLevels, pool);
+    printf("Loaded a %dx%d map with %d levels from \"%s\" in %.3f ms.\n",
+      mapWidth, mapDepth, mapLevels, mapFilePath,
+      (Common_getTimeSeconds() - startTime) * 1000.0);
+  }
+  else if (mazeWidth > 0)
+  {
+    int width = mazeWidth, depth = mazeDepth;
+    map = Maze_generateMap(mapSeed, &width, &depth, mapLevels);
+    mapWidth = width;
+    mapDepth = depth;
+    printf("Generated a %dx%d maze with %d levels (seed %u) in %.3f ms.\n",
+      mapWidth, mapDepth, mapLevels, mapSeed,
+      (Common_getTimeSeconds() - startTime) * 1000.0);
+  }
+}
+
+//Uses the built-in map if no other map was prepared with "Main_prepareMap".
+void Main_useDefaultMapIfEmpty(void)
+{
+  if (map != NULL) return;
+  map = defaultMap;
+  mapWidth = defaultMapWidth;
+  mapDepth = defaultMapDepth;
+  mapLevels = 1;
+}
+
+//Releases the current map (unless it's the built-in map).
+void Main_releaseMap(void)
+{
+  if (map != defaultMap) free(map);
+  map = NULL;
+}
+
+//Validates the built-in map or a number of generated mazes (with consecutive
+//seeds) without opening a window.
+//Returns the exit code of the application: 0 if all maps are valid.
+int Main_validateMaps(void)
+{
+  WorkerPool pool;
+  int invalidCount = 0;
+
+  //Only generated mazes differ from each other (by their seed).
+  int mapCount = mapFilePath == NULL && mazeWidth > 0 ? validationCount : 1;
+  if (endlessMode) Common_terminate("VALIDATION",
+    "Endless mazes can't be validated.");
+
+  WorkerPool_initialize(&pool, Common_getProcessorCount() - 1);
+
+  for (int i = 0; i < mapCount; i++)
+  {
+    Main_prepareMap(&pool);
+    Main_useDefaultMapIfEmpty();
+
+    MapAnalysis analysis = Analysis_analyzeMap(map, mapWidth, mapDepth,
+      mapLevels, &pool);
+    Analysis_print(&analysis);
+    if (!Analysis_isValid(&analysis)) invalidCount++;
+
+    Main_releaseMap();
+    mapSeed++;
+  }
+
+  WorkerPool_destroy(&pool);
+
+  printf("%d of %d maps are valid.\n", mapCount - invalidCount, mapCount);
+  return invalidCount == 0 ? 0 : 1;
+}
+
+//Saves the built-in map, the loaded map file or the generated maze into the 
+//file specified with the "--save-map" option.
+//Returns the exit code of the application.
+int Main_saveMap(void)
+{
+  WorkerPool pool;
+
+  if (endlessMode) Common_terminate("SAVING",
+    "Endless mazes can't be saved.");
+
+  WorkerPool_initialize(&pool, Common_getProcessorCount() - 1);
+  Main_prepareMap(&pool);
+  Main_useDefaultMapIfEmpty();
+  WorkerPool_destroy(&pool);
+
+  size_t fileSize = MapFile_save(saveMapFilePath, map, mapWidth, mapDepth,
+    mapLevels, compressMapFile);
+  printf("Saved the map into \"%s\" (%llu bytes, %.2f bits per field).\n",
+    saveMapFilePath, (unsigned long long)fileSize,
+    fileSize * 8.0 / ((double)mapWidth * mapDepth * mapLevels));
+
+  Main_releaseMap();
+  return 0;
+}
+
+//Runs the benchmark specified with the "--benchmark" option on the map
+//specified with the options or a generated maze of BENCHMARK_MAZE_SIZE.
+//Returns the exit code of the application: 1 if the benchmark doesn't exist.
+int Main_runBenchmark(void)
+{
+  const Benchmark *benchmark = NULL;
+  WorkerPool pool;
+
+  for (int i = 0; i < (int)LENGTHOF(benchmarks); i++)
+    if (strcmp(benchmarks[i].name, benchmarkName) == 0)
+      benchmark = &benchmarks[i];
+
+  if (benchmark == NULL)
+  {
+    printf("Unknown benchmark \"%s\". Available benchmarks:\n",
+      benchmarkName);
+    for (int i = 0; i < (int)LENGTHOF(benchmarks); i++)
+      printf("  %s: %s\n", benchmarks[i].name, benchmarks[i].description);
+    return 1;
+  }
+
+  if (endlessMode) Common_terminate("BENCHMARK",
+    "Benchmarks can't be run in endless mazes.");
+  if (mapFilePath == NULL && mazeWidth <= 0)
+  {
+    mazeWidth = BENCHMARK_MAZE_SIZE;
+    mazeDepth = BENCHMARK_MAZE_SIZE;
+  }
+
+  WorkerPool_initialize(&pool, Common_getProcessorCount() - 1);
+  Main_prepareMap(&pool);
+
+  printf("Running benchmark \"%s\" with %d worker threads...\n",
+    benchmark->name, pool.threadCount);
+  benchmark->function(&pool);
+
+  WorkerPool_destroy(&pool);
+  Main_releaseMap();
+  return 0;
+}
+
+//Runs a dedicated server (see "--server") for the map specified with the
+//options, without opening a window - until the application is closed or
+//for the time given with "--duration".
+//Returns the exit code of the application.
+int Main_runServer(void)
+{
+  WorkerPool pool;
+  Server server;
+
+  if (endlessMode) Common_terminate("SERVER",
+    "The server can't be used in endless mazes.");
+
+  WorkerPool_initialize(&pool, Common_getProcessorCount() - 1);
+  Main_prepareMap(&pool);
+  Main_useDefaultMapIfEmpty();
+
+  MapAnalysis analysis = Analysis_analyzeMap(map, mapWidth, mapDepth,
+    mapLevels, &pool);
+  Analysis_print(&analysis);
+  if (!Analysis_isValid(&analysis)) Common_terminate("SERVER",
+    "The map can't be completed - see the map analysis above.");
+  Collision_initialize();
+  Pickup_initialize();
+
+  Server_initialize(&server, NET_ANY_HOST, (uint16_t)serverPort,
+    SERVER_MAX_CLIENTS, serverTickRate, serverInterestMode);
+  printf("Server: listening on port %d with %d ticks per second for up to "
+    "%d clients...\n", serverPort, serverTickRate, SERVER_MAX_CLIENTS);
+  fflush(stdout);
+  Server_run(&server, &pool, serverDuration);
+
+  Server_destroy(&server);
+  Pickup_destroy();
+  Collision_destroy();
+  WorkerPool_destroy(&pool);
+  Main_releaseMap();
+  return 0;
+}
+
+//Renders the views of the bots requested with "--render-views" and exits.
+//GLUT still needs a display for the (hidden) window - on machines without
+//one, a virtual framebuffer X server can be used.
+//argc, argv: The command line arguments (for GLUT).
+//Returns the exit code of the application.
+int Main_renderViews(int *argc, char **argv)
+{
+  WorkerPool loadingPool;
+  WorkerPool_initialize(&loadingPool, Common_getProcessorCount() - 1);
+  Main_prepareMap(&loadingPool);
+  WorkerPool_destroy(&loadingPool);
+
+  glutInit(argc, argv);
+  glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+  glutInitContextVersion(2, 0);
+  glutInitWindowSize(VIEW_SIZE, VIEW_SIZE);
+  glutCreateWindow("OpenGL window");
+  glutHideWindow();
+  glewInit();
+
+  //The views are drawn right here instead of in the main loop, so there's
+  //no simulation thread.
+  useSimulationThread = false;
+  Game_onLoad();
+  Game_renderViews(renderViewCount);
+  Game_onDestroy();
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  Main_parseOptions(argc, argv);
+  if (validationMode) return Main_validateMaps();
+  if (saveMapFilePath != NULL) return Main_saveMap();
+  if (benchmarkName != NULL) return Main_runBenchmark();
+  if (renderViewCount > 0) return Main_renderViews(&argc, argv);
+  if (serverMode) return Main_runServer();
+  if (connectAddress.port != 0 && endlessMode) Common_terminate("STARTUP",
+    "Servers can't be used in endless mazes.");
+  if (autopilotMode && endlessMode) Common_terminate("STARTUP",
+    "The autopilot can't be used in endless mazes.");
+
+  WorkerPool loadingPool;
+  WorkerPool_initialize(&loadingPool, Common_getProcessorCount() - 1);
+  Main_prepareMap(&loadingPool);
+  WorkerPool_destroy(&loadingPool);
+
+  printf("** GemQuest **\n");
+  printf("Find the magic gem and yeet it into the GemContainer(TM)!\n");
+  printf("Move: WASD, Jump: Space, Interact: E, Look: Mouse, Exit: ESC.\n");
+  printf("Hint: If you can't move, click once with your left mouse button.\n");
+  printf("Options: --endless (endless maze), --maze <width>x<depth> "
+    "(generated maze), --levels <number>, --seed <number>, "
+    "--stress-walls <walls toggled per update>, --validate (check the map "
+    "and exit), --count <mazes to validate>, --load-map <file>, "
+    "--save-map <file> (save the map and exit), --raw (don't compress saved "
+    "maps), --benchmark <name>, --npcs <maze dwellers>, --render-mode "
+    "<latency|throughput|synchronous>, --render-views <bots> (render the "
+    "views of bots offscreen and exit), --autopilot (let a bot play), "
+    "--restart (restart finished games and print statistics of every "
+    "lap), --server (run a dedicated server without a window), --port "
+    "<number>, --tick-rate <ticks per second>, --interest "
+    "<all|distance|visibility>, --duration <seconds>, --connect "
+    "<address>[:<port>] (play on a server), --bots <count> and --csv "
+    "<file> (for the load benchmark).\n");
+
+  //The autopilot runs unattended, so it doesn't ask for the window mode.
+  int c = 'w';
+  if (!autopilotMode)
+  {
+    printf("Run game in fullscreen ('f') or window ('w'): ");
+    c = getchar();
+  }
 
   glutInit(&argc, argv);
 
@@ -2293,6 +16511,8 @@ int main(int argc, char **argv)
   glutKeyboardUpFunc(Game_onKeyboardUp);
   glutPassiveMotionFunc(Game_onMouseMove);
   glutTimerFunc(UPDATE_TIMEOUT_MS, Game_onUpdate, 0);
+  if (useSimulationThread)
+    simulationThread = Thread_create(Game_runSimulation, NULL);
 
   glutMainLoop();
 